@@ -0,0 +1,313 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "device_channel.h"
+
+//==============================================================================
+// Multi-Device Aggregator
+//==============================================================================
+//
+// Drives several N-back units from one event loop. Each unit gets its own
+// command queue, clock sync state and per-session output files under
+// OUT/<name>/; no unit can block another.
+//
+//   nback-aggregator --out DIR --device NAME=PATH [--device NAME=PATH]...
+//                    [--control FIFO] [--sync-interval S] [--fsync-interval MS]
+//
+// Commands are read from stdin (or the --control FIFO), one per line:
+//
+//   <name> <command>   queue a command for one unit, e.g. "bench2 start"
+//   * <command>        queue it for every unit
+//   status             print one line per unit
+//   quit               flush all files and exit
+
+using namespace host;
+
+// Bytes read from one unit per wakeup, so a unit dumping its data cannot
+// starve the others
+static const size_t READ_BUDGET = 4096;
+
+// Bytes written to one unit's files per loop pass (whole blocks)
+static const size_t WRITE_BUDGET = 64 << 10;
+
+static const uint64_t RECONNECT_INTERVAL_US = 1000000;
+
+static volatile sig_atomic_t stopRequested = 0;
+
+static void onSignal(int)
+{
+    stopRequested = 1;
+}
+
+struct Slot
+{
+    std::unique_ptr<DeviceChannel> channel;
+    uint32_t events; // Epoll interest currently registered (0 = not registered)
+};
+
+static void updateInterest(int epollFd, Slot &slot, size_t index)
+{
+    DeviceChannel &channel = *slot.channel;
+    uint32_t wanted = 0;
+    if (channel.isOpen())
+    {
+        wanted = EPOLLRDHUP;
+        if (channel.wantsRead())
+        {
+            wanted |= EPOLLIN;
+        }
+        if (channel.wantsWrite())
+        {
+            wanted |= EPOLLOUT;
+        }
+    }
+    if (wanted == slot.events)
+    {
+        return;
+    }
+
+    struct epoll_event ev;
+    ev.events = wanted;
+    ev.data.u64 = index;
+    if (slot.events == 0)
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, channel.getFd(), &ev);
+    else if (wanted == 0)
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, channel.getFd(), &ev);
+    else
+        epoll_ctl(epollFd, EPOLL_CTL_MOD, channel.getFd(), &ev);
+    slot.events = wanted;
+}
+
+static void disconnect(int epollFd, Slot &slot)
+{
+    if (slot.events != 0)
+    {
+        struct epoll_event ev = {};
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, slot.channel->getFd(), &ev);
+        slot.events = 0;
+    }
+    slot.channel->close();
+    fprintf(stderr, "nback-aggregator: %s disconnected\n", slot.channel->getName().c_str());
+}
+
+static void printStatus(const std::vector<Slot> &slots)
+{
+    uint64_t now = monotonicMicros();
+    for (const Slot &slot : slots)
+    {
+        const DeviceChannel &c = *slot.channel;
+        const ChannelStats &s = c.getStats();
+        const TimeSync &sync = c.getTimeSync();
+        printf("%-12s %-6s session=%-16s bytes=%llu events=%llu sessions=%llu queued=%zu backlog=%zu%s "
+               "sync=%u rtt_us=%llu age_s=%.1f\n",
+               c.getName().c_str(), c.isOpen() ? "open" : "closed",
+               c.getCurrentSession().empty() ? "-" : c.getCurrentSession().c_str(),
+               (unsigned long long)s.bytesIn, (unsigned long long)s.events, (unsigned long long)s.sessions,
+               c.queuedCommands(), c.backlog(), c.isPaused() ? " PAUSED" : "", sync.count,
+               (unsigned long long)sync.rttMicros, sync.count ? (now - sync.hostMicros) / 1e6 : 0.0);
+    }
+    fflush(stdout);
+}
+
+// Returns false on "quit"
+static bool handleControlLine(const std::string &line, std::vector<Slot> &slots)
+{
+    if (line.empty())
+    {
+        return true;
+    }
+    if (line == "quit")
+    {
+        return false;
+    }
+    if (line == "status")
+    {
+        printStatus(slots);
+        return true;
+    }
+
+    size_t space = line.find(' ');
+    std::string target = line.substr(0, space);
+    std::string command = space == std::string::npos ? "" : line.substr(space + 1);
+    bool matched = false;
+    for (Slot &slot : slots)
+    {
+        if (!command.empty() && (target == "*" || target == slot.channel->getName()))
+        {
+            slot.channel->enqueue(command);
+            matched = true;
+        }
+    }
+    if (!matched)
+    {
+        fprintf(stderr, "nback-aggregator: expected '<name|*> <command>', 'status' or 'quit'\n");
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    std::string outputDir;
+    std::string controlPath;
+    double syncInterval = 0;
+    uint64_t fsyncIntervalMs = WriteBehindLog::DEFAULT_SYNC_INTERVAL_US / 1000;
+    std::vector<std::pair<std::string, std::string>> devices;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--out" && hasValue)
+            outputDir = argv[++i];
+        else if (arg == "--control" && hasValue)
+            controlPath = argv[++i];
+        else if (arg == "--sync-interval" && hasValue)
+            syncInterval = atof(argv[++i]);
+        else if (arg == "--fsync-interval" && hasValue)
+            fsyncIntervalMs = strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--device" && hasValue && strchr(argv[i + 1], '='))
+        {
+            std::string spec = argv[++i];
+            devices.push_back({spec.substr(0, spec.find('=')), spec.substr(spec.find('=') + 1)});
+        }
+        else
+        {
+            devices.clear();
+            break;
+        }
+    }
+    if (outputDir.empty() || devices.empty())
+    {
+        fprintf(stderr, "usage: nback-aggregator --out DIR --device NAME=PATH [--device NAME=PATH]...\n"
+                        "                        [--control FIFO] [--sync-interval S] [--fsync-interval MS]\n");
+        return 2;
+    }
+
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+    signal(SIGPIPE, SIG_IGN);
+
+    int epollFd = epoll_create1(0);
+    if (epollFd < 0)
+    {
+        perror("nback-aggregator: epoll_create1");
+        return 1;
+    }
+
+    // Control input; a FIFO is also held open for writing so it never reports EOF
+    int controlFd = STDIN_FILENO;
+    if (!controlPath.empty())
+    {
+        mkfifo(controlPath.c_str(), 0600);
+        controlFd = open(controlPath.c_str(), O_RDONLY | O_NONBLOCK);
+        if (controlFd < 0 || open(controlPath.c_str(), O_WRONLY) < 0)
+        {
+            perror("nback-aggregator: control FIFO");
+            return 1;
+        }
+    }
+    fcntl(controlFd, F_SETFL, fcntl(controlFd, F_GETFL) | O_NONBLOCK);
+    const uint64_t CONTROL_TAG = UINT64_MAX;
+    struct epoll_event controlEvent;
+    controlEvent.events = EPOLLIN;
+    controlEvent.data.u64 = CONTROL_TAG;
+    bool controlOpen = epoll_ctl(epollFd, EPOLL_CTL_ADD, controlFd, &controlEvent) == 0;
+
+    std::vector<Slot> slots;
+    for (const std::pair<std::string, std::string> &device : devices)
+    {
+        Slot slot;
+        slot.channel.reset(new DeviceChannel(device.first, device.second, outputDir, fsyncIntervalMs * 1000));
+        slot.events = 0;
+        slots.push_back(std::move(slot));
+    }
+
+    std::string controlLine;
+    uint64_t lastReconnect = 0;
+    uint64_t lastSync = monotonicMicros();
+    bool running = true;
+
+    while (running && !stopRequested)
+    {
+        uint64_t now = monotonicMicros();
+
+        // (Re)open ports that are not connected yet
+        if (now - lastReconnect >= RECONNECT_INTERVAL_US)
+        {
+            lastReconnect = now;
+            for (Slot &slot : slots)
+            {
+                if (!slot.channel->isOpen() && slot.channel->open())
+                {
+                    fprintf(stderr, "nback-aggregator: %s connected\n", slot.channel->getName().c_str());
+                }
+            }
+        }
+
+        if (syncInterval > 0 && now - lastSync >= (uint64_t)(syncInterval * 1e6))
+        {
+            lastSync = now;
+            for (Slot &slot : slots)
+            {
+                slot.channel->enqueue("sync");
+            }
+        }
+
+        for (size_t i = 0; i < slots.size(); i++)
+        {
+            slots[i].channel->tick(now, WRITE_BUDGET);
+            updateInterest(epollFd, slots[i], i);
+        }
+
+        struct epoll_event ready[16];
+        int count = epoll_wait(epollFd, ready, 16, 10);
+        for (int e = 0; e < count; e++)
+        {
+            if (ready[e].data.u64 == CONTROL_TAG)
+            {
+                char buffer[512];
+                ssize_t n;
+                while ((n = read(controlFd, buffer, sizeof(buffer))) > 0)
+                {
+                    controlLine.append(buffer, (size_t)n);
+                }
+                if (n == 0 && controlOpen)
+                {
+                    // stdin closed: keep running on the devices alone
+                    epoll_ctl(epollFd, EPOLL_CTL_DEL, controlFd, &controlEvent);
+                    controlOpen = false;
+                }
+                size_t newline;
+                while (running && (newline = controlLine.find('\n')) != std::string::npos)
+                {
+                    running = handleControlLine(controlLine.substr(0, newline), slots);
+                    controlLine.erase(0, newline + 1);
+                }
+                continue;
+            }
+
+            Slot &slot = slots[(size_t)ready[e].data.u64];
+            bool alive = true;
+            if (ready[e].events & EPOLLIN)
+                alive = slot.channel->onReadable(READ_BUDGET);
+            if (alive && (ready[e].events & EPOLLOUT))
+                alive = slot.channel->onWritable();
+            if (!alive || (ready[e].events & (EPOLLHUP | EPOLLERR)))
+                disconnect(epollFd, slot);
+        }
+    }
+
+    // Channels flush their files when destroyed
+    slots.clear();
+    return 0;
+}
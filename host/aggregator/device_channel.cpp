@@ -0,0 +1,324 @@
+#include "device_channel.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+
+namespace host
+{
+    // A command with no reply at all is given up on after this long
+    static const uint64_t COMMAND_TIMEOUT_US = 1000000;
+
+    // write> events have no header of their own; get_data rows bring theirs
+    static const char *EVENT_HEADER =
+        "Format=study_id,session_number,timestamp,task_type,event_type,stimulus_number,stimulus_color,"
+        "is_target,response_made,is_correct,stimulus_onset_time,response_time,reaction_time,"
+        "stimulus_end_time\n";
+
+    // Study IDs come from the device; keep only what is safe in a file name
+    static std::string fileSafe(std::string_view text)
+    {
+        std::string out;
+        for (char c : text)
+        {
+            bool safe = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+                        c == '-' || c == '_';
+            out += safe ? c : '_';
+        }
+        return out.empty() ? "unnamed" : out;
+    }
+
+    DeviceChannel::DeviceChannel(const std::string &name, const std::string &path, const std::string &outputDir,
+                                 uint64_t syncIntervalUs)
+        : name(name), path(path), directory(outputDir + "/" + fileSafe(name)), fd(-1), parser(*this),
+          awaitingReply(false), commandSentAt(0), syncSentAt(0), receivedAt(0), timeSync(),
+          syncIntervalUs(syncIntervalUs), pendingBytes(0), paused(false), stats()
+    {
+        mkdir(outputDir.c_str(), 0755);
+        mkdir(directory.c_str(), 0755);
+    }
+
+    DeviceChannel::~DeviceChannel()
+    {
+        close();
+        files.clear(); // Each log writes and syncs what it still holds
+    }
+
+    //==============================================================================
+    // Serial Endpoint
+    //==============================================================================
+
+    bool DeviceChannel::open()
+    {
+        if (fd >= 0)
+        {
+            return true;
+        }
+        fd = ::open(path.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK);
+        if (fd < 0)
+        {
+            return false;
+        }
+
+        // Raw 8N1 at the firmware's baud rate (ignored by ptys)
+        struct termios tio;
+        if (tcgetattr(fd, &tio) == 0)
+        {
+            cfmakeraw(&tio);
+            cfsetispeed(&tio, B9600);
+            cfsetospeed(&tio, B9600);
+            tcsetattr(fd, TCSANOW, &tio);
+        }
+
+        parser.reset();
+        txBuffer.clear();
+        awaitingReply = false;
+        syncSentAt = 0;
+        stats.reconnects++;
+        appendConsole("# port opened");
+        return true;
+    }
+
+    void DeviceChannel::close()
+    {
+        if (fd >= 0)
+        {
+            ::close(fd);
+            fd = -1;
+            appendConsole("# port closed");
+        }
+    }
+
+    bool DeviceChannel::onReadable(size_t budget)
+    {
+        char buffer[4096];
+        size_t total = 0;
+        receivedAt = monotonicMicros();
+
+        while (total < budget && !paused)
+        {
+            ssize_t n = ::read(fd, buffer, std::min(sizeof(buffer), budget - total));
+            if (n > 0)
+            {
+                total += (size_t)n;
+                stats.bytesIn += (uint64_t)n;
+                parser.feed(buffer, (size_t)n);
+                continue;
+            }
+            if (n < 0 && (errno == EAGAIN || errno == EINTR))
+            {
+                return true;
+            }
+            return false; // EOF or EIO: the device went away
+        }
+        return true;
+    }
+
+    bool DeviceChannel::onWritable()
+    {
+        while (!txBuffer.empty())
+        {
+            ssize_t n = ::write(fd, txBuffer.data(), txBuffer.size());
+            if (n > 0)
+            {
+                txBuffer.erase(0, (size_t)n);
+                continue;
+            }
+            return n < 0 && (errno == EAGAIN || errno == EINTR);
+        }
+        return true;
+    }
+
+    //==============================================================================
+    // Commands
+    //==============================================================================
+
+    void DeviceChannel::enqueue(const std::string &command)
+    {
+        commands.push_back(command);
+    }
+
+    void DeviceChannel::sendNextCommand(uint64_t now)
+    {
+        // One command in flight: the unit reads one line per loop() pass and
+        // a burst would overrun its receive buffer
+        if (commands.empty() || fd < 0 || !txBuffer.empty())
+        {
+            return;
+        }
+        if (awaitingReply && now - commandSentAt < COMMAND_TIMEOUT_US)
+        {
+            return;
+        }
+
+        std::string command = commands.front();
+        commands.pop_front();
+        txBuffer = command + "\n";
+        awaitingReply = true;
+        commandSentAt = now;
+        syncSentAt = command == "sync" ? now : 0;
+        stats.commandsSent++;
+        appendConsole("> " + command);
+        onWritable();
+    }
+
+    void DeviceChannel::tick(uint64_t now, size_t budget)
+    {
+        sendNextCommand(now);
+
+        // Write session output in whole blocks, about `budget` bytes per tick
+        for (std::pair<const std::string, std::unique_ptr<WriteBehindLog>> &entry : files)
+        {
+            size_t written = entry.second->pump(now, budget);
+            pendingBytes -= written;
+            budget -= std::min(budget, written);
+        }
+        updateBackpressure();
+    }
+
+    //==============================================================================
+    // Output Demultiplexing
+    //==============================================================================
+
+    void DeviceChannel::onEvent(const TrialRecord &event)
+    {
+        awaitingReply = false;
+        stats.events++;
+
+        std::string key = fileSafe(event.studyId) + "_s" + std::to_string(event.sessionNumber);
+        if (event.eventType == "start")
+        {
+            currentSession = key;
+            stats.sessions++;
+        }
+
+        std::string line(event.line);
+        line += '\n';
+        appendToFile(key, directory + "/" + key + ".csv", EVENT_HEADER, line);
+    }
+
+    void DeviceChannel::onFormat(const std::vector<ProtocolField> &columns, std::string_view line)
+    {
+        // The trial rows' own header: it names the columns the firmware has
+        // added since (markers, trigger latency), which the parser skips
+        if (std::find(columns.begin(), columns.end(), FIELD_STIMULUS_NUMBER) != columns.end())
+        {
+            trialFormat = line;
+            trialFormat += '\n';
+        }
+    }
+
+    void DeviceChannel::onTrialRow(const TrialRecord &row)
+    {
+        // get_data dump: kept next to the real-time events of the same session
+        std::string key = fileSafe(row.studyId) + "_s" + std::to_string(row.sessionNumber) + "_data";
+        std::string line(row.line);
+        line += '\n';
+        appendToFile(key, directory + "/" + key + ".csv", trialFormat, line);
+    }
+
+    void DeviceChannel::onDataSocketClose()
+    {
+        syncFiles();
+    }
+
+    void DeviceChannel::onTextLine(std::string_view line)
+    {
+        awaitingReply = false;
+
+        if (line.compare(0, 5, "sync ") == 0)
+        {
+            timeSync.deviceMillis = (uint32_t)strtoul(std::string(line.substr(5)).c_str(), nullptr, 10);
+            timeSync.rttMicros = syncSentAt ? receivedAt - syncSentAt : 0;
+            timeSync.hostMicros = syncSentAt ? syncSentAt + timeSync.rttMicros / 2 : receivedAt;
+            timeSync.count++;
+            syncSentAt = 0;
+
+            char note[96];
+            snprintf(note, sizeof(note), "# sync device_ms=%u host_us=%llu rtt_us=%llu", timeSync.deviceMillis,
+                     (unsigned long long)timeSync.hostMicros, (unsigned long long)timeSync.rttMicros);
+            appendConsole(note);
+        }
+        appendConsole(line);
+
+        // End of a session: everything it produced is on disk before the
+        // next command goes out
+        if (line == "task-completed")
+        {
+            syncFiles();
+        }
+    }
+
+    void DeviceChannel::appendConsole(std::string_view line)
+    {
+        char stamp[32];
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        struct tm local;
+        localtime_r(&ts.tv_sec, &local);
+        size_t length = strftime(stamp, sizeof(stamp), "%H:%M:%S", &local);
+        snprintf(stamp + length, sizeof(stamp) - length, ".%03ld ", ts.tv_nsec / 1000000);
+
+        std::string text = stamp;
+        text.append(line);
+        text += '\n';
+        appendToFile("console", directory + "/console.log", std::string_view(), text);
+    }
+
+    void DeviceChannel::appendToFile(const std::string &key, const std::string &filePath, std::string_view header,
+                                     std::string_view data)
+    {
+        std::map<std::string, std::unique_ptr<WriteBehindLog>>::iterator it = files.find(key);
+        if (it == files.end())
+        {
+            std::unique_ptr<WriteBehindLog> log(new WriteBehindLog());
+            if (!log->open(filePath, WriteBehindLog::DEFAULT_BLOCK_SIZE, syncIntervalUs))
+            {
+                return;
+            }
+            if (!header.empty() && log->size() == 0)
+            {
+                log->append(header);
+                pendingBytes += header.size();
+            }
+            it = files.insert(std::make_pair(key, std::move(log))).first;
+        }
+        it->second->append(data);
+        pendingBytes += data.size();
+        updateBackpressure();
+    }
+
+    void DeviceChannel::syncFiles()
+    {
+        for (std::pair<const std::string, std::unique_ptr<WriteBehindLog>> &entry : files)
+        {
+            size_t before = entry.second->pending();
+            entry.second->sync();
+            pendingBytes -= before - entry.second->pending();
+        }
+        updateBackpressure();
+    }
+
+    void DeviceChannel::updateBackpressure()
+    {
+        // Stop reading a unit whose output is not being written fast enough;
+        // its data waits in the kernel and the unit's own buffers instead of
+        // growing here, and the other units are not affected
+        if (!paused && pendingBytes >= HIGH_WATERMARK)
+        {
+            paused = true;
+            stats.pauses++;
+        }
+        else if (paused && pendingBytes <= LOW_WATERMARK)
+        {
+            paused = false;
+        }
+    }
+}
@@ -0,0 +1,126 @@
+#ifndef DEVICE_CHANNEL_H
+#define DEVICE_CHANNEL_H
+
+#include <stdint.h>
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include "protocol_parser.h"
+#include "write_behind_log.h"
+
+//==============================================================================
+// Device Channel
+//==============================================================================
+//
+// One N-back unit as seen by the aggregator: its serial endpoint, the
+// commands waiting to be sent to it, its clock offset and the session files
+// its write> events are demultiplexed into. The port is non-blocking and
+// the files are write-behind logs; the aggregator's event loop calls in when
+// the port is readable or writable and once per tick.
+
+namespace host
+{
+    // Clock relation from the last answered "sync" command
+    struct TimeSync
+    {
+        uint32_t deviceMillis; // Value the unit reported
+        uint64_t hostMicros;   // Host time the reply is attributed to (mid-RTT)
+        uint64_t rttMicros;    // Command sent -> reply received
+        uint32_t count;        // Replies received so far
+    };
+
+    struct ChannelStats
+    {
+        uint64_t bytesIn;
+        uint64_t events;
+        uint64_t sessions;
+        uint64_t commandsSent;
+        uint64_t pauses; // Times reading stopped for backpressure
+        uint64_t reconnects;
+    };
+
+    class DeviceChannel : public ProtocolHandler
+    {
+    public:
+        // Bytes of unwritten file output at which reading from the port stops
+        static const size_t HIGH_WATERMARK = 1 << 20;
+        static const size_t LOW_WATERMARK = 256 << 10;
+
+        DeviceChannel(const std::string &name, const std::string &path, const std::string &outputDir,
+                      uint64_t syncIntervalUs = WriteBehindLog::DEFAULT_SYNC_INTERVAL_US);
+        ~DeviceChannel();
+
+        // Open the serial endpoint (raw, 9600 baud); false if not available
+        bool open();
+        void close();
+        bool isOpen() const { return fd >= 0; }
+        int getFd() const { return fd; }
+
+        const std::string &getName() const { return name; }
+        const std::string &getCurrentSession() const { return currentSession; }
+        size_t queuedCommands() const { return commands.size(); }
+        bool isPaused() const { return paused; }
+        const TimeSync &getTimeSync() const { return timeSync; }
+        const ChannelStats &getStats() const { return stats; }
+
+        // Read at most `budget` bytes from the port; false if the port went away
+        bool onReadable(size_t budget);
+
+        // Continue sending the current command; false if the port went away
+        bool onWritable();
+
+        // Queue a command line (without terminator)
+        void enqueue(const std::string &command);
+
+        // Per-tick work: command pacing and file output within `budget` bytes
+        void tick(uint64_t now, size_t budget);
+
+        // Epoll interest the channel currently needs
+        bool wantsRead() const { return !paused; }
+        bool wantsWrite() const { return !txBuffer.empty(); }
+
+        // Bytes produced but not yet written to session files
+        size_t backlog() const { return pendingBytes; }
+
+        // ProtocolHandler
+        void onEvent(const TrialRecord &event) override;
+        void onTextLine(std::string_view line) override;
+        void onFormat(const std::vector<ProtocolField> &columns, std::string_view line) override;
+        void onTrialRow(const TrialRecord &row) override;
+        void onDataSocketClose() override;
+
+    private:
+        void sendNextCommand(uint64_t now);
+        void appendToFile(const std::string &key, const std::string &path, std::string_view header,
+                          std::string_view data);
+        void appendConsole(std::string_view line);
+        void updateBackpressure();
+        void syncFiles();
+
+        std::string name;
+        std::string path;
+        std::string directory;
+        int fd;
+        ProtocolParser parser;
+
+        std::deque<std::string> commands;
+        std::string txBuffer;
+        bool awaitingReply; // A command was sent and nothing came back yet
+        uint64_t commandSentAt;
+        uint64_t syncSentAt; // 0 unless a "sync" is outstanding
+        uint64_t receivedAt; // Host time of the chunk being parsed
+        TimeSync timeSync;
+
+        uint64_t syncIntervalUs;
+        std::map<std::string, std::unique_ptr<WriteBehindLog>> files;
+        std::string currentSession; // Key of the session write> events go to
+        std::string trialFormat;    // Format= header of the data socket's trial rows
+        size_t pendingBytes;
+        bool paused;
+
+        ChannelStats stats;
+    };
+}
+
+#endif // DEVICE_CHANNEL_H
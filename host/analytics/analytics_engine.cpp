@@ -0,0 +1,329 @@
+#include "analytics_engine.h"
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <map>
+#include <thread>
+
+namespace host
+{
+    void clearAggregate(TrialAggregate &aggregate)
+    {
+        memset(&aggregate, 0, sizeof(aggregate));
+        aggregate.rtMin = UINT32_MAX;
+    }
+
+    void mergeAggregate(TrialAggregate &into, const TrialAggregate &from)
+    {
+        into.sessions += from.sessions;
+        into.trials += from.trials;
+        for (int o = 0; o < TRIAL_OUTCOME_COUNT; o++)
+        {
+            into.outcomes[o] += from.outcomes[o];
+        }
+        into.noResponseTargets += from.noResponseTargets;
+        into.recordedMismatches += from.recordedMismatches;
+        into.rtCount += from.rtCount;
+        into.rtSum += from.rtSum;
+        into.rtSumSquares += from.rtSumSquares;
+        into.rtMin = std::min(into.rtMin, from.rtMin);
+        into.rtMax = std::max(into.rtMax, from.rtMax);
+        into.hitRtSum += from.hitRtSum;
+    }
+
+    //==============================================================================
+    // Scoring Kernel
+    //==============================================================================
+
+    void accumulateTrials(const TrialColumns &c, int nBackLevel, TrialAggregate &out)
+    {
+        // classifyTrial() as 0/1 arithmetic so the loop has no branches.
+        // responded: the firmware only stores a response time for a press.
+        uint64_t noResponse = 0, hits = 0, misses = 0, falseAlarms = 0, rejections = 0, unscored = 0;
+        uint64_t noResponseTargets = 0, mismatches = 0;
+        uint64_t rtSum = 0, rtSumSquares = 0, hitRtSum = 0;
+        uint32_t rtMin = UINT32_MAX, rtMax = 0;
+
+        for (size_t i = 0; i < c.count; i++)
+        {
+            uint32_t responded = c.responseTime[i] != 0;
+            uint32_t target = c.isTarget[i] != 0;
+            uint32_t confirm = responded & (c.responseMade[i] != 0);
+            uint32_t early = c.stimulusNumber[i] <= (uint32_t)nBackLevel; // trialIndex < nBackLevel
+            uint32_t scoredTarget = responded & target & (early ^ 1);
+            uint32_t nonTarget = responded & (target ^ 1);
+
+            uint32_t hit = scoredTarget & confirm;
+            uint32_t rejection = nonTarget & (confirm ^ 1);
+            noResponse += responded ^ 1;
+            noResponseTargets += (responded ^ 1) & target & (early ^ 1);
+            hits += hit;
+            misses += scoredTarget & (confirm ^ 1);
+            falseAlarms += nonTarget & confirm;
+            rejections += rejection;
+            unscored += responded & target & early;
+            mismatches += (hit | rejection) != (c.isCorrect[i] != 0);
+
+            uint32_t rt = c.reactionTime[i] * responded;
+            rtSum += rt;
+            rtSumSquares += (uint64_t)rt * rt;
+            hitRtSum += rt * hit;
+            rtMin = std::min(rtMin, responded ? rt : UINT32_MAX);
+            rtMax = std::max(rtMax, rt);
+        }
+
+        out.trials += c.count;
+        out.outcomes[OUTCOME_NO_RESPONSE] += noResponse;
+        out.outcomes[OUTCOME_HIT] += hits;
+        out.outcomes[OUTCOME_MISS] += misses;
+        out.outcomes[OUTCOME_FALSE_ALARM] += falseAlarms;
+        out.outcomes[OUTCOME_CORRECT_REJECTION] += rejections;
+        out.outcomes[OUTCOME_UNSCORED] += unscored;
+        out.noResponseTargets += noResponseTargets;
+        out.recordedMismatches += mismatches;
+        out.rtCount += c.count - noResponse;
+        out.rtSum += rtSum;
+        out.rtSumSquares += rtSumSquares;
+        out.rtMin = std::min(out.rtMin, rtMin);
+        out.rtMax = std::max(out.rtMax, rtMax);
+        out.hitRtSum += hitRtSum;
+    }
+
+    bool verifyScoringKernel()
+    {
+        const int N_BACK = 2;
+        for (int responded = 0; responded < 2; responded++)
+            for (int target = 0; target < 2; target++)
+                for (int confirm = 0; confirm < 2; confirm++)
+                    for (int index = 0; index < 4; index++)
+                    {
+                        TrialOutcome expected = classifyTrial(responded, target, confirm, index, N_BACK);
+
+                        uint32_t stimulus = (uint32_t)index + 1;
+                        uint32_t isTarget = (uint32_t)target;
+                        uint32_t made = (uint32_t)confirm;
+                        uint32_t correct = outcomeIsCorrect(expected);
+                        uint32_t rt = 300;
+                        uint32_t responseTime = responded ? 5000 : 0;
+                        TrialColumns c = {&stimulus, &isTarget, &made, &correct, &rt, &responseTime, 1};
+
+                        TrialAggregate a;
+                        clearAggregate(a);
+                        accumulateTrials(c, N_BACK, a);
+                        if (a.outcomes[expected] != 1 || a.recordedMismatches != 0)
+                        {
+                            return false;
+                        }
+                    }
+        return true;
+    }
+
+    //==============================================================================
+    // Summary Statistics
+    //==============================================================================
+
+    double inverseNormal(double p)
+    {
+        // Acklam's rational approximation, refined with one Halley step
+        static const double a[] = {-3.969683028665376e+01, 2.209460984245205e+02, -2.759285104469687e+02,
+                                   1.383577518672690e+02, -3.066479806614716e+01, 2.506628277459239e+00};
+        static const double b[] = {-5.447609879822406e+01, 1.615858368580409e+02, -1.556989798598866e+02,
+                                   6.680131188771972e+01, -1.328068155288572e+01};
+        static const double c[] = {-7.784894002430293e-03, -3.223964580411365e-01, -2.400758277161838e+00,
+                                   -2.549732539343734e+00, 4.374664141464968e+00, 2.938163982698783e+00};
+        static const double d[] = {7.784695709041462e-03, 3.224671290700398e-01, 2.445134137142996e+00,
+                                   3.754408661907416e+00};
+        if (p <= 0)
+            return -INFINITY;
+        if (p >= 1)
+            return INFINITY;
+
+        double x;
+        if (p < 0.02425)
+        {
+            double q = sqrt(-2 * log(p));
+            x = (((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q + c[5]) /
+                ((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1);
+        }
+        else if (p > 1 - 0.02425)
+        {
+            double q = sqrt(-2 * log(1 - p));
+            x = -(((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q + c[5]) /
+                ((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1);
+        }
+        else
+        {
+            double q = p - 0.5;
+            double r = q * q;
+            x = (((((a[0] * r + a[1]) * r + a[2]) * r + a[3]) * r + a[4]) * r + a[5]) * q /
+                (((((b[0] * r + b[1]) * r + b[2]) * r + b[3]) * r + b[4]) * r + 1);
+        }
+
+        double e = 0.5 * erfc(-x / sqrt(2)) - p;
+        double u = e * sqrt(2 * M_PI) * exp(x * x / 2);
+        return x - u / (1 + x * u / 2);
+    }
+
+    GroupResult summarize(const std::string &key, const TrialAggregate &t)
+    {
+        GroupResult r;
+        r.key = key;
+        r.totals = t;
+
+        uint64_t hits = t.outcomes[OUTCOME_HIT];
+        uint64_t falseAlarms = t.outcomes[OUTCOME_FALSE_ALARM];
+        uint64_t targets = hits + t.outcomes[OUTCOME_MISS] + t.noResponseTargets;
+        uint64_t nonTargets = falseAlarms + t.outcomes[OUTCOME_CORRECT_REJECTION] +
+                              (t.outcomes[OUTCOME_NO_RESPONSE] - t.noResponseTargets);
+
+        r.accuracy = t.trials ? (double)(hits + t.outcomes[OUTCOME_CORRECT_REJECTION]) / t.trials : 0.0;
+        r.hitRate = targets ? (double)hits / targets : 0.0;
+        r.falseAlarmRate = nonTargets ? (double)falseAlarms / nonTargets : 0.0;
+
+        // Log-linear correction keeps d' finite at rates of 0 or 1
+        r.dPrime = inverseNormal((hits + 0.5) / (targets + 1.0)) - inverseNormal((falseAlarms + 0.5) / (nonTargets + 1.0));
+
+        r.rtMean = t.rtCount ? (double)t.rtSum / t.rtCount : 0.0;
+        double variance = t.rtCount > 1 ? ((double)t.rtSumSquares - t.rtCount * r.rtMean * r.rtMean) / (t.rtCount - 1) : 0.0;
+        r.rtSd = variance > 0 ? sqrt(variance) : 0.0;
+        r.hitRtMean = hits ? (double)t.hitRtSum / hits : 0.0;
+        return r;
+    }
+
+    //==============================================================================
+    // Archive Scan
+    //==============================================================================
+
+    static std::string groupKey(const ArchiveSession &session, int groupBy)
+    {
+        std::string key;
+        if (groupBy & (GROUP_BY_STUDY | GROUP_BY_SESSION))
+        {
+            key = session.studyId;
+        }
+        if (groupBy & GROUP_BY_SESSION)
+        {
+            key += "/s" + std::to_string(session.sessionNumber);
+        }
+        if (groupBy & GROUP_BY_NBACK_LEVEL)
+        {
+            key += (key.empty() ? "" : "/") + std::string("n") + std::to_string(session.nBackLevel);
+        }
+        return key.empty() ? "all" : key;
+    }
+
+    // Consecutive sessions scored as one unit: their rows are decoded together,
+    // so short sessions do not each pay for whole blocks
+    struct WorkUnit
+    {
+        size_t firstSession;
+        size_t sessionCount;
+    };
+
+    static const uint64_t UNIT_ROWS = 4 * ARCHIVE_BLOCK_VALUES;
+
+    static void scoreUnit(const ArchiveReader &archive, const std::vector<ArchiveSession> &sessions,
+                          const WorkUnit &unit, std::vector<uint32_t> (&buffers)[6],
+                          std::vector<TrialAggregate> &perSession)
+    {
+        static const ArchiveColumn COLUMNS[6] = {COLUMN_STIMULUS_NUMBER, COLUMN_IS_TARGET, COLUMN_RESPONSE_MADE,
+                                                 COLUMN_IS_CORRECT, COLUMN_REACTION_TIME, COLUMN_RESPONSE_TIME};
+        const ArchiveSession &first = sessions[unit.firstSession];
+        const ArchiveSession &last = sessions[unit.firstSession + unit.sessionCount - 1];
+        uint64_t rowBase = first.firstTrial;
+        uint64_t rows = last.firstTrial + last.trialCount - rowBase;
+        for (int c = 0; c < 6; c++)
+        {
+            buffers[c].resize(rows);
+            archive.readColumn(COLUMNS[c], rowBase, rows, buffers[c].data());
+        }
+
+        for (size_t s = unit.firstSession; s < unit.firstSession + unit.sessionCount; s++)
+        {
+            size_t offset = sessions[s].firstTrial - rowBase;
+            TrialColumns columns = {buffers[0].data() + offset, buffers[1].data() + offset,
+                                    buffers[2].data() + offset, buffers[3].data() + offset,
+                                    buffers[4].data() + offset, buffers[5].data() + offset, sessions[s].trialCount};
+            clearAggregate(perSession[s]);
+            perSession[s].sessions = 1;
+            accumulateTrials(columns, sessions[s].nBackLevel, perSession[s]);
+        }
+    }
+
+    std::vector<GroupResult> analyzeArchive(const ArchiveReader &archive, int groupBy, unsigned threads)
+    {
+        std::vector<ArchiveSession> sessions;
+        for (uint32_t s = 0; s < archive.sessionCount(); s++)
+        {
+            sessions.push_back(archive.session(s));
+        }
+
+        // Sessions are stored in row order, so a run of them is one row range
+        std::vector<WorkUnit> units;
+        for (size_t s = 0; s < sessions.size(); s++)
+        {
+            bool contiguous = !units.empty() &&
+                              sessions[s].firstTrial == sessions[s - 1].firstTrial + sessions[s - 1].trialCount;
+            if (contiguous && sessions[s].firstTrial + sessions[s].trialCount -
+                                      sessions[units.back().firstSession].firstTrial <= UNIT_ROWS)
+            {
+                units.back().sessionCount++;
+            }
+            else
+            {
+                units.push_back({s, 1});
+            }
+        }
+
+        // Workers take the next unit until none are left
+        std::vector<TrialAggregate> perSession(sessions.size());
+        std::atomic<size_t> next(0);
+        std::function<void()> worker = [&]() {
+            std::vector<uint32_t> buffers[6];
+            for (size_t u = next++; u < units.size(); u = next++)
+            {
+                scoreUnit(archive, sessions, units[u], buffers, perSession);
+            }
+        };
+
+        if (threads == 0)
+        {
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        threads = (unsigned)std::min<size_t>(threads, std::max<size_t>(units.size(), 1));
+        std::vector<std::thread> pool;
+        for (unsigned t = 1; t < threads; t++)
+        {
+            pool.emplace_back(worker);
+        }
+        worker();
+        for (std::thread &thread : pool)
+        {
+            thread.join();
+        }
+
+        // Merge in archive order so the sums never depend on scheduling
+        std::map<std::string, TrialAggregate> groups;
+        for (size_t s = 0; s < sessions.size(); s++)
+        {
+            std::string key = groupKey(sessions[s], groupBy);
+            std::map<std::string, TrialAggregate>::iterator it = groups.find(key);
+            if (it == groups.end())
+            {
+                it = groups.insert(std::make_pair(key, TrialAggregate())).first;
+                clearAggregate(it->second);
+            }
+            mergeAggregate(it->second, perSession[s]);
+        }
+
+        std::vector<GroupResult> results;
+        for (const std::pair<const std::string, TrialAggregate> &group : groups)
+        {
+            results.push_back(summarize(group.first, group.second));
+        }
+        return results;
+    }
+}
@@ -0,0 +1,89 @@
+#ifndef ANALYTICS_ENGINE_H
+#define ANALYTICS_ENGINE_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "session_archive.h"
+#include "trial_outcome.h"
+
+//==============================================================================
+// Analytics Engine
+//==============================================================================
+//
+// Scores archived trials and aggregates them per study, session or n-back
+// level. Trials are scored by the firmware's own rules (src/trial_outcome.h)
+// in a branch-free loop over column arrays that the compiler vectorises;
+// sessions are spread over worker threads and merged in archive order, so
+// the result does not depend on the thread count.
+
+namespace host
+{
+    // Grouping keys, combined with |
+    enum GroupBy
+    {
+        GROUP_BY_STUDY = 1,
+        GROUP_BY_SESSION = 2, // Study ID and session number
+        GROUP_BY_NBACK_LEVEL = 4
+    };
+
+    // One session's trials as column arrays (archive order)
+    struct TrialColumns
+    {
+        const uint32_t *stimulusNumber; // 1-based
+        const uint32_t *isTarget;
+        const uint32_t *responseMade; // Confirm pressed (only meaningful with a response)
+        const uint32_t *isCorrect;    // As recorded, checked against the rescoring
+        const uint32_t *reactionTime;
+        const uint32_t *responseTime; // 0 when nothing was pressed
+        size_t count;
+    };
+
+    struct TrialAggregate
+    {
+        uint64_t sessions;
+        uint64_t trials;
+        uint64_t outcomes[TRIAL_OUTCOME_COUNT];
+        uint64_t noResponseTargets; // OUTCOME_NO_RESPONSE on a scored target trial
+        uint64_t recordedMismatches; // Recorded is_correct differs from the rescoring
+        uint64_t rtCount;           // Trials with a response
+        uint64_t rtSum;
+        uint64_t rtSumSquares;
+        uint32_t rtMin;
+        uint32_t rtMax;
+        uint64_t hitRtSum; // Over OUTCOME_HIT trials
+    };
+
+    struct GroupResult
+    {
+        std::string key;
+        TrialAggregate totals;
+        double accuracy;       // Correct / trials
+        double hitRate;        // Hits / scored target trials
+        double falseAlarmRate; // False alarms / non-target trials
+        double dPrime;         // z(hit rate) - z(false alarm rate), log-linear corrected
+        double rtMean;         // All responses, as the firmware's average
+        double rtSd;
+        double hitRtMean;
+    };
+
+    void clearAggregate(TrialAggregate &aggregate);
+    void mergeAggregate(TrialAggregate &into, const TrialAggregate &from);
+
+    // Score and add one session's trials
+    void accumulateTrials(const TrialColumns &columns, int nBackLevel, TrialAggregate &out);
+
+    // Compare the vectorised scoring with classifyTrial() for every input
+    // combination; false if they ever disagree
+    bool verifyScoringKernel();
+
+    // Inverse of the standard normal CDF
+    double inverseNormal(double p);
+
+    GroupResult summarize(const std::string &key, const TrialAggregate &totals);
+
+    // Aggregate a whole archive; `threads` 0 = one per CPU
+    std::vector<GroupResult> analyzeArchive(const ArchiveReader &archive, int groupBy, unsigned threads);
+}
+
+#endif // ANALYTICS_ENGINE_H
@@ -0,0 +1,136 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "analytics_engine.h"
+
+//==============================================================================
+// Study Analytics
+//==============================================================================
+//
+// Per-group performance metrics over a session archive (nback-archive).
+//
+//   nback-analytics [--by study|session|nlevel[,...]] [--threads N] [--csv] ARCHIVE
+//
+// Groups default to one per session. Outcomes follow the firmware's scoring;
+// a trial whose recorded is_correct disagrees with the rescoring is counted
+// in the `mismatch` column.
+
+using namespace host;
+
+static bool parseGroupBy(const std::string &text, int &groupBy)
+{
+    groupBy = 0;
+    size_t start = 0;
+    while (start <= text.size())
+    {
+        size_t comma = text.find(',', start);
+        std::string part = text.substr(start, comma == std::string::npos ? std::string::npos : comma - start);
+        if (part == "study")
+            groupBy |= GROUP_BY_STUDY;
+        else if (part == "session")
+            groupBy |= GROUP_BY_SESSION;
+        else if (part == "nlevel")
+            groupBy |= GROUP_BY_NBACK_LEVEL;
+        else
+            return false;
+        if (comma == std::string::npos)
+            break;
+        start = comma + 1;
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    int groupBy = GROUP_BY_SESSION;
+    unsigned threads = 0;
+    bool csv = false;
+    std::string path;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool ok = true;
+        if (arg == "--by" && i + 1 < argc)
+            ok = parseGroupBy(argv[++i], groupBy);
+        else if (arg == "--threads" && i + 1 < argc)
+            threads = (unsigned)strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--csv")
+            csv = true;
+        else if (path.empty() && arg[0] != '-')
+            path = arg;
+        else
+            ok = false;
+        if (!ok)
+        {
+            path.clear();
+            break;
+        }
+    }
+    if (path.empty())
+    {
+        fprintf(stderr, "usage: nback-analytics [--by study|session|nlevel[,...]] [--threads N] [--csv] ARCHIVE\n");
+        return 2;
+    }
+
+    if (!verifyScoringKernel())
+    {
+        fprintf(stderr, "nback-analytics: scoring kernel disagrees with classifyTrial()\n");
+        return 1;
+    }
+
+    ArchiveReader archive;
+    std::string error;
+    if (!archive.open(path, error))
+    {
+        fprintf(stderr, "nback-analytics: %s\n", error.c_str());
+        return 1;
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::vector<GroupResult> results = analyzeArchive(archive, groupBy, threads);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (csv)
+    {
+        printf("group,sessions,trials,hits,misses,no_response,false_alarms,correct_rejections,unscored,mismatch,"
+               "accuracy,hit_rate,fa_rate,d_prime,rt_mean,rt_sd,rt_min,rt_max,hit_rt_mean\n");
+    }
+    else
+    {
+        printf("%-20s %5s %7s %6s %6s %6s %6s %6s %5s %6s %6s %6s %6s %7s %7s %7s %7s\n", "group", "sess", "trials",
+               "hit", "miss", "noresp", "fa", "cr", "unsc", "mism", "acc", "hr", "far", "d'", "rt", "rt_sd", "hit_rt");
+    }
+    uint64_t trials = 0;
+    for (const GroupResult &r : results)
+    {
+        const TrialAggregate &t = r.totals;
+        trials += t.trials;
+        if (csv)
+        {
+            printf("%s,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%.4f,%.4f,%.4f,%.4f,%.2f,%.2f,%u,%u,%.2f\n",
+                   r.key.c_str(), (unsigned long long)t.sessions, (unsigned long long)t.trials,
+                   (unsigned long long)t.outcomes[OUTCOME_HIT], (unsigned long long)t.outcomes[OUTCOME_MISS],
+                   (unsigned long long)t.outcomes[OUTCOME_NO_RESPONSE],
+                   (unsigned long long)t.outcomes[OUTCOME_FALSE_ALARM],
+                   (unsigned long long)t.outcomes[OUTCOME_CORRECT_REJECTION],
+                   (unsigned long long)t.outcomes[OUTCOME_UNSCORED], (unsigned long long)t.recordedMismatches,
+                   r.accuracy, r.hitRate, r.falseAlarmRate, r.dPrime, r.rtMean, r.rtSd, t.rtCount ? t.rtMin : 0,
+                   t.rtMax, r.hitRtMean);
+            continue;
+        }
+        printf("%-20s %5llu %7llu %6llu %6llu %6llu %6llu %6llu %5llu %6llu %6.3f %6.3f %6.3f %6.2f %7.1f %7.1f %7.1f\n",
+               r.key.c_str(), (unsigned long long)t.sessions, (unsigned long long)t.trials,
+               (unsigned long long)t.outcomes[OUTCOME_HIT], (unsigned long long)t.outcomes[OUTCOME_MISS],
+               (unsigned long long)t.outcomes[OUTCOME_NO_RESPONSE], (unsigned long long)t.outcomes[OUTCOME_FALSE_ALARM],
+               (unsigned long long)t.outcomes[OUTCOME_CORRECT_REJECTION], (unsigned long long)t.outcomes[OUTCOME_UNSCORED],
+               (unsigned long long)t.recordedMismatches, r.accuracy, r.hitRate, r.falseAlarmRate, r.dPrime, r.rtMean,
+               r.rtSd, r.hitRtMean);
+    }
+    fprintf(stderr, "%zu groups, %llu trials in %.2f ms (%.0f trials/s)\n", results.size(), (unsigned long long)trials,
+            seconds * 1e3, trials / seconds);
+    return 0;
+}
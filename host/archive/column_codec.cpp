@@ -0,0 +1,136 @@
+#include "column_codec.h"
+
+#include <string.h>
+
+namespace host
+{
+    static uint8_t bitsNeeded(uint64_t value)
+    {
+        uint8_t bits = 0;
+        while (value)
+        {
+            bits++;
+            value >>= 1;
+        }
+        return bits;
+    }
+
+    static uint64_t zigzag(int64_t value)
+    {
+        return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+    }
+
+    static int64_t unzigzag(uint64_t value)
+    {
+        return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+    }
+
+    size_t packedBytes(uint32_t count, uint8_t width)
+    {
+        return (((uint64_t)count * width + 63) / 64) * 8;
+    }
+
+    static void pack(const uint64_t *codes, uint32_t count, uint8_t width, std::string &out)
+    {
+        size_t words = packedBytes(count, width) / 8;
+        size_t start = out.size();
+        out.resize(start + words * 8);
+        uint64_t *dest = (uint64_t *)&out[start];
+        memset(dest, 0, words * 8);
+
+        uint64_t bit = 0;
+        for (uint32_t i = 0; i < count; i++, bit += width)
+        {
+            size_t word = bit / 64;
+            unsigned shift = bit % 64;
+            dest[word] |= codes[i] << shift;
+            if (shift + width > 64)
+            {
+                dest[word + 1] |= codes[i] >> (64 - shift);
+            }
+        }
+    }
+
+    void encodeBlock(const uint32_t *values, uint32_t count, BlockHeader &header, std::string &out)
+    {
+        uint64_t codes[ARCHIVE_BLOCK_VALUES];
+        uint32_t minimum = UINT32_MAX;
+        uint32_t maximum = 0;
+        uint64_t maxDelta = 0;
+
+        for (uint32_t i = 0; i < count; i++)
+        {
+            minimum = values[i] < minimum ? values[i] : minimum;
+            maximum = values[i] > maximum ? values[i] : maximum;
+            if (i > 0)
+            {
+                uint64_t delta = zigzag((int64_t)values[i] - (int64_t)values[i - 1]);
+                maxDelta = delta > maxDelta ? delta : maxDelta;
+            }
+        }
+
+        uint8_t frameWidth = bitsNeeded(count ? maximum - minimum : 0);
+        uint8_t deltaWidth = bitsNeeded(maxDelta);
+
+        header.count = count;
+        header.reserved = 0;
+        if (deltaWidth < frameWidth)
+        {
+            header.encoding = ENCODING_DELTA;
+            header.width = deltaWidth;
+            header.reference = values[0];
+            codes[0] = 0;
+            for (uint32_t i = 1; i < count; i++)
+            {
+                codes[i] = zigzag((int64_t)values[i] - (int64_t)values[i - 1]);
+            }
+        }
+        else
+        {
+            header.encoding = ENCODING_FRAME;
+            header.width = frameWidth;
+            header.reference = count ? minimum : 0;
+            for (uint32_t i = 0; i < count; i++)
+            {
+                codes[i] = values[i] - minimum;
+            }
+        }
+        pack(codes, count, header.width, out);
+    }
+
+    void decodeBlock(const BlockHeader &header, const uint8_t *data, uint32_t *out)
+    {
+        const uint8_t width = header.width;
+        const uint64_t mask = width == 64 ? ~0ULL : (1ULL << width) - 1;
+        uint64_t words[2];
+        uint64_t bit = 0;
+
+        for (uint32_t i = 0; i < header.count; i++, bit += width)
+        {
+            uint64_t code = 0;
+            if (width)
+            {
+                size_t word = bit / 64;
+                unsigned shift = bit % 64;
+                memcpy(&words[0], data + word * 8, 8);
+                code = words[0] >> shift;
+                if (shift + width > 64)
+                {
+                    memcpy(&words[1], data + (word + 1) * 8, 8);
+                    code |= words[1] << (64 - shift);
+                }
+                code &= mask;
+            }
+
+            if (header.encoding == ENCODING_DELTA)
+            {
+                int64_t previous = i ? (int64_t)out[i - 1] : header.reference;
+                out[i] = (uint32_t)(previous + unzigzag(code));
+            }
+            else
+            {
+                out[i] = (uint32_t)(header.reference + (int64_t)code);
+            }
+        }
+    }
+}
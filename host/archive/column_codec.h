@@ -0,0 +1,53 @@
+#ifndef COLUMN_CODEC_H
+#define COLUMN_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+//==============================================================================
+// Column Codec
+//==============================================================================
+//
+// Block encodings for the session archive. A column is stored as blocks of up
+// to ARCHIVE_BLOCK_VALUES unsigned 32-bit values, each block bit-packed with
+// whichever of two encodings is smaller:
+//
+//   ENCODING_FRAME  value - minimum            (flags, colours, reaction times)
+//   ENCODING_DELTA  zigzag(value - previous)   (timestamps, stimulus numbers)
+//
+// Values are packed LSB-first into 64-bit little-endian words.
+
+namespace host
+{
+    static const uint32_t ARCHIVE_BLOCK_VALUES = 4096;
+
+    enum BlockEncoding : uint8_t
+    {
+        ENCODING_FRAME = 0,
+        ENCODING_DELTA = 1
+    };
+
+    // Fixed-size description of one block, stored in the column's block table
+    struct BlockHeader
+    {
+        uint64_t dataOffset; // From the start of the archive
+        uint32_t count;      // Values in the block
+        uint8_t encoding;    // BlockEncoding
+        uint8_t width;       // Bits per packed value (0-33)
+        uint16_t reserved;
+        int64_t reference; // Minimum (frame) or first value (delta)
+    };
+
+    // Encode `count` values; appends the packed words to `out` and fills the
+    // header (except dataOffset)
+    void encodeBlock(const uint32_t *values, uint32_t count, BlockHeader &header, std::string &out);
+
+    // Decode a whole block into `out` (room for header.count values)
+    void decodeBlock(const BlockHeader &header, const uint8_t *data, uint32_t *out);
+
+    // Bytes of packed data a block occupies
+    size_t packedBytes(uint32_t count, uint8_t width);
+}
+
+#endif // COLUMN_CODEC_H
@@ -0,0 +1,193 @@
+#include "log_ingest.h"
+
+#include <stdlib.h>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include "protocol_parser.h"
+
+namespace host
+{
+    // Number after `key:` in the start event's additional data, 0 if absent
+    static uint32_t configValue(std::string_view extra, std::string_view key)
+    {
+        size_t pos = extra.find(key);
+        if (pos == std::string_view::npos || pos + key.size() >= extra.size() || extra[pos + key.size()] != ':')
+        {
+            return 0;
+        }
+        return (uint32_t)strtoul(std::string(extra.substr(pos + key.size() + 1, 8)).c_str(), nullptr, 10);
+    }
+
+    //==============================================================================
+    // Collector
+    //==============================================================================
+
+    struct LogIngest::Collector : public ProtocolHandler
+    {
+        struct Session
+        {
+            ArchiveSession info;
+            // A trial can arrive as a write> event and again as a dump row;
+            // keying by onset and stimulus number keeps one copy
+            std::map<std::pair<uint32_t, uint32_t>, ArchiveTrial> trials;
+        };
+
+        std::map<std::pair<std::string, uint16_t>, Session> sessions;
+        uint64_t errors = 0;
+
+        Session &sessionFor(std::string_view studyId, uint16_t number)
+        {
+            std::pair<std::string, uint16_t> key(std::string(studyId), number);
+            std::map<std::pair<std::string, uint16_t>, Session>::iterator it = sessions.find(key);
+            if (it == sessions.end())
+            {
+                Session session;
+                session.info = ArchiveSession();
+                session.info.studyId = key.first;
+                session.info.sessionNumber = number;
+                it = sessions.insert(std::make_pair(key, session)).first;
+            }
+            return it->second;
+        }
+
+        void addRecord(const TrialRecord &r)
+        {
+            if (r.eventType == "start")
+            {
+                ArchiveSession &info = sessionFor(r.studyId, r.sessionNumber).info;
+                info.nBackLevel = (uint8_t)configValue(r.extra, "n-back_level");
+                info.stimulusDuration = (uint16_t)configValue(r.extra, "stim_duration");
+                info.interStimulusInterval = (uint16_t)configValue(r.extra, "inter_stim_interval");
+                return;
+            }
+            // Tables without an event_type column hold only trials
+            if (!r.eventType.empty() && r.eventType != "trial_complete")
+            {
+                return;
+            }
+
+            ArchiveTrial trial;
+            trial.values[COLUMN_STIMULUS_NUMBER] = r.stimulusNumber;
+            trial.values[COLUMN_STIMULUS_COLOR] = r.colorIndex < 0 ? 255 : (uint32_t)r.colorIndex;
+            trial.values[COLUMN_IS_TARGET] = r.isTarget;
+            trial.values[COLUMN_RESPONSE_MADE] = r.responseMade;
+            trial.values[COLUMN_IS_CORRECT] = r.isCorrect;
+            trial.values[COLUMN_REACTION_TIME] = r.reactionTime;
+            trial.values[COLUMN_STIMULUS_ONSET_TIME] = r.stimulusOnsetTime;
+            trial.values[COLUMN_RESPONSE_TIME] = r.responseTime;
+            trial.values[COLUMN_STIMULUS_END_TIME] = r.stimulusEndTime;
+            sessionFor(r.studyId, r.sessionNumber).trials[std::make_pair(r.stimulusOnsetTime, r.stimulusNumber)] = trial;
+        }
+
+        void onEvent(const TrialRecord &r) override { addRecord(r); }
+        void onTrialRow(const TrialRecord &r) override { addRecord(r); }
+        void onSessionRow(const SessionRecord &r) override
+        {
+            sessionFor(r.studyId, r.sessionNumber).info.startTimeMillis = r.startTimeMillis;
+        }
+        void onError(ProtocolError, std::string_view) override { errors++; }
+    };
+
+    //==============================================================================
+    // Ingest
+    //==============================================================================
+
+    LogIngest::LogIngest() : collector(new Collector()), stats() {}
+
+    LogIngest::~LogIngest()
+    {
+        delete collector;
+    }
+
+    bool LogIngest::addPath(const std::string &path, std::string &error)
+    {
+        std::vector<std::string> files = listLogFiles(std::vector<std::string>(1, path));
+        if (files.empty())
+        {
+            error = "no log files at " + path;
+            return false;
+        }
+        for (const std::string &file : files)
+        {
+            if (!addFile(file, error))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool LogIngest::addFile(const std::string &path, std::string &error)
+    {
+        std::ifstream in(path, std::ios::binary);
+        if (!in)
+        {
+            error = "cannot read " + path;
+            return false;
+        }
+        std::ostringstream content;
+        content << in.rdbuf();
+        const std::string text = content.str();
+
+        // A saved CSV file has its Format= header on the first line and no
+        // data socket markers around the rows
+        ProtocolParser parser(*collector);
+        size_t first = text.find_first_not_of("\r\n");
+        if (first != std::string::npos && text.compare(first, 7, "Format=") == 0)
+        {
+            parser.expectTable();
+        }
+        parser.feed(text);
+        parser.finish();
+
+        stats.files++;
+        stats.bytes += text.size();
+        return true;
+    }
+
+    void LogIngest::writeTo(ArchiveWriter &writer)
+    {
+        std::vector<ArchiveTrial> trials;
+        for (std::pair<const std::pair<std::string, uint16_t>, Collector::Session> &entry : collector->sessions)
+        {
+            trials.clear();
+            for (const std::pair<const std::pair<uint32_t, uint32_t>, ArchiveTrial> &trial : entry.second.trials)
+            {
+                trials.push_back(trial.second);
+            }
+            writer.addSession(entry.second.info, trials);
+            stats.sessions++;
+            stats.trials += trials.size();
+        }
+        stats.errors = collector->errors;
+    }
+
+    std::vector<std::string> listLogFiles(const std::vector<std::string> &paths)
+    {
+        // Directories expand into their regular files, in a stable order
+        std::vector<std::string> files;
+        for (const std::string &path : paths)
+        {
+            std::error_code ec;
+            if (!std::filesystem::is_directory(path, ec))
+            {
+                files.push_back(path);
+                continue;
+            }
+            std::vector<std::string> found;
+            for (const auto &entry : std::filesystem::recursive_directory_iterator(path, ec))
+            {
+                if (entry.is_regular_file())
+                {
+                    found.push_back(entry.path().string());
+                }
+            }
+            std::sort(found.begin(), found.end());
+            files.insert(files.end(), found.begin(), found.end());
+        }
+        return files;
+    }
+}
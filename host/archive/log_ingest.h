@@ -0,0 +1,57 @@
+#ifndef LOG_INGEST_H
+#define LOG_INGEST_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "session_archive.h"
+
+//==============================================================================
+// Log Ingest
+//==============================================================================
+//
+// Collects sessions from existing text logs for the archive: raw serial
+// captures (write> events and get_data dumps) and saved CSV files that start
+// with a Format= header, such as the aggregator's session files. A session is
+// identified by study ID and session number across all files; its trials come
+// from a get_data dump when one was captured, otherwise from its
+// trial_complete events.
+
+namespace host
+{
+    struct IngestStats
+    {
+        uint64_t files;
+        uint64_t bytes;
+        uint64_t sessions;
+        uint64_t trials;
+        uint64_t errors; // Malformed rows skipped
+    };
+
+    class LogIngest
+    {
+    public:
+        LogIngest();
+        ~LogIngest();
+
+        // Read one file or every file below a directory
+        bool addPath(const std::string &path, std::string &error);
+
+        // Hand the sessions to the writer, ordered by study ID and session number
+        void writeTo(ArchiveWriter &writer);
+
+        const IngestStats &getStats() const { return stats; }
+
+    private:
+        bool addFile(const std::string &path, std::string &error);
+
+        struct Collector;
+        Collector *collector;
+        IngestStats stats;
+    };
+
+    // Expand directories (recursively) into their files
+    std::vector<std::string> listLogFiles(const std::vector<std::string> &paths);
+}
+
+#endif // LOG_INGEST_H
@@ -0,0 +1,323 @@
+#include "session_archive.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <fstream>
+
+namespace host
+{
+    static const char ARCHIVE_MAGIC[4] = {'N', 'B', 'C', 'A'};
+    static const uint32_t ARCHIVE_VERSION = 1;
+
+    struct ArchiveHeader
+    {
+        char magic[4];
+        uint32_t version;
+        uint64_t trialCount;
+        uint32_t sessionCount;
+        uint32_t columnCount;
+        uint64_t columnTableOffset;
+        uint64_t sessionTableOffset;
+        uint64_t stringTableOffset;
+        uint64_t stringTableSize;
+    };
+
+    struct ColumnEntry
+    {
+        uint64_t blockTableOffset;
+        uint32_t blockCount;
+        uint32_t reserved;
+        uint64_t packedBytes;
+    };
+
+    struct SessionEntry
+    {
+        uint64_t firstTrial;
+        uint32_t trialCount;
+        uint32_t studyOffset; // Into the string table
+        uint16_t studyLength;
+        uint16_t sessionNumber;
+        uint32_t startTimeMillis;
+        uint16_t stimulusDuration;
+        uint16_t interStimulusInterval;
+        uint8_t nBackLevel;
+        uint8_t reserved[7];
+    };
+
+    static const char *COLUMN_NAMES[ARCHIVE_COLUMN_COUNT] = {
+        "stimulus_number", "stimulus_color", "is_target", "response_made", "is_correct",
+        "reaction_time", "stimulus_onset_time", "response_time", "stimulus_end_time"};
+
+    const char *archiveColumnName(ArchiveColumn column)
+    {
+        return column >= 0 && column < ARCHIVE_COLUMN_COUNT ? COLUMN_NAMES[column] : "unknown";
+    }
+
+    //==============================================================================
+    // Writer
+    //==============================================================================
+
+    void ArchiveWriter::addSession(const ArchiveSession &session, const std::vector<ArchiveTrial> &trials)
+    {
+        ArchiveSession entry = session;
+        entry.firstTrial = trialCount();
+        entry.trialCount = (uint32_t)trials.size();
+        sessions.push_back(entry);
+
+        for (const ArchiveTrial &trial : trials)
+        {
+            for (int c = 0; c < ARCHIVE_COLUMN_COUNT; c++)
+            {
+                columns[c].push_back(trial.values[c]);
+            }
+        }
+    }
+
+    template <typename T>
+    static void append(std::string &out, const T &value)
+    {
+        out.append((const char *)&value, sizeof(value));
+    }
+
+    bool ArchiveWriter::write(const std::string &path, std::string &error)
+    {
+        std::string out(sizeof(ArchiveHeader), '\0');
+
+        // Column data, 8-byte aligned blocks
+        std::vector<BlockHeader> blockTables[ARCHIVE_COLUMN_COUNT];
+        ColumnEntry columnTable[ARCHIVE_COLUMN_COUNT];
+        for (int c = 0; c < ARCHIVE_COLUMN_COUNT; c++)
+        {
+            const std::vector<uint32_t> &values = columns[c];
+            size_t columnStart = out.size();
+            for (size_t first = 0; first < values.size(); first += ARCHIVE_BLOCK_VALUES)
+            {
+                uint32_t count = (uint32_t)std::min<size_t>(ARCHIVE_BLOCK_VALUES, values.size() - first);
+                BlockHeader header;
+                header.dataOffset = out.size();
+                encodeBlock(&values[first], count, header, out);
+                blockTables[c].push_back(header);
+            }
+            columnTable[c].packedBytes = out.size() - columnStart;
+        }
+
+        for (int c = 0; c < ARCHIVE_COLUMN_COUNT; c++)
+        {
+            columnTable[c].blockTableOffset = out.size();
+            columnTable[c].blockCount = (uint32_t)blockTables[c].size();
+            columnTable[c].reserved = 0;
+            for (const BlockHeader &header : blockTables[c])
+            {
+                append(out, header);
+            }
+        }
+
+        ArchiveHeader header;
+        memcpy(header.magic, ARCHIVE_MAGIC, sizeof(header.magic));
+        header.version = ARCHIVE_VERSION;
+        header.trialCount = trialCount();
+        header.sessionCount = (uint32_t)sessions.size();
+        header.columnCount = ARCHIVE_COLUMN_COUNT;
+        header.columnTableOffset = out.size();
+        for (int c = 0; c < ARCHIVE_COLUMN_COUNT; c++)
+        {
+            append(out, columnTable[c]);
+        }
+
+        std::string strings;
+        header.sessionTableOffset = out.size();
+        for (const ArchiveSession &session : sessions)
+        {
+            SessionEntry entry = {};
+            entry.firstTrial = session.firstTrial;
+            entry.trialCount = session.trialCount;
+            entry.studyOffset = (uint32_t)strings.size();
+            entry.studyLength = (uint16_t)std::min<size_t>(session.studyId.size(), UINT16_MAX);
+            entry.sessionNumber = session.sessionNumber;
+            entry.startTimeMillis = session.startTimeMillis;
+            entry.stimulusDuration = session.stimulusDuration;
+            entry.interStimulusInterval = session.interStimulusInterval;
+            entry.nBackLevel = session.nBackLevel;
+            strings.append(session.studyId, 0, entry.studyLength);
+            append(out, entry);
+        }
+        header.stringTableOffset = out.size();
+        header.stringTableSize = strings.size();
+        out += strings;
+        memcpy(&out[0], &header, sizeof(header));
+
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(out.data(), (std::streamsize)out.size());
+        if (!file)
+        {
+            error = "cannot write " + path;
+            return false;
+        }
+        return true;
+    }
+
+    //==============================================================================
+    // Reader
+    //==============================================================================
+
+    ArchiveReader::ArchiveReader() : fd(-1), base(nullptr), size(0) {}
+
+    ArchiveReader::~ArchiveReader()
+    {
+        close();
+    }
+
+    void ArchiveReader::close()
+    {
+        if (base)
+        {
+            munmap((void *)base, size);
+            base = nullptr;
+        }
+        if (fd >= 0)
+        {
+            ::close(fd);
+            fd = -1;
+        }
+        size = 0;
+    }
+
+    static const ArchiveHeader &headerOf(const uint8_t *base)
+    {
+        return *(const ArchiveHeader *)base;
+    }
+
+    bool ArchiveReader::open(const std::string &path, std::string &error)
+    {
+        close();
+        fd = ::open(path.c_str(), O_RDONLY);
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) != 0)
+        {
+            error = "cannot open " + path;
+            close();
+            return false;
+        }
+        size = (size_t)st.st_size;
+        if (size < sizeof(ArchiveHeader))
+        {
+            error = path + ": not a session archive";
+            close();
+            return false;
+        }
+        void *mapped = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        if (mapped == MAP_FAILED)
+        {
+            error = "cannot map " + path;
+            size = 0;
+            close();
+            return false;
+        }
+        base = (const uint8_t *)mapped;
+
+        // Check every offset once so accessors can trust them
+        const ArchiveHeader &h = headerOf(base);
+        bool valid = memcmp(h.magic, ARCHIVE_MAGIC, 4) == 0 && h.version == ARCHIVE_VERSION &&
+                     h.columnCount == ARCHIVE_COLUMN_COUNT &&
+                     h.columnTableOffset + sizeof(ColumnEntry) * ARCHIVE_COLUMN_COUNT <= size &&
+                     h.sessionTableOffset + (uint64_t)sizeof(SessionEntry) * h.sessionCount <= size &&
+                     h.stringTableOffset + h.stringTableSize <= size;
+        for (int c = 0; valid && c < ARCHIVE_COLUMN_COUNT; c++)
+        {
+            const ColumnEntry &column = ((const ColumnEntry *)(base + h.columnTableOffset))[c];
+            valid = column.blockTableOffset + (uint64_t)sizeof(BlockHeader) * column.blockCount <= size;
+            uint64_t rows = 0;
+            for (uint32_t b = 0; valid && b < column.blockCount; b++)
+            {
+                const BlockHeader &block = ((const BlockHeader *)(base + column.blockTableOffset))[b];
+                valid = block.count <= ARCHIVE_BLOCK_VALUES && block.width <= 64 &&
+                        block.dataOffset + packedBytes(block.count, block.width) <= size &&
+                        (block.count == ARCHIVE_BLOCK_VALUES || b + 1 == column.blockCount);
+                rows += block.count;
+            }
+            valid = valid && rows == h.trialCount;
+        }
+        for (uint32_t s = 0; valid && s < h.sessionCount; s++)
+        {
+            const SessionEntry &entry = ((const SessionEntry *)(base + h.sessionTableOffset))[s];
+            valid = entry.firstTrial + entry.trialCount <= h.trialCount &&
+                    (uint64_t)entry.studyOffset + entry.studyLength <= h.stringTableSize;
+        }
+        if (!valid)
+        {
+            error = path + ": corrupt or unsupported session archive";
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    uint64_t ArchiveReader::trialCount() const
+    {
+        return headerOf(base).trialCount;
+    }
+
+    uint32_t ArchiveReader::sessionCount() const
+    {
+        return headerOf(base).sessionCount;
+    }
+
+    ArchiveSession ArchiveReader::session(uint32_t index) const
+    {
+        const ArchiveHeader &h = headerOf(base);
+        const SessionEntry &entry = ((const SessionEntry *)(base + h.sessionTableOffset))[index];
+
+        ArchiveSession session;
+        session.studyId.assign((const char *)base + h.stringTableOffset + entry.studyOffset, entry.studyLength);
+        session.sessionNumber = entry.sessionNumber;
+        session.startTimeMillis = entry.startTimeMillis;
+        session.nBackLevel = entry.nBackLevel;
+        session.stimulusDuration = entry.stimulusDuration;
+        session.interStimulusInterval = entry.interStimulusInterval;
+        session.firstTrial = entry.firstTrial;
+        session.trialCount = entry.trialCount;
+        return session;
+    }
+
+    const BlockHeader *ArchiveReader::blockTable(ArchiveColumn column) const
+    {
+        const ArchiveHeader &h = headerOf(base);
+        const ColumnEntry &entry = ((const ColumnEntry *)(base + h.columnTableOffset))[column];
+        return (const BlockHeader *)(base + entry.blockTableOffset);
+    }
+
+    uint32_t ArchiveReader::blockCount(ArchiveColumn column) const
+    {
+        const ArchiveHeader &h = headerOf(base);
+        return ((const ColumnEntry *)(base + h.columnTableOffset))[column].blockCount;
+    }
+
+    uint64_t ArchiveReader::columnBytes(ArchiveColumn column) const
+    {
+        const ArchiveHeader &h = headerOf(base);
+        return ((const ColumnEntry *)(base + h.columnTableOffset))[column].packedBytes;
+    }
+
+    void ArchiveReader::readColumn(ArchiveColumn column, uint64_t first, uint64_t count, uint32_t *out) const
+    {
+        uint32_t values[ARCHIVE_BLOCK_VALUES];
+        const BlockHeader *blocks = blockTable(column);
+
+        // Every block but the last is full, so the block of a row is row / size
+        while (count > 0)
+        {
+            uint64_t b = first / ARCHIVE_BLOCK_VALUES;
+            uint32_t offset = (uint32_t)(first % ARCHIVE_BLOCK_VALUES);
+            decodeBlock(blocks[b], base + blocks[b].dataOffset, values);
+            uint64_t take = std::min<uint64_t>(count, blocks[b].count - offset);
+            memcpy(out, values + offset, take * sizeof(uint32_t));
+            out += take;
+            first += take;
+            count -= take;
+        }
+    }
+}
@@ -0,0 +1,129 @@
+#ifndef SESSION_ARCHIVE_H
+#define SESSION_ARCHIVE_H
+
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "column_codec.h"
+
+//==============================================================================
+// Session Archive
+//==============================================================================
+//
+// Columnar store for the trials of many sessions. Each NBackTrialData field is
+// one column of block-encoded values (column_codec.h); a session index maps
+// every session to its range of trial rows. The file is written once and read
+// through mmap, so a scan only touches the pages of the columns it uses.
+//
+// Layout (little-endian):
+//
+//   ArchiveHeader
+//   packed column blocks
+//   BlockHeader tables, one per column
+//   ColumnEntry[ARCHIVE_COLUMN_COUNT]
+//   SessionEntry[sessionCount]
+//   string table (study IDs)
+
+namespace host
+{
+    // One column per NBackTrialData field
+    enum ArchiveColumn
+    {
+        COLUMN_STIMULUS_NUMBER,
+        COLUMN_STIMULUS_COLOR, // ColorIndex, 255 if unknown
+        COLUMN_IS_TARGET,
+        COLUMN_RESPONSE_MADE,
+        COLUMN_IS_CORRECT,
+        COLUMN_REACTION_TIME,
+        COLUMN_STIMULUS_ONSET_TIME,
+        COLUMN_RESPONSE_TIME,
+        COLUMN_STIMULUS_END_TIME,
+        ARCHIVE_COLUMN_COUNT
+    };
+
+    const char *archiveColumnName(ArchiveColumn column);
+
+    // One trial as the firmware records it
+    struct ArchiveTrial
+    {
+        uint32_t values[ARCHIVE_COLUMN_COUNT];
+    };
+
+    // Session metadata kept in the index
+    struct ArchiveSession
+    {
+        std::string studyId;
+        uint16_t sessionNumber;
+        uint32_t startTimeMillis;       // Device millis at session start, 0 if unknown
+        uint8_t nBackLevel;             // 0 if unknown
+        uint16_t stimulusDuration;      // ms, 0 if unknown
+        uint16_t interStimulusInterval; // ms, 0 if unknown
+        uint64_t firstTrial;            // Row of its first trial
+        uint32_t trialCount;
+    };
+
+    class ArchiveWriter
+    {
+    public:
+        // Add a session and its trials; rows are appended in call order
+        void addSession(const ArchiveSession &session, const std::vector<ArchiveTrial> &trials);
+
+        // Encode everything into `path`; false (with `error`) on I/O failure
+        bool write(const std::string &path, std::string &error);
+
+        uint64_t trialCount() const { return columns[0].size(); }
+
+        // Values added so far, one per trial row
+        const std::vector<uint32_t> &column(ArchiveColumn c) const { return columns[c]; }
+
+    private:
+        std::vector<uint32_t> columns[ARCHIVE_COLUMN_COUNT];
+        std::vector<ArchiveSession> sessions;
+    };
+
+    class ArchiveReader
+    {
+    public:
+        ArchiveReader();
+        ~ArchiveReader();
+
+        bool open(const std::string &path, std::string &error);
+        void close();
+
+        uint64_t trialCount() const;
+        uint32_t sessionCount() const;
+        ArchiveSession session(uint32_t index) const;
+
+        // Bytes the column occupies on disk (packed data only)
+        uint64_t columnBytes(ArchiveColumn column) const;
+
+        // Decode rows [first, first + count) of one column into `out`; the rows must exist
+        void readColumn(ArchiveColumn column, uint64_t first, uint64_t count, uint32_t *out) const;
+
+        // Decode a column block by block: visit(values, count, firstRow)
+        template <typename Visitor>
+        void scanColumn(ArchiveColumn column, Visitor visit) const
+        {
+            uint32_t values[ARCHIVE_BLOCK_VALUES];
+            uint64_t row = 0;
+            const BlockHeader *blocks = blockTable(column);
+            for (uint32_t b = 0; b < blockCount(column); b++)
+            {
+                decodeBlock(blocks[b], base + blocks[b].dataOffset, values);
+                visit((const uint32_t *)values, blocks[b].count, row);
+                row += blocks[b].count;
+            }
+        }
+
+    private:
+        const BlockHeader *blockTable(ArchiveColumn column) const;
+        uint32_t blockCount(ArchiveColumn column) const;
+
+        int fd;
+        const uint8_t *base;
+        size_t size;
+    };
+}
+
+#endif // SESSION_ARCHIVE_H
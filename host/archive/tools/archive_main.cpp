@@ -0,0 +1,259 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "log_ingest.h"
+#include "session_archive.h"
+
+//==============================================================================
+// Session Archive Tool
+//==============================================================================
+//
+// Converts logged sessions into a columnar archive and queries it.
+//
+//   nback-archive convert OUT FILE|DIR...   build an archive from logs and CSV files
+//   nback-archive info ARCHIVE              sessions and per-column sizes
+//   nback-archive export ARCHIVE [INDEX]    trials as CSV (all sessions or one)
+//   nback-archive bench ARCHIVE FILE|DIR... mean RT and accuracy from the archive
+//                                           vs. re-parsing the source logs
+
+using namespace host;
+
+static const char *COLOR_NAMES[] = {"red", "green", "blue", "yellow", "purple"};
+
+static const char *colorName(uint32_t index)
+{
+    return index < sizeof(COLOR_NAMES) / sizeof(COLOR_NAMES[0]) ? COLOR_NAMES[index] : "unknown";
+}
+
+static const char *boolName(uint32_t value)
+{
+    return value ? "true" : "false";
+}
+
+static double secondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static bool ingest(const std::vector<std::string> &paths, ArchiveWriter &writer, IngestStats &stats)
+{
+    LogIngest logs;
+    for (const std::string &path : paths)
+    {
+        std::string error;
+        if (!logs.addPath(path, error))
+        {
+            fprintf(stderr, "nback-archive: %s\n", error.c_str());
+            return false;
+        }
+    }
+    logs.writeTo(writer);
+    stats = logs.getStats();
+    return true;
+}
+
+static int convert(const std::string &out, const std::vector<std::string> &paths)
+{
+    ArchiveWriter writer;
+    IngestStats stats;
+    if (!ingest(paths, writer, stats))
+    {
+        return 1;
+    }
+    std::string error;
+    if (!writer.write(out, error))
+    {
+        fprintf(stderr, "nback-archive: %s\n", error.c_str());
+        return 1;
+    }
+
+    struct stat st;
+    uint64_t archiveBytes = stat(out.c_str(), &st) == 0 ? (uint64_t)st.st_size : 0;
+    printf("%llu files, %llu bytes -> %s: %llu sessions, %llu trials, %llu bytes (%.1fx)",
+           (unsigned long long)stats.files, (unsigned long long)stats.bytes, out.c_str(),
+           (unsigned long long)stats.sessions, (unsigned long long)stats.trials, (unsigned long long)archiveBytes,
+           archiveBytes ? (double)stats.bytes / archiveBytes : 0.0);
+    if (stats.errors)
+    {
+        printf(", %llu malformed rows skipped", (unsigned long long)stats.errors);
+    }
+    printf("\n");
+    return 0;
+}
+
+static int info(const ArchiveReader &archive)
+{
+    printf("%llu trials in %u sessions\n\n", (unsigned long long)archive.trialCount(), archive.sessionCount());
+
+    printf("%-20s %12s %12s %8s\n", "column", "raw_bytes", "packed_bytes", "ratio");
+    uint64_t raw = archive.trialCount() * sizeof(uint32_t);
+    for (int c = 0; c < ARCHIVE_COLUMN_COUNT; c++)
+    {
+        uint64_t packed = archive.columnBytes((ArchiveColumn)c);
+        printf("%-20s %12llu %12llu %7.1fx\n", archiveColumnName((ArchiveColumn)c), (unsigned long long)raw,
+               (unsigned long long)packed, packed ? (double)raw / packed : 0.0);
+    }
+
+    printf("\n%5s %-16s %7s %6s %6s %6s %10s %7s\n", "index", "study_id", "session", "n", "stim", "isi",
+           "start_ms", "trials");
+    for (uint32_t s = 0; s < archive.sessionCount(); s++)
+    {
+        ArchiveSession session = archive.session(s);
+        printf("%5u %-16s %7u %6u %6u %6u %10u %7u\n", s, session.studyId.c_str(), session.sessionNumber,
+               session.nBackLevel, session.stimulusDuration, session.interStimulusInterval,
+               session.startTimeMillis, session.trialCount);
+    }
+    return 0;
+}
+
+static int exportCsv(const ArchiveReader &archive, long only)
+{
+    printf("Format=study_id,session_number,stimulus_number,stimulus_color,is_target,response_made,is_correct,"
+           "stimulus_onset_time,response_time,reaction_time,stimulus_end_time\n");
+
+    std::vector<uint32_t> columns[ARCHIVE_COLUMN_COUNT];
+    for (uint32_t s = 0; s < archive.sessionCount(); s++)
+    {
+        if (only >= 0 && (uint32_t)only != s)
+        {
+            continue;
+        }
+        ArchiveSession session = archive.session(s);
+        for (int c = 0; c < ARCHIVE_COLUMN_COUNT; c++)
+        {
+            columns[c].resize(session.trialCount);
+            archive.readColumn((ArchiveColumn)c, session.firstTrial, session.trialCount, columns[c].data());
+        }
+        for (uint32_t t = 0; t < session.trialCount; t++)
+        {
+            printf("%s,%u,%u,%s,%s,%s,%s,%u,%u,%u,%u\n", session.studyId.c_str(), session.sessionNumber,
+                   columns[COLUMN_STIMULUS_NUMBER][t], colorName(columns[COLUMN_STIMULUS_COLOR][t]),
+                   boolName(columns[COLUMN_IS_TARGET][t]), boolName(columns[COLUMN_RESPONSE_MADE][t]),
+                   boolName(columns[COLUMN_IS_CORRECT][t]), columns[COLUMN_STIMULUS_ONSET_TIME][t],
+                   columns[COLUMN_RESPONSE_TIME][t], columns[COLUMN_REACTION_TIME][t],
+                   columns[COLUMN_STIMULUS_END_TIME][t]);
+        }
+    }
+    return 0;
+}
+
+// Mean RT of trials with a response, and overall accuracy
+struct Summary
+{
+    uint64_t trials;
+    uint64_t responses;
+    uint64_t correct;
+    uint64_t rtSum;
+};
+
+static int bench(const ArchiveReader &archive, const std::vector<std::string> &paths)
+{
+    // Archive: three columns, decoded block by block straight from the mapping
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    Summary fromArchive = {};
+    std::vector<uint8_t> responded(archive.trialCount());
+    archive.scanColumn(COLUMN_RESPONSE_MADE, [&](const uint32_t *values, uint32_t count, uint64_t row) {
+        for (uint32_t i = 0; i < count; i++)
+        {
+            responded[row + i] = (uint8_t)values[i];
+            fromArchive.responses += values[i];
+        }
+    });
+    archive.scanColumn(COLUMN_REACTION_TIME, [&](const uint32_t *values, uint32_t count, uint64_t row) {
+        for (uint32_t i = 0; i < count; i++)
+        {
+            fromArchive.rtSum += responded[row + i] ? values[i] : 0;
+        }
+    });
+    archive.scanColumn(COLUMN_IS_CORRECT, [&](const uint32_t *values, uint32_t count, uint64_t) {
+        fromArchive.trials += count;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            fromArchive.correct += values[i];
+        }
+    });
+    double archiveSeconds = secondsSince(start);
+
+    // Logs: read and parse every file again
+    start = std::chrono::steady_clock::now();
+    ArchiveWriter rebuilt;
+    IngestStats stats;
+    if (!ingest(paths, rebuilt, stats))
+    {
+        return 1;
+    }
+    Summary fromLogs = {};
+    const std::vector<uint32_t> &made = rebuilt.column(COLUMN_RESPONSE_MADE);
+    const std::vector<uint32_t> &rt = rebuilt.column(COLUMN_REACTION_TIME);
+    const std::vector<uint32_t> &correct = rebuilt.column(COLUMN_IS_CORRECT);
+    for (size_t i = 0; i < made.size(); i++)
+    {
+        fromLogs.trials++;
+        fromLogs.responses += made[i];
+        fromLogs.rtSum += made[i] ? rt[i] : 0;
+        fromLogs.correct += correct[i];
+    }
+    double logSeconds = secondsSince(start);
+
+    uint64_t archiveBytes = archive.columnBytes(COLUMN_RESPONSE_MADE) + archive.columnBytes(COLUMN_REACTION_TIME) +
+                            archive.columnBytes(COLUMN_IS_CORRECT);
+    double meanRt = fromArchive.responses ? (double)fromArchive.rtSum / fromArchive.responses : 0.0;
+    double accuracy = fromArchive.trials ? (double)fromArchive.correct / fromArchive.trials : 0.0;
+    bool agree = fromArchive.trials == fromLogs.trials && fromArchive.responses == fromLogs.responses &&
+                 fromArchive.rtSum == fromLogs.rtSum && fromArchive.correct == fromLogs.correct;
+
+    printf("=== ARCHIVE SCAN vs LOG PARSE (%llu trials) ===\n", (unsigned long long)fromArchive.trials);
+    printf("mean_rt_ms %.1f  accuracy %.3f  %s\n", meanRt, accuracy, agree ? "(both paths agree)" : "(MISMATCH)");
+    printf("%-12s %10s %14s %10s %10s\n", "path", "ms", "trials/s", "bytes", "MB/s");
+    printf("%-12s %10.2f %14.0f %10llu %10.1f\n", "archive", archiveSeconds * 1e3, fromArchive.trials / archiveSeconds,
+           (unsigned long long)archiveBytes, archiveBytes / (1024.0 * 1024.0) / archiveSeconds);
+    printf("%-12s %10.2f %14.0f %10llu %10.1f\n", "logs", logSeconds * 1e3, fromLogs.trials / logSeconds,
+           (unsigned long long)stats.bytes, stats.bytes / (1024.0 * 1024.0) / logSeconds);
+    printf("speedup %.1fx\n", logSeconds / archiveSeconds);
+    return agree ? 0 : 1;
+}
+
+static int usage()
+{
+    fprintf(stderr, "usage: nback-archive convert OUT FILE|DIR...\n"
+                    "       nback-archive info ARCHIVE\n"
+                    "       nback-archive export ARCHIVE [INDEX]\n"
+                    "       nback-archive bench ARCHIVE FILE|DIR...\n");
+    return 2;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 3)
+    {
+        return usage();
+    }
+    std::string command = argv[1];
+    std::vector<std::string> rest(argv + 3, argv + argc);
+
+    if (command == "convert")
+    {
+        return rest.empty() ? usage() : convert(argv[2], rest);
+    }
+    if (command != "info" && command != "export" && command != "bench")
+    {
+        return usage();
+    }
+
+    ArchiveReader archive;
+    std::string error;
+    if (!archive.open(argv[2], error))
+    {
+        fprintf(stderr, "nback-archive: %s\n", error.c_str());
+        return 1;
+    }
+    if (command == "info")
+        return info(archive);
+    if (command == "export")
+        return exportCsv(archive, rest.empty() ? -1 : atol(rest[0].c_str()));
+    return rest.empty() ? usage() : bench(archive, rest);
+}
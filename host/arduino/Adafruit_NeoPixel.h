@@ -0,0 +1,79 @@
+#ifndef ADAFRUIT_NEOPIXEL_H
+#define ADAFRUIT_NEOPIXEL_H
+
+//==============================================================================
+// Host NeoPixel Strip
+//==============================================================================
+//
+// Stand-in for Adafruit_NeoPixel in the host builds. show() takes as long as
+// the real 800 kHz transfer and reports the latched colours to the runtime's
+// pixel observers at the moment the strip would update.
+
+#include <Arduino.h>
+#include <vector>
+
+typedef uint16_t neoPixelType;
+
+#define NEO_RGB ((0 << 6) | (0 << 4) | (1 << 2) | (2))
+#define NEO_GRB ((1 << 6) | (1 << 4) | (0 << 2) | (2))
+#define NEO_KHZ800 0x0000
+#define NEO_KHZ400 0x0100
+
+class Adafruit_NeoPixel
+{
+public:
+    Adafruit_NeoPixel(uint16_t n, int16_t pin = 6, neoPixelType type = NEO_GRB + NEO_KHZ800)
+        : pin(pin), brightness(0), pixels(n, 0)
+    {
+        (void)type;
+    }
+
+    void begin() {}
+
+    void show()
+    {
+        host::Runtime::get().showPixels(pixels.data(), (uint16_t)pixels.size());
+    }
+
+    void setPin(int16_t p) { pin = p; }
+
+    void setPixelColor(uint16_t n, uint32_t c)
+    {
+        if (n < pixels.size())
+        {
+            pixels[n] = c & 0xFFFFFF;
+        }
+    }
+
+    void setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b)
+    {
+        setPixelColor(n, Color(r, g, b));
+    }
+
+    void setBrightness(uint8_t b) { brightness = b; }
+    uint8_t getBrightness() const { return brightness; }
+
+    void clear()
+    {
+        for (uint32_t &c : pixels)
+        {
+            c = 0;
+        }
+    }
+
+    uint32_t getPixelColor(uint16_t n) const { return n < pixels.size() ? pixels[n] : 0; }
+    uint16_t numPixels() const { return (uint16_t)pixels.size(); }
+    bool canShow() const { return true; }
+
+    static uint32_t Color(uint8_t r, uint8_t g, uint8_t b)
+    {
+        return ((uint32_t)r << 16) | ((uint32_t)g << 8) | b;
+    }
+
+private:
+    int16_t pin;
+    uint8_t brightness;
+    std::vector<uint32_t> pixels;
+};
+
+#endif // ADAFRUIT_NEOPIXEL_H
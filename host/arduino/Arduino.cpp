@@ -0,0 +1,732 @@
+#include "Arduino.h"
+
+#include <ctype.h>
+#include <stdarg.h>
+
+using host::Runtime;
+
+//==============================================================================
+// Core Functions
+//==============================================================================
+
+unsigned long millis()
+{
+    return (unsigned long)(Runtime::get().now() / 1000);
+}
+
+unsigned long micros()
+{
+    return (unsigned long)Runtime::get().now();
+}
+
+void delay(unsigned long ms)
+{
+    Runtime::get().advance((host::Micros)ms * 1000);
+}
+
+void delayMicroseconds(unsigned int us)
+{
+    Runtime::get().advance(us);
+}
+
+void yield()
+{
+    Runtime::get().pump();
+}
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+    // Inputs are modelled as pulled up until a script drives them, unless
+    // they are pulled down
+    if (mode == INPUT_PULLDOWN)
+    {
+        Runtime::get().setInputPull(pin, LOW);
+    }
+    else if (mode == INPUT_PULLUP)
+    {
+        Runtime::get().setInputPull(pin, HIGH);
+    }
+}
+
+int digitalRead(uint8_t pin)
+{
+    Runtime &rt = Runtime::get();
+    rt.advance(rt.costs.digitalRead);
+    return rt.digitalLevel(pin) ? HIGH : LOW;
+}
+
+void digitalWrite(uint8_t pin, uint8_t level)
+{
+    Runtime::get().writeOutput(pin, level ? HIGH : LOW);
+}
+
+void attachInterruptArg(uint8_t pin, void (*handler)(void *), void *arg, int mode)
+{
+    Runtime::get().attachInterrupt(pin, [handler, arg]()
+                                   { handler(arg); }, mode);
+}
+
+void detachInterrupt(uint8_t pin)
+{
+    Runtime::get().detachInterrupt(pin);
+}
+
+uint16_t analogRead(uint8_t pin)
+{
+    // A floating ADC pin: 12-bit noise from the seeded runtime generator
+    (void)pin;
+    return (uint16_t)(Runtime::get().nextRandom() & 0x0FFF);
+}
+
+uint16_t touchRead(uint8_t pin)
+{
+    Runtime &rt = Runtime::get();
+    rt.advance(rt.costs.touchRead);
+    int value = rt.touchValue(pin);
+    return (uint16_t)(value < 0 ? 0 : value);
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task)
+{
+    // The firmware only runs the loop task
+    (void)task;
+    return Runtime::get().memory.stackHighWater;
+}
+
+//------------------------------------------------------------------------------
+// random() keeps its own state so randomSeed() does not disturb sensor noise
+//------------------------------------------------------------------------------
+
+static uint32_t randomState = 1;
+
+static uint32_t nextRandomValue()
+{
+    // xorshift32
+    uint32_t x = randomState;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    randomState = x;
+    return x;
+}
+
+long random(long howbig)
+{
+    if (howbig <= 0)
+    {
+        return 0;
+    }
+    return (long)(nextRandomValue() % (uint32_t)howbig);
+}
+
+long random(long howsmall, long howbig)
+{
+    if (howsmall >= howbig)
+    {
+        return howsmall;
+    }
+    return random(howbig - howsmall) + howsmall;
+}
+
+void randomSeed(unsigned long seed)
+{
+    randomState = seed != 0 ? (uint32_t)seed : 1;
+}
+
+long map(long x, long in_min, long in_max, long out_min, long out_max)
+{
+    if (in_max == in_min)
+    {
+        return out_min;
+    }
+    return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+}
+
+//==============================================================================
+// String
+//==============================================================================
+
+static std::string formatInteger(unsigned long long value, bool negative, unsigned char base)
+{
+    if (base < 2)
+    {
+        base = 10;
+    }
+    char digits[66];
+    int pos = sizeof(digits) - 1;
+    digits[pos] = '\0';
+    do
+    {
+        unsigned int d = (unsigned int)(value % base);
+        digits[--pos] = (char)(d < 10 ? '0' + d : 'a' + d - 10);
+        value /= base;
+    } while (value > 0);
+    if (negative)
+    {
+        digits[--pos] = '-';
+    }
+    return std::string(digits + pos);
+}
+
+String::String(const char *cstr) : buffer(cstr ? cstr : "") {}
+String::String(const __FlashStringHelper *str) : buffer(str ? reinterpret_cast<const char *>(str) : "") {}
+String::String(char c) : buffer(1, c) {}
+String::String(unsigned char value, unsigned char base) : buffer(formatInteger(value, false, base)) {}
+String::String(int value, unsigned char base)
+    : buffer(base == 10 && value < 0 ? formatInteger(-(long long)value, true, base)
+                                     : formatInteger((unsigned int)value, false, base)) {}
+String::String(unsigned int value, unsigned char base) : buffer(formatInteger(value, false, base)) {}
+String::String(long value, unsigned char base)
+    : buffer(base == 10 && value < 0 ? formatInteger(-(long long)value, true, base)
+                                     : formatInteger((unsigned long)value, false, base)) {}
+String::String(unsigned long value, unsigned char base) : buffer(formatInteger(value, false, base)) {}
+
+String::String(float value, unsigned char decimalPlaces) : String((double)value, decimalPlaces) {}
+
+String::String(double value, unsigned char decimalPlaces)
+{
+    char tmp[64];
+    snprintf(tmp, sizeof(tmp), "%.*f", decimalPlaces, value);
+    buffer = tmp;
+}
+
+String &String::operator=(const char *cstr)
+{
+    buffer = cstr ? cstr : "";
+    return *this;
+}
+
+char String::charAt(unsigned int index) const
+{
+    return index < buffer.length() ? buffer[index] : '\0';
+}
+
+bool String::reserve(unsigned int size)
+{
+    buffer.reserve(size);
+    return true;
+}
+
+bool String::concat(const String &str)
+{
+    buffer += str.buffer;
+    return true;
+}
+
+bool String::concat(const char *cstr)
+{
+    if (cstr)
+    {
+        buffer += cstr;
+    }
+    return cstr != nullptr;
+}
+
+bool String::concat(char c)
+{
+    buffer += c;
+    return true;
+}
+
+String &String::operator+=(const String &rhs)
+{
+    concat(rhs);
+    return *this;
+}
+
+String &String::operator+=(const char *cstr)
+{
+    concat(cstr);
+    return *this;
+}
+
+String &String::operator+=(char c)
+{
+    concat(c);
+    return *this;
+}
+
+String &String::operator+=(int value)
+{
+    return *this += String(value);
+}
+
+String &String::operator+=(unsigned int value)
+{
+    return *this += String(value);
+}
+
+String &String::operator+=(long value)
+{
+    return *this += String(value);
+}
+
+String &String::operator+=(unsigned long value)
+{
+    return *this += String(value);
+}
+
+bool String::equalsIgnoreCase(const String &s) const
+{
+    if (buffer.length() != s.buffer.length())
+    {
+        return false;
+    }
+    for (size_t i = 0; i < buffer.length(); i++)
+    {
+        if (tolower((unsigned char)buffer[i]) != tolower((unsigned char)s.buffer[i]))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool String::startsWith(const String &prefix) const
+{
+    return startsWith(prefix, 0);
+}
+
+bool String::startsWith(const String &prefix, unsigned int offset) const
+{
+    if (offset > buffer.length() || prefix.buffer.length() > buffer.length() - offset)
+    {
+        return false;
+    }
+    return buffer.compare(offset, prefix.buffer.length(), prefix.buffer) == 0;
+}
+
+bool String::endsWith(const String &suffix) const
+{
+    if (suffix.buffer.length() > buffer.length())
+    {
+        return false;
+    }
+    return buffer.compare(buffer.length() - suffix.buffer.length(), suffix.buffer.length(), suffix.buffer) == 0;
+}
+
+int String::indexOf(char ch, unsigned int fromIndex) const
+{
+    size_t pos = buffer.find(ch, fromIndex);
+    return pos == std::string::npos ? -1 : (int)pos;
+}
+
+int String::indexOf(const String &str, unsigned int fromIndex) const
+{
+    size_t pos = buffer.find(str.buffer, fromIndex);
+    return pos == std::string::npos ? -1 : (int)pos;
+}
+
+int String::lastIndexOf(char ch) const
+{
+    size_t pos = buffer.rfind(ch);
+    return pos == std::string::npos ? -1 : (int)pos;
+}
+
+String String::substring(unsigned int beginIndex) const
+{
+    return substring(beginIndex, length());
+}
+
+String String::substring(unsigned int beginIndex, unsigned int endIndex) const
+{
+    // Arduino swaps reversed bounds and clamps to the string length
+    if (beginIndex > endIndex)
+    {
+        unsigned int tmp = beginIndex;
+        beginIndex = endIndex;
+        endIndex = tmp;
+    }
+    if (beginIndex >= buffer.length())
+    {
+        return String();
+    }
+    if (endIndex > buffer.length())
+    {
+        endIndex = buffer.length();
+    }
+    String out;
+    out.buffer = buffer.substr(beginIndex, endIndex - beginIndex);
+    return out;
+}
+
+void String::replace(const String &find, const String &replaceWith)
+{
+    if (find.buffer.empty())
+    {
+        return;
+    }
+    size_t pos = 0;
+    while ((pos = buffer.find(find.buffer, pos)) != std::string::npos)
+    {
+        buffer.replace(pos, find.buffer.length(), replaceWith.buffer);
+        pos += replaceWith.buffer.length();
+    }
+}
+
+void String::remove(unsigned int index)
+{
+    if (index < buffer.length())
+    {
+        buffer.erase(index);
+    }
+}
+
+void String::remove(unsigned int index, unsigned int count)
+{
+    if (index < buffer.length())
+    {
+        buffer.erase(index, count);
+    }
+}
+
+void String::toLowerCase()
+{
+    for (char &c : buffer)
+    {
+        c = (char)tolower((unsigned char)c);
+    }
+}
+
+void String::toUpperCase()
+{
+    for (char &c : buffer)
+    {
+        c = (char)toupper((unsigned char)c);
+    }
+}
+
+void String::trim()
+{
+    size_t begin = 0;
+    while (begin < buffer.length() && isspace((unsigned char)buffer[begin]))
+    {
+        begin++;
+    }
+    size_t end = buffer.length();
+    while (end > begin && isspace((unsigned char)buffer[end - 1]))
+    {
+        end--;
+    }
+    buffer = buffer.substr(begin, end - begin);
+}
+
+long String::toInt() const
+{
+    return atol(buffer.c_str());
+}
+
+float String::toFloat() const
+{
+    return (float)atof(buffer.c_str());
+}
+
+String operator+(const String &lhs, const String &rhs)
+{
+    String out(lhs);
+    out += rhs;
+    return out;
+}
+
+String operator+(const String &lhs, const char *rhs)
+{
+    String out(lhs);
+    out += rhs;
+    return out;
+}
+
+String operator+(const char *lhs, const String &rhs)
+{
+    String out(lhs);
+    out += rhs;
+    return out;
+}
+
+String operator+(const String &lhs, char rhs)
+{
+    String out(lhs);
+    out += rhs;
+    return out;
+}
+
+//==============================================================================
+// Print
+//==============================================================================
+
+size_t Print::write(const uint8_t *buffer, size_t size)
+{
+    size_t n = 0;
+    while (size--)
+    {
+        n += write(*buffer++);
+    }
+    return n;
+}
+
+size_t Print::print(const __FlashStringHelper *str)
+{
+    return write(reinterpret_cast<const char *>(str));
+}
+
+size_t Print::print(const String &str)
+{
+    return write((const uint8_t *)str.c_str(), str.length());
+}
+
+size_t Print::print(const char *str)
+{
+    return write(str);
+}
+
+size_t Print::print(char c)
+{
+    return write((uint8_t)c);
+}
+
+size_t Print::print(unsigned char value, int base)
+{
+    return print((unsigned long)value, base);
+}
+
+size_t Print::print(int value, int base)
+{
+    return print((long)value, base);
+}
+
+size_t Print::print(unsigned int value, int base)
+{
+    return print((unsigned long)value, base);
+}
+
+size_t Print::print(long value, int base)
+{
+    return print((long long)value, base);
+}
+
+size_t Print::print(unsigned long value, int base)
+{
+    return printNumber(value, (uint8_t)base);
+}
+
+size_t Print::print(long long value, int base)
+{
+    if (base == DEC && value < 0)
+    {
+        size_t n = print('-');
+        return n + printNumber((unsigned long long)(-(value + 1)) + 1, DEC);
+    }
+    return printNumber((unsigned long long)value, (uint8_t)base);
+}
+
+size_t Print::print(unsigned long long value, int base)
+{
+    return printNumber(value, (uint8_t)base);
+}
+
+size_t Print::print(double value, int digits)
+{
+    return printFloat(value, (uint8_t)digits);
+}
+
+size_t Print::println()
+{
+    return write("\r\n");
+}
+
+size_t Print::printf(const char *format, ...)
+{
+    char stackBuffer[128];
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(stackBuffer, sizeof(stackBuffer), format, args);
+    va_end(args);
+    if (len < 0)
+    {
+        return 0;
+    }
+    if ((size_t)len < sizeof(stackBuffer))
+    {
+        return write((const uint8_t *)stackBuffer, len);
+    }
+
+    std::string heapBuffer(len + 1, '\0');
+    va_start(args, format);
+    vsnprintf(&heapBuffer[0], heapBuffer.size(), format, args);
+    va_end(args);
+    return write((const uint8_t *)heapBuffer.data(), len);
+}
+
+size_t Print::printNumber(unsigned long long value, uint8_t base)
+{
+    std::string digits = formatInteger(value, false, base);
+    // Arduino prints hexadecimal digits in upper case
+    for (char &c : digits)
+    {
+        c = (char)toupper((unsigned char)c);
+    }
+    return write((const uint8_t *)digits.data(), digits.length());
+}
+
+size_t Print::printFloat(double number, uint8_t digits)
+{
+    // Same algorithm as the Arduino core so output matches the device
+    if (isnan(number))
+    {
+        return print("nan");
+    }
+    if (isinf(number))
+    {
+        return print("inf");
+    }
+    if (number > 4294967040.0 || number < -4294967040.0)
+    {
+        return print("ovf");
+    }
+
+    size_t n = 0;
+    if (number < 0.0)
+    {
+        n += print('-');
+        number = -number;
+    }
+
+    double rounding = 0.5;
+    for (uint8_t i = 0; i < digits; ++i)
+    {
+        rounding /= 10.0;
+    }
+    number += rounding;
+
+    unsigned long intPart = (unsigned long)number;
+    double remainder = number - (double)intPart;
+    n += print(intPart);
+
+    if (digits > 0)
+    {
+        n += print('.');
+    }
+    while (digits-- > 0)
+    {
+        remainder *= 10.0;
+        unsigned int toPrint = (unsigned int)remainder;
+        n += print(toPrint);
+        remainder -= toPrint;
+    }
+    return n;
+}
+
+//==============================================================================
+// Stream
+//==============================================================================
+
+int Stream::timedRead()
+{
+    unsigned long start = millis();
+    do
+    {
+        int c = read();
+        if (c >= 0)
+        {
+            return c;
+        }
+        waitForInput();
+    } while (millis() - start < timeout);
+    return -1;
+}
+
+String Stream::readString()
+{
+    String out;
+    int c = timedRead();
+    while (c >= 0)
+    {
+        out += (char)c;
+        c = timedRead();
+    }
+    return out;
+}
+
+String Stream::readStringUntil(char terminator)
+{
+    String out;
+    int c = timedRead();
+    while (c >= 0 && c != terminator)
+    {
+        out += (char)c;
+        c = timedRead();
+    }
+    return out;
+}
+
+size_t Stream::readBytes(uint8_t *buffer, size_t length)
+{
+    size_t count = 0;
+    while (count < length)
+    {
+        int c = timedRead();
+        if (c < 0)
+        {
+            break;
+        }
+        buffer[count++] = (uint8_t)c;
+    }
+    return count;
+}
+
+//==============================================================================
+// HardwareSerial
+//==============================================================================
+
+HardwareSerial Serial;
+
+void HardwareSerial::begin(unsigned long baud)
+{
+    Runtime::get().uart().begin(baud);
+}
+
+int HardwareSerial::available()
+{
+    return Runtime::get().uart().available();
+}
+
+int HardwareSerial::read()
+{
+    return Runtime::get().uart().read();
+}
+
+int HardwareSerial::peek()
+{
+    return Runtime::get().uart().peek();
+}
+
+int HardwareSerial::availableForWrite()
+{
+    return Runtime::get().uart().availableForWrite();
+}
+
+void HardwareSerial::flush()
+{
+    Runtime::get().uart().flush();
+}
+
+size_t HardwareSerial::write(uint8_t byte)
+{
+    return Runtime::get().uart().write(byte);
+}
+
+void HardwareSerial::waitForInput()
+{
+    Runtime &rt = Runtime::get();
+    host::VirtualUart &port = rt.uart();
+
+    // Jump straight to the next byte in flight, otherwise let a millisecond pass
+    if (port.hasPendingInput() && port.nextArrival() > rt.now())
+    {
+        rt.advanceTo(port.nextArrival());
+    }
+    else
+    {
+        rt.advance(1000);
+        rt.pump();
+    }
+}
@@ -0,0 +1,296 @@
+#ifndef ARDUINO_H
+#define ARDUINO_H
+
+//==============================================================================
+// Host Arduino Core
+//==============================================================================
+//
+// The subset of the Arduino-ESP32 API used by the firmware, implemented on top
+// of the virtual board in host_runtime.h. Only compiled into the host builds.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <string>
+
+#include "host_runtime.h"
+
+//==============================================================================
+// Constants and Types
+//==============================================================================
+
+#define HIGH 0x1
+#define LOW 0x0
+
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+#define INPUT_PULLDOWN 0x09
+
+#define RISING 0x01
+#define FALLING 0x02
+#define CHANGE 0x03
+
+#define IRAM_ATTR
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+#define A0 36
+
+#define PROGMEM
+#define PSTR(s) (s)
+#define memcpy_P(dest, src, n) memcpy((dest), (src), (n))
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define pgm_read_word(addr) (*(const uint16_t *)(addr))
+#define pgm_read_dword(addr) (*(const uint32_t *)(addr))
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+class __FlashStringHelper;
+#define F(string_literal) (reinterpret_cast<const __FlashStringHelper *>(string_literal))
+
+using std::max;
+using std::min;
+
+template <typename T, typename L, typename H>
+inline T constrain(T amount, L low, H high)
+{
+    return amount < low ? low : (amount > high ? high : amount);
+}
+
+//==============================================================================
+// Core Functions
+//==============================================================================
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+
+void pinMode(uint8_t pin, uint8_t mode);
+int digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t level);
+uint16_t analogRead(uint8_t pin);
+uint16_t touchRead(uint8_t pin);
+void touchSleepWakeUpEnable(uint8_t pin, uint16_t threshold); // See esp_sleep.h
+
+// GPIO interrupts: the handler runs when a driven input changes (host_runtime.h)
+#define digitalPinToInterrupt(p) (p)
+void attachInterruptArg(uint8_t pin, void (*handler)(void *), void *arg, int mode);
+void detachInterrupt(uint8_t pin);
+
+long random(long howbig);
+long random(long howsmall, long howbig);
+void randomSeed(unsigned long seed);
+long map(long x, long in_min, long in_max, long out_min, long out_max);
+
+//==============================================================================
+// FreeRTOS
+//==============================================================================
+
+typedef void *TaskHandle_t;
+typedef unsigned int UBaseType_t;
+
+// Least free stack of `task` (NULL: the calling task) so far, in bytes
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task);
+
+// Spinlock critical sections; the host runs timer callbacks between loop()
+// statements, never during one, so they have nothing to exclude
+typedef int portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED 0
+#define portENTER_CRITICAL(mux) ((void)(mux))
+#define portEXIT_CRITICAL(mux) ((void)(mux))
+
+//==============================================================================
+// String
+//==============================================================================
+
+class String
+{
+public:
+    String(const char *cstr = "");
+    String(const String &str) = default;
+    String(const __FlashStringHelper *str);
+    explicit String(char c);
+    explicit String(unsigned char value, unsigned char base = 10);
+    explicit String(int value, unsigned char base = 10);
+    explicit String(unsigned int value, unsigned char base = 10);
+    explicit String(long value, unsigned char base = 10);
+    explicit String(unsigned long value, unsigned char base = 10);
+    explicit String(float value, unsigned char decimalPlaces = 2);
+    explicit String(double value, unsigned char decimalPlaces = 2);
+
+    String &operator=(const String &rhs) = default;
+    String &operator=(const char *cstr);
+
+    // Access
+    unsigned int length() const { return (unsigned int)buffer.length(); }
+    bool isEmpty() const { return buffer.empty(); }
+    const char *c_str() const { return buffer.c_str(); }
+    char charAt(unsigned int index) const;
+    char operator[](unsigned int index) const { return charAt(index); }
+    bool reserve(unsigned int size);
+
+    // Concatenation
+    bool concat(const String &str);
+    bool concat(const char *cstr);
+    bool concat(char c);
+    String &operator+=(const String &rhs);
+    String &operator+=(const char *cstr);
+    String &operator+=(char c);
+    String &operator+=(int value);
+    String &operator+=(unsigned int value);
+    String &operator+=(long value);
+    String &operator+=(unsigned long value);
+
+    // Comparison
+    bool equals(const String &s) const { return buffer == s.buffer; }
+    bool equalsIgnoreCase(const String &s) const;
+    bool operator==(const String &rhs) const { return buffer == rhs.buffer; }
+    bool operator==(const char *cstr) const { return buffer == cstr; }
+    bool operator!=(const String &rhs) const { return buffer != rhs.buffer; }
+    bool operator!=(const char *cstr) const { return buffer != cstr; }
+    bool operator<(const String &rhs) const { return buffer < rhs.buffer; }
+    bool startsWith(const String &prefix) const;
+    bool startsWith(const String &prefix, unsigned int offset) const;
+    bool endsWith(const String &suffix) const;
+
+    // Search
+    int indexOf(char ch, unsigned int fromIndex = 0) const;
+    int indexOf(const String &str, unsigned int fromIndex = 0) const;
+    int lastIndexOf(char ch) const;
+    String substring(unsigned int beginIndex) const;
+    String substring(unsigned int beginIndex, unsigned int endIndex) const;
+
+    // Modification
+    void replace(const String &find, const String &replaceWith);
+    void remove(unsigned int index);
+    void remove(unsigned int index, unsigned int count);
+    void toLowerCase();
+    void toUpperCase();
+    void trim();
+
+    // Conversion
+    long toInt() const;
+    float toFloat() const;
+
+private:
+    std::string buffer;
+};
+
+String operator+(const String &lhs, const String &rhs);
+String operator+(const String &lhs, const char *rhs);
+String operator+(const char *lhs, const String &rhs);
+String operator+(const String &lhs, char rhs);
+
+//==============================================================================
+// Print / Stream / HardwareSerial
+//==============================================================================
+
+class Print
+{
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t byte) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size);
+    size_t write(const char *str) { return str ? write((const uint8_t *)str, strlen(str)) : 0; }
+
+    size_t print(const __FlashStringHelper *str);
+    size_t print(const String &str);
+    size_t print(const char *str);
+    size_t print(char c);
+    size_t print(unsigned char value, int base = DEC);
+    size_t print(int value, int base = DEC);
+    size_t print(unsigned int value, int base = DEC);
+    size_t print(long value, int base = DEC);
+    size_t print(unsigned long value, int base = DEC);
+    size_t print(long long value, int base = DEC);
+    size_t print(unsigned long long value, int base = DEC);
+    size_t print(double value, int digits = 2);
+
+    size_t println();
+    template <typename T>
+    size_t println(const T &value)
+    {
+        size_t n = print(value);
+        return n + println();
+    }
+    template <typename T>
+    size_t println(const T &value, int format)
+    {
+        size_t n = print(value, format);
+        return n + println();
+    }
+
+    size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+private:
+    size_t printNumber(unsigned long long value, uint8_t base);
+    size_t printFloat(double value, uint8_t digits);
+};
+
+class Stream : public Print
+{
+public:
+    Stream() : timeout(1000) {}
+
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+
+    void setTimeout(unsigned long timeout) { this->timeout = timeout; }
+    unsigned long getTimeout() const { return timeout; }
+
+    String readString();
+    String readStringUntil(char terminator);
+    size_t readBytes(uint8_t *buffer, size_t length);
+    size_t readBytes(char *buffer, size_t length) { return readBytes((uint8_t *)buffer, length); }
+
+protected:
+    // Wait for the next byte, letting virtual time pass until the timeout
+    int timedRead();
+    virtual void waitForInput() = 0;
+
+    unsigned long timeout;
+};
+
+class HardwareSerial : public Stream
+{
+public:
+    void begin(unsigned long baud);
+    void end() {}
+
+    int available() override;
+    int read() override;
+    int peek() override;
+    int availableForWrite();
+    void flush();
+
+    size_t write(uint8_t byte) override;
+    using Print::write;
+
+    operator bool() const { return true; }
+
+protected:
+    void waitForInput() override;
+};
+
+extern HardwareSerial Serial;
+
+//==============================================================================
+// Firmware Entry Points
+//==============================================================================
+
+void setup();
+void loop();
+
+#endif // ARDUINO_H
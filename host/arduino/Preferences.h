@@ -0,0 +1,72 @@
+#ifndef PREFERENCES_H
+#define PREFERENCES_H
+
+//==============================================================================
+// Host Preferences
+//==============================================================================
+//
+// Stand-in for the Arduino-ESP32 Preferences library (NVS key/value storage)
+// in the host builds. Entries live in the runtime's NVS model, which a host
+// tool can back with a file so settings survive a restart of the tool.
+
+#include <Arduino.h>
+#include <vector>
+
+class Preferences
+{
+public:
+    Preferences() : open(false), readOnly(false) {}
+
+    bool begin(const char *name, bool readOnly = false)
+    {
+        space = name;
+        this->readOnly = readOnly;
+        open = true;
+        return true;
+    }
+
+    void end() { open = false; }
+
+    size_t putBytes(const char *key, const void *value, size_t len)
+    {
+        if (!open || readOnly)
+        {
+            return 0;
+        }
+        const uint8_t *bytes = static_cast<const uint8_t *>(value);
+        host::Runtime::get().nvsWrite(path(key), std::vector<uint8_t>(bytes, bytes + len));
+        return len;
+    }
+
+    size_t getBytesLength(const char *key)
+    {
+        std::vector<uint8_t> value;
+        return open && host::Runtime::get().nvsRead(path(key), value) ? value.size() : 0;
+    }
+
+    // Nothing is copied (and 0 returned) when the entry is larger than maxLen
+    size_t getBytes(const char *key, void *buf, size_t maxLen)
+    {
+        std::vector<uint8_t> value;
+        if (!open || !host::Runtime::get().nvsRead(path(key), value) || value.size() > maxLen)
+        {
+            return 0;
+        }
+        memcpy(buf, value.data(), value.size());
+        return value.size();
+    }
+
+    bool remove(const char *key)
+    {
+        return open && !readOnly && host::Runtime::get().nvsErase(path(key));
+    }
+
+private:
+    std::string path(const char *key) const { return space + "/" + key; }
+
+    std::string space;
+    bool open;
+    bool readOnly;
+};
+
+#endif // PREFERENCES_H
@@ -0,0 +1,26 @@
+#ifndef DRIVER_GPIO_H
+#define DRIVER_GPIO_H
+
+//==============================================================================
+// Host GPIO Driver
+//==============================================================================
+//
+// The part of the ESP-IDF GPIO driver used for light sleep wake-up; see
+// esp_sleep.h.
+
+#include <esp_sleep.h>
+
+typedef int gpio_num_t;
+
+typedef enum
+{
+    GPIO_INTR_DISABLE = 0,
+    GPIO_INTR_LOW_LEVEL = 4,
+    GPIO_INTR_HIGH_LEVEL = 5
+} gpio_int_type_t;
+
+// Wake from light sleep while `gpio_num` is at the level of `intr_type`
+esp_err_t gpio_wakeup_enable(gpio_num_t gpio_num, gpio_int_type_t intr_type);
+esp_err_t gpio_wakeup_disable(gpio_num_t gpio_num);
+
+#endif // DRIVER_GPIO_H
@@ -0,0 +1,18 @@
+#ifndef DRIVER_UART_H
+#define DRIVER_UART_H
+
+//==============================================================================
+// Host UART Driver
+//==============================================================================
+//
+// The part of the ESP-IDF UART driver used for light sleep wake-up; see
+// esp_sleep.h. The host wakes on the first byte whatever the threshold.
+
+#include <esp_sleep.h>
+
+typedef int uart_port_t;
+#define UART_NUM_0 0
+
+esp_err_t uart_set_wakeup_threshold(uart_port_t uart_num, int wakeup_threshold);
+
+#endif // DRIVER_UART_H
@@ -0,0 +1,16 @@
+#ifndef ESP_ERR_H
+#define ESP_ERR_H
+
+//==============================================================================
+// Host ESP-IDF Error Codes
+//==============================================================================
+//
+// The error type shared by the ESP-IDF stand-ins (esp_sleep.h, esp_timer.h).
+
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_ERR_INVALID_ARG 0x102
+#define ESP_ERR_INVALID_STATE 0x103
+
+#endif // ESP_ERR_H
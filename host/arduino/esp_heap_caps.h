@@ -0,0 +1,34 @@
+#ifndef ESP_HEAP_CAPS_H
+#define ESP_HEAP_CAPS_H
+
+//==============================================================================
+// Host Heap Capabilities
+//==============================================================================
+//
+// Stand-in for the ESP-IDF heap_caps queries in the host builds. The figures
+// come from the runtime's memory model; the capabilities are ignored.
+
+#include <Arduino.h>
+
+#define MALLOC_CAP_8BIT (1 << 2)
+#define MALLOC_CAP_INTERNAL (1 << 11)
+
+inline size_t heap_caps_get_free_size(uint32_t caps)
+{
+    (void)caps;
+    return host::Runtime::get().memory.freeHeap;
+}
+
+inline size_t heap_caps_get_largest_free_block(uint32_t caps)
+{
+    (void)caps;
+    return host::Runtime::get().memory.largestBlock;
+}
+
+inline size_t heap_caps_get_minimum_free_size(uint32_t caps)
+{
+    (void)caps;
+    return host::Runtime::get().memory.minFreeHeap;
+}
+
+#endif // ESP_HEAP_CAPS_H
@@ -0,0 +1,165 @@
+#include "esp_sleep.h"
+#include "driver/gpio.h"
+#include "driver/uart.h"
+
+#include <map>
+
+using host::Micros;
+using host::Runtime;
+
+//==============================================================================
+// Wake Sources
+//==============================================================================
+
+static bool timerArmed = false;
+static Micros timerUs = 0;
+static bool uartArmed = false;
+static bool gpioArmed = false;
+static bool touchArmed = false;
+static std::map<int, int> gpioWakeLevels;      // Pin -> level that wakes
+static std::map<int, int> touchWakeThresholds; // Pin -> wakes below
+static esp_sleep_wakeup_cause_t lastCause = ESP_SLEEP_WAKEUP_UNDEFINED;
+
+esp_err_t esp_sleep_enable_timer_wakeup(uint64_t time_in_us)
+{
+    timerArmed = true;
+    timerUs = time_in_us;
+    return ESP_OK;
+}
+
+esp_err_t esp_sleep_enable_uart_wakeup(int uart_num)
+{
+    (void)uart_num;
+    uartArmed = true;
+    return ESP_OK;
+}
+
+esp_err_t esp_sleep_enable_gpio_wakeup()
+{
+    gpioArmed = true;
+    return ESP_OK;
+}
+
+esp_err_t esp_sleep_enable_touchpad_wakeup()
+{
+    touchArmed = true;
+    return ESP_OK;
+}
+
+esp_err_t esp_sleep_disable_wakeup_source(esp_sleep_source_t source)
+{
+    bool all = source == ESP_SLEEP_WAKEUP_ALL;
+    timerArmed = timerArmed && !(all || source == ESP_SLEEP_WAKEUP_TIMER);
+    uartArmed = uartArmed && !(all || source == ESP_SLEEP_WAKEUP_UART);
+    gpioArmed = gpioArmed && !(all || source == ESP_SLEEP_WAKEUP_GPIO);
+    touchArmed = touchArmed && !(all || source == ESP_SLEEP_WAKEUP_TOUCHPAD);
+    return ESP_OK;
+}
+
+esp_err_t gpio_wakeup_enable(gpio_num_t gpio_num, gpio_int_type_t intr_type)
+{
+    gpioWakeLevels[gpio_num] = intr_type == GPIO_INTR_HIGH_LEVEL ? HIGH : LOW;
+    return ESP_OK;
+}
+
+esp_err_t gpio_wakeup_disable(gpio_num_t gpio_num)
+{
+    gpioWakeLevels.erase(gpio_num);
+    return ESP_OK;
+}
+
+esp_err_t uart_set_wakeup_threshold(uart_port_t uart_num, int wakeup_threshold)
+{
+    (void)uart_num;
+    (void)wakeup_threshold;
+    return ESP_OK;
+}
+
+void touchSleepWakeUpEnable(uint8_t pin, uint16_t threshold)
+{
+    touchWakeThresholds[pin] = threshold;
+}
+
+//==============================================================================
+// Light Sleep
+//==============================================================================
+
+static esp_sleep_wakeup_cause_t pendingWake(Micros timerAt)
+{
+    Runtime &rt = Runtime::get();
+    if (uartArmed && rt.uart().hasPendingInput() && rt.uart().nextArrival() <= rt.now())
+    {
+        return ESP_SLEEP_WAKEUP_UART;
+    }
+    if (gpioArmed)
+    {
+        for (const std::pair<const int, int> &wake : gpioWakeLevels)
+        {
+            if (rt.digitalLevel(wake.first) == wake.second)
+            {
+                return ESP_SLEEP_WAKEUP_GPIO;
+            }
+        }
+    }
+    if (touchArmed)
+    {
+        for (const std::pair<const int, int> &wake : touchWakeThresholds)
+        {
+            if (rt.touchLevel(wake.first) < wake.second)
+            {
+                return ESP_SLEEP_WAKEUP_TOUCHPAD;
+            }
+        }
+    }
+    if (timerArmed && rt.now() >= timerAt)
+    {
+        return ESP_SLEEP_WAKEUP_TIMER;
+    }
+    return ESP_SLEEP_WAKEUP_UNDEFINED;
+}
+
+esp_err_t esp_light_sleep_start()
+{
+    Runtime &rt = Runtime::get();
+    Micros timerAt = rt.now() + timerUs;
+    if (!timerArmed && !uartArmed && !gpioArmed && !touchArmed)
+    {
+        lastCause = ESP_SLEEP_WAKEUP_UNDEFINED;
+        return ESP_OK; // Nothing could wake it
+    }
+
+    // Step through virtual time (at most 1 ms at a time, so input from a
+    // linked pty is seen) until a wake source fires
+    esp_sleep_wakeup_cause_t cause;
+    while ((cause = pendingWake(timerAt)) == ESP_SLEEP_WAKEUP_UNDEFINED && !rt.quitRequested())
+    {
+        Micros next = rt.now() + 1000;
+        if (timerArmed && timerAt < next)
+        {
+            next = timerAt;
+        }
+        if (rt.hasPendingEvents() && rt.nextEventTime() > rt.now() && rt.nextEventTime() < next)
+        {
+            next = rt.nextEventTime();
+        }
+        if (uartArmed && rt.uart().hasPendingInput() && rt.uart().nextArrival() < next)
+        {
+            next = rt.uart().nextArrival();
+        }
+        rt.advanceTo(next);
+    }
+
+    rt.advance(rt.costs.sleepWake);
+    if (cause == ESP_SLEEP_WAKEUP_UART)
+    {
+        // The UART was off: what arrived while waking it is lost
+        rt.uart().discardArrived();
+    }
+    lastCause = cause;
+    return ESP_OK;
+}
+
+esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause()
+{
+    return lastCause;
+}
@@ -0,0 +1,38 @@
+#ifndef ESP_SLEEP_H
+#define ESP_SLEEP_H
+
+//==============================================================================
+// Host Sleep Modes
+//==============================================================================
+//
+// Stand-in for the ESP-IDF light sleep API in the host builds. A light sleep
+// lets virtual time pass until an armed wake source fires: the timer, bytes
+// arriving on the UART (which, as on the ESP32, are lost), a GPIO at its wake
+// level or a touch pad below its threshold. Waking costs
+// host::CostModel::sleepWake. Wake sources stay armed until disabled.
+
+#include <Arduino.h>
+#include <esp_err.h>
+
+typedef enum
+{
+    ESP_SLEEP_WAKEUP_UNDEFINED = 0,
+    ESP_SLEEP_WAKEUP_ALL = 1,
+    ESP_SLEEP_WAKEUP_TIMER = 4,
+    ESP_SLEEP_WAKEUP_TOUCHPAD = 5,
+    ESP_SLEEP_WAKEUP_GPIO = 7,
+    ESP_SLEEP_WAKEUP_UART = 8
+} esp_sleep_source_t;
+
+typedef esp_sleep_source_t esp_sleep_wakeup_cause_t;
+
+esp_err_t esp_sleep_enable_timer_wakeup(uint64_t time_in_us);
+esp_err_t esp_sleep_enable_uart_wakeup(int uart_num);
+esp_err_t esp_sleep_enable_gpio_wakeup();
+esp_err_t esp_sleep_enable_touchpad_wakeup();
+esp_err_t esp_sleep_disable_wakeup_source(esp_sleep_source_t source);
+
+esp_err_t esp_light_sleep_start();
+esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause();
+
+#endif // ESP_SLEEP_H
@@ -0,0 +1,62 @@
+#include "esp_timer.h"
+
+using host::Runtime;
+
+struct esp_timer
+{
+    esp_timer_cb_t callback;
+    void *arg;
+    uint64_t generation; // Bumped by every start and stop; stale events do nothing
+    bool active;
+};
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *create_args, esp_timer_handle_t *out_handle)
+{
+    if (create_args == nullptr || create_args->callback == nullptr || out_handle == nullptr)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *out_handle = new esp_timer{create_args->callback, create_args->arg, 0, false};
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    if (timer->active)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->active = true;
+    uint64_t generation = ++timer->generation;
+    Runtime &rt = Runtime::get();
+    rt.schedule(rt.now() + timeout_us, [timer, generation]()
+                {
+                    if (timer->generation != generation)
+                    {
+                        return;
+                    }
+                    timer->active = false;
+                    timer->callback(timer->arg); });
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    if (!timer->active)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->active = false;
+    timer->generation++;
+    return ESP_OK;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t timer)
+{
+    return timer->active;
+}
+
+int64_t esp_timer_get_time()
+{
+    return (int64_t)Runtime::get().now();
+}
@@ -0,0 +1,39 @@
+#ifndef ESP_TIMER_H
+#define ESP_TIMER_H
+
+//==============================================================================
+// Host High-Resolution Timer
+//==============================================================================
+//
+// Stand-in for the ESP-IDF esp_timer API in the host builds. A one-shot
+// timer runs its callback as a runtime event at the exact virtual time it
+// expires, whatever loop() is doing then, as the esp_timer task does on the
+// ESP32. Periodic timers are not modelled.
+
+#include <Arduino.h>
+#include <esp_err.h>
+
+typedef void (*esp_timer_cb_t)(void *arg);
+typedef struct esp_timer *esp_timer_handle_t;
+
+typedef enum
+{
+    ESP_TIMER_TASK
+} esp_timer_dispatch_t;
+
+typedef struct
+{
+    esp_timer_cb_t callback;
+    void *arg;
+    esp_timer_dispatch_t dispatch_method;
+    const char *name;
+    bool skip_unhandled_events;
+} esp_timer_create_args_t;
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *create_args, esp_timer_handle_t *out_handle);
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us);
+esp_err_t esp_timer_stop(esp_timer_handle_t timer); // ESP_ERR_INVALID_STATE if not running
+bool esp_timer_is_active(esp_timer_handle_t timer);
+int64_t esp_timer_get_time();
+
+#endif // ESP_TIMER_H
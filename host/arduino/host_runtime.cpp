@@ -0,0 +1,516 @@
+#include "host_runtime.h"
+
+#include <stdio.h>
+#include <thread>
+#include "trace.h"
+
+namespace host
+{
+    //==========================================================================
+    // Virtual UART
+    //==========================================================================
+
+    VirtualUart::VirtualUart()
+        : baud(0),
+          txFifoSize(128),  // ESP32 hardware FIFO, driver installed without a TX ring buffer
+          rxBufferSize(256), // Arduino-ESP32 default RX buffer
+          txBusyUntil(0),
+          rxBusyUntil(0),
+          rxOverflows(0),
+          txBlocked(0)
+    {
+    }
+
+    void VirtualUart::begin(unsigned long baud)
+    {
+        this->baud = baud;
+    }
+
+    Micros VirtualUart::byteTime() const
+    {
+        if (baud == 0)
+        {
+            return 0;
+        }
+        // One start bit, eight data bits, one stop bit
+        return (10ULL * 1000000ULL + baud / 2) / baud;
+    }
+
+    size_t VirtualUart::write(uint8_t byte)
+    {
+        // Writes before begin() go nowhere, as on the device
+        if (baud == 0)
+        {
+            return 0;
+        }
+
+        Runtime &rt = Runtime::get();
+        deliver(rt.now());
+
+        // Block the caller while the FIFO is full, exactly like the UART driver
+        while (tx.size() >= txFifoSize)
+        {
+            Micros blockedFrom = rt.now();
+            rt.advanceTo(tx.front().at);
+            deliver(rt.now());
+            txBlocked += rt.now() - blockedFrom;
+        }
+
+        Micros start = txBusyUntil > rt.now() ? txBusyUntil : rt.now();
+        txBusyUntil = start + byteTime();
+        tx.push_back({txBusyUntil, byte});
+        return 1;
+    }
+
+    int VirtualUart::availableForWrite()
+    {
+        deliver(Runtime::get().now());
+        return tx.size() >= txFifoSize ? 0 : (int)(txFifoSize - tx.size());
+    }
+
+    void VirtualUart::flush()
+    {
+        Runtime &rt = Runtime::get();
+        if (!tx.empty())
+        {
+            rt.advanceTo(tx.back().at);
+        }
+        deliver(rt.now());
+    }
+
+    int VirtualUart::available()
+    {
+        Micros now = Runtime::get().now();
+        settleRx();
+        int count = 0;
+        for (const TimedByte &b : rx)
+        {
+            if (b.at > now)
+            {
+                break;
+            }
+            count++;
+        }
+        return count;
+    }
+
+    int VirtualUart::read()
+    {
+        settleRx();
+        if (rx.empty() || rx.front().at > Runtime::get().now())
+        {
+            return -1;
+        }
+        uint8_t value = rx.front().value;
+        rx.pop_front();
+        return value;
+    }
+
+    int VirtualUart::peek()
+    {
+        settleRx();
+        if (rx.empty() || rx.front().at > Runtime::get().now())
+        {
+            return -1;
+        }
+        return rx.front().value;
+    }
+
+    void VirtualUart::settleRx()
+    {
+        // Nothing was read since the last call, so every byte that arrived
+        // after the buffer filled up was lost
+        Micros now = Runtime::get().now();
+        size_t arrived = 0;
+        while (arrived < rx.size() && rx[arrived].at <= now)
+        {
+            arrived++;
+        }
+        if (arrived > rxBufferSize)
+        {
+            rxOverflows += arrived - rxBufferSize;
+            rx.erase(rx.begin() + rxBufferSize, rx.begin() + arrived);
+        }
+    }
+
+    void VirtualUart::receive(const uint8_t *data, size_t length)
+    {
+        Micros now = Runtime::get().now();
+        for (size_t i = 0; i < length; i++)
+        {
+            Micros start = rxBusyUntil > now ? rxBusyUntil : now;
+            rxBusyUntil = start + byteTime();
+            rx.push_back({rxBusyUntil, data[i]});
+        }
+    }
+
+    void VirtualUart::discardArrived()
+    {
+        Micros now = Runtime::get().now();
+        while (!rx.empty() && rx.front().at <= now)
+        {
+            rx.pop_front();
+        }
+    }
+
+    Micros VirtualUart::nextArrival() const
+    {
+        return rx.empty() ? 0 : rx.front().at;
+    }
+
+    void VirtualUart::deliver(Micros upTo)
+    {
+        Runtime &rt = Runtime::get();
+        while (!tx.empty() && tx.front().at <= upTo)
+        {
+            TimedByte b = tx.front();
+            tx.pop_front();
+            rt.notifySerial(b.at, b.value);
+        }
+    }
+
+    //==========================================================================
+    // Runtime
+    //==========================================================================
+
+    Runtime &Runtime::get()
+    {
+        static Runtime runtime;
+        return runtime;
+    }
+
+    Runtime::Runtime()
+        : nowUs(0),
+          lastPumpUs(0),
+          eventOrder(0),
+          inEvent(false),
+          timeScale(0),
+          virtualStart(0),
+          inPump(false),
+          touchBaseline(60),
+          nvsWrites(0),
+          randomState(0x853c49e6748fea9bULL),
+          quit(false)
+    {
+        costs.loopOverhead = 20;
+        costs.touchRead = 100;
+        costs.digitalRead = 1;
+        costs.pixelLatch = 50;
+        costs.sleepWake = 350;
+        costs.interruptEntry = 2;
+        costs.interruptExit = 1;
+        memory.freeHeap = 298000;
+        memory.largestBlock = 110580;
+        memory.minFreeHeap = 292000;
+        memory.stackHighWater = 6400;
+        wallStart = std::chrono::steady_clock::now();
+    }
+
+    void Runtime::advanceTo(Micros target)
+    {
+        if (target < nowUs)
+        {
+            return;
+        }
+
+        // Fire every event that falls inside the interval, in time order
+        if (!inEvent)
+        {
+            while (!events.empty() && events.top().at <= target)
+            {
+                Event ev = events.top();
+                events.pop();
+                if (ev.at > nowUs)
+                {
+                    nowUs = ev.at;
+                }
+                inEvent = true;
+                ev.action();
+                inEvent = false;
+            }
+        }
+        // Interrupt handlers run by events may have taken the clock past target
+        if (target > nowUs)
+        {
+            nowUs = target;
+        }
+
+        pace();
+
+        // External I/O is moved at most once per virtual half millisecond
+        if (nowUs - lastPumpUs >= 500)
+        {
+            pump();
+        }
+    }
+
+    void Runtime::schedule(Micros at, std::function<void()> action)
+    {
+        events.push({at < nowUs ? nowUs : at, eventOrder++, action});
+    }
+
+    Micros Runtime::nextEventTime() const
+    {
+        return events.empty() ? 0 : events.top().at;
+    }
+
+    void Runtime::setTimeScale(double scale)
+    {
+        timeScale = scale;
+        wallStart = std::chrono::steady_clock::now();
+        virtualStart = nowUs;
+    }
+
+    void Runtime::pace()
+    {
+        if (timeScale <= 0)
+        {
+            return;
+        }
+
+        // Hold virtual time back until the wall clock has caught up
+        double wallSeconds = (double)(nowUs - virtualStart) / 1e6 / timeScale;
+        std::chrono::steady_clock::time_point due =
+            wallStart + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                            std::chrono::duration<double>(wallSeconds));
+        while (std::chrono::steady_clock::now() + std::chrono::microseconds(200) < due)
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+            pump();
+        }
+    }
+
+    void Runtime::pump()
+    {
+        lastPumpUs = nowUs;
+        serialPort.deliver(nowUs);
+
+        if (pumpHook && !inPump)
+        {
+            inPump = true;
+            pumpHook();
+            inPump = false;
+        }
+    }
+
+    //--------------------------------------------------------------------------
+    // Board Model
+    //--------------------------------------------------------------------------
+
+    // Interrupt modes, as Arduino's RISING, FALLING and CHANGE
+    static const int RISING_EDGE = 0x01;
+    static const int FALLING_EDGE = 0x02;
+    static const int ANY_EDGE = 0x03;
+
+    int Runtime::digitalLevel(int pin) const
+    {
+        std::map<int, int>::const_iterator it = inputLevels.find(pin);
+        if (it != inputLevels.end())
+        {
+            return it->second;
+        }
+        // Undriven inputs read their pull, HIGH unless pulled down
+        it = inputPulls.find(pin);
+        return it == inputPulls.end() ? 1 : it->second;
+    }
+
+    void Runtime::driveInput(int pin, int level)
+    {
+        int previous = digitalLevel(pin);
+        inputLevels[pin] = level;
+        for (PinObserver &observer : pinObservers)
+        {
+            observer(nowUs, pin, level);
+        }
+
+        std::map<int, Interrupt>::iterator it = interrupts.find(pin);
+        if (it == interrupts.end() || level == previous)
+        {
+            return;
+        }
+        int edge = level ? RISING_EDGE : FALLING_EDGE;
+        if (it->second.mode == edge || it->second.mode == ANY_EDGE)
+        {
+            // Interrupt time is taken from whatever runs at the edge
+            nowUs += costs.interruptEntry;
+            it->second.handler();
+            nowUs += costs.interruptExit;
+        }
+    }
+
+    void Runtime::attachInterrupt(int pin, std::function<void()> handler, int mode)
+    {
+        interrupts[pin] = {handler, mode};
+    }
+
+    int Runtime::touchValue(int pin)
+    {
+        // A couple of counts of measurement noise
+        return touchLevel(pin) + (int)(nextRandom() % 5) - 2;
+    }
+
+    int Runtime::touchLevel(int pin) const
+    {
+        std::map<int, int>::const_iterator it = touchValues.find(pin);
+        return it == touchValues.end() ? touchBaseline : it->second;
+    }
+
+    void Runtime::setTouchValue(int pin, int value)
+    {
+        touchValues[pin] = value;
+        for (PinObserver &observer : pinObservers)
+        {
+            observer(nowUs, pin, value);
+        }
+    }
+
+    void Runtime::writeOutput(int pin, int level)
+    {
+        for (PinObserver &observer : pinObservers)
+        {
+            observer(nowUs, pin, level);
+        }
+    }
+
+    void Runtime::showPixels(const uint32_t *colors, uint16_t count)
+    {
+        // 24 bits per pixel at 800 kHz, then the latch; LEDs update at the end
+        advance((Micros)count * 24 * 5 / 4 + costs.pixelLatch);
+        for (PixelObserver &observer : pixelObservers)
+        {
+            observer(nowUs, colors, count);
+        }
+    }
+
+    void Runtime::notifySerial(Micros at, uint8_t byte)
+    {
+        for (SerialObserver &observer : serialObservers)
+        {
+            observer(at, byte);
+        }
+    }
+
+    void Runtime::notifyTrace(int point)
+    {
+        for (TraceObserver &observer : traceObservers)
+        {
+            observer(nowUs, point);
+        }
+    }
+
+    //--------------------------------------------------------------------------
+    // Entropy
+    //--------------------------------------------------------------------------
+
+    bool Runtime::setNvsFile(const std::string &path)
+    {
+        // Entries: key length (u16), key, value length (u32), value
+        nvsFile = path;
+        nvs.clear();
+        FILE *file = fopen(path.c_str(), "rb");
+        if (file == nullptr)
+        {
+            return true; // Fresh flash
+        }
+        bool ok = true;
+        uint16_t keyLength;
+        while (fread(&keyLength, sizeof(keyLength), 1, file) == 1)
+        {
+            std::string key(keyLength, '\0');
+            uint32_t valueLength = 0;
+            if (fread(&key[0], 1, keyLength, file) != keyLength || fread(&valueLength, sizeof(valueLength), 1, file) != 1)
+            {
+                ok = false;
+                break;
+            }
+            std::vector<uint8_t> value(valueLength);
+            if (fread(value.data(), 1, valueLength, file) != valueLength)
+            {
+                ok = false;
+                break;
+            }
+            nvs[key] = value;
+        }
+        fclose(file);
+        return ok;
+    }
+
+    bool Runtime::nvsRead(const std::string &key, std::vector<uint8_t> &value) const
+    {
+        std::map<std::string, std::vector<uint8_t>>::const_iterator entry = nvs.find(key);
+        if (entry == nvs.end())
+        {
+            return false;
+        }
+        value = entry->second;
+        return true;
+    }
+
+    void Runtime::nvsWrite(const std::string &key, const std::vector<uint8_t> &value)
+    {
+        nvs[key] = value;
+        nvsWrites++;
+        saveNvs();
+    }
+
+    bool Runtime::nvsErase(const std::string &key)
+    {
+        if (nvs.erase(key) == 0)
+        {
+            return false;
+        }
+        saveNvs();
+        return true;
+    }
+
+    void Runtime::saveNvs() const
+    {
+        if (nvsFile.empty())
+        {
+            return;
+        }
+        // Replace the file in one rename, like NVS never leaves half an entry
+        std::string temp = nvsFile + ".tmp";
+        FILE *file = fopen(temp.c_str(), "wb");
+        if (file == nullptr)
+        {
+            return;
+        }
+        for (const std::pair<const std::string, std::vector<uint8_t>> &entry : nvs)
+        {
+            uint16_t keyLength = (uint16_t)entry.first.size();
+            uint32_t valueLength = (uint32_t)entry.second.size();
+            fwrite(&keyLength, sizeof(keyLength), 1, file);
+            fwrite(entry.first.data(), 1, keyLength, file);
+            fwrite(&valueLength, sizeof(valueLength), 1, file);
+            fwrite(entry.second.data(), 1, valueLength, file);
+        }
+        fclose(file);
+        rename(temp.c_str(), nvsFile.c_str());
+    }
+
+    void Runtime::seedRandom(uint32_t seed)
+    {
+        randomState = 0x853c49e6748fea9bULL ^ ((uint64_t)seed << 1);
+        nextRandom();
+    }
+
+    uint32_t Runtime::nextRandom()
+    {
+        // PCG32: small, fast and reproducible across hosts
+        uint64_t old = randomState;
+        randomState = old * 6364136223846793005ULL + 1442695040888963407ULL;
+        uint32_t xorshifted = (uint32_t)(((old >> 18u) ^ old) >> 27u);
+        uint32_t rot = (uint32_t)(old >> 59u);
+        return (xorshifted >> rot) | (xorshifted << ((-rot) & 31));
+    }
+}
+
+//==============================================================================
+// Firmware Trace Points
+//==============================================================================
+
+void hostTrace(TracePoint point)
+{
+    host::Runtime::get().notifyTrace(point);
+}
@@ -0,0 +1,260 @@
+#ifndef HOST_RUNTIME_H
+#define HOST_RUNTIME_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <map>
+#include <queue>
+#include <string>
+#include <vector>
+
+//==============================================================================
+// Host Runtime
+//==============================================================================
+//
+// Virtual board used by the host builds. The firmware runs unmodified on top
+// of it: millis()/micros() read a virtual clock, blocking calls (delay, a full
+// UART FIFO, a NeoPixel transfer, touchRead) consume virtual time, and
+// scripted inputs are delivered as timed events on that clock.
+
+namespace host
+{
+    typedef uint64_t Micros;
+
+    // Observers notified as the emulated hardware produces output
+    typedef std::function<void(Micros at, const uint32_t *colors, uint16_t count)> PixelObserver;
+    typedef std::function<void(Micros at, uint8_t byte)> SerialObserver;
+    typedef std::function<void(Micros at, int pin, int level)> PinObserver;
+    typedef std::function<void(Micros at, int point)> TraceObserver;
+
+    //--------------------------------------------------------------------------
+    // Cost Model
+    //--------------------------------------------------------------------------
+
+    // Virtual time consumed by operations that take real time on the ESP32
+    struct CostModel
+    {
+        Micros loopOverhead; // One pass through loop() outside modelled calls
+        Micros touchRead;    // One capacitive touch measurement
+        Micros digitalRead;  // One GPIO read
+        Micros pixelLatch;   // Reset/latch time after a strip transfer
+        Micros sleepWake;    // From a light sleep wake-up to running code
+        Micros interruptEntry; // From a GPIO edge to its interrupt handler
+        Micros interruptExit;  // From the handler's return to the interrupted code
+    };
+
+    //--------------------------------------------------------------------------
+    // Memory Model
+    //--------------------------------------------------------------------------
+
+    // Heap and stack figures the board reports (heap_caps, FreeRTOS); fixed
+    // values typical of the ESP32 firmware, not measured on the host
+    struct MemoryModel
+    {
+        uint32_t freeHeap;       // Free internal heap (bytes)
+        uint32_t largestBlock;   // Largest free heap block (bytes)
+        uint32_t minFreeHeap;    // Lowest free heap since boot (bytes)
+        uint32_t stackHighWater; // Least free stack of the loop task (bytes)
+    };
+
+    //--------------------------------------------------------------------------
+    // Virtual UART (8N1, paced at the configured baud)
+    //--------------------------------------------------------------------------
+    class VirtualUart
+    {
+    public:
+        VirtualUart();
+
+        void begin(unsigned long baud);
+        unsigned long getBaud() const { return baud; }
+
+        // Time to move one 8N1 frame (10 bits) at the current baud
+        Micros byteTime() const;
+
+        // Device side (used by HardwareSerial)
+        size_t write(uint8_t byte);
+        int availableForWrite();
+        void flush();
+        int available();
+        int read();
+        int peek();
+
+        // Drop the bytes that have arrived (they woke the UART from light sleep)
+        void discardArrived();
+
+        // Host side: bytes arrive at the device paced at the baud rate
+        void receive(const uint8_t *data, size_t length);
+        bool hasPendingInput() const { return !rx.empty(); }
+        Micros nextArrival() const;
+
+        // Hand bytes that have fully left the wire to the serial observers
+        void deliver(Micros upTo);
+
+        // Configuration of the modelled buffers
+        void setTxFifoSize(size_t size) { txFifoSize = size; }
+        void setRxBufferSize(size_t size) { rxBufferSize = size; }
+
+        // Statistics
+        uint32_t getRxOverflowCount() const { return rxOverflows; }
+        Micros getTxBlockedTime() const { return txBlocked; }
+
+    private:
+        struct TimedByte
+        {
+            Micros at;
+            uint8_t value;
+        };
+
+        // Drop bytes that arrived while the RX buffer was full
+        void settleRx();
+
+        unsigned long baud;
+        size_t txFifoSize;
+        size_t rxBufferSize;
+        std::deque<TimedByte> tx; // Bytes accepted for transmit, stamped with wire completion
+        std::deque<TimedByte> rx; // Bytes sent by the host, stamped with arrival time
+        Micros txBusyUntil;
+        Micros rxBusyUntil;
+        uint32_t rxOverflows;
+        Micros txBlocked;
+    };
+
+    //--------------------------------------------------------------------------
+    // Runtime
+    //--------------------------------------------------------------------------
+    class Runtime
+    {
+    public:
+        static Runtime &get();
+
+        // Clock
+        Micros now() const { return nowUs; }
+        void advance(Micros us) { advanceTo(nowUs + us); }
+        void advanceTo(Micros target);
+
+        // Run an action at a virtual time (events at the same time run in order)
+        void schedule(Micros at, std::function<void()> action);
+        bool hasPendingEvents() const { return !events.empty(); }
+        Micros nextEventTime() const;
+
+        // Wall-clock pacing: virtual seconds per wall second, 0 runs unthrottled
+        void setTimeScale(double scale);
+        double getTimeScale() const { return timeScale; }
+
+        // Called periodically (and while the firmware waits) to move external I/O
+        void setPumpHook(std::function<void()> hook) { pumpHook = hook; }
+        void pump();
+
+        // Board model: inputs
+        int digitalLevel(int pin) const;
+        void driveInput(int pin, int level);
+        void setInputPull(int pin, int level) { inputPulls[pin] = level; }
+
+        // Board model: GPIO interrupts. A driven input whose level changes
+        // the way `mode` (RISING, FALLING, CHANGE) asks for runs the handler
+        // interruptEntry after the edge; the interrupted code resumes
+        // interruptExit after the handler, the time it lost included.
+        void attachInterrupt(int pin, std::function<void()> handler, int mode);
+        void detachInterrupt(int pin) { interrupts.erase(pin); }
+        int touchValue(int pin);
+        void setTouchValue(int pin, int value);
+        int touchLevel(int pin) const; // Without the measurement noise
+        void setTouchBaseline(int value) { touchBaseline = value; }
+        int getTouchBaseline() const { return touchBaseline; }
+
+        // Board model: outputs
+        void writeOutput(int pin, int level);
+        void showPixels(const uint32_t *colors, uint16_t count);
+
+        // Board model: NVS flash behind Preferences, keyed "namespace/key".
+        // Kept in memory (empty at start) unless backed by a file, which is
+        // rewritten on every change so settings survive between runs
+        bool setNvsFile(const std::string &path);
+        bool nvsRead(const std::string &key, std::vector<uint8_t> &value) const;
+        void nvsWrite(const std::string &key, const std::vector<uint8_t> &value);
+        bool nvsErase(const std::string &key);
+        uint32_t getNvsWrites() const { return nvsWrites; }
+
+        // Observers
+        void addPixelObserver(PixelObserver observer) { pixelObservers.push_back(observer); }
+        void addSerialObserver(SerialObserver observer) { serialObservers.push_back(observer); }
+        void addPinObserver(PinObserver observer) { pinObservers.push_back(observer); }
+        void addTraceObserver(TraceObserver observer) { traceObservers.push_back(observer); }
+        void notifySerial(Micros at, uint8_t byte);
+        void notifyTrace(int point);
+
+        // Deterministic entropy for random()/analogRead()
+        void seedRandom(uint32_t seed);
+        uint32_t nextRandom();
+
+        VirtualUart &uart() { return serialPort; }
+        CostModel costs;
+        MemoryModel memory;
+
+        // Session control for the host tools
+        void requestQuit() { quit = true; }
+        bool quitRequested() const { return quit; }
+
+    private:
+        Runtime();
+
+        struct Event
+        {
+            Micros at;
+            uint64_t order;
+            std::function<void()> action;
+        };
+        struct EventLater
+        {
+            bool operator()(const Event &a, const Event &b) const
+            {
+                return a.at != b.at ? a.at > b.at : a.order > b.order;
+            }
+        };
+
+        void pace();
+
+        Micros nowUs;
+        Micros lastPumpUs;
+        uint64_t eventOrder;
+        std::priority_queue<Event, std::vector<Event>, EventLater> events;
+        bool inEvent;
+
+        double timeScale;
+        std::chrono::steady_clock::time_point wallStart;
+        Micros virtualStart;
+
+        std::function<void()> pumpHook;
+        bool inPump;
+
+        std::map<int, int> inputLevels;
+        std::map<int, int> inputPulls;
+        struct Interrupt
+        {
+            std::function<void()> handler;
+            int mode;
+        };
+        std::map<int, Interrupt> interrupts;
+        std::map<int, int> touchValues;
+        int touchBaseline;
+
+        std::map<std::string, std::vector<uint8_t>> nvs;
+        std::string nvsFile;
+        uint32_t nvsWrites;
+        void saveNvs() const;
+
+        std::vector<PixelObserver> pixelObservers;
+        std::vector<SerialObserver> serialObservers;
+        std::vector<PinObserver> pinObservers;
+        std::vector<TraceObserver> traceObservers;
+
+        uint64_t randomState;
+        VirtualUart serialPort;
+        bool quit;
+    };
+}
+
+#endif // HOST_RUNTIME_H
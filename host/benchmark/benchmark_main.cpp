@@ -0,0 +1,575 @@
+#include <Arduino.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "distribution.h"
+#include "event_markers.h"
+#include "trigger_input.h"
+#include "sequence_builder.h"
+#include "trace.h"
+#include "virtual_device.h"
+#include "virtual_participant.h"
+
+//==============================================================================
+// End-to-End Latency Benchmark
+//==============================================================================
+//
+// Runs the standard scenarios against the firmware and reports how much
+// latency each stage of a trial adds, from the input edge to the last byte of
+// the trial's real-time event leaving the UART.
+//
+//   nback-benchmark [--trials N] [--scenario NAME] [--seed N] [--json]
+//
+// Stages (all in virtual time, so results are identical on every machine):
+//   input_sampling  input edge -> press accepted by the task
+//   dispatch        press accepted -> evaluateTrialOutcome() entered
+//   evaluate        evaluateTrialOutcome() entered -> event serialization begins
+//                   (includes the wait in the deferred work queue)
+//   serialize       event serialization (includes waiting on a full TX FIFO)
+//   uart_drain      serialization done -> last byte of the event on the wire
+//   evaluate_total  evaluateTrialOutcome(): scoring and queueing the jobs
+//   end_to_end      input edge -> last byte of the event on the wire
+//   marker_onset    stimulus latched on the strip -> onset marker rising edge
+//   marker_response input edge -> response marker rising edge
+//   marker_width    marker pulse width
+//   trigger_onset   trigger pulse edge -> trial onset (paced scenarios)
+//   trigger_latched trigger pulse edge -> stimulus latched on the strip
+//   slack           last deferred job of a trial done -> next trial's onset
+//   stream_slack    last streamed data> line on the wire -> next trial's onset
+//                   (stream scenario)
+//
+// The TTL markers (event_markers.h) are on in every scenario and watched on
+// the marker pins; the run fails if the marker times the firmware records
+// for get_data differ from the edges on the pins. Paced scenarios send a
+// trigger pulse (trigger_input.h) every TRIGGER_PERIOD_US while a session
+// runs; the run fails if a recorded trigger latency differs from the time
+// from the last pulse edge before the onset to the stimulus latch, less the
+// interrupt entry the firmware cannot see. The run also fails if a trial's
+// deferred jobs (deferred_work.h) finish after the next onset. The stream scenario sets 'stream on', so each session
+// streams the previous one's data in its intervals; the run fails if a
+// streamed line is still on the wire at an onset.
+//
+// Session setup (config, validate, start with request IDs) is timed twice:
+// stop-and-wait sends each command once the previous one answered done,
+// pipelined sends all three at once and waits for the last done.
+
+using namespace host;
+
+struct Scenario
+{
+    const char *name;
+    bool useTouch;
+    bool verbose;
+    bool paced;  // Trials start on trigger pulses
+    bool stream; // The previous session's data streams while a session runs
+};
+
+static const Scenario SCENARIOS[] = {
+    {"button_quiet", false, false, false, false},
+    {"button_verbose", false, true, false, false},
+    {"touch_quiet", true, false, false, false},
+    {"touch_verbose", true, true, false, false},
+    {"button_paced", false, false, true, false},
+    {"button_stream", false, false, false, true},
+};
+static const int SCENARIO_COUNT = sizeof(SCENARIOS) / sizeof(SCENARIOS[0]);
+
+// Host reaction to a line it waited for: the default latency timer of FTDI
+// USB serial adapters
+static const Micros HOST_TURNAROUND_US = 16000;
+
+// Paced scenarios: a scanner TR longer than most trials and their interval
+static const Micros TRIGGER_PERIOD_US = 2000000;
+static const Micros TRIGGER_PULSE_US = 1000;
+
+// Trace timestamps of one trial (0 = not reached)
+struct TrialTrace
+{
+    Micros onset;
+    Micros latched;        // First stimulus colour on the strip
+    Micros onsetMarker;    // Rising edges on the marker pins
+    Micros responseMarker;
+    Micros captured;
+    Micros evaluateBegin;
+    Micros evaluateEnd;
+    Micros serializeBegin;
+    Micros serializeEnd;
+    Micros deferredDone;
+};
+
+enum Stage
+{
+    STAGE_INPUT_SAMPLING,
+    STAGE_DISPATCH,
+    STAGE_EVALUATE,
+    STAGE_SERIALIZE,
+    STAGE_UART_DRAIN,
+    STAGE_EVALUATE_TOTAL,
+    STAGE_END_TO_END,
+    STAGE_MARKER_ONSET,
+    STAGE_MARKER_RESPONSE,
+    STAGE_MARKER_WIDTH,
+    STAGE_TRIGGER_ONSET,
+    STAGE_TRIGGER_LATCHED,
+    STAGE_SLACK,
+    STAGE_STREAM_SLACK,
+    STAGE_COUNT
+};
+
+static const char *STAGE_NAMES[STAGE_COUNT] = {
+    "input_sampling", "dispatch", "evaluate", "serialize",
+    "uart_drain", "evaluate_total", "end_to_end",
+    "marker_onset", "marker_response", "marker_width",
+    "trigger_onset", "trigger_latched", "slack", "stream_slack"};
+
+struct ScenarioResult
+{
+    const Scenario *scenario;
+    int trials;
+    Distribution stages[STAGE_COUNT];
+};
+
+static std::vector<TrialTrace> traces;
+static std::vector<double> markerWidths; // ms, of the current session
+static std::vector<Micros> triggerPulses; // Rising edges, of the current session
+static int pacedSession = 0;              // Pulses keep coming for this session (0 = none)
+
+static void onTrace(Micros at, int point)
+{
+    if (point == TRACE_TRIAL_ONSET)
+    {
+        traces.push_back(TrialTrace());
+        traces.back().onset = at;
+        return;
+    }
+    if (traces.empty())
+    {
+        return;
+    }
+
+    TrialTrace &trial = traces.back();
+    switch (point)
+    {
+    case TRACE_RESPONSE_CAPTURED:
+        // First accepted press is the one the trial records
+        trial.captured = trial.captured ? trial.captured : at;
+        break;
+    case TRACE_EVALUATE_BEGIN:
+        trial.evaluateBegin = at;
+        break;
+    case TRACE_EVALUATE_END:
+        trial.evaluateEnd = at;
+        break;
+    case TRACE_EVENT_SERIALIZE_BEGIN:
+        trial.serializeBegin = at;
+        break;
+    case TRACE_EVENT_SERIALIZE_END:
+        trial.serializeEnd = at;
+        break;
+    case TRACE_DEFERRED_DONE:
+        trial.deferredDone = at;
+        break;
+    }
+}
+
+static void onPixels(Micros at, const uint32_t *colors, uint16_t count)
+{
+    if (!traces.empty() && !traces.back().latched && count > 0 && colors[0] != 0)
+    {
+        traces.back().latched = at;
+    }
+}
+
+// The marker pins as one code; a pulse runs from the code leaving 0 to its
+// return, and is a response marker if it carries a response code's bits
+static const int markerPins[MARKER_PIN_COUNT] = MARKER_PINS;
+static const uint8_t defaultMarkerCodes[MARKER_EVENT_COUNT] = DEFAULT_MARKER_CODES;
+static uint8_t markerCode = 0;
+static uint8_t pulseCode = 0;
+static Micros pulseStart = 0;
+
+static void onPin(Micros at, int pin, int level)
+{
+    int bit = -1;
+    for (int i = 0; i < MARKER_PIN_COUNT; i++)
+    {
+        bit = markerPins[i] == pin ? i : bit;
+    }
+    if (bit < 0)
+    {
+        return;
+    }
+    uint8_t previous = markerCode;
+    markerCode = level ? (markerCode | 1 << bit) : (markerCode & ~(1 << bit));
+    if (previous == 0 && markerCode != 0)
+    {
+        pulseStart = at;
+        pulseCode = 0;
+    }
+    pulseCode |= markerCode;
+    if (previous == 0 || markerCode != 0 || traces.empty())
+    {
+        return;
+    }
+
+    TrialTrace &trial = traces.back();
+    bool response = pulseCode == defaultMarkerCodes[MARKER_CONFIRM] || pulseCode == defaultMarkerCodes[MARKER_WRONG];
+    Micros &edge = response ? trial.responseMarker : trial.onsetMarker;
+    edge = edge ? edge : pulseStart;
+    markerWidths.push_back((at - pulseStart) / 1000.0);
+}
+
+// One trigger pulse now and the next one period later, while `session` is
+// the paced session
+static void sendTriggerPulse(VirtualDevice &device, int session)
+{
+    if (session != pacedSession)
+    {
+        return;
+    }
+    Micros now = Runtime::get().now();
+    triggerPulses.push_back(now);
+    device.pulseTrigger(now, TRIGGER_PULSE_US);
+    Runtime::get().schedule(now + TRIGGER_PERIOD_US, [&device, session]()
+                            { sendTriggerPulse(device, session); });
+}
+
+static bool runScenario(VirtualDevice &device, const Scenario &scenario, int totalTrials,
+                        uint64_t seed, ScenarioResult &result)
+{
+    ParticipantProfile profile = {0.85, 0.10, 450.0, 60.0, 150.0, 150.0, 120.0, scenario.useTouch};
+    VirtualParticipant participant(device, profile, seed);
+    std::mt19937_64 sequenceRng(seed ^ 0x9E3779B97F4A7C15ULL);
+    const int nBack = 2;
+
+    nBackTask.setInputMode(scenario.useTouch ? CAPACITIVE_INPUT : BUTTON_INPUT);
+    device.sendLine(scenario.verbose ? "verbose on" : "verbose off");
+    device.sendLine("marker on");
+    device.sendLine(scenario.paced ? "trigger pace" : "trigger off");
+    device.sendLine(scenario.stream ? "stream on" : "stream off");
+    device.runFor(1000000);
+    device.takeLines();
+
+    result.scenario = &scenario;
+    result.trials = 0;
+
+    for (int done = 0, session = 1; done < totalTrials; session++)
+    {
+        int trials = std::max(std::min(MAX_TRIALS, totalTrials - done), 5);
+
+        char config[64];
+        snprintf(config, sizeof(config), "config 1000,500,%d,%d,BENCH,%d,", nBack, trials, session);
+        device.sendLine(config + sequenceArgument(buildSequence(sequenceRng, trials, nBack, 0.3)));
+        if (!device.runUntilLine("Custom color sequence applied successfully", 10000000))
+        {
+            fprintf(stderr, "nback-benchmark: %s: session %d was not configured\n", scenario.name, session);
+            return false;
+        }
+        device.takeLines();
+
+        traces.clear();
+        markerWidths.clear();
+        participant.beginSession(nBack);
+        device.sendLine("start");
+        triggerPulses.clear();
+        if (scenario.paced)
+        {
+            pacedSession = session;
+            Runtime::get().schedule(Runtime::get().now() + TRIGGER_PERIOD_US, [&device, session]()
+                                    { sendTriggerPulse(device, session); });
+        }
+        if (!device.runUntilLine("task-completed", (Micros)trials * 60000000ULL))
+        {
+            fprintf(stderr, "nback-benchmark: %s: session %d did not complete\n", scenario.name, session);
+            return false;
+        }
+        participant.endSession();
+        pacedSession = 0;
+
+        // The last pulse ends after task-completed
+        device.runFor((Micros)MARKER_MAX_WIDTH_MS * 1000);
+
+        // The n-th trial_complete event on the wire belongs to the n-th trial
+        std::vector<Micros> onWire;
+        std::vector<OutputLine> streamed;
+        for (const OutputLine &line : device.takeLines())
+        {
+            if (line.text.compare(0, 6, "write>") == 0 && line.text.find(",trial_complete,") != std::string::npos)
+            {
+                onWire.push_back(line.completedAt);
+            }
+            if (line.text.compare(0, 5, "data>") == 0)
+            {
+                streamed.push_back(line);
+            }
+        }
+
+        // Streamed lines are off the wire before each onset (with the line
+        // terminator, 10 bits a byte)
+        Micros byteUs = Runtime::get().uart().byteTime();
+        for (size_t i = 1; i < traces.size(); i++)
+        {
+            Micros last = 0;
+            for (const OutputLine &line : streamed)
+            {
+                Micros start = line.completedAt - (line.text.size() + 2) * byteUs;
+                if (start < traces[i].onset && line.completedAt > traces[i].onset)
+                {
+                    fprintf(stderr, "nback-benchmark: %s: session %d trial %zu: a streamed line was on the wire "
+                                    "at the onset\n",
+                            scenario.name, session, i + 1);
+                    return false;
+                }
+                if (line.completedAt > traces[i - 1].onset && line.completedAt <= traces[i].onset)
+                {
+                    last = line.completedAt;
+                }
+            }
+            if (last)
+            {
+                result.stages[STAGE_STREAM_SLACK].add((traces[i].onset - last) / 1000.0);
+            }
+        }
+
+        const std::vector<GroundTruth> &truth = participant.getTrials();
+        size_t count = std::min(std::min(truth.size(), traces.size()), onWire.size());
+        for (size_t i = 0; i < count; i++)
+        {
+            const TrialTrace &t = traces[i];
+            if (!t.captured || !t.evaluateBegin || !t.serializeEnd)
+            {
+                continue;
+            }
+            Micros edge = truth[i].pressAt;
+            Distribution *stages = result.stages;
+            stages[STAGE_INPUT_SAMPLING].add((t.captured - edge) / 1000.0);
+            stages[STAGE_DISPATCH].add((t.evaluateBegin - t.captured) / 1000.0);
+            stages[STAGE_EVALUATE].add((t.serializeBegin - t.evaluateBegin) / 1000.0);
+            stages[STAGE_SERIALIZE].add((t.serializeEnd - t.serializeBegin) / 1000.0);
+            stages[STAGE_UART_DRAIN].add((onWire[i] - t.serializeEnd) / 1000.0);
+            stages[STAGE_EVALUATE_TOTAL].add((t.evaluateEnd - t.evaluateBegin) / 1000.0);
+            stages[STAGE_END_TO_END].add((onWire[i] - edge) / 1000.0);
+            result.trials++;
+        }
+
+        // Markers of every trial, also those without a press
+        const DataCollector &data = nBackTask.getDataCollector();
+        for (size_t i = 0; i < traces.size() && i < data.getTrialCount(); i++)
+        {
+            const TrialTrace &t = traces[i];
+            const NBackTrialData *row = data.getTrial((uint8_t)i);
+            uint32_t onsetUs = t.onsetMarker ? (uint32_t)(t.onsetMarker - t.onset) : 0;
+            uint32_t responseUs = t.responseMarker ? (uint32_t)(t.responseMarker - t.onset) : 0;
+            if (!t.onsetMarker || row->onset_marker_us != onsetUs || row->response_marker_us != responseUs)
+            {
+                fprintf(stderr, "nback-benchmark: %s: session %d trial %zu: markers recorded at %u/%u us, "
+                                "seen on the pins at %u/%u us\n",
+                        scenario.name, session, i + 1, (unsigned)row->onset_marker_us,
+                        (unsigned)row->response_marker_us, (unsigned)onsetUs, (unsigned)responseUs);
+                return false;
+            }
+            result.stages[STAGE_MARKER_ONSET].add((t.onsetMarker - t.latched) / 1000.0);
+            if (t.responseMarker && i < truth.size())
+            {
+                result.stages[STAGE_MARKER_RESPONSE].add((t.responseMarker - truth[i].pressAt) / 1000.0);
+            }
+        }
+        for (double width : markerWidths)
+        {
+            result.stages[STAGE_MARKER_WIDTH].add(width);
+        }
+
+        // Deferred jobs are done before the next onset
+        for (size_t i = 0; i + 1 < traces.size(); i++)
+        {
+            if (!traces[i].deferredDone || traces[i].deferredDone > traces[i + 1].onset)
+            {
+                fprintf(stderr, "nback-benchmark: %s: session %d trial %zu: deferred jobs not done before the "
+                                "next onset\n",
+                        scenario.name, session, i + 1);
+                return false;
+            }
+            result.stages[STAGE_SLACK].add((traces[i + 1].onset - traces[i].deferredDone) / 1000.0);
+        }
+
+        // Paced trials start on the last pulse before their onset
+        for (size_t i = 0; scenario.paced && i < traces.size() && i < data.getTrialCount(); i++)
+        {
+            const TrialTrace &t = traces[i];
+            Micros pulse = 0;
+            for (Micros edge : triggerPulses)
+            {
+                pulse = edge <= t.onset ? edge : pulse;
+            }
+            uint32_t latencyUs = (uint32_t)(t.latched - pulse - Runtime::get().costs.interruptEntry);
+            if (!pulse || data.getTrial((uint8_t)i)->trigger_latency_us != latencyUs)
+            {
+                fprintf(stderr, "nback-benchmark: %s: session %d trial %zu: trigger latency recorded as %u us, "
+                                "latched %u us after the last pulse\n",
+                        scenario.name, session, i + 1, (unsigned)data.getTrial((uint8_t)i)->trigger_latency_us,
+                        (unsigned)latencyUs);
+                return false;
+            }
+            result.stages[STAGE_TRIGGER_ONSET].add((t.onset - pulse) / 1000.0);
+            result.stages[STAGE_TRIGGER_LATCHED].add((t.latched - pulse) / 1000.0);
+        }
+        done += trials;
+    }
+
+    // The last session's data streams once the device is idle
+    if (scenario.stream && !device.runUntilLine("data>Closing Data Socket", 60000000))
+    {
+        fprintf(stderr, "nback-benchmark: %s: the last session's data was not streamed\n", scenario.name);
+        return false;
+    }
+    device.sendLine("trigger off");
+    device.sendLine("stream off");
+    device.runFor(1000000);
+    device.takeLines();
+    return true;
+}
+
+// Virtual ms from the first setup byte sent to the host seeing `done 3`
+static bool timeSetup(VirtualDevice &device, bool pipelined, uint64_t seed, double &setupMs)
+{
+    std::mt19937_64 sequenceRng(seed);
+    const int trials = 20;
+    char config[64];
+    snprintf(config, sizeof(config), "config 1000,500,2,%d,BENCH,1,", trials);
+    const std::string commands[] = {
+        "@1 " + (config + sequenceArgument(buildSequence(sequenceRng, trials, 2, 0.3))),
+        "@2 validate",
+        "@3 start",
+    };
+
+    device.runFor(1000000);
+    device.takeLines();
+    Micros begin = Runtime::get().now();
+    for (int i = 0; i < 3; i++)
+    {
+        if (pipelined)
+        {
+            device.sendLine(commands[i]);
+            continue;
+        }
+        if (i > 0)
+        {
+            device.runFor(HOST_TURNAROUND_US);
+        }
+        device.sendLine(commands[i]);
+        if (!device.runUntilLine("done " + std::to_string(i + 1), 10000000))
+        {
+            fprintf(stderr, "nback-benchmark: setup command %d did not complete\n", i + 1);
+            return false;
+        }
+    }
+    if (pipelined && !device.runUntilLine("done 3", 10000000))
+    {
+        fprintf(stderr, "nback-benchmark: pipelined setup did not complete\n");
+        return false;
+    }
+    setupMs = (Runtime::get().now() - begin) / 1000.0;
+
+    device.sendLine("exit");
+    device.runFor(1000000);
+    device.takeLines();
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    int totalTrials = 500;
+    uint64_t seed = 1;
+    bool json = false;
+    std::string only;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--trials" && hasValue)
+            totalTrials = atoi(argv[++i]);
+        else if (arg == "--scenario" && hasValue)
+            only = argv[++i];
+        else if (arg == "--seed" && hasValue)
+            seed = strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--json")
+            json = true;
+        else
+        {
+            fprintf(stderr, "usage: nback-benchmark [--trials N] [--scenario NAME] [--seed N] [--json]\n");
+            return 2;
+        }
+    }
+
+    Runtime &rt = Runtime::get();
+    rt.seedRandom((uint32_t)seed);
+    rt.addTraceObserver(onTrace);
+    rt.addPixelObserver(onPixels);
+    rt.addPinObserver(onPin);
+
+    VirtualDevice device;
+    device.boot();
+    device.runFor(5000000);
+    device.takeLines();
+
+    std::vector<ScenarioResult> results;
+    for (int s = 0; s < SCENARIO_COUNT; s++)
+    {
+        if (!only.empty() && only != SCENARIOS[s].name)
+        {
+            continue;
+        }
+        results.push_back(ScenarioResult());
+        if (!runScenario(device, SCENARIOS[s], totalTrials, seed, results.back()))
+        {
+            return 1;
+        }
+    }
+    if (results.empty())
+    {
+        fprintf(stderr, "nback-benchmark: unknown scenario '%s'\n", only.c_str());
+        return 2;
+    }
+
+    double stopAndWaitMs = 0;
+    double pipelinedMs = 0;
+    if (!timeSetup(device, false, seed, stopAndWaitMs) || !timeSetup(device, true, seed, pipelinedMs))
+    {
+        return 1;
+    }
+
+    if (json)
+    {
+        printf("{\"seed\":%llu,\"setup_ms\":{\"stop_and_wait\":%.3f,\"pipelined\":%.3f},\"scenarios\":{",
+               (unsigned long long)seed, stopAndWaitMs, pipelinedMs);
+        for (size_t r = 0; r < results.size(); r++)
+        {
+            printf("%s\"%s\":{\"trials\":%d", r ? "," : "", results[r].scenario->name, results[r].trials);
+            for (int s = 0; s < STAGE_COUNT; s++)
+            {
+                printf(",%s", results[r].stages[s].toJson(std::string(STAGE_NAMES[s]) + "_ms").c_str());
+            }
+            printf("}");
+        }
+        printf("}}\n");
+        return 0;
+    }
+
+    for (ScenarioResult &result : results)
+    {
+        printf("=== %s (%d trials) ===\n", result.scenario->name, result.trials);
+        for (int s = 0; s < STAGE_COUNT; s++)
+        {
+            result.stages[s].printRow(stdout, STAGE_NAMES[s], "ms");
+        }
+        printf("\n");
+    }
+    printf("=== session setup (config, validate, start) ===\n");
+    printf("stop-and-wait  %8.3f ms\n", stopAndWaitMs);
+    printf("pipelined      %8.3f ms\n", pipelinedMs);
+    return 0;
+}
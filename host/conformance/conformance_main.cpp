@@ -0,0 +1,605 @@
+#include <Arduino.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "virtual_device.h"
+
+//==============================================================================
+// Serial Protocol Conformance
+//==============================================================================
+//
+// Drives the firmware through scripted command scenarios and compares every
+// byte it prints with a golden transcript, and the time each command takes to
+// answer with a latency baseline.
+//
+//   nback-conformance [--dir DIR] [--scenario NAME] [--update] [--show] [--json]
+//
+// DIR (default host/conformance) holds scenarios/NAME.txt, golden/NAME.txt
+// and golden/latency.csv. --update rewrites the goldens and the baseline from
+// the current firmware; review the diff before committing it. --show prints
+// the transcripts instead of checking them.
+//
+// Scenario scripts, one step per line ('#' comments):
+//
+//   input button|touch        firmware input mode (before the first command)
+//   send <command>            send a command line and run until the answer is
+//                             over (no output for 200 ms)
+//   post <command>            send a command line right behind the previous
+//                             one, without waiting for an answer (pipelining)
+//   wait <ms>                 run for virtual ms
+//   until <prefix>            run until a line starts with prefix (60 s at most)
+//   press confirm|wrong [ms]  push button, held for ms (default 100)
+//   touch confirm|wrong [ms]  touch pad, held for ms (default 100)
+//   trigger <count> [ms]      trigger pulses, one now and then one every ms
+//                             (default 1000)
+//
+// Transcripts hold the firmware's lines as printed, "> command" for every line
+// sent, "* press confirm" or "* trigger 3" for inputs and "! timeout: <prefix>"
+// when an until step times out. Each scenario runs in a forked process on a
+// freshly booted firmware; boot output is only part of the transcript of the
+// "boot" scenario.
+//
+// Latency (virtual time, identical on every machine) runs from the last byte
+// of a command reaching the device to its first and to its last answer line.
+// A command whose last line comes more than 10% and 1 ms later than in the
+// baseline is a regression.
+
+using namespace host;
+
+static const Micros BOOT_TIME_US = 5000000;
+static const Micros SETTLE_US = 200000;      // Silence that ends a command's answer
+static const Micros SETTLE_MAX_US = 5000000; // Answers that never go quiet
+static const Micros UNTIL_TIMEOUT_US = 60000000;
+static const Micros TRIGGER_PULSE_US = 1000; // Scanner TR pulses are a few ms at most
+
+struct CommandLatency
+{
+    std::string scenario;
+    int step;           // Line number in the scenario
+    std::string command;
+    Micros firstUs;     // 0 if nothing was printed
+    Micros doneUs;
+    int lines;
+};
+
+struct ScenarioResult
+{
+    std::string transcript;
+    std::vector<CommandLatency> latencies;
+    std::string error;
+};
+
+static std::string readFile(const std::string &path)
+{
+    std::ifstream in(path, std::ios::binary);
+    std::ostringstream content;
+    content << in.rdbuf();
+    return content.str();
+}
+
+static bool writeFile(const std::string &path, const std::string &data)
+{
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out << data;
+    return (bool)out;
+}
+
+//==============================================================================
+// Scenario Runner (child process)
+//==============================================================================
+
+class ScenarioRunner
+{
+public:
+    ScenarioRunner(const std::string &name) : name(name), pending(-1) {}
+
+    void run(const std::string &script, bool keepBoot)
+    {
+        Runtime &rt = Runtime::get();
+        rt.seedRandom(1);
+
+        std::istringstream in(script);
+        std::string line;
+        int lineNumber = 0;
+        bool started = false;
+        while (std::getline(in, line))
+        {
+            lineNumber++;
+            std::istringstream fields(line);
+            std::string action;
+            if (!(fields >> action) || action[0] == '#')
+            {
+                continue;
+            }
+
+            if (action == "input")
+            {
+                std::string mode;
+                fields >> mode;
+                nBackTask.setInputMode(mode == "touch" ? CAPACITIVE_INPUT : BUTTON_INPUT);
+                continue;
+            }
+            if (!started)
+            {
+                device.boot();
+                runFor(BOOT_TIME_US);
+                collect(keepBoot);
+                started = true;
+            }
+
+            if (action == "send")
+            {
+                std::string text;
+                std::getline(fields >> std::ws, text);
+                closeCommand();
+                transcript += "> " + text + "\n";
+                device.sendLine(text);
+
+                // The device has the command once its last byte is off the wire
+                CommandLatency latency = {name, lineNumber, text.substr(0, text.find(' ')), 0, 0, 0};
+                sentAt = rt.now() + (text.size() + 1) * rt.uart().byteTime();
+                latencies.push_back(latency);
+                pending = (int)latencies.size() - 1;
+                settle();
+            }
+            else if (action == "post")
+            {
+                std::string text;
+                std::getline(fields >> std::ws, text);
+                closeCommand();
+                transcript += "> " + text + "\n";
+                device.sendLine(text);
+            }
+            else if (action == "wait")
+            {
+                unsigned long ms = 0;
+                fields >> ms;
+                runFor((Micros)ms * 1000);
+                collect(true);
+            }
+            else if (action == "until")
+            {
+                std::string prefix;
+                std::getline(fields >> std::ws, prefix);
+                if (!runUntilPrefix(prefix, UNTIL_TIMEOUT_US))
+                {
+                    transcript += "! timeout: " + prefix + "\n";
+                }
+            }
+            else if (action == "press" || action == "touch")
+            {
+                std::string which;
+                unsigned long holdMs = 100;
+                fields >> which >> holdMs;
+                closeCommand();
+                ResponseInput input = which == "wrong" ? RESPONSE_WRONG : RESPONSE_CONFIRM;
+                transcript += "* " + action + " " + which + "\n";
+                if (action == "press")
+                    device.pressButton(input, rt.now(), (Micros)holdMs * 1000);
+                else
+                    device.touchPad(input, rt.now(), (Micros)holdMs * 1000);
+            }
+            else if (action == "trigger")
+            {
+                unsigned long count = 1, periodMs = 1000;
+                fields >> count >> periodMs;
+                closeCommand();
+                transcript += "* trigger " + std::to_string(count) + "\n";
+                for (unsigned long i = 0; i < count; i++)
+                {
+                    device.pulseTrigger(rt.now() + (Micros)i * periodMs * 1000, TRIGGER_PULSE_US);
+                }
+            }
+            else
+            {
+                error = "line " + std::to_string(lineNumber) + ": unknown step '" + action + "'";
+                return;
+            }
+        }
+        closeCommand();
+    }
+
+    std::string transcript;
+    std::vector<CommandLatency> latencies;
+    std::string error;
+
+private:
+    // Run loop() with the UART delivering output as it leaves the wire
+    void runFor(Micros duration)
+    {
+        Runtime &rt = Runtime::get();
+        Micros until = rt.now() + duration;
+        while (rt.now() < until)
+        {
+            device.step();
+            rt.uart().deliver(rt.now());
+        }
+    }
+
+    // Run until nothing was printed for SETTLE_US
+    void settle()
+    {
+        Runtime &rt = Runtime::get();
+        Micros quietSince = rt.now();
+        Micros deadline = rt.now() + SETTLE_MAX_US;
+        while (rt.now() - quietSince < SETTLE_US && rt.now() < deadline)
+        {
+            device.step();
+            rt.uart().deliver(rt.now());
+            std::vector<OutputLine> lines = device.takeLines();
+            for (const OutputLine &line : lines)
+            {
+                record(line);
+            }
+            if (!lines.empty())
+            {
+                quietSince = rt.now();
+            }
+        }
+    }
+
+    bool runUntilPrefix(const std::string &prefix, Micros timeout)
+    {
+        Runtime &rt = Runtime::get();
+        Micros deadline = rt.now() + timeout;
+        while (rt.now() < deadline)
+        {
+            device.step();
+            rt.uart().deliver(rt.now());
+            // Lines after the match in the same pass are kept too
+            bool matched = false;
+            for (const OutputLine &line : device.takeLines())
+            {
+                matched |= line.text.compare(0, prefix.size(), prefix) == 0;
+                record(line);
+            }
+            if (matched)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void collect(bool keep)
+    {
+        for (const OutputLine &line : device.takeLines())
+        {
+            if (keep)
+            {
+                record(line);
+            }
+        }
+    }
+
+    void record(const OutputLine &line)
+    {
+        transcript += line.text + "\n";
+        if (pending >= 0)
+        {
+            CommandLatency &latency = latencies[(size_t)pending];
+            Micros after = line.completedAt > sentAt ? line.completedAt - sentAt : 0;
+            if (latency.lines == 0)
+            {
+                latency.firstUs = after;
+            }
+            latency.doneUs = after;
+            latency.lines++;
+        }
+    }
+
+    // Lines after the next command or input belong to that step
+    void closeCommand()
+    {
+        collect(true);
+        pending = -1;
+    }
+
+    std::string name;
+    VirtualDevice device;
+    int pending; // Index into `latencies` of the command being answered
+    Micros sentAt;
+};
+
+// Run one scenario in a child process so every scenario boots fresh firmware
+static ScenarioResult runScenario(const std::string &name, const std::string &script)
+{
+    ScenarioResult result;
+    int out[2];
+    if (pipe(out) != 0)
+    {
+        result.error = "pipe failed";
+        return result;
+    }
+
+    pid_t child = fork();
+    if (child == 0)
+    {
+        close(out[0]);
+        ScenarioRunner runner(name);
+        runner.run(script, name == "boot");
+
+        std::ostringstream report;
+        report << runner.error << "\n";
+        for (const CommandLatency &l : runner.latencies)
+        {
+            report << l.step << " " << l.command << " " << l.firstUs << " " << l.doneUs << " " << l.lines << "\n";
+        }
+        report << "@@\n" << runner.transcript;
+        std::string data = report.str();
+        for (size_t done = 0; done < data.size();)
+        {
+            ssize_t n = write(out[1], data.data() + done, data.size() - done);
+            if (n <= 0)
+                break;
+            done += (size_t)n;
+        }
+        _exit(0);
+    }
+    close(out[1]);
+
+    std::string data;
+    char buffer[4096];
+    ssize_t n;
+    while ((n = read(out[0], buffer, sizeof(buffer))) > 0)
+    {
+        data.append(buffer, (size_t)n);
+    }
+    close(out[0]);
+    int status = 0;
+    waitpid(child, &status, 0);
+
+    size_t split = data.find("@@\n");
+    if (split == std::string::npos)
+    {
+        result.error = "scenario process failed";
+        return result;
+    }
+    result.transcript = data.substr(split + 3);
+    std::istringstream header(data.substr(0, split));
+    std::getline(header, result.error);
+    CommandLatency l;
+    l.scenario = name;
+    while (header >> l.step >> l.command >> l.firstUs >> l.doneUs >> l.lines)
+    {
+        result.latencies.push_back(l);
+    }
+    return result;
+}
+
+//==============================================================================
+// Checking
+//==============================================================================
+
+// First differing line, for the failure report
+static std::string firstDifference(const std::string &expected, const std::string &actual)
+{
+    std::istringstream a(expected), b(actual);
+    std::string lineA, lineB;
+    for (int line = 1;; line++)
+    {
+        bool moreA = (bool)std::getline(a, lineA);
+        bool moreB = (bool)std::getline(b, lineB);
+        if (!moreA && !moreB)
+        {
+            return "line endings differ";
+        }
+        if (!moreA || !moreB || lineA != lineB)
+        {
+            return "line " + std::to_string(line) + ":\n    expected: " + (moreA ? lineA : "<end>") +
+                   "\n    actual:   " + (moreB ? lineB : "<end>");
+        }
+    }
+}
+
+static std::string latencyKey(const CommandLatency &l)
+{
+    return l.scenario + ":" + std::to_string(l.step);
+}
+
+static std::map<std::string, CommandLatency> loadBaseline(const std::string &path)
+{
+    std::map<std::string, CommandLatency> baseline;
+    std::istringstream in(readFile(path));
+    std::string line;
+    while (std::getline(in, line))
+    {
+        if (line.empty() || line[0] == '#')
+        {
+            continue;
+        }
+        std::istringstream fields(line);
+        CommandLatency l;
+        std::string step, first, done, lines;
+        std::getline(fields, l.scenario, ',');
+        std::getline(fields, step, ',');
+        std::getline(fields, l.command, ',');
+        std::getline(fields, first, ',');
+        std::getline(fields, done, ',');
+        std::getline(fields, lines, ',');
+        l.step = atoi(step.c_str());
+        l.firstUs = strtoull(first.c_str(), nullptr, 10);
+        l.doneUs = strtoull(done.c_str(), nullptr, 10);
+        l.lines = atoi(lines.c_str());
+        baseline[latencyKey(l)] = l;
+    }
+    return baseline;
+}
+
+int main(int argc, char **argv)
+{
+    std::string dir = "host/conformance";
+    std::string only;
+    bool update = false;
+    bool show = false;
+    bool json = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--dir" && hasValue)
+            dir = argv[++i];
+        else if (arg == "--scenario" && hasValue)
+            only = argv[++i];
+        else if (arg == "--update")
+            update = true;
+        else if (arg == "--show")
+            show = true;
+        else if (arg == "--json")
+            json = true;
+        else
+        {
+            fprintf(stderr, "usage: nback-conformance [--dir DIR] [--scenario NAME] [--update] [--show] [--json]\n");
+            return 2;
+        }
+    }
+
+    std::vector<std::string> names;
+    std::error_code ec;
+    for (const auto &entry : std::filesystem::directory_iterator(dir + "/scenarios", ec))
+    {
+        if (entry.path().extension() == ".txt")
+        {
+            names.push_back(entry.path().stem().string());
+        }
+    }
+    std::sort(names.begin(), names.end());
+    if (!only.empty())
+    {
+        names.assign(std::find(names.begin(), names.end(), only) != names.end() ? 1 : 0, only);
+    }
+    if (names.empty())
+    {
+        fprintf(stderr, "nback-conformance: no scenarios in %s/scenarios\n", dir.c_str());
+        return 1;
+    }
+
+    std::string baselinePath = dir + "/golden/latency.csv";
+    std::map<std::string, CommandLatency> baseline = loadBaseline(baselinePath);
+    std::vector<CommandLatency> latencies;
+    int failures = 0;
+    int regressions = 0;
+
+    for (const std::string &name : names)
+    {
+        ScenarioResult result = runScenario(name, readFile(dir + "/scenarios/" + name + ".txt"));
+        latencies.insert(latencies.end(), result.latencies.begin(), result.latencies.end());
+        std::string goldenPath = dir + "/golden/" + name + ".txt";
+
+        if (!result.error.empty())
+        {
+            failures++;
+            fprintf(stderr, "ERROR %s: %s\n", name.c_str(), result.error.c_str());
+        }
+        else if (show)
+        {
+            printf("=== %s ===\n%s", name.c_str(), result.transcript.c_str());
+        }
+        else if (update)
+        {
+            if (!writeFile(goldenPath, result.transcript))
+            {
+                fprintf(stderr, "nback-conformance: cannot write %s\n", goldenPath.c_str());
+                return 1;
+            }
+        }
+        else
+        {
+            std::string golden = readFile(goldenPath);
+            bool match = golden == result.transcript;
+            failures += !match;
+            if (!json)
+            {
+                printf("%s %s\n", match ? "PASS" : "FAIL", name.c_str());
+                if (!match)
+                {
+                    printf("  %s\n", golden.empty() ? "no golden transcript" : firstDifference(golden, result.transcript).c_str());
+                }
+            }
+        }
+    }
+
+    if (update && failures == 0)
+    {
+        // Keep the baseline of scenarios that were not run
+        for (const CommandLatency &l : latencies)
+        {
+            baseline[latencyKey(l)] = l;
+        }
+        std::ostringstream csv;
+        csv << "# scenario,step,command,first_us,done_us,lines\n";
+        std::vector<CommandLatency> sorted;
+        for (const std::pair<const std::string, CommandLatency> &entry : baseline)
+        {
+            sorted.push_back(entry.second);
+        }
+        std::sort(sorted.begin(), sorted.end(), [](const CommandLatency &a, const CommandLatency &b)
+                  { return a.scenario != b.scenario ? a.scenario < b.scenario : a.step < b.step; });
+        for (const CommandLatency &l : sorted)
+        {
+            csv << l.scenario << "," << l.step << "," << l.command << "," << l.firstUs << "," << l.doneUs << ","
+                << l.lines << "\n";
+        }
+        writeFile(baselinePath, csv.str());
+        printf("updated %zu transcripts and %s\n", names.size(), baselinePath.c_str());
+        return 0;
+    }
+    if (show || update)
+    {
+        return failures == 0 ? 0 : 1;
+    }
+
+    // Latency against the baseline
+    if (json)
+    {
+        printf("{\"scenarios\":%zu,\"failures\":%d,\"commands\":[", names.size(), failures);
+    }
+    else
+    {
+        printf("\n%-22s %4s %-12s %10s %10s %10s %6s\n", "scenario", "step", "command", "first_ms", "done_ms",
+               "base_ms", "lines");
+    }
+    bool firstRow = true;
+    for (const CommandLatency &l : latencies)
+    {
+        std::map<std::string, CommandLatency>::const_iterator base = baseline.find(latencyKey(l));
+        bool known = base != baseline.end() && base->second.command == l.command;
+        bool slower = known && l.doneUs > base->second.doneUs + std::max<Micros>(base->second.doneUs / 10, 1000);
+        regressions += slower;
+        if (json)
+        {
+            printf("%s{\"scenario\":\"%s\",\"step\":%d,\"command\":\"%s\",\"first_us\":%llu,\"done_us\":%llu,"
+                   "\"baseline_done_us\":%lld,\"lines\":%d}",
+                   firstRow ? "" : ",", l.scenario.c_str(), l.step, l.command.c_str(), (unsigned long long)l.firstUs,
+                   (unsigned long long)l.doneUs, known ? (long long)base->second.doneUs : -1LL, l.lines);
+            firstRow = false;
+            continue;
+        }
+        char baseText[16] = "-";
+        if (known)
+        {
+            snprintf(baseText, sizeof(baseText), "%.3f", base->second.doneUs / 1000.0);
+        }
+        printf("%-22s %4d %-12s %10.3f %10.3f %10s %6d%s\n", l.scenario.c_str(), l.step, l.command.c_str(),
+               l.firstUs / 1000.0, l.doneUs / 1000.0, baseText, l.lines, slower ? "  SLOWER" : "");
+    }
+    if (json)
+    {
+        printf("],\"regressions\":%d}\n", regressions);
+    }
+    else
+    {
+        printf("\n%zu scenarios, %d transcript failures, %d latency regressions\n", names.size(), failures, regressions);
+    }
+    return failures == 0 && regressions == 0 ? 0 : 1;
+}
@@ -0,0 +1,105 @@
+#ifndef DISTRIBUTION_H
+#define DISTRIBUTION_H
+
+#include <stdio.h>
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+//==============================================================================
+// Distribution
+//==============================================================================
+//
+// Collects samples of one measured quantity and summarises them for the host
+// tools' reports (text for people, JSON for regression tracking).
+
+namespace host
+{
+    class Distribution
+    {
+    public:
+        void add(double value)
+        {
+            samples.push_back(value);
+            sorted = false;
+        }
+
+        size_t count() const { return samples.size(); }
+
+        double mean() const
+        {
+            if (samples.empty())
+            {
+                return 0;
+            }
+            double sum = 0;
+            for (double v : samples)
+            {
+                sum += v;
+            }
+            return sum / samples.size();
+        }
+
+        double stddev() const
+        {
+            if (samples.size() < 2)
+            {
+                return 0;
+            }
+            double m = mean();
+            double sumSq = 0;
+            for (double v : samples)
+            {
+                sumSq += (v - m) * (v - m);
+            }
+            return std::sqrt(sumSq / (samples.size() - 1));
+        }
+
+        // Nearest-rank percentile, p in [0, 100]
+        double percentile(double p)
+        {
+            if (samples.empty())
+            {
+                return 0;
+            }
+            if (!sorted)
+            {
+                std::sort(samples.begin(), samples.end());
+                sorted = true;
+            }
+            size_t rank = (size_t)std::ceil(p / 100.0 * samples.size());
+            rank = rank == 0 ? 0 : rank - 1;
+            return samples[std::min(rank, samples.size() - 1)];
+        }
+
+        double min() { return percentile(0); }
+        double max() { return percentile(100); }
+
+        // "name": {"n":..,"mean":..,"sd":..,"min":..,"p50":..,...}
+        std::string toJson(const std::string &name)
+        {
+            char buffer[384];
+            snprintf(buffer, sizeof(buffer),
+                     "\"%s\":{\"n\":%zu,\"mean\":%.4f,\"sd\":%.4f,\"min\":%.4f,\"p1\":%.4f,"
+                     "\"p5\":%.4f,\"p50\":%.4f,\"p95\":%.4f,\"p99\":%.4f,\"max\":%.4f}",
+                     name.c_str(), count(), mean(), stddev(), min(), percentile(1),
+                     percentile(5), percentile(50), percentile(95), percentile(99), max());
+            return buffer;
+        }
+
+        // One aligned line of the text report
+        void printRow(FILE *out, const std::string &name, const char *unit)
+        {
+            fprintf(out, "%-28s n=%-6zu mean=%9.3f sd=%8.3f  p5=%9.3f p50=%9.3f p95=%9.3f p99=%9.3f max=%9.3f %s\n",
+                    name.c_str(), count(), mean(), stddev(), percentile(5), percentile(50),
+                    percentile(95), percentile(99), max(), unit);
+        }
+
+    private:
+        std::vector<double> samples;
+        bool sorted = false;
+    };
+}
+
+#endif // DISTRIBUTION_H
@@ -0,0 +1,43 @@
+#include "sequence_builder.h"
+
+namespace host
+{
+    static const char *COLOR_NAMES[] = {"red", "green", "blue", "yellow", "purple"};
+    static const int COLORS_USED_COUNT = 5;
+
+    std::vector<int> buildSequence(std::mt19937_64 &rng, int trials, int nBack, double targetRate)
+    {
+        std::vector<int> sequence;
+        std::uniform_int_distribution<int> color(0, COLORS_USED_COUNT - 1);
+        std::uniform_real_distribution<double> coin(0.0, 1.0);
+
+        for (int i = 0; i < trials; i++)
+        {
+            if (i >= nBack && coin(rng) < targetRate)
+            {
+                sequence.push_back(sequence[i - nBack]);
+                continue;
+            }
+
+            // Non-targets never repeat the colour n positions back
+            int c = color(rng);
+            while (i >= nBack && c == sequence[i - nBack])
+            {
+                c = color(rng);
+            }
+            sequence.push_back(c);
+        }
+        return sequence;
+    }
+
+    std::string sequenceArgument(const std::vector<int> &sequence)
+    {
+        std::string out = "%";
+        for (size_t i = 0; i < sequence.size(); i++)
+        {
+            out += i ? "," : "";
+            out += COLOR_NAMES[sequence[i]];
+        }
+        return out + "%";
+    }
+}
@@ -0,0 +1,24 @@
+#ifndef SEQUENCE_BUILDER_H
+#define SEQUENCE_BUILDER_H
+
+#include <random>
+#include <string>
+#include <vector>
+
+//==============================================================================
+// Sequence Builder
+//==============================================================================
+//
+// Colour sequences for host-driven sessions. Uploading the sequence with the
+// config command keeps sessions independent of the firmware's generator.
+
+namespace host
+{
+    // Colour indices (as in ColorIndex) with about `targetRate` n-back matches
+    std::vector<int> buildSequence(std::mt19937_64 &rng, int trials, int nBack, double targetRate);
+
+    // "%red,green,...%" argument for the config command
+    std::string sequenceArgument(const std::vector<int> &sequence);
+}
+
+#endif // SEQUENCE_BUILDER_H
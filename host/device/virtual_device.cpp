@@ -0,0 +1,145 @@
+#include "virtual_device.h"
+
+namespace host
+{
+    VirtualDevice::VirtualDevice()
+        : booted(false),
+          capture(true),
+          touchedValue(10),
+          latchedColor(0),
+          latchedAt(0)
+    {
+        Runtime &rt = Runtime::get();
+
+        rt.addSerialObserver([this](Micros at, uint8_t byte)
+                             { onSerialByte(at, byte); });
+
+        // Only colour changes count; loop() re-sends the same frame constantly
+        rt.addPixelObserver([this](Micros at, const uint32_t *colors, uint16_t count)
+                            {
+                                uint32_t color = count > 0 ? colors[0] : 0;
+                                if (color != latchedColor)
+                                {
+                                    latchedColor = color;
+                                    latchedAt = at;
+                                } });
+    }
+
+    void VirtualDevice::boot()
+    {
+        if (booted)
+        {
+            return;
+        }
+        booted = true;
+        setup();
+    }
+
+    void VirtualDevice::step()
+    {
+        Runtime &rt = Runtime::get();
+        loop();
+        rt.advance(rt.costs.loopOverhead);
+    }
+
+    void VirtualDevice::runUntil(Micros t)
+    {
+        boot();
+        while (Runtime::get().now() < t && !Runtime::get().quitRequested())
+        {
+            step();
+        }
+    }
+
+    bool VirtualDevice::runUntilLine(const std::string &text, Micros timeout)
+    {
+        boot();
+        Runtime &rt = Runtime::get();
+        Micros deadline = rt.now() + timeout;
+        size_t scanned = lines.size();
+
+        while (rt.now() < deadline && !rt.quitRequested())
+        {
+            step();
+            rt.uart().deliver(rt.now());
+            for (; scanned < lines.size(); scanned++)
+            {
+                if (lines[scanned].text == text)
+                {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    void VirtualDevice::sendLine(const std::string &line)
+    {
+        std::string framed = line + "\n";
+        Runtime::get().uart().receive((const uint8_t *)framed.data(), framed.size());
+    }
+
+    void VirtualDevice::pressButton(ResponseInput input, Micros at, Micros hold)
+    {
+        Runtime &rt = Runtime::get();
+        int pin = input == RESPONSE_CONFIRM ? BUTTON_CORRECT_PIN : BUTTON_WRONG_PIN;
+
+        // Buttons pull the pin LOW while held
+        rt.schedule(at, [pin]()
+                    { Runtime::get().driveInput(pin, LOW); });
+        rt.schedule(at + hold, [pin]()
+                    { Runtime::get().driveInput(pin, HIGH); });
+    }
+
+    void VirtualDevice::touchPad(ResponseInput input, Micros at, Micros hold)
+    {
+        Runtime &rt = Runtime::get();
+        int pin = input == RESPONSE_CONFIRM ? TOUCH_CORRECT_PIN : TOUCH_WRONG_PIN;
+        int touched = touchedValue;
+
+        // A finger on the pad drops the reading; lifting it restores the baseline
+        rt.schedule(at, [pin, touched]()
+                    { Runtime::get().setTouchValue(pin, touched); });
+        rt.schedule(at + hold, [pin]()
+                    { Runtime::get().setTouchValue(pin, Runtime::get().getTouchBaseline()); });
+    }
+
+    void VirtualDevice::pulseTrigger(Micros at, Micros width)
+    {
+        Runtime &rt = Runtime::get();
+        rt.schedule(at, []()
+                    { Runtime::get().driveInput(TRIGGER_PIN, HIGH); });
+        rt.schedule(at + width, []()
+                    { Runtime::get().driveInput(TRIGGER_PIN, LOW); });
+    }
+
+    std::vector<OutputLine> VirtualDevice::takeLines()
+    {
+        std::vector<OutputLine> out;
+        out.swap(lines);
+        return out;
+    }
+
+    void VirtualDevice::onSerialByte(Micros at, uint8_t byte)
+    {
+        if (!capture)
+        {
+            return;
+        }
+
+        if (byte == '\n')
+        {
+            // println() ends lines with "\r\n"; keep the text only
+            if (!partialLine.empty() && partialLine.back() == '\r')
+            {
+                partialLine.pop_back();
+            }
+            lines.push_back({at, partialLine});
+            partialLine.clear();
+        }
+        else
+        {
+            partialLine += (char)byte;
+        }
+    }
+}
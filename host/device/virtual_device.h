@@ -0,0 +1,89 @@
+#ifndef VIRTUAL_DEVICE_H
+#define VIRTUAL_DEVICE_H
+
+#include <Arduino.h>
+#include <string>
+#include <vector>
+#include "nback_task.h"
+
+//==============================================================================
+// Virtual Device
+//==============================================================================
+//
+// The complete firmware (main.cpp and everything it owns) running on the host
+// runtime, with the participant-facing hardware exposed as scriptable inputs.
+// Every host tool drives the firmware through this class.
+
+// Objects owned by main.cpp
+extern NBackTask nBackTask;
+
+namespace host
+{
+    // The two response inputs of the unit
+    enum ResponseInput
+    {
+        RESPONSE_CONFIRM,
+        RESPONSE_WRONG
+    };
+
+    // One line the firmware printed, stamped when its last byte left the UART
+    struct OutputLine
+    {
+        Micros completedAt;
+        std::string text;
+    };
+
+    class VirtualDevice
+    {
+    public:
+        VirtualDevice();
+
+        // Run setup() once; safe to call again (does nothing the second time)
+        void boot();
+
+        // One pass through loop() plus the modelled loop overhead
+        void step();
+
+        // Run loop() until the virtual clock reaches the given time
+        void runUntil(Micros t);
+        void runFor(Micros duration) { runUntil(Runtime::get().now() + duration); }
+
+        // Run until the firmware prints a line equal to `text`; false on timeout
+        bool runUntilLine(const std::string &text, Micros timeout);
+
+        // Host to device: one command line, terminated with '\n'
+        void sendLine(const std::string &line);
+
+        // Participant inputs, pressed at `at` and released `hold` later
+        void pressButton(ResponseInput input, Micros at, Micros hold);
+        void touchPad(ResponseInput input, Micros at, Micros hold);
+
+        // External trigger: a pulse on TRIGGER_PIN, high from `at` for `width`
+        void pulseTrigger(Micros at, Micros width);
+
+        // Pad reading while touched (the untouched baseline is the runtime's)
+        void setTouchedValue(int value) { touchedValue = value; }
+
+        // Output captured since the last call (complete lines only)
+        std::vector<OutputLine> takeLines();
+        bool isCapturing() const { return capture; }
+        void setCapture(bool enabled) { capture = enabled; }
+
+        // Colour currently latched on the strip and when it was latched
+        uint32_t currentColor() const { return latchedColor; }
+        Micros colorLatchedAt() const { return latchedAt; }
+
+    private:
+        void onSerialByte(Micros at, uint8_t byte);
+
+        bool booted;
+        bool capture;
+        int touchedValue;
+        std::string partialLine;
+        std::vector<OutputLine> lines;
+        uint32_t latchedColor;
+        Micros latchedAt;
+    };
+}
+
+#endif // VIRTUAL_DEVICE_H
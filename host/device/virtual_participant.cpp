@@ -0,0 +1,79 @@
+#include "virtual_participant.h"
+
+namespace host
+{
+    // Feedback flash colour; never a stimulus
+    static const uint32_t FEEDBACK_WHITE = 0xFFFFFF;
+
+    VirtualParticipant::VirtualParticipant(VirtualDevice &device, const ParticipantProfile &profile, uint64_t seed)
+        : device(device),
+          profile(profile),
+          rng(seed),
+          active(false),
+          nBackLevel(1),
+          lastColor(0)
+    {
+        Runtime::get().addPixelObserver([this](Micros at, const uint32_t *colors, uint16_t count)
+                                        { onPixels(at, count > 0 ? colors[0] : 0); });
+    }
+
+    void VirtualParticipant::beginSession(int nBackLevel)
+    {
+        this->nBackLevel = nBackLevel;
+        active = true;
+        lastColor = 0;
+        seen.clear();
+        trials.clear();
+    }
+
+    void VirtualParticipant::onPixels(Micros at, uint32_t color)
+    {
+        uint32_t previous = lastColor;
+        lastColor = color;
+
+        // A stimulus is the strip going from dark to a task colour
+        if (!active || previous != 0 || color == 0 || color == FEEDBACK_WHITE)
+        {
+            return;
+        }
+
+        GroundTruth trial;
+        trial.stimulusNumber = (uint16_t)(trials.size() + 1);
+        trial.color = color;
+        trial.isTarget = (int)seen.size() >= nBackLevel && seen[seen.size() - nBackLevel] == color;
+        seen.push_back(color);
+
+        std::uniform_real_distribution<double> coin(0.0, 1.0);
+        double pConfirm = trial.isTarget ? profile.hitRate : profile.falseAlarmRate;
+        trial.respondedConfirm = coin(rng) < pConfirm;
+
+        trial.onsetAt = at;
+        trial.pressAt = at + (Micros)(drawReactionTimeMs() * 1000.0 + 0.5);
+        trials.push_back(trial);
+
+        ResponseInput input = trial.respondedConfirm ? RESPONSE_CONFIRM : RESPONSE_WRONG;
+        Micros hold = (Micros)(profile.holdMs * 1000.0);
+        if (profile.useTouch)
+        {
+            device.touchPad(input, trial.pressAt, hold);
+        }
+        else
+        {
+            device.pressButton(input, trial.pressAt, hold);
+        }
+    }
+
+    double VirtualParticipant::drawReactionTimeMs()
+    {
+        // Ex-Gaussian: normal + exponential, the standard shape of human RTs
+        std::normal_distribution<double> normal(profile.muMs, profile.sigmaMs);
+        std::exponential_distribution<double> exponential(profile.tauMs > 0 ? 1.0 / profile.tauMs : 1.0);
+
+        double rt;
+        do
+        {
+            rt = normal(rng) + (profile.tauMs > 0 ? exponential(rng) : 0.0);
+        } while (rt < profile.minRtMs);
+        return rt;
+    }
+}
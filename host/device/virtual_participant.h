@@ -0,0 +1,69 @@
+#ifndef VIRTUAL_PARTICIPANT_H
+#define VIRTUAL_PARTICIPANT_H
+
+#include <random>
+#include <vector>
+#include "virtual_device.h"
+
+//==============================================================================
+// Virtual Participant
+//==============================================================================
+//
+// Watches the emulated strip like a participant would and answers every
+// stimulus on the response hardware. Each press is scheduled at an exact
+// virtual time, so the true reaction time of every trial is known.
+
+namespace host
+{
+    // Behaviour of the simulated participant
+    struct ParticipantProfile
+    {
+        double hitRate;        // P(confirm | target)
+        double falseAlarmRate; // P(confirm | non-target)
+        double muMs;           // Ex-Gaussian: mean of the normal component
+        double sigmaMs;        // Ex-Gaussian: SD of the normal component
+        double tauMs;          // Ex-Gaussian: mean of the exponential component
+        double minRtMs;        // Anticipations below this are redrawn
+        double holdMs;         // How long the finger stays on the input
+        bool useTouch;         // Touch pads instead of push buttons
+    };
+
+    // What actually happened on one trial
+    struct GroundTruth
+    {
+        uint16_t stimulusNumber;  // 1-based position in the session
+        uint32_t color;           // Colour latched on the strip
+        bool isTarget;            // Colour equals the one n stimuli back
+        bool respondedConfirm;    // Which input was pressed
+        Micros onsetAt;           // Strip latched the stimulus (virtual us)
+        Micros pressAt;           // Input went active (virtual us)
+    };
+
+    class VirtualParticipant
+    {
+    public:
+        VirtualParticipant(VirtualDevice &device, const ParticipantProfile &profile, uint64_t seed);
+
+        // Forget the previous session; nBackLevel decides what counts as a target
+        void beginSession(int nBackLevel);
+        void endSession() { active = false; }
+
+        const std::vector<GroundTruth> &getTrials() const { return trials; }
+
+    private:
+        void onPixels(Micros at, uint32_t color);
+        double drawReactionTimeMs();
+
+        VirtualDevice &device;
+        ParticipantProfile profile;
+        std::mt19937_64 rng;
+
+        bool active;
+        int nBackLevel;
+        uint32_t lastColor;
+        std::vector<uint32_t> seen;
+        std::vector<GroundTruth> trials;
+    };
+}
+
+#endif // VIRTUAL_PARTICIPANT_H
@@ -0,0 +1,154 @@
+#include <Arduino.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+#include "input_script.h"
+#include "pty_port.h"
+#include "virtual_device.h"
+#include "virtual_participant.h"
+
+//==============================================================================
+// N-Back Unit Emulator
+//==============================================================================
+//
+// Runs the firmware as a Linux process and exposes its serial port as a pty.
+//
+//   nback-emulator [--link PATH] [--script FILE] [--time-scale X]
+//                  [--input button|touch] [--seed N] [--until MS] [--echo]
+//                  [--participant] [--nvs FILE]
+//
+// --participant answers every stimulus as a simulated 2-back participant,
+// so host software can run whole sessions without an input script.
+//
+// --nvs keeps the unit's NVS flash (stored settings) in FILE, so
+// configuration and calibration survive a restart like a power cycle.
+//
+// --time-scale 1 runs in real time, 60 runs a 30-minute session in 30 s and
+// 0 runs as fast as the host allows. Serial output is always paced at the
+// baud rate passed to Serial.begin(), in virtual time.
+
+using namespace host;
+
+static volatile sig_atomic_t stopRequested = 0;
+
+static void onSignal(int)
+{
+    stopRequested = 1;
+}
+
+static void printUsage()
+{
+    fprintf(stderr,
+            "usage: nback-emulator [--link PATH] [--script FILE] [--time-scale X]\n"
+            "                      [--input button|touch] [--seed N] [--until MS] [--echo]\n"
+            "                      [--participant] [--nvs FILE]\n");
+}
+
+int main(int argc, char **argv)
+{
+    std::string linkPath;
+    std::string scriptPath;
+    double timeScale = 1.0;
+    bool touchInput = true;
+    bool echo = false;
+    bool participate = false;
+    unsigned long seed = 1;
+    unsigned long long untilMs = 0;
+    std::string nvsPath;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--link" && hasValue)
+            linkPath = argv[++i];
+        else if (arg == "--script" && hasValue)
+            scriptPath = argv[++i];
+        else if (arg == "--time-scale" && hasValue)
+            timeScale = atof(argv[++i]);
+        else if (arg == "--input" && hasValue)
+            touchInput = strcmp(argv[++i], "button") != 0;
+        else if (arg == "--seed" && hasValue)
+            seed = strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--until" && hasValue)
+            untilMs = strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--echo")
+            echo = true;
+        else if (arg == "--participant")
+            participate = true;
+        else if (arg == "--nvs" && hasValue)
+            nvsPath = argv[++i];
+        else
+        {
+            printUsage();
+            return 2;
+        }
+    }
+
+    Runtime &rt = Runtime::get();
+    rt.seedRandom(seed);
+    if (!nvsPath.empty() && !rt.setNvsFile(nvsPath))
+    {
+        fprintf(stderr, "nback-emulator: %s: damaged NVS file\n", nvsPath.c_str());
+        return 1;
+    }
+
+    PtyPort port;
+    if (!port.open(linkPath))
+    {
+        perror("nback-emulator: cannot create pty");
+        return 1;
+    }
+    fprintf(stderr, "nback-emulator: serial port at %s\n",
+            linkPath.empty() ? port.getSlavePath().c_str() : linkPath.c_str());
+
+    VirtualDevice device;
+    device.setCapture(false);
+
+    // Device output reaches the pty when its last bit leaves the emulated wire
+    rt.addSerialObserver([&port, echo](Micros, uint8_t byte)
+                         {
+                             port.write(byte);
+                             if (echo)
+                             {
+                                 fputc(byte, stdout);
+                             } });
+    rt.setPumpHook([&port, &rt]()
+                   { port.pump(rt.uart()); });
+
+    InputScript script;
+    if (!scriptPath.empty() && !script.load(scriptPath, device))
+    {
+        fprintf(stderr, "nback-emulator: %s: %s\n", scriptPath.c_str(), script.getError().c_str());
+        return 1;
+    }
+
+    ParticipantProfile profile = {0.85, 0.10, 450.0, 60.0, 150.0, 150.0, 120.0, touchInput};
+    VirtualParticipant participant(device, profile, seed);
+    if (participate)
+    {
+        participant.beginSession(2);
+    }
+
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+
+    rt.setTimeScale(timeScale);
+    device.boot();
+    nBackTask.setInputMode(touchInput ? CAPACITIVE_INPUT : BUTTON_INPUT);
+
+    while (!stopRequested && !rt.quitRequested() &&
+           (untilMs == 0 || rt.now() < untilMs * 1000))
+    {
+        device.step();
+    }
+
+    // Let the last line drain before the pty goes away
+    rt.uart().flush();
+    rt.pump();
+    fflush(stdout);
+    return 0;
+}
@@ -0,0 +1,109 @@
+#include "input_script.h"
+
+#include <fstream>
+#include <sstream>
+
+namespace host
+{
+    bool InputScript::load(const std::string &path, VirtualDevice &device)
+    {
+        std::ifstream in(path);
+        if (!in)
+        {
+            error = "cannot open " + path;
+            return false;
+        }
+
+        std::string line;
+        int lineNumber = 0;
+        while (std::getline(in, line))
+        {
+            lineNumber++;
+            if (!scheduleLine(line, lineNumber, device))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool InputScript::scheduleLine(const std::string &line, int lineNumber, VirtualDevice &device)
+    {
+        std::istringstream fields(line);
+        std::string timeField;
+        std::string action;
+
+        if (!(fields >> timeField) || timeField[0] == '#')
+        {
+            return true; // Blank line or comment
+        }
+
+        // Absolute or relative (+ms) virtual time
+        bool relative = timeField[0] == '+';
+        char *end = nullptr;
+        const char *digits = timeField.c_str() + (relative ? 1 : 0);
+        unsigned long long ms = strtoull(digits, &end, 10);
+        if (end == digits || *end != '\0' || !(fields >> action))
+        {
+            error = "line " + std::to_string(lineNumber) + ": expected '<time> <action>'";
+            return false;
+        }
+        Micros at = relative ? lastTime + ms * 1000 : ms * 1000;
+        lastTime = at;
+
+        Runtime &rt = Runtime::get();
+        if (action == "send")
+        {
+            std::string text;
+            std::getline(fields >> std::ws, text);
+            rt.schedule(at, [&device, text]()
+                        { device.sendLine(text); });
+        }
+        else if (action == "press" || action == "touch")
+        {
+            std::string which;
+            unsigned long holdMs = 100;
+            unsigned long parsedHold = 0;
+            fields >> which;
+            if (fields >> parsedHold)
+            {
+                holdMs = parsedHold;
+            }
+
+            ResponseInput input;
+            if (which == "confirm")
+            {
+                input = RESPONSE_CONFIRM;
+            }
+            else if (which == "wrong")
+            {
+                input = RESPONSE_WRONG;
+            }
+            else
+            {
+                error = "line " + std::to_string(lineNumber) + ": expected 'confirm' or 'wrong'";
+                return false;
+            }
+
+            if (action == "press")
+            {
+                device.pressButton(input, at, (Micros)holdMs * 1000);
+            }
+            else
+            {
+                device.touchPad(input, at, (Micros)holdMs * 1000);
+            }
+        }
+        else if (action == "quit")
+        {
+            rt.schedule(at, []()
+                        { Runtime::get().requestQuit(); });
+        }
+        else
+        {
+            error = "line " + std::to_string(lineNumber) + ": unknown action '" + action + "'";
+            return false;
+        }
+        return true;
+    }
+}
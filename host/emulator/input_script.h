@@ -0,0 +1,39 @@
+#ifndef INPUT_SCRIPT_H
+#define INPUT_SCRIPT_H
+
+#include <string>
+#include "virtual_device.h"
+
+//==============================================================================
+// Input Script
+//==============================================================================
+//
+// Timed participant and host actions for the emulator, one per line:
+//
+//   <time> send <command text>        host sends a command line
+//   <time> press confirm|wrong [ms]   push button held for ms (default 100)
+//   <time> touch confirm|wrong [ms]   finger on a touch pad for ms (default 100)
+//   <time> quit                       stop the emulator
+//
+// <time> is virtual milliseconds since boot, or +ms relative to the previous
+// line. Blank lines and lines starting with '#' are ignored.
+
+namespace host
+{
+    class InputScript
+    {
+    public:
+        // Parse `path` and schedule every action on the runtime; false on error
+        bool load(const std::string &path, VirtualDevice &device);
+
+        const std::string &getError() const { return error; }
+
+    private:
+        bool scheduleLine(const std::string &line, int lineNumber, VirtualDevice &device);
+
+        Micros lastTime = 0;
+        std::string error;
+    };
+}
+
+#endif // INPUT_SCRIPT_H
@@ -0,0 +1,110 @@
+#include "pty_port.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+
+namespace host
+{
+    PtyPort::PtyPort()
+        : masterFd(-1),
+          slaveFd(-1)
+    {
+    }
+
+    PtyPort::~PtyPort()
+    {
+        if (!linkPath.empty())
+        {
+            unlink(linkPath.c_str());
+        }
+        if (slaveFd >= 0)
+        {
+            close(slaveFd);
+        }
+        if (masterFd >= 0)
+        {
+            close(masterFd);
+        }
+    }
+
+    bool PtyPort::open(const std::string &link)
+    {
+        masterFd = posix_openpt(O_RDWR | O_NOCTTY);
+        if (masterFd < 0 || grantpt(masterFd) != 0 || unlockpt(masterFd) != 0)
+        {
+            return false;
+        }
+
+        const char *name = ptsname(masterFd);
+        if (name == nullptr)
+        {
+            return false;
+        }
+        slavePath = name;
+
+        // Hold the slave open so the master never sees EIO between clients
+        slaveFd = ::open(slavePath.c_str(), O_RDWR | O_NOCTTY);
+        if (slaveFd < 0)
+        {
+            return false;
+        }
+
+        // Raw 8-bit line like a USB CDC port; clients may reconfigure it
+        struct termios tio;
+        if (tcgetattr(slaveFd, &tio) == 0)
+        {
+            cfmakeraw(&tio);
+            tcsetattr(slaveFd, TCSANOW, &tio);
+        }
+
+        fcntl(masterFd, F_SETFL, fcntl(masterFd, F_GETFL) | O_NONBLOCK);
+
+        if (!link.empty())
+        {
+            unlink(link.c_str());
+            if (symlink(slavePath.c_str(), link.c_str()) != 0)
+            {
+                return false;
+            }
+            linkPath = link;
+        }
+        return true;
+    }
+
+    void PtyPort::pump(VirtualUart &uart)
+    {
+        uint8_t buffer[256];
+        ssize_t n;
+        while ((n = read(masterFd, buffer, sizeof(buffer))) > 0)
+        {
+            uart.receive(buffer, (size_t)n);
+        }
+        flushPending();
+    }
+
+    void PtyPort::write(uint8_t byte)
+    {
+        pending += (char)byte;
+        if (pending.size() >= 256)
+        {
+            flushPending();
+        }
+    }
+
+    void PtyPort::flushPending()
+    {
+        while (!pending.empty())
+        {
+            ssize_t n = ::write(masterFd, pending.data(), pending.size());
+            if (n <= 0)
+            {
+                // Client not reading: keep the bytes for the next pump
+                return;
+            }
+            pending.erase(0, (size_t)n);
+        }
+    }
+}
@@ -0,0 +1,44 @@
+#ifndef PTY_PORT_H
+#define PTY_PORT_H
+
+#include <string>
+#include "host_runtime.h"
+
+//==============================================================================
+// Pseudo-Terminal Port
+//==============================================================================
+//
+// Exposes the emulated UART as a pty so host software can open it like the
+// USB serial port of a real unit. The emulator keeps the slave side open so
+// clients can connect and disconnect freely.
+
+namespace host
+{
+    class PtyPort
+    {
+    public:
+        PtyPort();
+        ~PtyPort();
+
+        // Create the pty; `linkPath` (optional) becomes a symlink to the slave
+        bool open(const std::string &linkPath);
+        const std::string &getSlavePath() const { return slavePath; }
+
+        // Move bytes written by the client into the UART and flush device output
+        void pump(VirtualUart &uart);
+
+        // Device output that has left the emulated wire
+        void write(uint8_t byte);
+
+    private:
+        void flushPending();
+
+        int masterFd;
+        int slaveFd;
+        std::string slavePath;
+        std::string linkPath;
+        std::string pending;
+    };
+}
+
+#endif // PTY_PORT_H
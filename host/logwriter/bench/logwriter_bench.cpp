@@ -0,0 +1,214 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "write_behind_log.h"
+
+//==============================================================================
+// Event Log Writer Throughput
+//==============================================================================
+//
+// Writes the same interleaved event stream of several devices to one file per
+// device, once with a write() per line (optionally fdatasync per line, as a
+// durable line-at-a-time writer must) and through WriteBehindLog, with a
+// barrier at the end of every session and with interval syncs only.
+//
+//   nback-log-bench [--devices N] [--lines N] [--sync-lines N] [--dir DIR] [--json]
+//
+// --sync-lines limits the per-line fdatasync run, which is slow on real disks.
+
+using namespace host;
+
+static const int LINES_PER_SESSION = 32;
+
+struct Result
+{
+    std::string name;
+    uint64_t lines;
+    uint64_t bytes;
+    double seconds;
+    uint64_t writes;
+    uint64_t syncs;
+    double p99Micros; // Per-line time spent in the writer
+    double maxMicros;
+};
+
+static std::string eventLine(int device, uint64_t index)
+{
+    char line[256];
+    uint32_t t = (uint32_t)(index * 1337 % 900000);
+    snprintf(line, sizeof(line),
+             "DEV%02d,%llu,%u,n-back,trial_complete,%llu,purple,false,true,false,%u,%u,%u,%u\n", device,
+             (unsigned long long)(index / LINES_PER_SESSION + 1), t + 700, (unsigned long long)(index % 100 + 1), t,
+             t + 700, 700, t + 700);
+    return line;
+}
+
+static std::string filePath(const std::string &dir, int device)
+{
+    return dir + "/nback-log-bench-" + std::to_string(getpid()) + "-" + std::to_string(device) + ".csv";
+}
+
+static void finish(Result &result, std::vector<double> &latencies, double seconds)
+{
+    std::sort(latencies.begin(), latencies.end());
+    result.seconds = seconds;
+    result.p99Micros = latencies.empty() ? 0 : latencies[latencies.size() * 99 / 100];
+    result.maxMicros = latencies.empty() ? 0 : latencies.back();
+}
+
+static Result runPerLine(const std::string &dir, int devices, uint64_t lines, bool syncEachLine)
+{
+    Result result = {syncEachLine ? "per_line_fdatasync" : "per_line_write", 0, 0, 0, 0, 0, 0, 0};
+    std::vector<int> fds;
+    for (int d = 0; d < devices; d++)
+    {
+        fds.push_back(open(filePath(dir, d).c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644));
+    }
+
+    std::vector<double> latencies;
+    uint64_t start = monotonicMicros();
+    for (uint64_t i = 0; i < lines; i++)
+    {
+        int d = (int)(i % devices);
+        std::string line = eventLine(d, i / devices);
+        uint64_t before = monotonicMicros();
+        if (write(fds[d], line.data(), line.size()) == (ssize_t)line.size())
+        {
+            result.writes++;
+        }
+        if (syncEachLine)
+        {
+            fdatasync(fds[d]);
+            result.syncs++;
+        }
+        latencies.push_back((double)(monotonicMicros() - before));
+        result.lines++;
+        result.bytes += line.size();
+    }
+    finish(result, latencies, (monotonicMicros() - start) / 1e6);
+
+    for (int d = 0; d < devices; d++)
+    {
+        close(fds[d]);
+        unlink(filePath(dir, d).c_str());
+    }
+    return result;
+}
+
+static Result runWriteBehind(const std::string &dir, int devices, uint64_t lines, size_t blockSize, bool barriers)
+{
+    Result result = {"write_behind_" + std::to_string(blockSize >> 10) + "k" + (barriers ? "" : "_interval"),
+                     0, 0, 0, 0, 0, 0, 0};
+    std::vector<std::unique_ptr<WriteBehindLog>> logs;
+    for (int d = 0; d < devices; d++)
+    {
+        unlink(filePath(dir, d).c_str());
+        logs.emplace_back(new WriteBehindLog());
+        logs.back()->open(filePath(dir, d), blockSize);
+    }
+
+    std::vector<double> latencies;
+    uint64_t start = monotonicMicros();
+    for (uint64_t i = 0; i < lines; i++)
+    {
+        int d = (int)(i % devices);
+        uint64_t index = i / devices;
+        std::string line = eventLine(d, index);
+        uint64_t before = monotonicMicros();
+        logs[d]->append(line);
+        if (barriers && (index + 1) % LINES_PER_SESSION == 0)
+        {
+            logs[d]->sync(); // task-completed
+        }
+        else
+        {
+            logs[d]->pump(before);
+        }
+        latencies.push_back((double)(monotonicMicros() - before));
+        result.lines++;
+        result.bytes += line.size();
+    }
+    for (std::unique_ptr<WriteBehindLog> &log : logs)
+    {
+        log->sync();
+    }
+    finish(result, latencies, (monotonicMicros() - start) / 1e6);
+
+    for (int d = 0; d < devices; d++)
+    {
+        result.writes += logs[d]->getStats().writes;
+        result.syncs += logs[d]->getStats().syncs;
+        logs[d]->close();
+        unlink(filePath(dir, d).c_str());
+    }
+    return result;
+}
+
+int main(int argc, char **argv)
+{
+    int devices = 4;
+    uint64_t lines = 200000;
+    uint64_t syncLines = 2000;
+    std::string dir = "/tmp";
+    bool json = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--devices" && hasValue)
+            devices = std::max(1, atoi(argv[++i]));
+        else if (arg == "--lines" && hasValue)
+            lines = strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--sync-lines" && hasValue)
+            syncLines = strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--dir" && hasValue)
+            dir = argv[++i];
+        else if (arg == "--json")
+            json = true;
+        else
+        {
+            fprintf(stderr, "usage: nback-log-bench [--devices N] [--lines N] [--sync-lines N] [--dir DIR] [--json]\n");
+            return 2;
+        }
+    }
+
+    std::vector<Result> results;
+    results.push_back(runPerLine(dir, devices, lines, false));
+    results.push_back(runPerLine(dir, devices, std::min(lines, syncLines), true));
+    results.push_back(runWriteBehind(dir, devices, lines, 4096, true));
+    results.push_back(runWriteBehind(dir, devices, lines, 65536, true));
+    results.push_back(runWriteBehind(dir, devices, lines, 4096, false));
+
+    if (json)
+    {
+        printf("{\"devices\":%d", devices);
+        for (const Result &r : results)
+        {
+            printf(",\"%s\":{\"lines\":%llu,\"lines_s\":%.0f,\"mb_s\":%.1f,\"writes\":%llu,\"syncs\":%llu,"
+                   "\"p99_us\":%.1f,\"max_us\":%.1f}",
+                   r.name.c_str(), (unsigned long long)r.lines, r.lines / r.seconds,
+                   r.bytes / (1024.0 * 1024.0) / r.seconds, (unsigned long long)r.writes,
+                   (unsigned long long)r.syncs, r.p99Micros, r.maxMicros);
+        }
+        printf("}\n");
+        return 0;
+    }
+
+    printf("=== EVENT LOG WRITERS (%d devices, %d lines per session) ===\n", devices, LINES_PER_SESSION);
+    printf("%-24s %9s %12s %8s %9s %7s %9s %9s\n", "writer", "lines", "lines/s", "MB/s", "writes", "syncs",
+           "p99_us", "max_us");
+    for (const Result &r : results)
+    {
+        printf("%-24s %9llu %12.0f %8.1f %9llu %7llu %9.1f %9.1f\n", r.name.c_str(), (unsigned long long)r.lines,
+               r.lines / r.seconds, r.bytes / (1024.0 * 1024.0) / r.seconds, (unsigned long long)r.writes,
+               (unsigned long long)r.syncs, r.p99Micros, r.maxMicros);
+    }
+    return 0;
+}
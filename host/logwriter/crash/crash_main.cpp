@@ -0,0 +1,318 @@
+#include <Arduino.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+
+#include "protocol_parser.h"
+#include "sequence_builder.h"
+#include "virtual_device.h"
+#include "virtual_participant.h"
+#include "write_behind_log.h"
+
+//==============================================================================
+// Write-Behind Log Crash Check
+//==============================================================================
+//
+// Kills a logging process at random points and checks what survived. Each
+// round forks a child that runs the emulated firmware with a simulated
+// participant and logs its write> events through a WriteBehindLog, the way
+// the aggregator does. After every task-completed barrier the child reports
+// the bytes logged so far and their hash over a pipe; the parent SIGKILLs
+// the child after a random delay and then checks that
+//
+//   - every acknowledged byte is in the file, unchanged
+//   - everything after it is whole event lines, apart from one torn last line
+//
+//   nback-log-crashcheck [--rounds N] [--max-delay MS] [--trials N]
+//                        [--fsync-interval MS] [--dir DIR] [--seed N] [--no-barrier]
+//
+// --no-barrier leaves out the sync at task-completed to show what the check
+// catches without it. SIGKILL loses the process, not the page cache, so this
+// checks what the writer hands to the kernel; durability across power loss
+// rests on the fdatasync calls it makes at the same points.
+
+using namespace host;
+
+static const char *EVENT_HEADER =
+    "Format=study_id,session_number,timestamp,task_type,event_type,stimulus_number,stimulus_color,"
+    "is_target,response_made,is_correct,stimulus_onset_time,response_time,reaction_time,"
+    "stimulus_end_time\n";
+
+static uint64_t fnv1a(uint64_t hash, const char *data, size_t length)
+{
+    for (size_t i = 0; i < length; i++)
+    {
+        hash = (hash ^ (uint8_t)data[i]) * 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+static const uint64_t FNV_OFFSET = 0xCBF29CE484222325ULL;
+
+// Child side: device output -> event lines -> log, acknowledging barriers
+class EventLogger : public ProtocolHandler
+{
+public:
+    EventLogger(WriteBehindLog &log, int ackFd, bool barrier)
+        : log(log), ackFd(ackFd), barrier(barrier), bytes(0), hash(FNV_OFFSET), completed(0)
+    {
+        add(EVENT_HEADER);
+    }
+
+    void onEvent(const TrialRecord &event) override
+    {
+        std::string line(event.line);
+        line += '\n';
+        add(line);
+    }
+
+    void onTextLine(std::string_view line) override
+    {
+        if (line != "task-completed")
+        {
+            return;
+        }
+        if (barrier)
+        {
+            log.sync();
+        }
+        completed++;
+        char ack[96];
+        int length = snprintf(ack, sizeof(ack), "ack %d %llu %016llx\n", completed, (unsigned long long)bytes,
+                              (unsigned long long)hash);
+        if (write(ackFd, ack, (size_t)length) != length)
+        {
+            _exit(3);
+        }
+    }
+
+    int sessionsCompleted() const { return completed; }
+
+private:
+    void add(std::string_view data)
+    {
+        log.append(data);
+        bytes += data.size();
+        hash = fnv1a(hash, data.data(), data.size());
+    }
+
+    WriteBehindLog &log;
+    int ackFd;
+    bool barrier;
+    uint64_t bytes;
+    uint64_t hash;
+    int completed;
+};
+
+static void runChild(const std::string &path, int ackFd, bool barrier, uint64_t seed, int trials,
+                     uint64_t fsyncIntervalUs)
+{
+    Runtime &rt = Runtime::get();
+    rt.seedRandom((uint32_t)seed);
+    VirtualDevice device;
+    ParticipantProfile profile = {0.85, 0.10, 450.0, 60.0, 150.0, 150.0, 120.0, false};
+    VirtualParticipant participant(device, profile, seed);
+    std::mt19937_64 sequenceRng(seed);
+
+    device.boot();
+    nBackTask.setInputMode(BUTTON_INPUT);
+    device.runFor(5000000);
+    device.takeLines();
+
+    WriteBehindLog log;
+    if (!log.open(path, WriteBehindLog::DEFAULT_BLOCK_SIZE, fsyncIntervalUs))
+    {
+        _exit(2);
+    }
+    EventLogger logger(log, ackFd, barrier);
+    ProtocolParser parser(logger);
+
+    // Sessions until killed
+    for (int session = 1;; session++)
+    {
+        char config[64];
+        snprintf(config, sizeof(config), "config 600,300,2,%d,CRASH,%d,", trials, session);
+        device.sendLine(config + sequenceArgument(buildSequence(sequenceRng, trials, 2, 0.3)));
+        participant.beginSession(2);
+        device.sendLine("start");
+
+        int done = logger.sessionsCompleted();
+        while (logger.sessionsCompleted() == done)
+        {
+            Micros until = rt.now() + 20000;
+            while (rt.now() < until)
+            {
+                device.step();
+                rt.uart().deliver(rt.now());
+            }
+            for (const OutputLine &line : device.takeLines())
+            {
+                parser.feed(line.text + "\n");
+            }
+            log.pump(monotonicMicros());
+        }
+        participant.endSession();
+    }
+}
+
+// Parent side: what the file must contain after the kill
+struct RoundResult
+{
+    bool ok;
+    int acknowledged; // Sessions acknowledged before the kill
+    bool tornTail;
+    std::string problem;
+};
+
+class LineChecker : public ProtocolHandler
+{
+public:
+    uint64_t errors = 0;
+    void onError(ProtocolError, std::string_view) override { errors++; }
+};
+
+static RoundResult checkRound(const std::string &path, const std::string &acks)
+{
+    RoundResult result = {true, 0, false, ""};
+    unsigned long long ackedBytes = 0, ackedHash = FNV_OFFSET;
+    std::istringstream in(acks);
+    std::string line;
+    while (std::getline(in, line))
+    {
+        int session;
+        unsigned long long bytes, hash;
+        if (sscanf(line.c_str(), "ack %d %llu %llx", &session, &bytes, &hash) == 3)
+        {
+            result.acknowledged = session;
+            ackedBytes = bytes;
+            ackedHash = hash;
+        }
+    }
+
+    std::ifstream file(path, std::ios::binary);
+    std::ostringstream content;
+    content << file.rdbuf();
+    std::string data = content.str();
+
+    if (data.size() < ackedBytes)
+    {
+        result.ok = false;
+        result.problem = "file has " + std::to_string(data.size()) + " bytes, " + std::to_string(ackedBytes) +
+                         " were acknowledged";
+        return result;
+    }
+    if (ackedBytes > 0 && fnv1a(FNV_OFFSET, data.data(), ackedBytes) != ackedHash)
+    {
+        result.ok = false;
+        result.problem = "acknowledged bytes differ from what was logged";
+        return result;
+    }
+
+    // After the last barrier: whole lines, then at most one torn line
+    size_t end = data.rfind('\n');
+    size_t whole = end == std::string::npos ? 0 : end + 1;
+    result.tornTail = whole < data.size();
+    LineChecker checker;
+    ProtocolParser parser(checker);
+    parser.expectTable();
+    parser.feed(data.data(), whole);
+    if (checker.errors > 0)
+    {
+        result.ok = false;
+        result.problem = std::to_string(checker.errors) + " malformed lines";
+    }
+    return result;
+}
+
+int main(int argc, char **argv)
+{
+    int rounds = 20;
+    int maxDelayMs = 400;
+    int trials = 10;
+    uint64_t fsyncIntervalMs = 1000;
+    std::string dir = "/tmp";
+    uint64_t seed = 1;
+    bool barrier = true;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--rounds" && hasValue)
+            rounds = atoi(argv[++i]);
+        else if (arg == "--max-delay" && hasValue)
+            maxDelayMs = atoi(argv[++i]);
+        else if (arg == "--trials" && hasValue)
+            trials = atoi(argv[++i]);
+        else if (arg == "--fsync-interval" && hasValue)
+            fsyncIntervalMs = strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--dir" && hasValue)
+            dir = argv[++i];
+        else if (arg == "--seed" && hasValue)
+            seed = strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--no-barrier")
+            barrier = false;
+        else
+        {
+            fprintf(stderr, "usage: nback-log-crashcheck [--rounds N] [--max-delay MS] [--trials N]\n"
+                            "       [--fsync-interval MS] [--dir DIR] [--seed N] [--no-barrier]\n");
+            return 2;
+        }
+    }
+
+    std::mt19937_64 rng(seed);
+    int failures = 0, acknowledged = 0, torn = 0;
+
+    for (int round = 1; round <= rounds; round++)
+    {
+        std::string path = dir + "/nback-crashcheck-" + std::to_string(getpid()) + ".csv";
+        unlink(path.c_str());
+
+        int ack[2];
+        if (pipe(ack) != 0)
+        {
+            perror("nback-log-crashcheck: pipe");
+            return 1;
+        }
+        pid_t child = fork();
+        if (child == 0)
+        {
+            close(ack[0]);
+            runChild(path, ack[1], barrier, seed + round, trials, fsyncIntervalMs * 1000);
+            _exit(0);
+        }
+        close(ack[1]);
+
+        usleep((useconds_t)(rng() % ((uint64_t)maxDelayMs * 1000 + 1)));
+        kill(child, SIGKILL);
+        waitpid(child, nullptr, 0);
+
+        std::string acks;
+        char buffer[512];
+        ssize_t n;
+        while ((n = read(ack[0], buffer, sizeof(buffer))) > 0)
+        {
+            acks.append(buffer, (size_t)n);
+        }
+        close(ack[0]);
+
+        RoundResult result = checkRound(path, acks);
+        acknowledged += result.acknowledged;
+        torn += result.tornTail;
+        if (!result.ok)
+        {
+            failures++;
+            printf("round %d: FAILED after %d sessions: %s\n", round, result.acknowledged, result.problem.c_str());
+        }
+        unlink(path.c_str());
+    }
+
+    printf("%d rounds, %d sessions acknowledged, %d torn tails, %d failures\n", rounds, acknowledged, torn, failures);
+    return failures == 0 ? 0 : 1;
+}
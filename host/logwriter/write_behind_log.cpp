@@ -0,0 +1,143 @@
+#include "write_behind_log.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+
+namespace host
+{
+    uint64_t monotonicMicros()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+    }
+
+    WriteBehindLog::WriteBehindLog()
+        : fd(-1), blockSize(DEFAULT_BLOCK_SIZE), syncIntervalUs(DEFAULT_SYNC_INTERVAL_US), start(0), fileOffset(0),
+          lastSync(0), dirty(false), stats()
+    {
+    }
+
+    WriteBehindLog::~WriteBehindLog()
+    {
+        close();
+    }
+
+    bool WriteBehindLog::open(const std::string &path, size_t blockSize, uint64_t syncIntervalUs)
+    {
+        close();
+        fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) != 0)
+        {
+            close();
+            return false;
+        }
+        this->blockSize = std::max<size_t>(blockSize, 1);
+        this->syncIntervalUs = syncIntervalUs;
+        fileOffset = (uint64_t)st.st_size;
+        lastSync = monotonicMicros();
+        return true;
+    }
+
+    void WriteBehindLog::close()
+    {
+        if (fd >= 0)
+        {
+            sync();
+            ::close(fd);
+            fd = -1;
+        }
+        buffer.clear();
+        start = 0;
+        dirty = false;
+    }
+
+    void WriteBehindLog::append(std::string_view data)
+    {
+        // Reclaim the written front before the buffer grows again
+        if (start > 0 && start >= buffer.size() / 2)
+        {
+            buffer.erase(0, start);
+            start = 0;
+        }
+        buffer.append(data);
+        stats.bytesAppended += data.size();
+    }
+
+    size_t WriteBehindLog::pump(uint64_t nowMicros, size_t budget)
+    {
+        if (fd < 0)
+        {
+            return 0;
+        }
+        size_t before = pending();
+
+        if (nowMicros - lastSync >= syncIntervalUs && (dirty || before > 0))
+        {
+            sync();
+            return before - pending();
+        }
+
+        // Up to the next block boundary first, then whole blocks
+        size_t head = blockSize - (size_t)(fileOffset % blockSize);
+        if (before >= head)
+        {
+            size_t limit = std::min(before, std::max(budget, head));
+            writeOut(head + (limit - head) / blockSize * blockSize);
+        }
+        return before - pending();
+    }
+
+    bool WriteBehindLog::sync()
+    {
+        if (fd < 0)
+        {
+            return false;
+        }
+        bool ok = writeOut(pending());
+        if (dirty)
+        {
+            uint64_t began = monotonicMicros();
+            ok = fdatasync(fd) == 0 && ok;
+            uint64_t took = monotonicMicros() - began;
+            stats.syncs++;
+            stats.maxSyncMicros = std::max(stats.maxSyncMicros, took);
+            dirty = false;
+        }
+        lastSync = monotonicMicros();
+        return ok;
+    }
+
+    bool WriteBehindLog::writeOut(size_t length)
+    {
+        while (length > 0)
+        {
+            ssize_t n = ::write(fd, buffer.data() + start, length);
+            if (n < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (n <= 0)
+            {
+                return false;
+            }
+            start += (size_t)n;
+            length -= (size_t)n;
+            fileOffset += (uint64_t)n;
+            stats.bytesWritten += (uint64_t)n;
+            stats.writes++;
+            dirty = true;
+        }
+        if (start == buffer.size())
+        {
+            buffer.clear();
+            start = 0;
+        }
+        return true;
+    }
+}
@@ -0,0 +1,90 @@
+#ifndef WRITE_BEHIND_LOG_H
+#define WRITE_BEHIND_LOG_H
+
+#include <stdint.h>
+#include <string>
+#include <string_view>
+
+//==============================================================================
+// Write-Behind Log
+//==============================================================================
+//
+// Append-only file that collects lines in memory and writes them in whole
+// blocks aligned to the file offset, instead of one write() per line. Data
+// becomes durable in two ways:
+//
+//   - pump() writes every complete block; once the sync interval has passed
+//     since the last fdatasync it also writes the partial last block and
+//     syncs, so no line waits longer than one interval
+//   - sync() writes and syncs everything at once; callers use it as a
+//     barrier at session boundaries (task-completed)
+//
+// A crash may leave a torn last line behind the last barrier, never a gap.
+
+namespace host
+{
+    struct WriteBehindStats
+    {
+        uint64_t bytesAppended;
+        uint64_t bytesWritten;
+        uint64_t writes; // write() calls
+        uint64_t syncs;  // fdatasync() calls
+        uint64_t maxSyncMicros;
+    };
+
+    class WriteBehindLog
+    {
+    public:
+        static const size_t DEFAULT_BLOCK_SIZE = 4096;
+        static const uint64_t DEFAULT_SYNC_INTERVAL_US = 1000000;
+
+        WriteBehindLog();
+        ~WriteBehindLog(); // Syncs and closes
+
+        WriteBehindLog(const WriteBehindLog &) = delete;
+        WriteBehindLog &operator=(const WriteBehindLog &) = delete;
+
+        // Open for appending; false if the file cannot be opened
+        bool open(const std::string &path, size_t blockSize = DEFAULT_BLOCK_SIZE,
+                  uint64_t syncIntervalUs = DEFAULT_SYNC_INTERVAL_US);
+        void close();
+        bool isOpen() const { return fd >= 0; }
+
+        // Queue data; nothing is written until pump() or sync()
+        void append(std::string_view data);
+
+        // Write whole blocks, at most `budget` bytes (one block at least), and
+        // everything plus fdatasync once the interval has passed; returns
+        // the bytes written
+        size_t pump(uint64_t nowMicros, size_t budget = SIZE_MAX);
+
+        // Write everything queued and fdatasync; false on I/O error
+        bool sync();
+
+        // Bytes queued but not written yet
+        size_t pending() const { return buffer.size() - start; }
+
+        // File size once everything queued is written
+        uint64_t size() const { return fileOffset + pending(); }
+
+        const WriteBehindStats &getStats() const { return stats; }
+
+    private:
+        bool writeOut(size_t length);
+
+        int fd;
+        size_t blockSize;
+        uint64_t syncIntervalUs;
+        std::string buffer;
+        size_t start;        // First unwritten byte of `buffer`
+        uint64_t fileOffset; // Bytes in the file
+        uint64_t lastSync;   // pump() time of the last sync
+        bool dirty;          // Written since the last sync
+        WriteBehindStats stats;
+    };
+
+    // Microseconds on CLOCK_MONOTONIC
+    uint64_t monotonicMicros();
+}
+
+#endif // WRITE_BEHIND_LOG_H
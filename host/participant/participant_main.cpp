@@ -0,0 +1,173 @@
+#include <Arduino.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <map>
+#include <string>
+
+#include "distribution.h"
+#include "sequence_builder.h"
+#include "virtual_device.h"
+#include "virtual_participant.h"
+
+//==============================================================================
+// RT Accuracy Harness
+//==============================================================================
+//
+// Runs thousands of trials against a simulated participant whose true
+// reaction times are known, then compares what the firmware recorded in its
+// DataCollector with the ground truth.
+//
+//   nback-participant [--trials N] [--nback N] [--input button|touch]
+//                     [--hit-rate P] [--fa-rate P] [--mu MS] [--sigma MS]
+//                     [--tau MS] [--stim MS] [--isi MS] [--seed N] [--json]
+
+using namespace host;
+
+int main(int argc, char **argv)
+{
+    int totalTrials = 2000;
+    int nBack = 2;
+    int stimMs = 1000;
+    int isiMs = 500;
+    bool json = false;
+    uint64_t seed = 1;
+    ParticipantProfile profile = {0.85, 0.10, 450.0, 60.0, 150.0, 150.0, 120.0, true};
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--trials" && hasValue)
+            totalTrials = atoi(argv[++i]);
+        else if (arg == "--nback" && hasValue)
+            nBack = atoi(argv[++i]);
+        else if (arg == "--input" && hasValue)
+            profile.useTouch = strcmp(argv[++i], "button") != 0;
+        else if (arg == "--hit-rate" && hasValue)
+            profile.hitRate = atof(argv[++i]);
+        else if (arg == "--fa-rate" && hasValue)
+            profile.falseAlarmRate = atof(argv[++i]);
+        else if (arg == "--mu" && hasValue)
+            profile.muMs = atof(argv[++i]);
+        else if (arg == "--sigma" && hasValue)
+            profile.sigmaMs = atof(argv[++i]);
+        else if (arg == "--tau" && hasValue)
+            profile.tauMs = atof(argv[++i]);
+        else if (arg == "--stim" && hasValue)
+            stimMs = atoi(argv[++i]);
+        else if (arg == "--isi" && hasValue)
+            isiMs = atoi(argv[++i]);
+        else if (arg == "--seed" && hasValue)
+            seed = strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--json")
+            json = true;
+        else
+        {
+            fprintf(stderr, "usage: nback-participant [--trials N] [--nback N] [--input button|touch]\n"
+                            "       [--hit-rate P] [--fa-rate P] [--mu MS] [--sigma MS] [--tau MS]\n"
+                            "       [--stim MS] [--isi MS] [--seed N] [--json]\n");
+            return 2;
+        }
+    }
+
+    Runtime &rt = Runtime::get();
+    rt.seedRandom((uint32_t)seed);
+
+    VirtualDevice device;
+    VirtualParticipant participant(device, profile, seed);
+    std::mt19937_64 sequenceRng(seed ^ 0x9E3779B97F4A7C15ULL);
+
+    device.boot();
+    nBackTask.setInputMode(profile.useTouch ? CAPACITIVE_INPUT : BUTTON_INPUT);
+    device.runFor(5000000);
+    device.takeLines();
+
+    Distribution rtError;       // recorded RT - true RT
+    Distribution onsetError;    // recorded onset - strip latch
+    Distribution responseError; // recorded response time - input edge
+    std::map<long, int> rtErrorHistogram;
+    int compared = 0;
+    int outcomeMismatches = 0;
+    int targetMismatches = 0;
+    int sessions = 0;
+
+    for (int done = 0; done < totalTrials; sessions++)
+    {
+        int trials = std::min(MAX_TRIALS, totalTrials - done);
+        trials = std::max(trials, 5); // Smallest session the firmware accepts
+
+        char config[64];
+        snprintf(config, sizeof(config), "config %d,%d,%d,%d,SIM,%d,", stimMs, isiMs, nBack, trials, sessions + 1);
+        device.sendLine(config + sequenceArgument(buildSequence(sequenceRng, trials, nBack, 0.3)));
+        if (!device.runUntilLine("Custom color sequence applied successfully", 10000000))
+        {
+            fprintf(stderr, "nback-participant: session %d was not configured\n", sessions + 1);
+            return 1;
+        }
+
+        participant.beginSession(nBack);
+        device.sendLine("start");
+        if (!device.runUntilLine("task-completed", (Micros)trials * 60000000ULL))
+        {
+            fprintf(stderr, "nback-participant: session %d did not complete\n", sessions + 1);
+            return 1;
+        }
+        participant.endSession();
+        device.takeLines();
+
+        // Compare every recorded trial with what the participant actually did
+        const DataCollector &data = nBackTask.getDataCollector();
+        const std::vector<GroundTruth> &truth = participant.getTrials();
+        double sessionStartUs = (double)data.getSessionAbsoluteStartTime() * 1000.0;
+        for (uint8_t i = 0; i < data.getTrialCount() && i < truth.size(); i++)
+        {
+            const NBackTrialData *trial = data.getTrial(i);
+            const GroundTruth &gt = truth[i];
+
+            double trueRtMs = (gt.pressAt - gt.onsetAt) / 1000.0;
+            double error = trial->reaction_time - trueRtMs;
+            rtError.add(error);
+            rtErrorHistogram[(long)std::floor(error)]++;
+            onsetError.add((sessionStartUs + trial->stimulus_onset_time * 1000.0 - gt.onsetAt) / 1000.0);
+            responseError.add((sessionStartUs + trial->response_time * 1000.0 - gt.pressAt) / 1000.0);
+
+            bool expectedCorrect = gt.isTarget == gt.respondedConfirm;
+            outcomeMismatches += trial->is_correct != expectedCorrect;
+            targetMismatches += trial->is_target != gt.isTarget;
+            compared++;
+        }
+        done += trials;
+    }
+
+    if (json)
+    {
+        printf("{\"sessions\":%d,\"trials\":%d,\"outcome_mismatches\":%d,\"target_mismatches\":%d,%s,%s,%s,\"rt_error_histogram_ms\":{",
+               sessions, compared, outcomeMismatches, targetMismatches,
+               rtError.toJson("rt_error_ms").c_str(),
+               onsetError.toJson("onset_error_ms").c_str(),
+               responseError.toJson("response_error_ms").c_str());
+        bool first = true;
+        for (const std::pair<const long, int> &bin : rtErrorHistogram)
+        {
+            printf("%s\"%ld\":%d", first ? "" : ",", bin.first, bin.second);
+            first = false;
+        }
+        printf("}}\n");
+        return 0;
+    }
+
+    printf("=== RT ACCURACY (%d sessions, %d trials, %s input) ===\n",
+           sessions, compared, profile.useTouch ? "touch" : "button");
+    rtError.printRow(stdout, "RT error (recorded-true)", "ms");
+    onsetError.printRow(stdout, "Onset timestamp error", "ms");
+    responseError.printRow(stdout, "Response timestamp error", "ms");
+    printf("Bias %.3f ms, jitter (SD) %.3f ms\n", rtError.mean(), rtError.stddev());
+    printf("Outcome mismatches: %d, target mismatches: %d\n", outcomeMismatches, targetMismatches);
+    printf("RT error histogram (1 ms bins):\n");
+    for (const std::pair<const long, int> &bin : rtErrorHistogram)
+    {
+        printf("  [%5ld, %5ld) %d\n", bin.first, bin.first + 1, bin.second);
+    }
+    return 0;
+}
@@ -0,0 +1,201 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "protocol_parser.h"
+
+//==============================================================================
+// Protocol Parser Throughput
+//==============================================================================
+//
+// Measures parsing speed in MB/s for several receive chunk sizes, next to a
+// getline-and-split baseline that copies every field into a std::string.
+//
+//   nback-protocol-bench [--mb N] [--file LOG] [--json]
+//
+// Without --file the input is a synthetic stream of sessions as the firmware
+// prints them: a start event, trial_complete events, then the data socket.
+
+using namespace host;
+
+// Counts records and touches every field so nothing is optimised away
+class CountingHandler : public ProtocolHandler
+{
+public:
+    uint64_t records = 0;
+    uint64_t checksum = 0;
+
+    void onEvent(const TrialRecord &r) override { count(r); }
+    void onTrialRow(const TrialRecord &r) override { count(r); }
+    void onSessionRow(const SessionRecord &r) override
+    {
+        records++;
+        checksum += r.totalTrials + r.startTimeMillis + r.studyId.size();
+    }
+
+private:
+    void count(const TrialRecord &r)
+    {
+        records++;
+        checksum += r.reactionTime + r.stimulusOnsetTime + r.stimulusNumber + r.isCorrect + r.studyId.size();
+    }
+};
+
+static std::string syntheticStream(size_t bytes)
+{
+    static const char *COLORS[] = {"red", "green", "blue", "yellow", "purple"};
+    std::mt19937 rng(7);
+    std::string out;
+    char line[256];
+
+    for (int session = 1; out.size() < bytes; session++)
+    {
+        const int trials = 30;
+        std::string rows;
+        snprintf(line, sizeof(line),
+                 "write>STUDY01,%d,1977,n-back,start,0,none,false,false,false,0,0,0,0,"
+                 "n-back_level:2,stim_duration:1500,inter_stim_interval:1000,trials:%d\r\n",
+                 session, trials);
+        out += line;
+
+        uint32_t t = 2000;
+        for (int i = 1; i <= trials; i++)
+        {
+            uint32_t rt = 250 + rng() % 900;
+            bool target = rng() % 3 == 0;
+            bool confirm = rng() % 2 == 0;
+            snprintf(line, sizeof(line), "STUDY01,%d,%u,n-back,trial_complete,%d,%s,%s,%s,%s,%u,%u,%u,%u\r\n",
+                     session, t + rt, i, COLORS[rng() % 5], target ? "true" : "false",
+                     confirm ? "true" : "false", target == confirm ? "true" : "false", t, t + rt, rt, t + rt);
+            out += std::string("write>") + line;
+            rows += line;
+            t += rt + 1000;
+        }
+
+        out += "Opening Data Socket\r\n"
+               "Format=study_id,session_number,timestamp,task_type,event_type,stimulus_number,stimulus_color,"
+               "is_target,response_made,is_correct,stimulus_onset_time,response_time,reaction_time,"
+               "stimulus_end_time\r\n$$$\r\n";
+        out += rows;
+        out += "$$$\r\nFormat=study_id,session_number,start_time_millis,start_time,completion_time,"
+               "total_duration,total_trials\r\n$$$\r\n";
+        snprintf(line, sizeof(line), "STUDY01,%d,4057,00:00:04:057,00:01:17:007,00:01:12:950,%d\r\n$$$\r\n"
+                                     "Closing Data Socket\r\n",
+                 session, trials);
+        out += line;
+    }
+    return out;
+}
+
+// What ad hoc host code does today: one std::string per line and per field
+static uint64_t splitBaseline(const std::string &input)
+{
+    std::istringstream in(input);
+    std::string line;
+    uint64_t checksum = 0;
+    while (std::getline(in, line))
+    {
+        std::vector<std::string> fields;
+        std::stringstream ss(line);
+        std::string field;
+        while (std::getline(ss, field, ','))
+        {
+            fields.push_back(field);
+        }
+        if (fields.size() >= 14)
+        {
+            checksum += atoi(fields[12].c_str()) + atoi(fields[10].c_str());
+        }
+    }
+    return checksum;
+}
+
+static double secondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char **argv)
+{
+    size_t megabytes = 64;
+    std::string file;
+    bool json = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--mb" && i + 1 < argc)
+            megabytes = strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--file" && i + 1 < argc)
+            file = argv[++i];
+        else if (arg == "--json")
+            json = true;
+        else
+        {
+            fprintf(stderr, "usage: nback-protocol-bench [--mb N] [--file LOG] [--json]\n");
+            return 2;
+        }
+    }
+
+    std::string input;
+    if (file.empty())
+    {
+        input = syntheticStream(megabytes << 20);
+    }
+    else
+    {
+        std::ifstream in(file, std::ios::binary);
+        std::ostringstream content;
+        content << in.rdbuf();
+        input = content.str();
+    }
+    double mb = input.size() / (1024.0 * 1024.0);
+
+    static const size_t CHUNKS[] = {64, 4096, 65536, 0}; // 0 = whole input at once
+    std::vector<std::pair<std::string, double>> results;
+    uint64_t records = 0;
+
+    for (size_t chunk : CHUNKS)
+    {
+        CountingHandler handler;
+        ProtocolParser parser(handler);
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        size_t step = chunk ? chunk : input.size();
+        for (size_t pos = 0; pos < input.size(); pos += step)
+        {
+            parser.feed(input.data() + pos, std::min(step, input.size() - pos));
+        }
+        parser.finish();
+        double seconds = secondsSince(start);
+        records = handler.records;
+        results.push_back({chunk ? "parser_chunk_" + std::to_string(chunk) : std::string("parser_whole"), mb / seconds});
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    volatile uint64_t sink = splitBaseline(input);
+    (void)sink;
+    results.push_back({"getline_split_baseline", mb / secondsSince(start)});
+
+    if (json)
+    {
+        printf("{\"input_mb\":%.2f,\"records\":%llu", mb, (unsigned long long)records);
+        for (const std::pair<std::string, double> &result : results)
+        {
+            printf(",\"%s_mb_s\":%.1f", result.first.c_str(), result.second);
+        }
+        printf("}\n");
+        return 0;
+    }
+
+    printf("=== PROTOCOL PARSER THROUGHPUT (%.1f MB, %llu records) ===\n", mb, (unsigned long long)records);
+    for (const std::pair<std::string, double> &result : results)
+    {
+        printf("%-28s %9.1f MB/s\n", result.first.c_str(), result.second);
+    }
+    return 0;
+}
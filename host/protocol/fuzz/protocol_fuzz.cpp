@@ -0,0 +1,213 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "protocol_parser.h"
+
+//==============================================================================
+// Protocol Parser Fuzz Target
+//==============================================================================
+//
+// Differential check: the input is parsed once as a single chunk and once cut
+// into chunks whose sizes come from the input itself. Both runs must produce
+// the same transcript of handler calls, and neither may crash.
+//
+// Built with -DNBACK_LIBFUZZER and -fsanitize=fuzzer this is a libFuzzer
+// target. Otherwise the driver below replays the corpus and then runs a
+// simple mutation loop:
+//
+//   nback-protocol-fuzz [--iterations N] [--seed N] FILE|DIR...
+
+using namespace host;
+
+// Writes every callback into a string so two runs can be compared
+class TranscriptHandler : public ProtocolHandler
+{
+public:
+    std::string out;
+
+    void onEvent(const TrialRecord &r) override { out += "E:" + describe(r) + "\n"; }
+    void onDataSocketOpen() override { out += "OPEN\n"; }
+    void onFormat(const std::vector<ProtocolField> &columns, std::string_view line) override
+    {
+        out += "F:";
+        for (ProtocolField field : columns)
+        {
+            out += std::to_string(field) + ",";
+        }
+        out += "|" + std::string(line) + "\n";
+    }
+    void onTrialRow(const TrialRecord &r) override { out += "T:" + describe(r) + "\n"; }
+    void onSessionRow(const SessionRecord &r) override
+    {
+        std::ostringstream s;
+        s << "S:" << r.studyId << "|" << r.sessionNumber << "|" << r.startTimeMillis << "|" << r.startTime
+          << "|" << r.completionTime << "|" << r.totalDuration << "|" << (int)r.totalTrials << "\n";
+        out += s.str();
+    }
+    void onDataSocketClose() override { out += "CLOSE\n"; }
+    void onTextLine(std::string_view line) override { out += "L:" + std::string(line) + "\n"; }
+    void onError(ProtocolError code, std::string_view line) override
+    {
+        out += "X" + std::to_string(code) + ":" + std::string(line) + "\n";
+    }
+
+private:
+    static std::string describe(const TrialRecord &r)
+    {
+        std::ostringstream s;
+        s << r.studyId << "|" << r.sessionNumber << "|" << r.timestamp << "|" << r.taskType << "|"
+          << r.eventType << "|" << r.stimulusNumber << "|" << r.stimulusColor << "|"
+          << (int)r.colorIndex << "|" << r.isTarget << r.responseMade << r.isCorrect << "|"
+          << r.stimulusOnsetTime << "|" << r.responseTime << "|" << r.reactionTime << "|"
+          << r.stimulusEndTime << "|" << r.extra;
+        return s.str();
+    }
+};
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    const char *text = (const char *)data;
+    const size_t maxLine = 256; // Small, so over-long lines are exercised
+
+    TranscriptHandler whole;
+    ProtocolParser wholeParser(whole, maxLine);
+    wholeParser.feed(text, size);
+    wholeParser.finish();
+
+    // Chunk sizes 1..16 taken from the input bytes, cycling
+    TranscriptHandler chunked;
+    ProtocolParser chunkedParser(chunked, maxLine);
+    size_t pos = 0;
+    for (size_t i = 0; pos < size; i++)
+    {
+        size_t chunk = std::min(size - pos, (size_t)(data[i % size] & 0x0F) + 1);
+        chunkedParser.feed(text + pos, chunk);
+        pos += chunk;
+    }
+    chunkedParser.finish();
+
+    if (whole.out != chunked.out)
+    {
+        fprintf(stderr, "protocol-fuzz: chunked parse differs from whole parse\n--- whole\n%s--- chunked\n%s",
+                whole.out.c_str(), chunked.out.c_str());
+        abort();
+    }
+    if (wholeParser.getStats().lines != chunkedParser.getStats().lines ||
+        wholeParser.getStats().errors != chunkedParser.getStats().errors)
+    {
+        fprintf(stderr, "protocol-fuzz: statistics differ between whole and chunked parse\n");
+        abort();
+    }
+    return 0;
+}
+
+#ifndef NBACK_LIBFUZZER
+
+static void mutate(std::string &input, const std::vector<std::string> &corpus, std::mt19937_64 &rng)
+{
+    static const char *TOKENS[] = {",", "\n", "\r\n", "$$$\n", "write>", "Format=", "Opening Data Socket\n",
+                                   "Closing Data Socket\n", "true", "false", "4294967296", "-1", "stimulus_number"};
+    std::uniform_int_distribution<int> op(0, 5);
+    size_t pos = input.empty() ? 0 : rng() % (input.size() + 1);
+
+    switch (op(rng))
+    {
+    case 0: // Flip a byte
+        if (!input.empty())
+            input[pos % input.size()] ^= (char)(1 << (rng() % 8));
+        break;
+    case 1: // Insert a random byte
+        input.insert(pos, 1, (char)(rng() & 0xFF));
+        break;
+    case 2: // Delete a run
+        input.erase(pos, rng() % 16);
+        break;
+    case 3: // Insert a protocol token
+        input.insert(pos, TOKENS[rng() % (sizeof(TOKENS) / sizeof(TOKENS[0]))]);
+        break;
+    case 4: // Splice in part of another seed
+    {
+        const std::string &other = corpus[rng() % corpus.size()];
+        size_t from = other.empty() ? 0 : rng() % other.size();
+        input.insert(pos, other.substr(from, rng() % 128));
+        break;
+    }
+    default: // Duplicate a run
+        input.insert(pos, input.substr(pos, rng() % 64));
+        break;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    long iterations = 20000;
+    uint64_t seed = 1;
+    std::vector<std::string> paths;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--iterations" && i + 1 < argc)
+            iterations = atol(argv[++i]);
+        else if (arg == "--seed" && i + 1 < argc)
+            seed = strtoull(argv[++i], nullptr, 10);
+        else
+            paths.push_back(arg);
+    }
+
+    std::vector<std::string> corpus;
+    for (const std::string &path : paths)
+    {
+        std::vector<std::filesystem::path> files;
+        if (std::filesystem::is_directory(path))
+        {
+            for (const auto &entry : std::filesystem::directory_iterator(path))
+                files.push_back(entry.path());
+        }
+        else
+        {
+            files.push_back(path);
+        }
+        for (const std::filesystem::path &file : files)
+        {
+            std::ifstream in(file, std::ios::binary);
+            std::ostringstream content;
+            content << in.rdbuf();
+            corpus.push_back(content.str());
+        }
+    }
+    if (corpus.empty())
+    {
+        fprintf(stderr, "usage: nback-protocol-fuzz [--iterations N] [--seed N] FILE|DIR...\n");
+        return 2;
+    }
+
+    for (const std::string &input : corpus)
+    {
+        LLVMFuzzerTestOneInput((const uint8_t *)input.data(), input.size());
+    }
+
+    std::mt19937_64 rng(seed);
+    for (long i = 0; i < iterations; i++)
+    {
+        std::string input = corpus[rng() % corpus.size()];
+        for (int m = 1 + rng() % 8; m > 0; m--)
+        {
+            mutate(input, corpus, rng);
+        }
+        LLVMFuzzerTestOneInput((const uint8_t *)input.data(), input.size());
+    }
+
+    printf("protocol-fuzz: %zu seeds and %ld mutations passed\n", corpus.size(), iterations);
+    return 0;
+}
+
+#endif // NBACK_LIBFUZZER
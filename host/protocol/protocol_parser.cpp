@@ -0,0 +1,368 @@
+#include "protocol_parser.h"
+
+#include <string.h>
+#include <charconv>
+
+namespace host
+{
+    static const char *FIELD_NAMES[PROTOCOL_FIELD_COUNT] = {
+        "study_id", "session_number", "timestamp", "task_type", "event_type",
+        "stimulus_number", "stimulus_color", "is_target", "response_made", "is_correct",
+        "stimulus_onset_time", "response_time", "reaction_time", "stimulus_end_time",
+        "start_time_millis", "start_time", "completion_time", "total_duration", "total_trials"};
+
+    // Column layout of every write> event (DataCollector::sendRealTimeEvent)
+    static const std::vector<ProtocolField> EVENT_COLUMNS = {
+        FIELD_STUDY_ID, FIELD_SESSION_NUMBER, FIELD_TIMESTAMP, FIELD_TASK_TYPE, FIELD_EVENT_TYPE,
+        FIELD_STIMULUS_NUMBER, FIELD_STIMULUS_COLOR, FIELD_IS_TARGET, FIELD_RESPONSE_MADE,
+        FIELD_IS_CORRECT, FIELD_STIMULUS_ONSET_TIME, FIELD_RESPONSE_TIME, FIELD_REACTION_TIME,
+        FIELD_STIMULUS_END_TIME};
+
+    static const char *COLOR_NAMES[] = {"red", "green", "blue", "yellow", "purple"};
+
+    const char *protocolFieldName(ProtocolField field)
+    {
+        return field >= 0 && field < PROTOCOL_FIELD_COUNT ? FIELD_NAMES[field] : "unknown";
+    }
+
+    ProtocolField protocolFieldFromName(std::string_view name)
+    {
+        for (int i = 0; i < PROTOCOL_FIELD_COUNT; i++)
+        {
+            if (name == FIELD_NAMES[i])
+            {
+                return (ProtocolField)i;
+            }
+        }
+        return FIELD_UNKNOWN;
+    }
+
+    static bool startsWith(std::string_view text, std::string_view prefix)
+    {
+        return text.size() >= prefix.size() && text.compare(0, prefix.size(), prefix) == 0;
+    }
+
+    // Decimal without sign or spaces, at most `limit`
+    static bool parseNumber(std::string_view text, uint32_t limit, uint32_t &value)
+    {
+        const char *end = text.data() + text.size();
+        std::from_chars_result result = std::from_chars(text.data(), end, value);
+        return !text.empty() && result.ec == std::errc() && result.ptr == end && value <= limit;
+    }
+
+    //==============================================================================
+    // Chunk Handling
+    //==============================================================================
+
+    ProtocolParser::ProtocolParser(ProtocolHandler &handler, size_t maxLineLength)
+        : handler(handler), maxLineLength(maxLineLength)
+    {
+        reset();
+    }
+
+    void ProtocolParser::reset()
+    {
+        carry.clear();
+        discarding = false;
+        for (Socket *target : {&socket, &streamed})
+        {
+            target->section = SECTION_NONE;
+            target->format.clear();
+            target->formatHasTrials = false;
+            target->formatHasSession = false;
+        }
+        stats = ProtocolStats();
+    }
+
+    void ProtocolParser::feed(const char *data, size_t length)
+    {
+        stats.bytes += length;
+        size_t pos = 0;
+        while (pos < length)
+        {
+            const char *newline = (const char *)memchr(data + pos, '\n', length - pos);
+            size_t end = newline ? (size_t)(newline - data) : length;
+            std::string_view piece(data + pos, end - pos);
+
+            if (discarding)
+            {
+                discarding = newline == nullptr;
+            }
+            else if (carry.size() + piece.size() > maxLineLength)
+            {
+                // Report the start of the line, however it was chunked
+                carry.append(piece.substr(0, 64));
+                error(ERROR_LINE_TOO_LONG, std::string_view(carry).substr(0, 64));
+                carry.clear();
+                discarding = newline == nullptr;
+            }
+            else if (newline == nullptr)
+            {
+                carry.append(piece);
+            }
+            else if (!carry.empty())
+            {
+                // The only copy: a line that started in an earlier chunk
+                carry.append(piece);
+                stats.joinedLines++;
+                parseLine(carry);
+                carry.clear();
+            }
+            else
+            {
+                parseLine(piece);
+            }
+            pos = end + 1;
+        }
+    }
+
+    void ProtocolParser::finish()
+    {
+        if (!carry.empty() && !discarding)
+        {
+            parseLine(carry);
+        }
+        carry.clear();
+        discarding = false;
+    }
+
+    //==============================================================================
+    // Line Parsing
+    //==============================================================================
+
+    void ProtocolParser::parseLine(std::string_view line)
+    {
+        if (!line.empty() && line.back() == '\r')
+        {
+            line.remove_suffix(1);
+        }
+        stats.lines++;
+
+        if (startsWith(line, "write>"))
+        {
+            TrialRecord event;
+            SessionRecord unused;
+            if (parseColumns(line.substr(6), EVENT_COLUMNS, event, unused))
+            {
+                stats.events++;
+                handler.onEvent(event);
+            }
+            return;
+        }
+
+        // Streamed socket lines carry the data> prefix
+        bool parsed = startsWith(line, "data>") ? parseSocketLine(line.substr(5), streamed)
+                                                : parseSocketLine(line, socket);
+        if (!parsed)
+        {
+            handler.onTextLine(line);
+        }
+    }
+
+    bool ProtocolParser::parseSocketLine(std::string_view line, Socket &target)
+    {
+        if (line == "Opening Data Socket")
+        {
+            target.section = SECTION_HEADER;
+            target.format.clear();
+            target.formatHasTrials = target.formatHasSession = false;
+            handler.onDataSocketOpen();
+            return true;
+        }
+        if (line == "Closing Data Socket")
+        {
+            target.section = SECTION_NONE;
+            handler.onDataSocketClose();
+            return true;
+        }
+
+        if (target.section != SECTION_NONE && startsWith(line, "Format="))
+        {
+            parseFormat(line, target);
+            return true;
+        }
+        if (target.section != SECTION_NONE && line == "$$$")
+        {
+            target.section = target.section == SECTION_ROWS ? SECTION_HEADER : SECTION_ROWS;
+            return true;
+        }
+        if (target.section == SECTION_ROWS)
+        {
+            parseRow(line, target);
+            return true;
+        }
+        return false;
+    }
+
+    void ProtocolParser::parseFormat(std::string_view line, Socket &target)
+    {
+        std::string_view columns = line.substr(7);
+        std::vector<ProtocolField> &format = target.format;
+        format.clear();
+        target.formatHasTrials = target.formatHasSession = false;
+
+        size_t start = 0;
+        for (;;)
+        {
+            size_t comma = columns.find(',', start);
+            ProtocolField field = protocolFieldFromName(columns.substr(start, comma - start));
+            format.push_back(field);
+            target.formatHasTrials |= field == FIELD_STIMULUS_NUMBER;
+            target.formatHasSession |= field == FIELD_TOTAL_TRIALS;
+            if (comma == std::string_view::npos)
+            {
+                break;
+            }
+            start = comma + 1;
+        }
+        handler.onFormat(format, line);
+    }
+
+    void ProtocolParser::parseRow(std::string_view line, const Socket &source)
+    {
+        if (!source.formatHasTrials && !source.formatHasSession)
+        {
+            error(ERROR_UNEXPECTED_ROW, line);
+            return;
+        }
+
+        TrialRecord trial;
+        SessionRecord session;
+        if (!parseColumns(line, source.format, trial, session))
+        {
+            return;
+        }
+        if (source.formatHasTrials)
+        {
+            stats.trialRows++;
+            handler.onTrialRow(trial);
+        }
+        else
+        {
+            stats.sessionRows++;
+            handler.onSessionRow(session);
+        }
+    }
+
+    bool ProtocolParser::parseColumns(std::string_view line, const std::vector<ProtocolField> &columns,
+                                      TrialRecord &trial, SessionRecord &session)
+    {
+        trial = TrialRecord();
+        trial.colorIndex = -1;
+        trial.line = line;
+        session = SessionRecord();
+
+        size_t start = 0;
+        for (size_t column = 0; column < columns.size(); column++)
+        {
+            if (start > line.size())
+            {
+                error(ERROR_MISSING_FIELDS, line);
+                return false;
+            }
+            size_t comma = line.find(',', start);
+            std::string_view value = line.substr(start, comma == std::string_view::npos ? std::string_view::npos : comma - start);
+            start = comma == std::string_view::npos ? line.size() + 1 : comma + 1;
+
+            uint32_t number = 0;
+            bool numberOk = true;
+            bool booleanOk = true;
+            switch (columns[column])
+            {
+            case FIELD_STUDY_ID:
+                trial.studyId = session.studyId = value;
+                break;
+            case FIELD_SESSION_NUMBER:
+                numberOk = parseNumber(value, UINT16_MAX, number);
+                trial.sessionNumber = session.sessionNumber = (uint16_t)number;
+                break;
+            case FIELD_TIMESTAMP:
+                numberOk = parseNumber(value, UINT32_MAX, trial.timestamp);
+                break;
+            case FIELD_TASK_TYPE:
+                trial.taskType = value;
+                break;
+            case FIELD_EVENT_TYPE:
+                trial.eventType = value;
+                break;
+            case FIELD_STIMULUS_NUMBER:
+                numberOk = parseNumber(value, UINT32_MAX, trial.stimulusNumber);
+                break;
+            case FIELD_STIMULUS_COLOR:
+                trial.stimulusColor = value;
+                for (int i = 0; i < 5; i++)
+                {
+                    if (value == COLOR_NAMES[i])
+                    {
+                        trial.colorIndex = (int8_t)i;
+                    }
+                }
+                break;
+            case FIELD_IS_TARGET:
+            case FIELD_RESPONSE_MADE:
+            case FIELD_IS_CORRECT:
+            {
+                booleanOk = value == "true" || value == "false";
+                bool flag = value == "true";
+                if (columns[column] == FIELD_IS_TARGET)
+                    trial.isTarget = flag;
+                else if (columns[column] == FIELD_RESPONSE_MADE)
+                    trial.responseMade = flag;
+                else
+                    trial.isCorrect = flag;
+                break;
+            }
+            case FIELD_STIMULUS_ONSET_TIME:
+                numberOk = parseNumber(value, UINT32_MAX, trial.stimulusOnsetTime);
+                break;
+            case FIELD_RESPONSE_TIME:
+                numberOk = parseNumber(value, UINT32_MAX, trial.responseTime);
+                break;
+            case FIELD_REACTION_TIME:
+                numberOk = parseNumber(value, UINT16_MAX, number);
+                trial.reactionTime = (uint16_t)number;
+                break;
+            case FIELD_STIMULUS_END_TIME:
+                numberOk = parseNumber(value, UINT32_MAX, trial.stimulusEndTime);
+                break;
+            case FIELD_START_TIME_MILLIS:
+                numberOk = parseNumber(value, UINT32_MAX, session.startTimeMillis);
+                break;
+            case FIELD_START_TIME:
+                session.startTime = value;
+                break;
+            case FIELD_COMPLETION_TIME:
+                session.completionTime = value;
+                break;
+            case FIELD_TOTAL_DURATION:
+                session.totalDuration = value;
+                break;
+            case FIELD_TOTAL_TRIALS:
+                numberOk = parseNumber(value, UINT8_MAX, number);
+                session.totalTrials = (uint8_t)number;
+                break;
+            default:
+                break; // Column this parser does not know
+            }
+
+            if (!numberOk || !booleanOk)
+            {
+                error(numberOk ? ERROR_BAD_BOOLEAN : ERROR_BAD_NUMBER, line);
+                return false;
+            }
+        }
+
+        // Anything after the known columns, e.g. the start event's configuration
+        if (start < line.size())
+        {
+            trial.extra = line.substr(start);
+        }
+        return true;
+    }
+
+    void ProtocolParser::error(ProtocolError code, std::string_view line)
+    {
+        stats.errors++;
+        handler.onError(code, line);
+    }
+}
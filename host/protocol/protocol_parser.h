@@ -0,0 +1,193 @@
+#ifndef PROTOCOL_PARSER_H
+#define PROTOCOL_PARSER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+//==============================================================================
+// Protocol Parser
+//==============================================================================
+//
+// Incremental parser for the unit's serial output on the host side: the
+// write> real-time events from DataCollector::sendRealTimeEvent() and
+// sendTimestampedEvent(), the data socket from sendDataOverSerial()
+// (Opening Data Socket / Format= / $$$ sections / Closing Data Socket), the
+// same socket streamed in the background with the data> prefix on every line
+// and every other line as plain text. A streamed socket has its own state, so
+// the lines of the running block can come between its lines.
+//
+// feed() accepts arbitrary chunks straight from the receive buffer. Complete
+// lines are parsed in place and every string_view handed to the handler
+// points into the chunk being fed; only a line split across two chunks is
+// copied once to join it. Views are valid until the handler returns.
+//
+// Rows are mapped to fields by the most recent Format= header, so reordered
+// or added columns need no parser change. write> events have no header of
+// their own and always use the firmware's real-time event layout.
+
+namespace host
+{
+    // Typed fields the parser knows; anything else in a header is skipped
+    enum ProtocolField
+    {
+        FIELD_UNKNOWN = -1,
+        FIELD_STUDY_ID,
+        FIELD_SESSION_NUMBER,
+        FIELD_TIMESTAMP,
+        FIELD_TASK_TYPE,
+        FIELD_EVENT_TYPE,
+        FIELD_STIMULUS_NUMBER,
+        FIELD_STIMULUS_COLOR,
+        FIELD_IS_TARGET,
+        FIELD_RESPONSE_MADE,
+        FIELD_IS_CORRECT,
+        FIELD_STIMULUS_ONSET_TIME,
+        FIELD_RESPONSE_TIME,
+        FIELD_REACTION_TIME,
+        FIELD_STIMULUS_END_TIME,
+        FIELD_START_TIME_MILLIS,
+        FIELD_START_TIME,
+        FIELD_COMPLETION_TIME,
+        FIELD_TOTAL_DURATION,
+        FIELD_TOTAL_TRIALS,
+        PROTOCOL_FIELD_COUNT
+    };
+
+    // Column name as printed in Format= headers
+    const char *protocolFieldName(ProtocolField field);
+    ProtocolField protocolFieldFromName(std::string_view name);
+
+    // One trial row of the data socket, or one write> event
+    struct TrialRecord
+    {
+        std::string_view studyId;
+        uint16_t sessionNumber;
+        uint32_t timestamp; // Event time (ms since session start)
+        std::string_view taskType;
+        std::string_view eventType; // trial_complete, start, pause, ...
+        uint32_t stimulusNumber; // Continuous sessions run past 255 trials
+        std::string_view stimulusColor;
+        int8_t colorIndex; // ColorIndex of stimulusColor, -1 if none/unknown
+        bool isTarget;
+        bool responseMade;
+        bool isCorrect;
+        uint32_t stimulusOnsetTime;
+        uint32_t responseTime;
+        uint16_t reactionTime;
+        uint32_t stimulusEndTime;
+        std::string_view extra; // Additional data after the fixed columns (start event config)
+        std::string_view line;  // The whole row, without write> and line terminator
+    };
+
+    // The session summary row of the data socket
+    struct SessionRecord
+    {
+        std::string_view studyId;
+        uint16_t sessionNumber;
+        uint32_t startTimeMillis;
+        std::string_view startTime; // Formatted HH:MM:SS:mmm
+        std::string_view completionTime;
+        std::string_view totalDuration;
+        uint8_t totalTrials;
+    };
+
+    enum ProtocolError
+    {
+        ERROR_LINE_TOO_LONG,  // Line exceeded the limit and was dropped
+        ERROR_MISSING_FIELDS, // Fewer columns than the format requires
+        ERROR_BAD_NUMBER,     // Numeric column is not an in-range decimal
+        ERROR_BAD_BOOLEAN,    // Boolean column is neither true nor false
+        ERROR_UNEXPECTED_ROW  // $$$ section row without a usable Format= header
+    };
+
+    // Receives everything the parser recognises; override what you need
+    class ProtocolHandler
+    {
+    public:
+        virtual ~ProtocolHandler() {}
+
+        virtual void onEvent(const TrialRecord &) {}
+        virtual void onDataSocketOpen() {}
+        // The columns of a Format= header, and its line as sent (column names
+        // the parser does not know are only in the line)
+        virtual void onFormat(const std::vector<ProtocolField> &, std::string_view) {}
+        virtual void onTrialRow(const TrialRecord &) {}
+        virtual void onSessionRow(const SessionRecord &) {}
+        virtual void onDataSocketClose() {}
+        virtual void onTextLine(std::string_view) {}
+        virtual void onError(ProtocolError, std::string_view) {}
+    };
+
+    struct ProtocolStats
+    {
+        uint64_t bytes;
+        uint64_t lines;
+        uint64_t events;
+        uint64_t trialRows;
+        uint64_t sessionRows;
+        uint64_t errors;
+        uint64_t joinedLines; // Lines that straddled two chunks
+    };
+
+    class ProtocolParser
+    {
+    public:
+        static const size_t DEFAULT_MAX_LINE = 4096;
+
+        explicit ProtocolParser(ProtocolHandler &handler, size_t maxLineLength = DEFAULT_MAX_LINE);
+
+        // Parse a chunk; incomplete trailing data waits for the next call
+        void feed(const char *data, size_t length);
+        void feed(std::string_view chunk) { feed(chunk.data(), chunk.size()); }
+
+        // Parse a final line that has no terminator (end of file)
+        void finish();
+
+        // Forget all state, e.g. after the port was reopened
+        void reset();
+
+        // Treat what follows as table rows under a Format= header, as in a
+        // saved CSV file, rather than as a serial stream
+        void expectTable() { socket.section = SECTION_ROWS; }
+
+        const ProtocolStats &getStats() const { return stats; }
+
+    private:
+        enum Section
+        {
+            SECTION_NONE,   // Outside the data socket
+            SECTION_HEADER, // Data socket open, waiting for Format= or $$$
+            SECTION_ROWS    // Between $$$ markers
+        };
+
+        // A data socket: the one from get_data or the streamed one
+        struct Socket
+        {
+            Section section;
+            std::vector<ProtocolField> format;
+            bool formatHasTrials;
+            bool formatHasSession;
+        };
+
+        void parseLine(std::string_view line);
+        bool parseSocketLine(std::string_view line, Socket &target);
+        void parseFormat(std::string_view line, Socket &target);
+        void parseRow(std::string_view line, const Socket &source);
+        bool parseColumns(std::string_view line, const std::vector<ProtocolField> &columns,
+                          TrialRecord &trial, SessionRecord &session);
+        void error(ProtocolError code, std::string_view line);
+
+        ProtocolHandler &handler;
+        size_t maxLineLength;
+        std::string carry; // Start of a line split across chunks
+        bool discarding;   // Dropping the rest of an over-long line
+        Socket socket;
+        Socket streamed;   // data> lines
+        ProtocolStats stats;
+    };
+}
+
+#endif // PROTOCOL_PARSER_H
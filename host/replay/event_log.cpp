@@ -0,0 +1,152 @@
+#include "event_log.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <fstream>
+
+namespace host
+{
+    // Columns of a write> event (see DataCollector::sendRealTimeEvent)
+    enum EventColumn
+    {
+        COL_STUDY_ID,
+        COL_SESSION_NUMBER,
+        COL_TIMESTAMP,
+        COL_TASK_TYPE,
+        COL_EVENT_TYPE,
+        COL_STIMULUS_NUMBER,
+        COL_STIMULUS_COLOR,
+        COL_IS_TARGET,
+        COL_RESPONSE_MADE,
+        COL_IS_CORRECT,
+        COL_STIMULUS_ONSET_TIME,
+        COL_RESPONSE_TIME,
+        COL_REACTION_TIME,
+        COL_STIMULUS_END_TIME,
+        EVENT_COLUMN_COUNT
+    };
+
+    static const char *COLOR_NAMES[] = {"red", "green", "blue", "yellow", "purple"};
+
+    int colorIndexFromName(const std::string &name)
+    {
+        for (int i = 0; i < 5; i++)
+        {
+            if (name == COLOR_NAMES[i])
+            {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    static std::vector<std::string> splitFields(const std::string &line)
+    {
+        std::vector<std::string> fields;
+        size_t start = 0;
+        for (;;)
+        {
+            size_t comma = line.find(',', start);
+            fields.push_back(line.substr(start, comma - start));
+            if (comma == std::string::npos)
+            {
+                return fields;
+            }
+            start = comma + 1;
+        }
+    }
+
+    // "key:value" entries after the standard columns of the start event
+    static int startParameter(const std::vector<std::string> &fields, const char *key)
+    {
+        size_t keyLength = strlen(key);
+        for (size_t i = EVENT_COLUMN_COUNT; i < fields.size(); i++)
+        {
+            if (fields[i].compare(0, keyLength, key) == 0 && fields[i].size() > keyLength &&
+                fields[i][keyLength] == ':')
+            {
+                return atoi(fields[i].c_str() + keyLength + 1);
+            }
+        }
+        return -1;
+    }
+
+    bool loadEventLog(const std::string &path, std::vector<RecordedSession> &sessions, std::string &error)
+    {
+        std::ifstream in(path);
+        if (!in)
+        {
+            error = "cannot open " + path;
+            return false;
+        }
+
+        RecordedSession *current = nullptr;
+        bool inDataDump = false;
+        std::string line;
+        int lineNumber = 0;
+        while (std::getline(in, line))
+        {
+            lineNumber++;
+            if (!line.empty() && line.back() == '\r')
+            {
+                line.pop_back();
+            }
+
+            // A get_data dump repeats the trials without the write> prefix
+            if (line == "Opening Data Socket" || line == "Closing Data Socket")
+            {
+                inDataDump = line[0] == 'O';
+                continue;
+            }
+            if (inDataDump || line.compare(0, 5, "data>") == 0)
+            {
+                continue; // Or streamed in the background
+            }
+
+            if (line.compare(0, 6, "write>") == 0)
+            {
+                line.erase(0, 6);
+            }
+
+            std::vector<std::string> fields = splitFields(line);
+            if (fields.size() < EVENT_COLUMN_COUNT || fields[COL_TASK_TYPE] != "n-back")
+            {
+                continue; // Header, protocol chatter or foreign data
+            }
+
+            const std::string &eventType = fields[COL_EVENT_TYPE];
+            if (eventType == "start")
+            {
+                RecordedSession session;
+                session.source = path;
+                session.line = lineNumber;
+                session.startTime = strtoul(fields[COL_TIMESTAMP].c_str(), nullptr, 10);
+                session.studyId = fields[COL_STUDY_ID];
+                session.sessionNumber = atoi(fields[COL_SESSION_NUMBER].c_str());
+                session.nBackLevel = startParameter(fields, "n-back_level");
+                session.stimulusDuration = startParameter(fields, "stim_duration");
+                session.interStimulusInterval = startParameter(fields, "inter_stim_interval");
+                session.trialCount = startParameter(fields, "trials");
+                sessions.push_back(session);
+                current = &sessions.back();
+            }
+            else if (eventType == "trial_complete" && current != nullptr &&
+                     fields[COL_STUDY_ID] == current->studyId &&
+                     atoi(fields[COL_SESSION_NUMBER].c_str()) == current->sessionNumber)
+            {
+                RecordedTrial trial;
+                trial.stimulusNumber = atoi(fields[COL_STIMULUS_NUMBER].c_str());
+                trial.color = colorIndexFromName(fields[COL_STIMULUS_COLOR]);
+                trial.isTarget = fields[COL_IS_TARGET] == "true";
+                trial.responseMade = fields[COL_RESPONSE_MADE] == "true";
+                trial.isCorrect = fields[COL_IS_CORRECT] == "true";
+                trial.onsetTime = strtoul(fields[COL_STIMULUS_ONSET_TIME].c_str(), nullptr, 10);
+                trial.responseTime = strtoul(fields[COL_RESPONSE_TIME].c_str(), nullptr, 10);
+                trial.reactionTime = strtoul(fields[COL_REACTION_TIME].c_str(), nullptr, 10);
+                trial.endTime = strtoul(fields[COL_STIMULUS_END_TIME].c_str(), nullptr, 10);
+                current->trials.push_back(trial);
+            }
+        }
+        return true;
+    }
+}
@@ -0,0 +1,54 @@
+#ifndef EVENT_LOG_H
+#define EVENT_LOG_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+//==============================================================================
+// Event Log
+//==============================================================================
+//
+// Sessions reconstructed from a recorded stream of write> events, as saved by
+// the receiving side (with or without the write> prefix). A session starts at
+// its "start" event, which carries the configuration, and collects every
+// trial_complete event of the same study and session number.
+
+namespace host
+{
+    // One trial_complete event
+    struct RecordedTrial
+    {
+        int stimulusNumber;
+        int color; // ColorIndex, -1 if the name was not recognised
+        bool isTarget;
+        bool responseMade;
+        bool isCorrect;
+        uint32_t onsetTime;
+        uint32_t responseTime;
+        uint32_t reactionTime;
+        uint32_t endTime;
+    };
+
+    struct RecordedSession
+    {
+        std::string source; // File the session was read from
+        int line;           // Line of its start event
+        uint32_t startTime; // Start event timestamp (ms after configuration)
+        std::string studyId;
+        int sessionNumber;
+        int nBackLevel;
+        int stimulusDuration;
+        int interStimulusInterval;
+        int trialCount; // Configured, not necessarily recorded
+        std::vector<RecordedTrial> trials;
+    };
+
+    // Append every session found in `path`; false (with `error`) if unreadable
+    bool loadEventLog(const std::string &path, std::vector<RecordedSession> &sessions, std::string &error);
+
+    // Index of a colour name as printed by the firmware, -1 if unknown
+    int colorIndexFromName(const std::string &name);
+}
+
+#endif // EVENT_LOG_H
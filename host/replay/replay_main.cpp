@@ -0,0 +1,338 @@
+#include <Arduino.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "event_log.h"
+#include "trace.h"
+#include "virtual_device.h"
+
+//==============================================================================
+// Session Replay
+//==============================================================================
+//
+// Re-drives the firmware from recorded write> logs and checks that it
+// produces the same trial records. For every recorded session the replay
+// sends the original configuration with the recorded colour sequence, then
+// presses the recorded input of each trial so that the firmware measures the
+// recorded reaction time, and compares the regenerated DataCollector rows and
+// session metrics with the originals.
+//
+//   nback-replay [--tolerance MS] [--quiet] FILE|DIR...
+//
+// Directories are searched recursively. Timestamps (onset, response, end)
+// may drift by up to --tolerance ms (default 5); all other fields must match
+// exactly. Exit status is 0 when everything matched, 1 otherwise.
+
+using namespace host;
+
+// Summary of one session, computed the same way for both sides
+struct SessionMetrics
+{
+    int hits;
+    int misses;
+    int falseAlarms;
+    int correctRejections;
+    double meanReactionTime;
+};
+
+// Presses the recorded input of the trial that just started
+struct ReplayState
+{
+    VirtualDevice *device;
+    const RecordedSession *session;
+    size_t nextTrial;
+};
+
+static ReplayState replay;
+
+static void onTrace(Micros at, int point)
+{
+    if (point != TRACE_TRIAL_ONSET || replay.session == nullptr ||
+        replay.nextTrial >= replay.session->trials.size())
+    {
+        return;
+    }
+
+    const RecordedTrial &trial = replay.session->trials[replay.nextTrial++];
+
+    // The firmware stamps both ends of the RT with millis(); land the press
+    // just after the recorded millisecond starts so it is sampled within it
+    Micros onsetMs = at / 1000;
+    Micros pressAt = (onsetMs + trial.reactionTime) * 1000 + 100;
+    pressAt = pressAt > at ? pressAt : at + 1;
+
+    Micros hold = (Micros)replay.session->interStimulusInterval * 500;
+    replay.device->pressButton(trial.responseMade ? RESPONSE_CONFIRM : RESPONSE_WRONG, pressAt, hold);
+}
+
+static SessionMetrics computeMetrics(const std::vector<RecordedTrial> &trials)
+{
+    SessionMetrics metrics = {0, 0, 0, 0, 0.0};
+    double sum = 0;
+    for (const RecordedTrial &trial : trials)
+    {
+        if (trial.isTarget)
+        {
+            trial.responseMade ? metrics.hits++ : metrics.misses++;
+        }
+        else
+        {
+            trial.responseMade ? metrics.falseAlarms++ : metrics.correctRejections++;
+        }
+        sum += trial.reactionTime;
+    }
+    metrics.meanReactionTime = trials.empty() ? 0.0 : sum / trials.size();
+    return metrics;
+}
+
+static RecordedTrial fromCollector(const NBackTrialData &data)
+{
+    RecordedTrial trial;
+    trial.stimulusNumber = data.stimulus_number;
+    trial.color = data.stimulus_color;
+    trial.isTarget = data.is_target;
+    trial.responseMade = data.response_made;
+    trial.isCorrect = data.is_correct;
+    trial.onsetTime = data.stimulus_onset_time;
+    trial.responseTime = data.response_time;
+    trial.reactionTime = data.reaction_time;
+    trial.endTime = data.stimulus_end_time;
+    return trial;
+}
+
+// Adds one line per differing field to `differences`
+static void compareTrial(size_t index, const RecordedTrial &recorded, const RecordedTrial &replayed,
+                         long tolerance, std::vector<std::string> &differences)
+{
+    char buffer[128];
+    struct Field
+    {
+        const char *name;
+        long recorded;
+        long replayed;
+        bool timestamp;
+    } fields[] = {
+        {"stimulus_number", recorded.stimulusNumber, replayed.stimulusNumber, false},
+        {"stimulus_color", recorded.color, replayed.color, false},
+        {"is_target", recorded.isTarget, replayed.isTarget, false},
+        {"response_made", recorded.responseMade, replayed.responseMade, false},
+        {"is_correct", recorded.isCorrect, replayed.isCorrect, false},
+        {"reaction_time", (long)recorded.reactionTime, (long)replayed.reactionTime, false},
+        {"stimulus_onset_time", (long)recorded.onsetTime, (long)replayed.onsetTime, true},
+        {"response_time", (long)recorded.responseTime, (long)replayed.responseTime, true},
+        {"stimulus_end_time", (long)recorded.endTime, (long)replayed.endTime, true},
+    };
+
+    for (const Field &field : fields)
+    {
+        long delta = labs(field.replayed - field.recorded);
+        if (field.timestamp ? delta > tolerance : delta != 0)
+        {
+            snprintf(buffer, sizeof(buffer), "trial %zu %s: recorded %ld, replayed %ld",
+                     index + 1, field.name, field.recorded, field.replayed);
+            differences.push_back(buffer);
+        }
+    }
+}
+
+// Replays one session; returns false if the firmware could not run it
+static bool replaySession(VirtualDevice &device, const RecordedSession &session, long tolerance,
+                          std::vector<std::string> &differences, std::vector<std::string> &notes)
+{
+    int trials = (int)session.trials.size();
+    if (trials < session.trialCount)
+    {
+        notes.push_back("log is truncated: " + std::to_string(trials) + " of " +
+                        std::to_string(session.trialCount) + " trials recorded, replaying those");
+    }
+
+    std::string sequence;
+    for (const RecordedTrial &trial : session.trials)
+    {
+        if (trial.color < 0)
+        {
+            differences.push_back("trial " + std::to_string(trial.stimulusNumber) + " has an unknown colour");
+            return false;
+        }
+        static const char *names[] = {"red", "green", "blue", "yellow", "purple"};
+        sequence += sequence.empty() ? "%" : ",";
+        sequence += names[trial.color];
+    }
+
+    char config[96];
+    snprintf(config, sizeof(config), "config %d,%d,%d,%d,%s,%d,", session.stimulusDuration,
+             session.interStimulusInterval, session.nBackLevel, trials, session.studyId.c_str(),
+             session.sessionNumber);
+    device.sendLine(config + sequence + "%");
+    if (!device.runUntilLine("Custom color sequence applied successfully", 10000000))
+    {
+        differences.push_back("firmware rejected the recorded configuration");
+        device.takeLines();
+        return false;
+    }
+
+    // Session timestamps count from the configuration, so start the task as
+    // long after it as the recording did (less the time "start" takes on the wire)
+    Runtime &rt = Runtime::get();
+    Micros startAt = (Micros)(nBackTask.getDataCollector().getSessionStartTime() + session.startTime) * 1000;
+    Micros wireTime = rt.uart().byteTime() * 6;
+    device.runUntil(startAt > wireTime ? startAt - wireTime : 0);
+    device.takeLines();
+
+    replay.device = &device;
+    replay.session = &session;
+    replay.nextTrial = 0;
+
+    device.sendLine("start");
+    Micros timeout = (Micros)trials * (session.stimulusDuration + session.interStimulusInterval + 60000) * 1000ULL;
+    bool completed = device.runUntilLine("task-completed", timeout);
+    replay.session = nullptr;
+    device.takeLines();
+    if (!completed)
+    {
+        differences.push_back("replayed session did not complete");
+        return false;
+    }
+
+    std::vector<RecordedTrial> replayed;
+    const DataCollector &data = nBackTask.getDataCollector();
+    for (uint8_t i = 0; i < data.getTrialCount(); i++)
+    {
+        replayed.push_back(fromCollector(*data.getTrial(i)));
+    }
+    if (replayed.size() != session.trials.size())
+    {
+        differences.push_back("replayed " + std::to_string(replayed.size()) + " trials");
+    }
+    for (size_t i = 0; i < replayed.size() && i < session.trials.size(); i++)
+    {
+        compareTrial(i, session.trials[i], replayed[i], tolerance, differences);
+    }
+
+    SessionMetrics a = computeMetrics(session.trials);
+    SessionMetrics b = computeMetrics(replayed);
+    if (a.hits != b.hits || a.misses != b.misses || a.falseAlarms != b.falseAlarms ||
+        a.correctRejections != b.correctRejections || a.meanReactionTime != b.meanReactionTime)
+    {
+        char buffer[192];
+        snprintf(buffer, sizeof(buffer),
+                 "metrics (hit/miss/FA/CR, mean RT): recorded %d/%d/%d/%d %.1f ms, replayed %d/%d/%d/%d %.1f ms",
+                 a.hits, a.misses, a.falseAlarms, a.correctRejections, a.meanReactionTime,
+                 b.hits, b.misses, b.falseAlarms, b.correctRejections, b.meanReactionTime);
+        differences.push_back(buffer);
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    long tolerance = 5;
+    bool quiet = false;
+    std::vector<std::string> paths;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--tolerance" && i + 1 < argc)
+            tolerance = atol(argv[++i]);
+        else if (arg == "--quiet")
+            quiet = true;
+        else if (arg[0] != '-')
+            paths.push_back(arg);
+        else
+        {
+            paths.clear();
+            break;
+        }
+    }
+    if (paths.empty())
+    {
+        fprintf(stderr, "usage: nback-replay [--tolerance MS] [--quiet] FILE|DIR...\n");
+        return 2;
+    }
+
+    // Expand directories into their regular files, in a stable order
+    std::vector<std::string> files;
+    for (const std::string &path : paths)
+    {
+        std::error_code ec;
+        if (!std::filesystem::is_directory(path, ec))
+        {
+            files.push_back(path);
+            continue;
+        }
+        std::vector<std::string> found;
+        for (const auto &entry : std::filesystem::recursive_directory_iterator(path, ec))
+        {
+            if (entry.is_regular_file())
+            {
+                found.push_back(entry.path().string());
+            }
+        }
+        std::sort(found.begin(), found.end());
+        files.insert(files.end(), found.begin(), found.end());
+    }
+
+    std::vector<RecordedSession> sessions;
+    for (const std::string &file : files)
+    {
+        std::string error;
+        if (!loadEventLog(file, sessions, error))
+        {
+            fprintf(stderr, "nback-replay: %s\n", error.c_str());
+            return 2;
+        }
+    }
+
+    std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+
+    // Button input and no progress messages keep the sampling latency far
+    // below a millisecond, so every recorded RT can be reproduced exactly
+    Runtime &rt = Runtime::get();
+    rt.addTraceObserver(onTrace);
+    VirtualDevice device;
+    device.boot();
+    nBackTask.setInputMode(BUTTON_INPUT);
+    device.sendLine("verbose off");
+    device.runFor(5000000);
+    device.takeLines();
+
+    int mismatched = 0;
+    int failed = 0;
+    size_t trials = 0;
+    for (const RecordedSession &session : sessions)
+    {
+        std::vector<std::string> differences;
+        std::vector<std::string> notes;
+        bool replayed = replaySession(device, session, tolerance, differences, notes);
+        trials += session.trials.size();
+        failed += !replayed;
+        mismatched += replayed && !differences.empty();
+
+        if (quiet && replayed && differences.empty())
+        {
+            continue;
+        }
+        printf("%s:%d: %s session %d (%zu trials): %s\n", session.source.c_str(), session.line,
+               session.studyId.c_str(), session.sessionNumber, session.trials.size(),
+               !replayed ? "NOT REPLAYED" : differences.empty() ? "match" : "DIFFERS");
+        for (const std::string &note : notes)
+        {
+            printf("    note: %s\n", note.c_str());
+        }
+        for (const std::string &difference : differences)
+        {
+            printf("    %s\n", difference.c_str());
+        }
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    printf("%zu sessions, %zu trials replayed in %.2f s: %zu matched, %d differ, %d not replayed\n",
+           sessions.size(), trials, seconds, sessions.size() - mismatched - failed, mismatched, failed);
+    return mismatched || failed ? 1 : 0;
+}
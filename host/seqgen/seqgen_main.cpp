@@ -0,0 +1,376 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "checksum.h"
+#include "sequence_codec.h"
+#include "sequence_stream.h"
+
+//==============================================================================
+// Sequence Library Generator
+//==============================================================================
+//
+// Builds the firmware's flash sequence library (src/sequence_library.h) from
+// a specification file.
+//
+//   nback-seqgen SPEC [--out FILE] [--list]
+//   nback-seqgen --stream SEED NBACK TRIALS
+//   nback-seqgen --pack COLOR,COLOR,...
+//
+// SPEC lines (see host/seqgen/library.txt):
+//
+//   seed N               generator seed (before the first set)
+//   target-rate P        share of trials after the first n that are targets
+//   NBACK TRIALS COUNT   COUNT sequences of TRIALS trials for NBACK
+//
+// Every sequence has exactly round((TRIALS - NBACK) * P) targets and no
+// other n-back matches, and is checked again before it is written. Each
+// sequence is generated from the seed and its own ID, so appending sets
+// never changes existing sequences. --out writes the C++ header (default
+// stdout); --list prints the sequences as color names instead.
+//
+// --stream regenerates a sequence the firmware generated during a session
+// (src/sequence_stream.h) from the seed and generator version logged in the
+// session's start event. --pack prints a sequence of color names in the
+// packed form for `config ...,$PACKED` (src/sequence_codec.h).
+
+static const char *COLOR_NAMES[] = {"red", "green", "blue", "yellow", "purple"};
+static const int COLORS_USED_COUNT = 5;
+static const int MAX_SEQUENCE_LENGTH = 100; // MAX_TRIALS of the firmware
+
+struct LibrarySequence
+{
+    int id;
+    int nBackLevel;
+    int targets;
+    size_t offset;
+    uint32_t crc;
+    std::vector<uint8_t> colors;
+};
+
+// SplitMix64: the same sequences on every host and standard library
+class Generator
+{
+public:
+    explicit Generator(uint64_t seed) : state(seed) {}
+
+    uint64_t next()
+    {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    int below(int bound) { return (int)(next() % (uint64_t)bound); }
+
+private:
+    uint64_t state;
+};
+
+static int countTargets(const std::vector<uint8_t> &colors, int nBack)
+{
+    int targets = 0;
+    for (size_t i = (size_t)nBack; i < colors.size(); i++)
+    {
+        targets += colors[i] == colors[i - nBack];
+    }
+    return targets;
+}
+
+static std::vector<uint8_t> buildSequence(Generator &rng, int trials, int nBack, int targets)
+{
+    // Choose the target positions (partial Fisher-Yates over n..trials-1)
+    std::vector<int> positions;
+    for (int i = nBack; i < trials; i++)
+    {
+        positions.push_back(i);
+    }
+    std::vector<bool> isTarget(trials, false);
+    for (int t = 0; t < targets; t++)
+    {
+        int pick = t + rng.below((int)positions.size() - t);
+        std::swap(positions[t], positions[pick]);
+        isTarget[positions[t]] = true;
+    }
+
+    std::vector<uint8_t> colors;
+    for (int i = 0; i < trials; i++)
+    {
+        if (isTarget[i])
+        {
+            colors.push_back(colors[i - nBack]);
+            continue;
+        }
+        // Non-targets never repeat the color n positions back
+        int color = rng.below(COLORS_USED_COUNT);
+        while (i >= nBack && color == colors[i - nBack])
+        {
+            color = rng.below(COLORS_USED_COUNT);
+        }
+        colors.push_back((uint8_t)color);
+    }
+    return colors;
+}
+
+// CRC as verified by loadSequence(): n-back level, length, colors
+static uint32_t sequenceCrc(int nBack, const std::vector<uint8_t> &colors)
+{
+    uint8_t header[2] = {(uint8_t)nBack, (uint8_t)colors.size()};
+    return crc32(colors.data(), colors.size(), crc32(header, sizeof(header)));
+}
+
+static bool readSpec(const std::string &path, std::vector<LibrarySequence> &library, std::string &error)
+{
+    std::ifstream in(path);
+    if (!in)
+    {
+        error = "cannot open " + path;
+        return false;
+    }
+
+    uint64_t seed = 1;
+    double targetRate = 0.25;
+    size_t offset = 0;
+    std::string line;
+    for (int lineNumber = 1; std::getline(in, line); lineNumber++)
+    {
+        std::istringstream fields(line.substr(0, line.find('#')));
+        std::string first;
+        if (!(fields >> first))
+        {
+            continue;
+        }
+        std::string where = path + ":" + std::to_string(lineNumber) + ": ";
+
+        if (first == "seed")
+        {
+            if (!library.empty() || !(fields >> seed))
+            {
+                error = where + "seed must be a number before the first set";
+                return false;
+            }
+            continue;
+        }
+        if (first == "target-rate")
+        {
+            if (!(fields >> targetRate) || targetRate < 0 || targetRate > 1)
+            {
+                error = where + "target-rate must be between 0 and 1";
+                return false;
+            }
+            continue;
+        }
+
+        int nBack = atoi(first.c_str());
+        int trials = 0;
+        int count = 0;
+        if (!(fields >> trials >> count) || nBack < 1 || trials < 5 || trials > MAX_SEQUENCE_LENGTH ||
+            nBack >= trials || count < 1)
+        {
+            error = where + "expected NBACK TRIALS COUNT (1 <= NBACK < TRIALS, 5 <= TRIALS <= 100)";
+            return false;
+        }
+
+        int targets = (int)lround((trials - nBack) * targetRate);
+        for (int i = 0; i < count; i++)
+        {
+            LibrarySequence sequence;
+            sequence.id = (int)library.size() + 1;
+            sequence.nBackLevel = nBack;
+            sequence.targets = targets;
+            sequence.offset = offset;
+
+            Generator rng(seed ^ ((uint64_t)sequence.id * 0xD1B54A32D192ED03ULL));
+            sequence.colors = buildSequence(rng, trials, nBack, targets);
+
+            // Check the result independently of how it was built
+            if (countTargets(sequence.colors, nBack) != targets)
+            {
+                error = where + "sequence " + std::to_string(sequence.id) + " failed validation";
+                return false;
+            }
+            sequence.crc = sequenceCrc(nBack, sequence.colors);
+            offset += sequence.colors.size();
+            library.push_back(sequence);
+        }
+    }
+    if (offset > 0xFFFF)
+    {
+        error = "library too large for 16-bit offsets";
+        return false;
+    }
+    return true;
+}
+
+static std::string headerText(const std::string &specPath, const std::vector<LibrarySequence> &library)
+{
+    std::ostringstream out;
+    out << "#ifndef SEQUENCE_LIBRARY_DATA_H\n"
+        << "#define SEQUENCE_LIBRARY_DATA_H\n\n"
+        << "// Generated by nback-seqgen from " << specPath << "; do not edit.\n\n"
+        << "#include \"sequence_library.h\"\n\n"
+        << "#define SEQUENCE_LIBRARY_COUNT " << library.size() << "\n\n"
+        << "static const uint8_t SEQUENCE_LIBRARY_COLORS[] PROGMEM = {\n";
+    for (const LibrarySequence &sequence : library)
+    {
+        out << "    // " << sequence.id << "\n   ";
+        for (size_t i = 0; i < sequence.colors.size(); i++)
+        {
+            out << " " << (int)sequence.colors[i] << ",";
+            if (i % 25 == 24 && i + 1 < sequence.colors.size())
+            {
+                out << "\n   ";
+            }
+        }
+        out << "\n";
+    }
+    out << "};\n\n"
+        << "static const SequenceEntry SEQUENCE_LIBRARY_ENTRIES[] PROGMEM = {\n"
+        << "    // id, n-back, length, targets, offset, crc\n";
+    for (const LibrarySequence &sequence : library)
+    {
+        char crc[16];
+        snprintf(crc, sizeof(crc), "0x%08X", sequence.crc);
+        out << "    {" << sequence.id << ", " << sequence.nBackLevel << ", " << sequence.colors.size() << ", "
+            << sequence.targets << ", " << sequence.offset << ", " << crc << "u},\n";
+    }
+    out << "};\n\n"
+        << "#endif // SEQUENCE_LIBRARY_DATA_H\n";
+    return out.str();
+}
+
+// The first `trials` stimuli of a generated session, with the same code
+static int printStream(uint32_t seed, int nBack, long trials)
+{
+    if (nBack < 1 || nBack > SEQUENCE_MAX_NBACK || trials < 1)
+    {
+        fprintf(stderr, "nback-seqgen: expected 1 <= NBACK <= %d and TRIALS >= 1\n", SEQUENCE_MAX_NBACK);
+        return 2;
+    }
+    SequenceStream stream;
+    stream.begin(seed, (uint8_t)nBack);
+    long targets = 0;
+    std::string colors;
+    for (long trial = 0; trial < trials; trial++)
+    {
+        stream.generateThrough((uint32_t)trial);
+        bool target = stream.isTarget((uint32_t)trial);
+        targets += target;
+        colors += std::string(" ") + COLOR_NAMES[stream.colorAt((uint32_t)trial)] + (target ? "*" : "");
+    }
+    printf("seed %u generator %d %d-back, %ld trials, %ld targets:%s\n", seed, SEQUENCE_GENERATOR_VERSION, nBack,
+           trials, targets, colors.c_str());
+    return 0;
+}
+
+// The `$...` config suffix for a list of color names
+static int printPacked(const std::string &list)
+{
+    std::vector<uint8_t> colors;
+    std::istringstream names(list);
+    std::string name;
+    while (std::getline(names, name, ','))
+    {
+        int color = 0;
+        while (color < COLORS_USED_COUNT && name != COLOR_NAMES[color])
+        {
+            color++;
+        }
+        if (color == COLORS_USED_COUNT)
+        {
+            fprintf(stderr, "nback-seqgen: unknown color '%s' at position %zu\n", name.c_str(), colors.size() + 1);
+            return 1;
+        }
+        colors.push_back((uint8_t)color);
+    }
+    if (colors.empty() || colors.size() > PACKED_SEQUENCE_MAX_LENGTH)
+    {
+        fprintf(stderr, "nback-seqgen: expected 1 to %d colors\n", PACKED_SEQUENCE_MAX_LENGTH);
+        return 1;
+    }
+    char text[PACKED_SEQUENCE_MAX_CHARS + 1];
+    encodePackedSequence(colors.data(), (uint8_t)colors.size(), text, sizeof(text));
+    printf("$%s\n", text);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc == 5 && std::string(argv[1]) == "--stream")
+    {
+        return printStream((uint32_t)strtoul(argv[2], nullptr, 10), atoi(argv[3]), atol(argv[4]));
+    }
+    if (argc == 3 && std::string(argv[1]) == "--pack")
+    {
+        return printPacked(argv[2]);
+    }
+
+    std::string specPath;
+    std::string outPath;
+    bool list = false;
+    bool usage = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--out" && i + 1 < argc)
+            outPath = argv[++i];
+        else if (arg == "--list")
+            list = true;
+        else if (specPath.empty() && arg[0] != '-')
+            specPath = arg;
+        else
+            usage = true;
+    }
+    if (usage || specPath.empty())
+    {
+        fprintf(stderr, "usage: nback-seqgen SPEC [--out FILE] [--list]\n"
+                        "       nback-seqgen --stream SEED NBACK TRIALS\n"
+                        "       nback-seqgen --pack COLOR,COLOR,...\n");
+        return 2;
+    }
+
+    std::vector<LibrarySequence> library;
+    std::string error;
+    if (!readSpec(specPath, library, error))
+    {
+        fprintf(stderr, "nback-seqgen: %s\n", error.c_str());
+        return 1;
+    }
+
+    if (list)
+    {
+        for (const LibrarySequence &sequence : library)
+        {
+            printf("#%d %d-back, %zu trials, %d targets:", sequence.id, sequence.nBackLevel,
+                   sequence.colors.size(), sequence.targets);
+            for (uint8_t color : sequence.colors)
+            {
+                printf(" %s", COLOR_NAMES[color]);
+            }
+            printf("\n");
+        }
+        return 0;
+    }
+
+    std::string text = headerText(specPath, library);
+    if (outPath.empty())
+    {
+        fputs(text.c_str(), stdout);
+        return 0;
+    }
+    std::ofstream out(outPath, std::ios::binary | std::ios::trunc);
+    out << text;
+    if (!out)
+    {
+        fprintf(stderr, "nback-seqgen: cannot write %s\n", outPath.c_str());
+        return 1;
+    }
+    fprintf(stderr, "nback-seqgen: %zu sequences written to %s\n", library.size(), outPath.c_str());
+    return 0;
+}
@@ -65,6 +65,22 @@ public:
      */
     int getReading(int sensorIndex = 0);
 
+    /**
+     * @brief Get the touch threshold of a sensor
+     *
+     * @param sensorIndex The sensor (0 for first, 1 for second)
+     * @return Readings below this value count as touched
+     */
+    int getThreshold(int sensorIndex) const { return thresholds[sensorIndex]; }
+
+    /**
+     * @brief Set the touch threshold of a sensor (e.g., restored from settings)
+     *
+     * @param sensorIndex The sensor (0 for first, 1 for second)
+     * @param threshold Readings below this value count as touched
+     */
+    void setThreshold(int sensorIndex, int threshold) { thresholds[sensorIndex] = threshold; }
+
     /**
      * @brief Run continuous monitoring with serial output
      *
@@ -0,0 +1,32 @@
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+//==============================================================================
+// Checksum
+//==============================================================================
+//
+// CRC-32 (IEEE 802.3, as zlib and Python's binascii.crc32) for data the
+// firmware stores or receives. Bitwise, without a table: the records it
+// covers are small. No Arduino dependencies: the header also compiles on the
+// host.
+
+// Pass the previous result as `crc` to continue over several buffers
+inline uint32_t crc32(const void *data, size_t length, uint32_t crc = 0)
+{
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    crc = ~crc;
+    for (size_t i = 0; i < length; i++)
+    {
+        crc ^= bytes[i];
+        for (int bit = 0; bit < 8; bit++)
+        {
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+        }
+    }
+    return ~crc;
+}
+
+#endif // CHECKSUM_H
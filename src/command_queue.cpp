@@ -0,0 +1,116 @@
+#include "command_queue.h"
+
+CommandQueue::CommandQueue() : partialSince(0), head(0), count(0)
+{
+}
+
+void CommandQueue::poll()
+{
+    while (Serial.available() > 0)
+    {
+        char c = (char)Serial.read();
+        if (c == '\n')
+        {
+            enqueue(partial);
+            partial = "";
+            continue;
+        }
+        if (partial.length() == 0)
+        {
+            partialSince = millis();
+        }
+        partial += c;
+    }
+
+    // A host that never ends its line still gets it run
+    if (partial.length() > 0 && millis() - partialSince >= COMMAND_LINE_TIMEOUT_MS)
+    {
+        enqueue(partial);
+        partial = "";
+    }
+}
+
+bool CommandQueue::next(QueuedCommand &command)
+{
+    if (count == 0)
+    {
+        return false;
+    }
+    command = queue[head];
+    queue[head].id = "";
+    queue[head].text = "";
+    head = (head + 1) % COMMAND_QUEUE_DEPTH;
+    count--;
+    return true;
+}
+
+void CommandQueue::enqueue(String line)
+{
+    line.trim();
+    line.toLowerCase();
+
+    // `@<id> ` in front is a request ID; anything else is part of the command
+    String id;
+    int space = line.indexOf(' ');
+    int idLength = (space == -1 ? (int)line.length() : space) - 1;
+    if (line.startsWith("@") && idLength >= 1 && idLength <= COMMAND_ID_MAX)
+    {
+        bool valid = true;
+        for (int i = 1; i <= idLength; i++)
+        {
+            char c = line.charAt(i);
+            valid = valid && ((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '-' || c == '_');
+        }
+        if (valid)
+        {
+            id = line.substring(1, idLength + 1);
+            line = space == -1 ? String("") : line.substring(space + 1);
+            line.trim();
+        }
+    }
+
+    if (count == COMMAND_QUEUE_DEPTH)
+    {
+        if (id.length() > 0)
+        {
+            sendNack(id, F("busy"));
+        }
+        else
+        {
+            Serial.print(F("!!!Warning: Command queue full, dropped: "));
+            Serial.print(line);
+            Serial.println(F("!!!"));
+        }
+        return;
+    }
+
+    QueuedCommand &slot = queue[(head + count) % COMMAND_QUEUE_DEPTH];
+    slot.id = id;
+    slot.text = line;
+    count++;
+    if (id.length() > 0)
+    {
+        Serial.print(F("ack "));
+        Serial.println(id);
+    }
+}
+
+void CommandQueue::sendDone(const String &id)
+{
+    if (id.length() > 0)
+    {
+        Serial.print(F("done "));
+        Serial.println(id);
+    }
+}
+
+void CommandQueue::sendNack(const String &id, const __FlashStringHelper *reason)
+{
+    if (id.length() > 0)
+    {
+        Serial.print(F("nack "));
+        Serial.print(id);
+        Serial.print(' ');
+        Serial.println(reason);
+    }
+}
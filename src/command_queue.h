@@ -0,0 +1,64 @@
+#ifndef COMMAND_QUEUE_H
+#define COMMAND_QUEUE_H
+
+#include <Arduino.h>
+
+//==============================================================================
+// Command Queue
+//==============================================================================
+//
+// Reads command lines without blocking loop() and holds up to
+// COMMAND_QUEUE_DEPTH of them, so a host can send config, validate and start
+// back to back instead of waiting for each answer. A line may start with a
+// request ID, `@<id> <command>`; such a command is answered with
+//
+//   ack <id>             when the line is queued
+//   done <id>            once it has run
+//   nack <id> <reason>   if it was not recognized, failed, or the queue was full
+//
+// around the command's usual output. Lines without an ID get the usual
+// output only. A line without its ending is taken after
+// COMMAND_LINE_TIMEOUT_MS, as Serial.readStringUntil() did.
+
+#define COMMAND_QUEUE_DEPTH 4
+#define COMMAND_LINE_TIMEOUT_MS 1000
+#define COMMAND_ID_MAX 8 // Characters: a-z, 0-9, '-' and '_'
+
+struct QueuedCommand
+{
+    String id;   // Empty without a request ID
+    String text; // Trimmed and lowercased, without the ID
+};
+
+class CommandQueue
+{
+public:
+    CommandQueue();
+
+    // Take what the UART has received; complete lines are queued (and
+    // acknowledged if they carry an ID)
+    void poll();
+
+    // The oldest queued command, false if none
+    bool next(QueuedCommand &command);
+
+    uint8_t size() const { return count; }
+
+    // Commands queued or a line still arriving
+    bool pending() const { return count > 0 || partial.length() > 0; }
+
+    // Completion lines for a command with an ID; nothing without one
+    static void sendDone(const String &id);
+    static void sendNack(const String &id, const __FlashStringHelper *reason);
+
+private:
+    void enqueue(String line);
+
+    String partial;
+    unsigned long partialSince; // When the first byte of `partial` arrived (ms)
+    QueuedCommand queue[COMMAND_QUEUE_DEPTH];
+    uint8_t head;
+    uint8_t count;
+};
+
+#endif // COMMAND_QUEUE_H
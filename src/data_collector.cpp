@@ -1,32 +1,89 @@
 #include "data_collector.h"
+#include "trace.h"
 
 //==============================================================================
 // Core Interface
 //==============================================================================
 
 DataCollector::DataCollector()
-    : study_id(""),
-      session_number(0),
-      session_start_time(0),
-      session_absolute_millis(0),
-      trial_count(0)
+    : recording(0),
+      sealedState(SEALED_NONE),
+      streamLine(0),
+      streamLength(0),
+      streamEnabled(false),
+      blocksStreamed(0),
+      blocksFlushed(0),
+      blocksReplaced(0),
+      overlapUs(0),
+      flushMs(0)
 {
+    for (uint8_t i = 0; i < DATA_BLOCK_COUNT; i++)
+    {
+        blocks[i].session_number = 0;
+        blocks[i].session_start_time = 0;
+        blocks[i].completion_time = 0;
+        blocks[i].trial_count = 0;
+        blocks[i].dropped_count = 0;
+    }
 }
 
 void DataCollector::begin(const String &study_id, uint16_t session_number)
 {
-    // Store study information
-    this->study_id = study_id;
-    this->session_number = session_number;
-    this->session_start_time = millis();
-    this->session_absolute_millis = millis(); // Store absolute timestamp
-    this->trial_count = 0;
+    // Store study information; the sealed block keeps its own
+    DataBlock &block = blocks[recording];
+    block.study_id = study_id;
+    block.session_number = session_number;
+    block.session_start_time = millis();
+    block.trial_count = 0;
+    block.dropped_count = 0;
 }
 
 void DataCollector::reset()
 {
-    // Clear all stored trials
-    trial_count = 0;
+    // Clear the trials stored for the next run
+    blocks[recording].trial_count = 0;
+    blocks[recording].dropped_count = 0;
+}
+
+void DataCollector::seal()
+{
+    // The previous block goes to the host first: finish its stream now,
+    // or give it up if nobody asked for it
+    if (sealedState == SEALED_STREAMING)
+    {
+        unsigned long start = millis();
+        finishStream();
+        blocksFlushed++;
+        flushMs += millis() - start;
+    }
+    else if (sealedState == SEALED_WAITING)
+    {
+        blocksReplaced++;
+    }
+
+    DataBlock &block = blocks[recording];
+    block.completion_time = millis();
+
+    // Another start without a config continues the same session
+    recording = (recording + 1) % DATA_BLOCK_COUNT;
+    DataBlock &next = blocks[recording];
+    next.study_id = block.study_id;
+    next.session_number = block.session_number;
+    next.session_start_time = block.session_start_time;
+    next.trial_count = 0;
+    next.dropped_count = 0;
+
+    streamLine = 0;
+    streamLength = 0;
+    if (!streamEnabled)
+    {
+        sealedState = SEALED_WAITING;
+    }
+    else
+    {
+        // An empty block has nothing to stream
+        sealedState = block.trial_count > 0 ? SEALED_STREAMING : SEALED_SENT;
+    }
 }
 
 void DataCollector::recordCompletedTrial(
@@ -38,161 +95,218 @@ void DataCollector::recordCompletedTrial(
     uint32_t stimulus_onset_time,
     uint32_t response_time,
     uint16_t reaction_time,
-    uint32_t stimulus_end_time)
+    uint32_t stimulus_end_time,
+    uint32_t onset_marker_us,
+    uint32_t response_marker_us,
+    uint32_t trigger_latency_us)
 {
-    // Only record if we have space
-    if (trial_count < MAX_DATA_ROWS)
+    DataBlock &block = blocks[recording];
+
+    // Only record if we have space; the rest are counted
+    if (block.trial_count >= MAX_DATA_ROWS)
     {
-        NBackTrialData &trial = trials[trial_count];
-
-        // Store all trial data
-        trial.stimulus_number = stimulus_number;
-        trial.stimulus_color = stimulus_color;
-        trial.is_target = is_target;
-        trial.response_made = response_made;
-        trial.is_correct = is_correct;
-        trial.stimulus_onset_time = stimulus_onset_time;
-        trial.response_time = response_time;
-        trial.reaction_time = reaction_time;
-        trial.stimulus_end_time = stimulus_end_time;
-
-        // Increment trial counter
-        trial_count++;
+        block.dropped_count++;
+        return;
     }
+
+    NBackTrialData &trial = block.trials[block.trial_count];
+
+    // Store all trial data
+    trial.stimulus_number = stimulus_number;
+    trial.stimulus_color = stimulus_color;
+    trial.is_target = is_target;
+    trial.response_made = response_made;
+    trial.is_correct = is_correct;
+    trial.stimulus_onset_time = stimulus_onset_time;
+    trial.response_time = response_time;
+    trial.reaction_time = reaction_time;
+    trial.stimulus_end_time = stimulus_end_time;
+    trial.onset_marker_us = onset_marker_us;
+    trial.response_marker_us = response_marker_us;
+    trial.trigger_latency_us = trigger_latency_us;
+
+    // Increment trial counter
+    block.trial_count++;
 }
 
 void DataCollector::sendDataOverSerial()
 {
+    // A stream already under way is completed rather than sent twice
+    if (sealedState == SEALED_STREAMING)
+    {
+        finishStream();
+        return;
+    }
+
+    const DataBlock &block = blocks[(recording + 1) % DATA_BLOCK_COUNT];
+    sealedState = SEALED_SENT;
+
     // Nothing to send if no trials recorded
-    if (trial_count == 0)
+    if (block.trial_count == 0)
     {
         Serial.println(F("No data to send"));
         return;
     }
 
     // Following the specified protocol
-    Serial.println(F("Opening Data Socket"));
+    char line[DATA_LINE_SIZE];
+    for (uint16_t i = 0; i < lineCount(block); i++)
+    {
+        formatLine(block, i, line, sizeof(line));
+        Serial.println(line);
+        if (i >= 3 && i < block.trial_count + 3)
+        {
+            delay(10); // After each data row
+        }
+    }
+}
+
+void DataCollector::discard()
+{
+    if (sealedState == SEALED_WAITING)
+    {
+        sealedState = SEALED_NONE;
+    }
+}
+
+//==============================================================================
+// Background Streaming
+//==============================================================================
 
-    // Print header format for trial data
-    Serial.print(F("Format=study_id,session_number,timestamp,task_type,event_type,"));
-    Serial.println(F("stimulus_number,stimulus_color,is_target,response_made,is_correct,stimulus_onset_time,response_time,reaction_time,stimulus_end_time"));
+void DataCollector::setStreaming(bool enabled)
+{
+    streamEnabled = enabled;
+    if (enabled && sealedState == SEALED_WAITING)
+    {
+        sealedState = blocks[(recording + 1) % DATA_BLOCK_COUNT].trial_count > 0 ? SEALED_STREAMING : SEALED_SENT;
+        streamLine = 0;
+        streamLength = 0;
+    }
+}
 
-    // Start data section
-    Serial.println(F("$$$"));
+void DataCollector::streamNext()
+{
+    if (sealedState != SEALED_STREAMING)
+    {
+        return;
+    }
+    prepareStreamLine();
+    sendStreamLine();
+}
 
-    // Buffer for timestamp formatting
-    char timestampBuffer[16]; // HH:MM:SS:mmm format needs 13 chars + null
+void DataCollector::streamNext(unsigned long deadlineMs)
+{
+    if (sealedState != SEALED_STREAMING)
+    {
+        return;
+    }
+    prepareStreamLine();
+
+    // data> and the line terminator, behind what the FIFO still holds
+    size_t bytes = streamLength + 7;
+    int room = Serial.availableForWrite();
+    size_t queued = room < DATA_STREAM_TX_FIFO ? DATA_STREAM_TX_FIFO - room : 0;
+    uint32_t wireUs = (bytes + queued) * DATA_STREAM_BYTE_US;
+    long slackMs = (long)(deadlineMs - millis());
+    if (slackMs <= 0 || (uint32_t)slackMs * 1000 <= wireUs)
+    {
+        return;
+    }
+
+    sendStreamLine();
+    overlapUs += bytes * DATA_STREAM_BYTE_US;
+}
 
-    // Send each data row
-    for (uint8_t i = 0; i < trial_count; i++)
+void DataCollector::finishStream()
+{
+    while (sealedState == SEALED_STREAMING)
     {
-        const NBackTrialData &trial = trials[i];
+        prepareStreamLine();
+        sendStreamLine();
+    }
+}
 
-        // Common fields
-        Serial.print(study_id);
-        Serial.print(F(","));
-        Serial.print(session_number);
-        Serial.print(F(","));
-        Serial.print(trial.stimulus_end_time);
-        Serial.print(F(","));
-        Serial.print(F("n-back"));
-        Serial.print(F(","));
-        Serial.print(F("trial_complete"));
+void DataCollector::prepareStreamLine()
+{
+    if (streamLength == 0)
+    {
+        streamLength = formatLine(blocks[(recording + 1) % DATA_BLOCK_COUNT], streamLine,
+                                  streamBuffer, sizeof(streamBuffer));
+    }
+}
 
-        // N-Back specific fields
-        Serial.print(F(","));
-        Serial.print(trial.stimulus_number);
-        Serial.print(F(","));
+void DataCollector::sendStreamLine()
+{
+    Serial.print(F("data>"));
+    Serial.println(streamBuffer);
+    streamLength = 0;
+
+    streamLine++;
+    if (streamLine == lineCount(blocks[(recording + 1) % DATA_BLOCK_COUNT]))
+    {
+        sealedState = SEALED_SENT;
+        blocksStreamed++;
+    }
+}
 
-        // Color name
-        switch (trial.stimulus_color)
+void DataCollector::printStreamStatus() const
+{
+    Serial.print(F("Data stream: "));
+    Serial.println(streamEnabled ? F("on") : F("off"));
+
+    const DataBlock &block = blocks[(recording + 1) % DATA_BLOCK_COUNT];
+    if (sealedState == SEALED_NONE)
+    {
+        Serial.println(F("Sealed block: none"));
+    }
+    else
+    {
+        Serial.print(F("Sealed block: "));
+        Serial.print(block.study_id);
+        Serial.print(F(" session "));
+        Serial.print(block.session_number);
+        Serial.print(F(", "));
+        Serial.print(block.trial_count);
+        Serial.print(F(" trials"));
+        if (block.dropped_count > 0)
         {
-        case 0:
-            Serial.print(F("red"));
-            break;
-        case 1:
-            Serial.print(F("green"));
-            break;
-        case 2:
-            Serial.print(F("blue"));
-            break;
-        case 3:
-            Serial.print(F("yellow"));
+            Serial.print(F(" ("));
+            Serial.print(block.dropped_count);
+            Serial.print(F(" more not stored)"));
+        }
+        switch (sealedState)
+        {
+        case SEALED_WAITING:
+            Serial.println(F(", waits for get_data"));
             break;
-        case 4:
-            Serial.print(F("purple"));
+        case SEALED_STREAMING:
+            Serial.print(F(", streaming line "));
+            Serial.print(streamLine + 1);
+            Serial.print(F(" of "));
+            Serial.println(lineCount(block));
             break;
         default:
-            Serial.print(F("unknown"));
+            Serial.println(F(", sent"));
             break;
         }
-
-        Serial.print(F(","));
-        Serial.print(trial.is_target ? F("true") : F("false"));
-        Serial.print(F(","));
-        Serial.print(trial.response_made ? F("true") : F("false"));
-        Serial.print(F(","));
-        Serial.print(trial.is_correct ? F("true") : F("false"));
-        Serial.print(F(","));
-
-        // Keep all time values as milliseconds for analysis
-        Serial.print(trial.stimulus_onset_time);
-        Serial.print(F(","));
-        Serial.print(trial.response_time);
-        Serial.print(F(","));
-        Serial.print(trial.reaction_time); // Keep reaction time as raw milliseconds for analysis
-        Serial.print(F(","));
-        Serial.print(trial.stimulus_end_time);
-
-        Serial.println();
-        delay(10);
     }
 
-    // End trial data section
-    Serial.println(F("$$$"));
-
-    // Now add session timing information section
-    Serial.println(F("Format=study_id,session_number,start_time_millis,start_time,completion_time,total_duration,total_trials"));
-
-    // Start session data section
-    Serial.println(F("$$$"));
-
-    // Calculate total completion time
-    uint32_t currentTime = millis();
-    uint32_t totalDuration = currentTime - session_start_time;
-
-    // Format timestamps for summary
-    char startTimeBuffer[16];
-    char completionTimeBuffer[16];
-    char durationBuffer[16];
-    formatTimestamp(session_absolute_millis, startTimeBuffer, sizeof(startTimeBuffer));
-    formatTimestamp(currentTime, completionTimeBuffer, sizeof(completionTimeBuffer));
-    formatTimestamp(totalDuration, durationBuffer, sizeof(durationBuffer));
-
-    // Output session summary line
-    Serial.print(study_id);
-    Serial.print(F(","));
-    Serial.print(session_number);
-    Serial.print(F(","));
-    Serial.print(session_absolute_millis);
-    Serial.print(F(","));
-    Serial.print(startTimeBuffer);
-    Serial.print(F(","));
-    Serial.print(completionTimeBuffer);
-    Serial.print(F(","));
-    Serial.print(durationBuffer);
-    Serial.print(F(","));
-    Serial.println(trial_count);
-
-    // End session data section
-    Serial.println(F("$$$"));
-
-    // Close data socket
-    Serial.println(F("Closing Data Socket"));
+    Serial.print(F("Blocks streamed: "));
+    Serial.print(blocksStreamed);
+    Serial.print(F(" ("));
+    Serial.print(blocksFlushed);
+    Serial.print(F(" finished at the end of the next block, waiting "));
+    Serial.print(flushMs);
+    Serial.println(F(" ms)"));
+    Serial.print(F("Blocks replaced before they were sent: "));
+    Serial.println(blocksReplaced);
+    Serial.print(F("Sent while the next block ran: "));
+    Serial.print((uint32_t)(overlapUs / 1000));
+    Serial.println(F(" ms of transfer (session time saved)"));
 }
 
 void DataCollector::sendRealTimeEvent(const String &event_type,
-                                      uint8_t stimulus_number,
+                                      uint32_t stimulus_number,
                                       uint8_t stimulus_color,
                                       bool is_target,
                                       bool response_made,
@@ -202,15 +316,18 @@ void DataCollector::sendRealTimeEvent(const String &event_type,
                                       uint16_t reaction_time,
                                       uint32_t stimulus_end_time)
 {
+    NBACK_TRACE(TRACE_EVENT_SERIALIZE_BEGIN);
+
     // Start with the write> prefix to indicate this should be saved to a file
     Serial.print(F("write>"));
 
     // Common fields
-    Serial.print(study_id);
+    const DataBlock &block = blocks[recording];
+    Serial.print(block.study_id);
     Serial.print(F(","));
-    Serial.print(session_number);
+    Serial.print(block.session_number);
     Serial.print(F(","));
-    Serial.print(millis() - session_start_time); // Current timestamp relative to session start
+    Serial.print(millis() - block.session_start_time); // Current timestamp relative to session start
     Serial.print(F(","));
     Serial.print(F("n-back"));
     Serial.print(F(","));
@@ -260,6 +377,8 @@ void DataCollector::sendRealTimeEvent(const String &event_type,
     Serial.print(stimulus_end_time);
 
     Serial.println();
+
+    NBACK_TRACE(TRACE_EVENT_SERIALIZE_END);
 }
 
 void DataCollector::sendTimestampedEvent(const String &event_type, const String &additional_data)
@@ -268,11 +387,12 @@ void DataCollector::sendTimestampedEvent(const String &event_type, const String
     Serial.print(F("write>"));
 
     // Common fields
-    Serial.print(study_id);
+    const DataBlock &block = blocks[recording];
+    Serial.print(block.study_id);
     Serial.print(F(","));
-    Serial.print(session_number);
+    Serial.print(block.session_number);
     Serial.print(F(","));
-    Serial.print(millis() - session_start_time); // Current timestamp relative to session start
+    Serial.print(millis() - block.session_start_time); // Current timestamp relative to session start
     Serial.print(F(","));
     Serial.print(F("n-back"));
     Serial.print(F(","));
@@ -297,17 +417,93 @@ void DataCollector::sendTimestampedEvent(const String &event_type, const String
 
 uint8_t DataCollector::getTrialCount() const
 {
-    return trial_count;
+    return blocks[(recording + 1) % DATA_BLOCK_COUNT].trial_count;
+}
+
+const NBackTrialData *DataCollector::getTrial(uint8_t index) const
+{
+    const DataBlock &block = blocks[(recording + 1) % DATA_BLOCK_COUNT];
+    return index < block.trial_count ? &block.trials[index] : nullptr;
 }
 
 uint32_t DataCollector::getSessionStartTime() const
 {
-    return session_start_time;
+    return blocks[recording].session_start_time;
 }
 
 uint32_t DataCollector::getSessionAbsoluteStartTime() const
 {
-    return session_absolute_millis;
+    return blocks[(recording + 1) % DATA_BLOCK_COUNT].session_start_time;
+}
+
+//==============================================================================
+// Private Helper Methods
+//==============================================================================
+
+// Color names of the data rows
+static const char *dataColorName(uint8_t color_index)
+{
+    static const char *const names[] = {"red", "green", "blue", "yellow", "purple"};
+    return color_index < sizeof(names) / sizeof(names[0]) ? names[color_index] : "unknown";
+}
+
+size_t DataCollector::formatLine(const DataBlock &block, uint16_t line, char *buffer, size_t size)
+{
+    uint16_t rows = block.trial_count;
+    int length;
+    if (line == 0)
+    {
+        length = snprintf(buffer, size, "Opening Data Socket");
+    }
+    else if (line == 1)
+    {
+        // Header format for trial data
+        length = snprintf(buffer, size, "%s%s", "Format=study_id,session_number,timestamp,task_type,event_type,",
+                          "stimulus_number,stimulus_color,is_target,response_made,is_correct,stimulus_onset_time,"
+                          "response_time,reaction_time,stimulus_end_time,onset_marker_us,response_marker_us,"
+                          "trigger_latency_us");
+    }
+    else if (line == 2 || line == rows + 3 || line == rows + 5 || line == rows + 7)
+    {
+        // Start or end of a data section
+        length = snprintf(buffer, size, "$$$");
+    }
+    else if (line < rows + 3)
+    {
+        // A data row; all time values stay milliseconds for analysis
+        const NBackTrialData &trial = block.trials[line - 3];
+        length = snprintf(buffer, size, "%s,%u,%lu,n-back,trial_complete,%u,%s,%s,%s,%s,%lu,%lu,%u,%lu,%lu,%lu,%lu",
+                          block.study_id.c_str(), block.session_number, (unsigned long)trial.stimulus_end_time,
+                          trial.stimulus_number, dataColorName(trial.stimulus_color),
+                          trial.is_target ? "true" : "false", trial.response_made ? "true" : "false",
+                          trial.is_correct ? "true" : "false", (unsigned long)trial.stimulus_onset_time,
+                          (unsigned long)trial.response_time, trial.reaction_time,
+                          (unsigned long)trial.stimulus_end_time, (unsigned long)trial.onset_marker_us,
+                          (unsigned long)trial.response_marker_us, (unsigned long)trial.trigger_latency_us);
+    }
+    else if (line == rows + 4)
+    {
+        // Session timing information section
+        length = snprintf(buffer, size, "Format=study_id,session_number,start_time_millis,start_time,completion_time,total_duration,total_trials");
+    }
+    else if (line == rows + 6)
+    {
+        // Session summary line, up to when the block was sealed
+        char startTimeBuffer[16];
+        char completionTimeBuffer[16];
+        char durationBuffer[16];
+        formatTimestamp(block.session_start_time, startTimeBuffer, sizeof(startTimeBuffer));
+        formatTimestamp(block.completion_time, completionTimeBuffer, sizeof(completionTimeBuffer));
+        formatTimestamp(block.completion_time - block.session_start_time, durationBuffer, sizeof(durationBuffer));
+        length = snprintf(buffer, size, "%s,%u,%lu,%s,%s,%s,%u",
+                          block.study_id.c_str(), block.session_number, (unsigned long)block.session_start_time,
+                          startTimeBuffer, completionTimeBuffer, durationBuffer, rows);
+    }
+    else
+    {
+        length = snprintf(buffer, size, "Closing Data Socket");
+    }
+    return length < 0 ? 0 : ((size_t)length < size ? (size_t)length : size - 1);
 }
 
 //==============================================================================
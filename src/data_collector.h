@@ -7,9 +7,20 @@
 // Configuration
 //==============================================================================
 
-// Maximum number of trials to store data for
+// Maximum number of trials to store data for, per block
 #define MAX_DATA_ROWS 100
 
+// One block records while the other, sealed, waits to be sent
+#define DATA_BLOCK_COUNT 2
+
+// Longest line of the data socket (the trial Format= header), plus terminator
+#define DATA_LINE_SIZE 256
+
+// A line streamed while a block records goes out only if it is on the wire
+// before the next onset, after the bytes still in the transmit FIFO
+#define DATA_STREAM_TX_FIFO 128  // ESP32 UART FIFO, no TX ring buffer
+#define DATA_STREAM_BYTE_US 1042 // 10 bits at 9600 baud (main.cpp)
+
 //==============================================================================
 // Data Structures
 //==============================================================================
@@ -31,11 +42,54 @@ struct NBackTrialData
     uint32_t stimulus_onset_time; // When stimulus appeared (relative to session start)
     uint32_t response_time;       // When response occurred (0 if none)
     uint32_t stimulus_end_time;   // When stimulus disappeared
+
+    // TTL markers (event_markers.h), us after the trial started (0 if none)
+    uint32_t onset_marker_us;
+    uint32_t response_marker_us;
+
+    // Trial start after the trigger pulse that started it (trigger_input.h), us (0 if none)
+    uint32_t trigger_latency_us;
+};
+
+// The trials of one task run (a block) and the session they belong to
+struct DataBlock
+{
+    String study_id;             // Study identifier
+    uint16_t session_number;     // Session number
+    uint32_t session_start_time; // millis() value when the session was configured
+    uint32_t completion_time;    // millis() value when the block was sealed
+    NBackTrialData trials[MAX_DATA_ROWS];
+    uint8_t trial_count;
+    uint16_t dropped_count; // Trials past MAX_DATA_ROWS, not stored
+};
+
+// What happens to the sealed block
+enum SealedState
+{
+    SEALED_NONE,      // Nothing sealed yet, or it was discarded
+    SEALED_WAITING,   // Waits for get_data
+    SEALED_STREAMING, // Being sent in the background
+    SEALED_SENT       // On its way to the host
 };
 
 //==============================================================================
 // DataCollector Class
 //==============================================================================
+//
+// Trials are recorded into one of two blocks. When a task ends its block is
+// sealed and the next task records into the other one, so the sealed block
+// stays available while the next session is configured and run: get_data
+// sends it at once, or with streaming on it is sent in the background, one
+// line of the data socket per call to streamNext(), each with the data>
+// prefix so that the lines can interleave with the running block's output.
+//
+// Back-pressure and overflow:
+// - A block seals only once the previous one is sent; a stream that has not
+//   finished by then is completed first, at the end of the block (never
+//   during a trial), and the time it took is counted
+// - Without streaming, a block that was not retrieved is replaced by the
+//   next one, as before, and counted
+// - Trials past MAX_DATA_ROWS in a block are not stored, and counted
 
 class DataCollector
 {
@@ -50,9 +104,12 @@ public:
     // Initialize the data collector for a new session
     void begin(const String &study_id, uint16_t session_number);
 
-    // Reset all stored data
+    // Clear the trials of the recording block; the sealed block is kept
     void reset();
 
+    // The task ended: seal the recording block and record into the other one
+    void seal();
+
     // Record a completed trial
     void recordCompletedTrial(
         uint8_t stimulus_number,
@@ -63,14 +120,45 @@ public:
         uint32_t stimulus_onset_time,
         uint32_t response_time,
         uint16_t reaction_time,
-        uint32_t stimulus_end_time);
+        uint32_t stimulus_end_time,
+        uint32_t onset_marker_us = 0,
+        uint32_t response_marker_us = 0,
+        uint32_t trigger_latency_us = 0);
 
-    // Send all collected data over serial
+    // Send the sealed block over serial, or the rest of its stream
     void sendDataOverSerial();
 
+    // The sealed block waits for get_data or is still streaming
+    bool hasData() const { return sealedState == SEALED_WAITING || sealedState == SEALED_STREAMING; }
+
+    // Discard the sealed block unless it is already being sent
+    void discard();
+
+    //----------------------------------------------------------------------------
+    // Background Streaming
+    //----------------------------------------------------------------------------
+
+    // Stream blocks as they are sealed; turning it on also streams a block
+    // that waits for get_data, turning it off lets a stream finish
+    void setStreaming(bool enabled);
+    bool isStreaming() const { return streamEnabled; }
+
+    // The sealed block has lines left to stream
+    bool streamPending() const { return sealedState == SEALED_STREAMING; }
+
+    // Send the next line of the stream while idle
+    void streamNext();
+
+    // Send the next line while a block records, if it is on the wire before
+    // `deadlineMs` (millis()); counted as transfer time saved
+    void streamNext(unsigned long deadlineMs);
+
+    // The 'stream' command
+    void printStreamStatus() const;
+
     // Send real-time event data with write> prefix for immediate file writing
     void sendRealTimeEvent(const String &event_type,
-                           uint8_t stimulus_number = 0,
+                           uint32_t stimulus_number = 0,
                            uint8_t stimulus_color = 0,
                            bool is_target = false,
                            bool response_made = false,
@@ -87,17 +175,23 @@ public:
     // Accessors
     //----------------------------------------------------------------------------
 
-    // Get the number of trials recorded
+    // Get the number of trials recorded in the last completed block
     uint8_t getTrialCount() const;
 
-    // Get session start time (millis() value when begin was called)
+    // Get a trial of the last completed block (nullptr if index is out of range)
+    const NBackTrialData *getTrial(uint8_t index) const;
+
+    // Get session start time of the recording block (millis() value when begin was called)
     uint32_t getSessionStartTime() const;
 
-    // Get absolute millis() when session started
+    // Get absolute millis() when the session of the last completed block started
     uint32_t getSessionAbsoluteStartTime() const;
 
     // Get session number
-    uint16_t getSessionNumber() const { return session_number; }
+    uint16_t getSessionNumber() const { return blocks[recording].session_number; }
+
+    // Trials of the recording block that were not stored (past MAX_DATA_ROWS)
+    uint16_t getDroppedCount() const { return blocks[recording].dropped_count; }
 
     //----------------------------------------------------------------------------
     // Utility Functions
@@ -114,18 +208,44 @@ public:
 
 private:
     //----------------------------------------------------------------------------
-    // Private Data Members
+    // Private Helper Methods
     //----------------------------------------------------------------------------
 
-    // Configuration data
-    String study_id;                  // Study identifier
-    uint16_t session_number;          // Session number
-    uint32_t session_start_time;      // millis() value when session started
-    uint32_t session_absolute_millis; // Absolute millis() when session started
+    // Lines of a block's data socket: open, trial format, $$$, the rows,
+    // $$$, session format, $$$, the summary row, $$$, close
+    static uint16_t lineCount(const DataBlock &block) { return block.trial_count + 9; }
+
+    // Format line `line` of the block's data socket; returns its length
+    size_t formatLine(const DataBlock &block, uint16_t line, char *buffer, size_t size);
+
+    // Send the rest of the stream at once
+    void finishStream();
+
+    // Format the next line of the stream into streamBuffer, once
+    void prepareStreamLine();
+
+    // Send it and move on to the next line
+    void sendStreamLine();
+
+    //----------------------------------------------------------------------------
+    // Private Data Members
+    //----------------------------------------------------------------------------
 
     // Data storage
-    NBackTrialData trials[MAX_DATA_ROWS];
-    uint8_t trial_count;
+    DataBlock blocks[DATA_BLOCK_COUNT];
+    uint8_t recording;       // Block the trials go to; the other one is sealed
+    SealedState sealedState; // Of the other block
+    uint16_t streamLine;     // Next line of the sealed block to stream
+    char streamBuffer[DATA_LINE_SIZE];
+    size_t streamLength;     // Of the line in streamBuffer, 0 if not formatted yet
+    bool streamEnabled;
+
+    // Stream statistics since boot
+    uint32_t blocksStreamed;  // Streams completed
+    uint32_t blocksFlushed;   // Of those, finished at the end of the next block
+    uint32_t blocksReplaced;  // Sealed blocks never sent
+    uint64_t overlapUs;       // Transfer time while the next block recorded
+    uint32_t flushMs;         // Time the end of a block waited for a stream
 };
 
 #endif // DATA_COLLECTOR_H
\ No newline at end of file
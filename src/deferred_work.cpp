@@ -0,0 +1,139 @@
+#include "deferred_work.h"
+#include "trace.h"
+
+#define DEFERRED_MIN_ESTIMATE_US 1000 // Per job, before a longer one was seen
+
+DeferredWork::DeferredWork()
+    : head(0),
+      count(0),
+      deadlineMs(0),
+      maxJobUs(0)
+{
+    resetStats();
+}
+
+void DeferredWork::post(DeferredFunction run, void *context, uint8_t job, unsigned long deadlineMs)
+{
+    posted++;
+    if (count == DEFERRED_QUEUE_SIZE)
+    {
+        overflows++;
+        run(context, job);
+        return;
+    }
+
+    if (count == 0 || (long)(deadlineMs - this->deadlineMs) < 0)
+    {
+        this->deadlineMs = deadlineMs;
+    }
+    DeferredJob &entry = jobs[(head + count) % DEFERRED_QUEUE_SIZE];
+    entry.run = run;
+    entry.context = context;
+    entry.job = job;
+    count++;
+    if (count > maxDepth)
+    {
+        maxDepth = count;
+    }
+}
+
+void DeferredWork::runSlack()
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    // Rush once the queued jobs might not fit in the slack any more
+    long slackMs = (long)(deadlineMs - millis());
+    uint32_t estimateUs = maxJobUs > DEFERRED_MIN_ESTIMATE_US ? maxJobUs : DEFERRED_MIN_ESTIMATE_US;
+    if (slackMs > 0 && (uint32_t)slackMs * 1000 > estimateUs * count)
+    {
+        runNext();
+        return;
+    }
+    drain();
+}
+
+void DeferredWork::drain()
+{
+    while (count > 0)
+    {
+        runNext();
+    }
+}
+
+void DeferredWork::runNext()
+{
+    DeferredJob entry = jobs[head];
+    head = (head + 1) % DEFERRED_QUEUE_SIZE;
+    count--;
+
+    unsigned long start = micros();
+    if ((long)(millis() - deadlineMs) > 0)
+    {
+        late++;
+    }
+    entry.run(entry.context, entry.job);
+    uint32_t duration = micros() - start;
+    if (duration > maxJobUs)
+    {
+        maxJobUs = duration;
+    }
+
+    if (count == 0)
+    {
+        NBACK_TRACE(TRACE_DEFERRED_DONE);
+        lastSlackMs = (long)(deadlineMs - millis());
+        if (emptied == 0 || lastSlackMs < minSlackMs)
+        {
+            minSlackMs = lastSlackMs;
+        }
+        slackSumMs += lastSlackMs;
+        emptied++;
+    }
+}
+
+void DeferredWork::resetStats()
+{
+    posted = 0;
+    overflows = 0;
+    late = 0;
+    maxDepth = count;
+    emptied = 0;
+    lastSlackMs = 0;
+    minSlackMs = 0;
+    slackSumMs = 0;
+}
+
+void DeferredWork::printStats() const
+{
+    Serial.print(F("Deferred jobs: "));
+    Serial.print(posted);
+    Serial.print(F(" ("));
+    Serial.print(overflows);
+    Serial.print(F(" run at once with the queue full, "));
+    Serial.print(late);
+    Serial.println(F(" after their deadline)"));
+    Serial.print(F("Queue depth: "));
+    Serial.print(count);
+    Serial.print(F(", max "));
+    Serial.print(maxDepth);
+    Serial.print(F(" of "));
+    Serial.println(DEFERRED_QUEUE_SIZE);
+    Serial.print(F("Longest job: "));
+    Serial.print(maxJobUs);
+    Serial.println(F(" us"));
+    if (emptied == 0)
+    {
+        Serial.println(F("Slack before the deadline: none measured"));
+        return;
+    }
+    Serial.print(F("Slack before the deadline: last "));
+    Serial.print(lastSlackMs);
+    Serial.print(F(" ms, min "));
+    Serial.print(minSlackMs);
+    Serial.print(F(" ms, avg "));
+    Serial.print(slackSumMs / (long)emptied);
+    Serial.println(F(" ms"));
+}
@@ -0,0 +1,72 @@
+#ifndef DEFERRED_WORK_H
+#define DEFERRED_WORK_H
+
+#include <Arduino.h>
+
+//==============================================================================
+// Deferred Work
+//==============================================================================
+//
+// Bookkeeping and output a trial leaves behind when it completes (the outcome
+// messages, its data row and its real-time events), kept off the path from
+// the response to the interval. The task posts them as jobs with the next
+// onset as their deadline and loop() runs one per pass, so the strip, the
+// inputs and the command line are served between them. Once the slack left
+// before the deadline is no more than the queued jobs could take (each as
+// long as the longest job so far), the rest run in the same pass; drain()
+// runs whatever is left at the deadline itself. A full queue runs the job at
+// once.
+
+#define DEFERRED_QUEUE_SIZE 8 // Jobs waiting; a trial posts four
+
+// `job` tells the context which of its jobs to run
+typedef void (*DeferredFunction)(void *context, uint8_t job);
+
+struct DeferredJob
+{
+    DeferredFunction run;
+    void *context;
+    uint8_t job;
+};
+
+class DeferredWork
+{
+public:
+    DeferredWork();
+
+    // Queue a job that must be done by `deadlineMs` (millis()); runs it at
+    // once if the queue is full
+    void post(DeferredFunction run, void *context, uint8_t job, unsigned long deadlineMs);
+
+    // One loop pass: the next job, or all of them if the slack runs short
+    void runSlack();
+
+    // Run every queued job now: the deadline is here
+    void drain();
+
+    uint8_t depth() const { return count; }
+
+    // The figures of the 'perf' command, since the last resetStats()
+    void resetStats();
+    void printStats() const;
+
+private:
+    void runNext();
+
+    DeferredJob jobs[DEFERRED_QUEUE_SIZE];
+    uint8_t head;             // Oldest job
+    uint8_t count;            // Jobs queued
+    unsigned long deadlineMs; // Earliest deadline of the queued jobs
+
+    uint32_t posted;
+    uint32_t overflows; // Run at once: the queue was full
+    uint32_t late;      // Started after their deadline
+    uint8_t maxDepth;
+    uint32_t maxJobUs;  // Longest job so far (not reset): the estimate per job
+    uint32_t emptied;   // Times the queue ran empty, with the slack left then
+    long lastSlackMs;
+    long minSlackMs;
+    long slackSumMs;
+};
+
+#endif // DEFERRED_WORK_H
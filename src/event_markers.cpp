@@ -0,0 +1,190 @@
+#include "event_markers.h"
+
+#if defined(ESP32)
+#include <soc/gpio_reg.h>
+#include <soc/soc.h>
+#endif
+
+static const uint8_t markerPins[MARKER_PIN_COUNT] = MARKER_PINS;
+static const uint8_t defaultCodes[MARKER_EVENT_COUNT] = DEFAULT_MARKER_CODES;
+
+EventMarkers::EventMarkers()
+    : enabled(false),
+      widthMs(MARKER_DEFAULT_WIDTH_MS),
+      sent(0),
+      replaced(0)
+#if defined(EVENT_MARKERS_AVAILABLE)
+      ,
+      timer(nullptr),
+      pulseLock(portMUX_INITIALIZER_UNLOCKED)
+#endif
+{
+    memcpy(codes, defaultCodes, sizeof(codes));
+}
+
+bool EventMarkers::available()
+{
+#if defined(EVENT_MARKERS_AVAILABLE)
+    return true;
+#else
+    return false;
+#endif
+}
+
+void EventMarkers::begin()
+{
+#if defined(EVENT_MARKERS_AVAILABLE)
+    for (int i = 0; i < MARKER_PIN_COUNT; i++)
+    {
+        pinMode(markerPins[i], OUTPUT);
+        digitalWrite(markerPins[i], LOW);
+    }
+
+    // Runs in the esp_timer task, not in loop()
+    esp_timer_create_args_t args = {};
+    args.callback = &EventMarkers::endPulse;
+    args.arg = this;
+    args.dispatch_method = ESP_TIMER_TASK;
+    args.name = "marker";
+    esp_timer_create(&args, &timer);
+#endif
+}
+
+void EventMarkers::setEnabled(bool enabled)
+{
+    this->enabled = enabled && available();
+#if defined(EVENT_MARKERS_AVAILABLE)
+    if (!this->enabled && timer != nullptr)
+    {
+        portENTER_CRITICAL(&pulseLock);
+        if (esp_timer_stop(timer) == ESP_OK)
+        {
+            writeCode(0);
+        }
+        portEXIT_CRITICAL(&pulseLock);
+    }
+#endif
+}
+
+bool EventMarkers::setWidth(uint8_t widthMs)
+{
+    if (widthMs < 1 || widthMs > MARKER_MAX_WIDTH_MS)
+    {
+        return false;
+    }
+    this->widthMs = widthMs;
+    return true;
+}
+
+void EventMarkers::setCode(MarkerEvent event, uint8_t code)
+{
+    codes[event] = code & MARKER_MAX_CODE;
+}
+
+unsigned long EventMarkers::emit(MarkerEvent event)
+{
+#if defined(EVENT_MARKERS_AVAILABLE)
+    if (!enabled || codes[event] == 0 || timer == nullptr)
+    {
+        return 0;
+    }
+
+    // A pulse still high ends here, so the new code is not merged into it.
+    // The stop fails once the timer has expired, also while endPulse() is
+    // about to run for it: the lock keeps that call from ending this pulse
+    portENTER_CRITICAL(&pulseLock);
+    if (esp_timer_stop(timer) == ESP_OK)
+    {
+        writeCode(0);
+        replaced++;
+    }
+    writeCode(codes[event]);
+    unsigned long edge = micros();
+    if (esp_timer_start_once(timer, (uint64_t)widthMs * 1000) != ESP_OK)
+    {
+        // Nothing would take the pins low again
+        writeCode(0);
+        portEXIT_CRITICAL(&pulseLock);
+        return 0;
+    }
+    portEXIT_CRITICAL(&pulseLock);
+    sent++;
+    return edge;
+#else
+    (void)event;
+    return 0;
+#endif
+}
+
+void EventMarkers::endPulse(void *arg)
+{
+    EventMarkers *self = static_cast<EventMarkers *>(arg);
+
+    // An emit() since the expiry has armed the timer again for its own pulse
+    portENTER_CRITICAL(&self->pulseLock);
+    if (!esp_timer_is_active(self->timer))
+    {
+        self->writeCode(0);
+    }
+    portEXIT_CRITICAL(&self->pulseLock);
+}
+
+void EventMarkers::writeCode(uint8_t code)
+{
+#if defined(ESP32)
+    // One register write per level: the bits of a parallel code change together
+    uint32_t all = 0;
+    uint32_t high = 0;
+    for (int i = 0; i < MARKER_PIN_COUNT; i++)
+    {
+        all |= 1UL << markerPins[i];
+        if (code & (1 << i))
+        {
+            high |= 1UL << markerPins[i];
+        }
+    }
+    REG_WRITE(GPIO_OUT_W1TC_REG, all & ~high);
+    REG_WRITE(GPIO_OUT_W1TS_REG, high);
+#else
+    for (int i = 0; i < MARKER_PIN_COUNT; i++)
+    {
+        digitalWrite(markerPins[i], (code & (1 << i)) ? HIGH : LOW);
+    }
+#endif
+}
+
+void EventMarkers::printStatus() const
+{
+    if (!available())
+    {
+        Serial.println(F("Event markers are not available on this board"));
+        return;
+    }
+
+    Serial.print(F("Markers: "));
+    Serial.print(enabled ? F("on, ") : F("off, "));
+    Serial.print(widthMs);
+    Serial.print(F(" ms pulses on GPIO "));
+    for (int i = 0; i < MARKER_PIN_COUNT; i++)
+    {
+        if (i > 0)
+        {
+            Serial.print(',');
+        }
+        Serial.print(markerPins[i]);
+    }
+    Serial.println();
+    Serial.print(F("Codes: onset "));
+    Serial.print(codes[MARKER_ONSET]);
+    Serial.print(F(", target onset "));
+    Serial.print(codes[MARKER_TARGET_ONSET]);
+    Serial.print(F(", confirm "));
+    Serial.print(codes[MARKER_CONFIRM]);
+    Serial.print(F(", wrong "));
+    Serial.println(codes[MARKER_WRONG]);
+    Serial.print(F("Sent: "));
+    Serial.print(sent);
+    Serial.print(F(" ("));
+    Serial.print(replaced);
+    Serial.println(F(" replaced a pulse still high)"));
+}
@@ -0,0 +1,90 @@
+#ifndef EVENT_MARKERS_H
+#define EVENT_MARKERS_H
+
+#include <Arduino.h>
+
+#if defined(ESP32) || defined(NBACK_HOST)
+#include <esp_timer.h>
+#define EVENT_MARKERS_AVAILABLE
+#endif
+
+//==============================================================================
+// Event Markers
+//==============================================================================
+//
+// TTL marker outputs for EEG amplifiers and eye trackers, which cannot rely
+// on the serial timestamps and their USB latency. An event raises its code,
+// a bit mask over the MARKER_PIN_COUNT marker pins, and a one-shot hardware
+// timer takes the pins low again after the pulse width, so loop() never
+// waits for a pulse. Codes with one bit each give separate pulse lines, codes
+// with several bits a parallel code on the amplifier's trigger port.
+//
+// The task raises the stimulus onset marker right after the strip transfer
+// that shows the stimulus returns, and the response marker when it accepts a
+// press. A marker raised while the previous pulse is still high replaces it.
+// Boards without esp_timer have no markers.
+
+#define MARKER_PIN_COUNT 4
+#define MARKER_PINS {17, 18, 19, 23} // Code bit 0 first; all below GPIO 32
+#define MARKER_DEFAULT_WIDTH_MS 10
+#define MARKER_MAX_WIDTH_MS 100
+#define MARKER_MAX_CODE ((1 << MARKER_PIN_COUNT) - 1)
+
+enum MarkerEvent
+{
+    MARKER_ONSET,        // Stimulus on the strip, not an n-back target
+    MARKER_TARGET_ONSET, // Stimulus on the strip, an n-back target
+    MARKER_CONFIRM,      // Confirm response accepted
+    MARKER_WRONG,        // Wrong response accepted
+    MARKER_EVENT_COUNT
+};
+
+// Codes per MarkerEvent: onset on pin 1, targets also on pin 2, responses on
+// pins 3 and 4
+#define DEFAULT_MARKER_CODES {1, 3, 4, 8}
+
+class EventMarkers
+{
+public:
+    EventMarkers();
+
+    // The board can time marker pulses
+    static bool available();
+
+    // Marker pins as outputs, low
+    void begin();
+
+    void setEnabled(bool enabled);
+    bool isEnabled() const { return enabled; }
+
+    // Pulse width in ms (1 to MARKER_MAX_WIDTH_MS); false if out of range
+    bool setWidth(uint8_t widthMs);
+    uint8_t getWidth() const { return widthMs; }
+
+    // Code of an event (0 to MARKER_MAX_CODE, 0 = no marker)
+    void setCode(MarkerEvent event, uint8_t code);
+    uint8_t getCode(MarkerEvent event) const { return codes[event]; }
+
+    // Raise the event's code now; returns micros() at the rising edge, 0 if
+    // no marker was sent (off, code 0, or the timer could not be armed)
+    unsigned long emit(MarkerEvent event);
+
+    // The 'marker' command
+    void printStatus() const;
+
+private:
+    static void endPulse(void *arg);
+    void writeCode(uint8_t code);
+
+    bool enabled;
+    uint8_t widthMs;
+    uint8_t codes[MARKER_EVENT_COUNT];
+    uint32_t sent;
+    uint32_t replaced; // Raised while the previous pulse was still high
+#if defined(EVENT_MARKERS_AVAILABLE)
+    esp_timer_handle_t timer; // Ends the pulse
+    portMUX_TYPE pulseLock;   // emit() against endPulse() in the esp_timer task
+#endif
+};
+
+#endif // EVENT_MARKERS_H
@@ -0,0 +1,171 @@
+#include "idle_sleep.h"
+#include "nback_task.h"
+
+#if defined(ESP32) || defined(NBACK_HOST)
+#include <esp_sleep.h>
+#include <driver/gpio.h>
+#include <driver/uart.h>
+#define LIGHT_SLEEP_AVAILABLE
+#endif
+
+IdleSleep::IdleSleep()
+    : enabled(false),
+      lastActivityMs(0),
+      sleeps(0),
+      asleepUs(0),
+      timerLatencyUs(0),
+      maxTimerLatencyUs(0)
+{
+    memset(wakes, 0, sizeof(wakes));
+}
+
+bool IdleSleep::available()
+{
+#if defined(LIGHT_SLEEP_AVAILABLE)
+    return true;
+#else
+    return false;
+#endif
+}
+
+void IdleSleep::setEnabled(bool enabled)
+{
+    this->enabled = enabled && available();
+    lastActivityMs = millis();
+}
+
+void IdleSleep::noteActivity()
+{
+    lastActivityMs = millis();
+}
+
+unsigned long IdleSleep::sleep(unsigned long idleMs, bool touchInput, int correctThreshold, int wrongThreshold)
+{
+#if defined(LIGHT_SLEEP_AVAILABLE)
+    if (idleMs == 0)
+    {
+        // Busy (a session): the hold starts again when it ends, so the host
+        // can fetch the data without waking the board
+        lastActivityMs = millis();
+        return 0;
+    }
+    if (!enabled || idleMs < IDLE_SLEEP_MIN_MS || millis() - lastActivityMs < IDLE_SLEEP_HOLD_MS ||
+        Serial.available() > 0)
+    {
+        return 0;
+    }
+    if (idleMs > IDLE_SLEEP_MAX_MS)
+    {
+        idleMs = IDLE_SLEEP_MAX_MS;
+    }
+
+    // The UART stops in light sleep; output still in its FIFO would be cut
+    Serial.flush();
+
+    esp_sleep_disable_wakeup_source(ESP_SLEEP_WAKEUP_ALL);
+    esp_sleep_enable_timer_wakeup((uint64_t)idleMs * 1000);
+    uart_set_wakeup_threshold(UART_NUM_0, 3); // The edges of one newline
+    esp_sleep_enable_uart_wakeup(0);
+    if (touchInput)
+    {
+        touchSleepWakeUpEnable(TOUCH_CORRECT_PIN, correctThreshold);
+        touchSleepWakeUpEnable(TOUCH_WRONG_PIN, wrongThreshold);
+        esp_sleep_enable_touchpad_wakeup();
+    }
+    else
+    {
+        // Buttons pull their pins low
+        gpio_wakeup_enable((gpio_num_t)BUTTON_CORRECT_PIN, GPIO_INTR_LOW_LEVEL);
+        gpio_wakeup_enable((gpio_num_t)BUTTON_WRONG_PIN, GPIO_INTR_LOW_LEVEL);
+        esp_sleep_enable_gpio_wakeup();
+    }
+
+    unsigned long start = micros();
+    esp_light_sleep_start();
+    unsigned long slept = micros() - start;
+
+    sleeps++;
+    asleepUs += slept;
+    switch (esp_sleep_get_wakeup_cause())
+    {
+    case ESP_SLEEP_WAKEUP_UART:
+        // The host is talking: stay awake for the command that follows
+        wakes[WAKE_SERIAL]++;
+        lastActivityMs = millis();
+        break;
+    case ESP_SLEEP_WAKEUP_GPIO:
+    case ESP_SLEEP_WAKEUP_TOUCHPAD:
+        // The wake is level-triggered: no sleep while the press may still last
+        wakes[WAKE_INPUT]++;
+        lastActivityMs = millis();
+        break;
+    case ESP_SLEEP_WAKEUP_TIMER:
+    {
+        // Beyond the requested time is the wake latency
+        wakes[WAKE_TIMER]++;
+        uint32_t latency = slept > idleMs * 1000 ? slept - idleMs * 1000 : 0;
+        timerLatencyUs += latency;
+        maxTimerLatencyUs = max(maxTimerLatencyUs, latency);
+        break;
+    }
+    default:
+        wakes[WAKE_OTHER]++;
+        break;
+    }
+    return slept;
+#else
+    (void)idleMs;
+    (void)touchInput;
+    (void)correctThreshold;
+    (void)wrongThreshold;
+    return 0;
+#endif
+}
+
+void IdleSleep::printStats() const
+{
+    if (!available())
+    {
+        Serial.println(F("Idle sleep is not available on this board"));
+        return;
+    }
+
+    Serial.print(F("Idle sleep: "));
+    Serial.println(enabled ? F("on") : F("off"));
+    Serial.print(F("Sleeps: "));
+    Serial.print(sleeps);
+    Serial.print(F(" (serial "));
+    Serial.print(wakes[WAKE_SERIAL]);
+    Serial.print(F(", input "));
+    Serial.print(wakes[WAKE_INPUT]);
+    Serial.print(F(", timer "));
+    Serial.print(wakes[WAKE_TIMER]);
+    Serial.println(F(")"));
+
+    // millis() keeps counting through light sleep
+    uint32_t uptimeMs = millis();
+    uint32_t asleepMs = (uint32_t)(asleepUs / 1000);
+    Serial.print(F("Asleep: "));
+    Serial.print(asleepMs);
+    Serial.print(F(" of "));
+    Serial.print(uptimeMs);
+    Serial.print(F(" ms ("));
+    Serial.print(uptimeMs > 0 ? (uint32_t)((uint64_t)asleepMs * 100 / uptimeMs) : 0);
+    Serial.println(F("%)"));
+
+    Serial.print(F("Timer wake latency: "));
+    Serial.print(wakes[WAKE_TIMER] > 0 ? (uint32_t)(timerLatencyUs / wakes[WAKE_TIMER]) : 0);
+    Serial.print(F(" us average, "));
+    Serial.print(maxTimerLatencyUs);
+    Serial.println(F(" us max"));
+
+    // uA * ms / 3.6e6 = uAh
+    uint64_t awakeMs = uptimeMs > asleepMs ? uptimeMs - asleepMs : 0;
+    uint64_t charge = (awakeMs * IDLE_AWAKE_CURRENT_UA + (uint64_t)asleepMs * IDLE_SLEEP_CURRENT_UA) / 3600000;
+    uint64_t chargeAwake = (uint64_t)uptimeMs * IDLE_AWAKE_CURRENT_UA / 3600000;
+    Serial.print(F("Estimated charge: "));
+    Serial.print((uint32_t)charge);
+    Serial.print(F(" uAh ("));
+    Serial.print((uint32_t)chargeAwake);
+    Serial.println(F(" uAh without sleep)"));
+}
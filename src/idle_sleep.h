@@ -0,0 +1,74 @@
+#ifndef IDLE_SLEEP_H
+#define IDLE_SLEEP_H
+
+#include <Arduino.h>
+
+//==============================================================================
+// Idle Sleep
+//==============================================================================
+//
+// Light sleep while the task has nothing due, so units on battery packs do
+// not spin loop() at full power for hours between sessions. The CPU stops
+// until a byte on the serial line, a response pad or button, or the task's
+// next deadline wakes it; RAM, the LEDs and millis() carry on. The task only
+// reports idle time in the idle and data ready states, so a session never
+// sleeps.
+//
+// On the ESP32 the bytes that wake the UART are lost. The board therefore
+// stays awake for IDLE_SLEEP_HOLD_MS after a command or a session, and a
+// host that may find it asleep sends an empty line first. Off by default
+// ('sleep on'); boards without light sleep never sleep. 'power' reports the
+// time asleep, the wake latency measured on timer wakes and an estimate of
+// the charge used.
+
+#define IDLE_SLEEP_HOLD_MS 5000 // Awake after a command, a session or a wake-up by input
+#define IDLE_SLEEP_MIN_MS 3     // Shorter idle times are not worth a sleep
+#define IDLE_SLEEP_MAX_MS 1000  // Longest sleep; loop() and the watchdog run in between
+
+// Typical supply current of the ESP32 module, for the charge estimate
+#define IDLE_AWAKE_CURRENT_UA 40000
+#define IDLE_SLEEP_CURRENT_UA 800
+
+enum WakeCause
+{
+    WAKE_SERIAL, // Bytes on the UART
+    WAKE_INPUT,  // Response button or touch pad
+    WAKE_TIMER,  // The task's deadline or IDLE_SLEEP_MAX_MS
+    WAKE_OTHER,
+    WAKE_CAUSE_COUNT
+};
+
+class IdleSleep
+{
+public:
+    IdleSleep();
+
+    // The board supports light sleep
+    static bool available();
+
+    void setEnabled(bool enabled);
+    bool isEnabled() const { return enabled; }
+
+    // A command was received: stay awake for IDLE_SLEEP_HOLD_MS
+    void noteActivity();
+
+    // Sleep for up to `idleMs`, the time the task has nothing due (0 while
+    // busy), unless disabled, held awake or too short. Response input wakes it early:
+    // the buttons, or the touch pads below their thresholds. Returns the
+    // time asleep in us, 0 if it did not sleep.
+    unsigned long sleep(unsigned long idleMs, bool touchInput, int correctThreshold, int wrongThreshold);
+
+    // The 'power' command
+    void printStats() const;
+
+private:
+    bool enabled;
+    unsigned long lastActivityMs;
+    uint32_t sleeps;
+    uint32_t wakes[WAKE_CAUSE_COUNT];
+    uint64_t asleepUs;
+    uint64_t timerLatencyUs; // Sum over the timer wakes
+    uint32_t maxTimerLatencyUs;
+};
+
+#endif // IDLE_SLEEP_H
@@ -2,6 +2,10 @@
 #include "nback_task.h"
 #include "data_collector.h"
 #include "capacitive_touch_debugger.h"
+#include "settings_store.h"
+#include "watchdog.h"
+#include "idle_sleep.h"
+#include "command_queue.h"
 
 // Create an instance of the NBackTask class
 NBackTask nBackTask;
@@ -9,22 +13,69 @@ NBackTask nBackTask;
 // Create a capacitive touch debugger for both sensors
 CapacitiveTouchDebugger touchDebugger(TOUCH_CORRECT_PIN, TOUCH_WRONG_PIN, "Correct", "Wrong", TOUCH_THRESHOLD_CORRECT, TOUCH_THRESHOLD_WRONG);
 
+// Settings kept across power cycles, and the built-in defaults
+SettingsStore settingsStore;
+DeviceSettings defaultSettings;
+
+// Resets a hung loop() and keeps breadcrumbs of where it was
+Watchdog watchdog;
+
+// Light sleep between sessions
+IdleSleep idleSleep;
+
+// Command lines received and not yet run
+CommandQueue commandQueue;
+
 bool debugMode = false;
 void handleSerialInput();
+void loadSettings();
+void saveSettings();
+void printSettings();
 
 void setup()
 {
+  unsigned long bootStart = micros();
   Serial.begin(9600);
+  watchdog.begin();
+  unsigned long serialDone = micros();
 
-  // Wait for Serial connection
-  delay(1000);
+  // Initialize the task; the power-on LED test finishes in loop()
+  nBackTask.setup();
+  unsigned long taskDone = micros();
 
-  Serial.println(F("N-Back LED Button System"));
-  Serial.println(F("Enter 'debug_touch' for capacitive touch debugging"));
+  // Default configuration; its sequence is generated while the task runs
+  nBackTask.configure(2000, 2000, 1, 10, "TEST", 1, false);
+  unsigned long configDone = micros();
 
-  // Initialize the task
-  nBackTask.setup();
-  nBackTask.configure(2000, 2000, 1, 10, "TEST", 1, true);
+  // Stored settings replace the defaults
+  loadSettings();
+  unsigned long settingsDone = micros();
+
+  Serial.println(F("N-Back LED Button System (send 'help' for commands)"));
+  Serial.println(F("ready"));
+  unsigned long readyDone = micros();
+
+  // Boot phase timings, after 'ready' so they do not delay it
+  Serial.print(F("boot us: serial "));
+  Serial.print(serialDone - bootStart);
+  Serial.print(F(", task "));
+  Serial.print(taskDone - serialDone);
+  Serial.print(F(", config "));
+  Serial.print(configDone - taskDone);
+  Serial.print(F(", settings "));
+  Serial.print(settingsDone - configDone);
+  Serial.print(F(" ("));
+  Serial.print(SettingsStore::statusName(settingsStore.getStatus()));
+  Serial.print(F(")"));
+  Serial.print(F(", total "));
+  Serial.println(readyDone - bootStart);
+
+  if (watchdog.crashed())
+  {
+    Serial.print(F("Reset by "));
+    Serial.print(Watchdog::resetReasonName(watchdog.getResetReason()));
+    Serial.println(F(", send 'crashinfo' for the breadcrumbs"));
+  }
 
   // Uncomment to run task directly at startup
   /*
@@ -40,33 +91,242 @@ void loop()
   // Run the task loop if not in debug mode
   if (!debugMode)
   {
+    watchdog.enterPhase(PHASE_TASK);
     nBackTask.loop();
   }
+
+  // A complete pass: breadcrumbs, stalls, and the watchdog is fed
+  watchdog.setTaskState(nBackTask.getState(), nBackTask.getCurrentTrial());
+  LoopPhase stalledPhase;
+  uint32_t stallMs = watchdog.endPass(stalledPhase);
+  if (stallMs > 0)
+  {
+    nBackTask.reportStall(stallMs, Watchdog::phaseName(stalledPhase));
+  }
+
+  // Nothing due: sleep until input or the task's next deadline; the time
+  // asleep is not part of a loop pass
+  if (!debugMode)
+  {
+    unsigned long idleMs = commandQueue.pending() ? 0 : nBackTask.idleFor();
+    unsigned long sleptUs = idleSleep.sleep(idleMs, nBackTask.getInputMode() == CAPACITIVE_INPUT,
+                                            touchDebugger.getThreshold(0), touchDebugger.getThreshold(1));
+    watchdog.excludeFromPass(sleptUs);
+  }
 }
 
 void handleSerialInput()
 {
-  if (Serial.available() > 0)
+  // Lines are read as they arrive and run one per loop() pass
+  if (Serial.available() > 0 || commandQueue.pending())
   {
-    String command = Serial.readStringUntil('\n');
-    command.trim();
-    command.toLowerCase();
+    watchdog.enterPhase(PHASE_SERIAL_READ);
+    commandQueue.poll();
+  }
+
+  QueuedCommand queued;
+  if (commandQueue.next(queued))
+  {
+    const String &command = queued.text;
+    watchdog.noteCommand(command);
+    watchdog.enterPhase(PHASE_COMMAND);
+    idleSleep.noteActivity();
+    nBackTask.takeCommandError();
 
     Serial.print(F("Received command: "));
     Serial.println(command);
 
     bool commandProcessed = false;
 
-    commandProcessed = touchDebugger.processCommand(command);
-
-    if (!commandProcessed)
+    if (command == "debug_touch")
+    {
+      // Interactive sensor session; returns on its own 'exit' or 'q'
+      watchdog.suspend();
+      touchDebugger.runInteractiveMode();
+      watchdog.resume();
+      Serial.println(F("ready"));
+      commandProcessed = true;
+    }
+    else if (command == "crashinfo")
+    {
+      watchdog.printCrashInfo();
+      commandProcessed = true;
+    }
+    else if (command == "sleep on" || command == "sleep off")
     {
-      // Process command for NBackTask if not handled by touch debugger
+      idleSleep.setEnabled(command == "sleep on");
+      if (!IdleSleep::available())
+      {
+        Serial.println(F("Idle sleep is not available on this board"));
+        nBackTask.failCommand(F("not available"));
+      }
+      else
+      {
+        Serial.println(idleSleep.isEnabled() ? F("Idle sleep on") : F("Idle sleep off"));
+      }
+      commandProcessed = true;
+    }
+    else if (command == "power")
+    {
+      idleSleep.printStats();
+      commandProcessed = true;
+    }
+    else if (command == "settings")
+    {
+      printSettings();
+      commandProcessed = true;
+    }
+    else if (command == "settings reset")
+    {
+      // Back to the built-in defaults, also after the next power cycle
+      settingsStore.erase(defaultSettings);
+      nBackTask.applySettings(defaultSettings);
+      touchDebugger.setThreshold(0, defaultSettings.touchThresholds[0]);
+      touchDebugger.setThreshold(1, defaultSettings.touchThresholds[1]);
+      idleSleep.setEnabled(defaultSettings.idleSleep != 0);
+      Serial.println(F("Settings reset to defaults"));
+      commandProcessed = true;
+    }
+    else
+    {
+      // Task commands first: the touch debugger also answers to 'exit'
       commandProcessed = nBackTask.processSerialCommands(command);
     }
     if (!commandProcessed)
+    {
+      commandProcessed = touchDebugger.processCommand(command);
+    }
+    if (!commandProcessed)
     {
       Serial.println(F("Command not recognized."));
+      CommandQueue::sendNack(queued.id, F("unknown command"));
+      return;
+    }
+    saveSettings();
+
+    const __FlashStringHelper *error = nBackTask.takeCommandError();
+    if (error != nullptr)
+    {
+      CommandQueue::sendNack(queued.id, error);
     }
+    else
+    {
+      CommandQueue::sendDone(queued.id);
+    }
+  }
+}
+
+void loadSettings()
+{
+  // Everything not stored yet keeps its built-in value
+  nBackTask.setTouchThresholds(touchDebugger.getThreshold(0), touchDebugger.getThreshold(1));
+  nBackTask.exportSettings(defaultSettings);
+  defaultSettings.idleSleep = idleSleep.isEnabled();
+
+  DeviceSettings settings = defaultSettings;
+  if (settingsStore.load(settings) == SETTINGS_LOADED)
+  {
+    nBackTask.applySettings(settings);
+    touchDebugger.setThreshold(0, settings.touchThresholds[0]);
+    touchDebugger.setThreshold(1, settings.touchThresholds[1]);
+    idleSleep.setEnabled(settings.idleSleep != 0);
+  }
+}
+
+void saveSettings()
+{
+  // Thresholds are set and calibrated through the touch debugger
+  nBackTask.setTouchThresholds(touchDebugger.getThreshold(0), touchDebugger.getThreshold(1));
+
+  // Only written to NVS when a setting changed
+  DeviceSettings settings;
+  nBackTask.exportSettings(settings);
+  settings.idleSleep = idleSleep.isEnabled();
+  if (settingsStore.save(settings))
+  {
+    Serial.println(F("Settings saved"));
+  }
+}
+
+void printSettings()
+{
+  DeviceSettings settings;
+  nBackTask.exportSettings(settings);
+
+  Serial.print(F("Settings: "));
+  Serial.println(SettingsStore::statusName(settingsStore.getStatus()));
+  Serial.print(F("Config: "));
+  Serial.print(settings.stimulusDuration);
+  Serial.print(',');
+  Serial.print(settings.interStimulusInterval);
+  Serial.print(',');
+  Serial.print(settings.nBackLevel);
+  Serial.print(',');
+  Serial.print(settings.trialsNumber);
+  Serial.print(',');
+  Serial.print(settings.studyId);
+  Serial.print(',');
+  Serial.print(settings.sessionNumber);
+  if (settings.sequenceId != 0)
+  {
+    Serial.print(F(",#"));
+    Serial.print(settings.sequenceId);
+  }
+  Serial.println();
+  Serial.print(F("Touch thresholds: "));
+  Serial.print(settings.touchThresholds[0]);
+  Serial.print(',');
+  Serial.println(settings.touchThresholds[1]);
+  Serial.print(F("Debounce: "));
+  Serial.print(settings.debounceMs[0]);
+  Serial.print(',');
+  Serial.print(settings.debounceMs[1]);
+  Serial.println(F(" ms"));
+  Serial.print(F("Palette:"));
+  for (int i = 0; i < SETTINGS_PALETTE_SIZE; i++)
+  {
+    Serial.print(' ');
+    Serial.print(settings.palette[i], HEX);
+  }
+  Serial.println();
+  Serial.print(F("Validation bounds: "));
+  Serial.print(settings.validationBounds.minTargetPercent);
+  Serial.print(',');
+  Serial.print(settings.validationBounds.maxTargetPercent);
+  Serial.print(',');
+  Serial.print(settings.validationBounds.maxLurePercent);
+  Serial.print(',');
+  Serial.print(settings.validationBounds.maxColorPercent);
+  Serial.print(',');
+  Serial.print(settings.validationBounds.maxRun);
+  Serial.println(settings.validationStrict ? F(" (strict)") : F(""));
+  Serial.print(F("Idle sleep: "));
+  Serial.println(idleSleep.isEnabled() ? F("on") : F("off"));
+  Serial.print(F("Markers: "));
+  Serial.print(settings.markers ? F("on, ") : F("off, "));
+  Serial.print(settings.markerWidthMs);
+  Serial.print(F(" ms, codes "));
+  for (int i = 0; i < SETTINGS_MARKER_CODES; i++)
+  {
+    if (i > 0)
+    {
+      Serial.print(',');
+    }
+    Serial.print(settings.markerCodes[i]);
+  }
+  Serial.println();
+  Serial.print(F("Trigger: "));
+  Serial.println(TriggerInput::modeName((TriggerMode)settings.triggerMode));
+  Serial.print(F("Response window: "));
+  if (settings.responseWindowMs == SELF_PACED_WINDOW)
+  {
+    Serial.println(F("self-paced"));
+  }
+  else
+  {
+    Serial.print(settings.responseWindowMs);
+    Serial.println(F(" ms"));
   }
+  Serial.print(F("Data stream: "));
+  Serial.println(settings.dataStream ? F("on") : F("off"));
 }
\ No newline at end of file
@@ -0,0 +1,96 @@
+#include "memory_monitor.h"
+
+#if defined(ESP32) || defined(NBACK_HOST)
+#include <esp_heap_caps.h>
+#define MEMORY_FIGURES_AVAILABLE
+#endif
+
+MemoryMonitor::MemoryMonitor() : peakValid(false)
+{
+    memset(&last, 0, sizeof(last));
+    memset(&peak, 0, sizeof(peak));
+}
+
+bool MemoryMonitor::available()
+{
+#if defined(MEMORY_FIGURES_AVAILABLE)
+    return true;
+#else
+    return false;
+#endif
+}
+
+const MemoryStats &MemoryMonitor::sample()
+{
+#if defined(MEMORY_FIGURES_AVAILABLE)
+    // The 8-bit capable heap is the one new[] and String allocate from;
+    // largest_free_block walks the free list, tens of microseconds
+    last.freeHeap = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    last.largestBlock = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+    last.minFreeHeap = heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT);
+    last.stackFree = uxTaskGetStackHighWaterMark(NULL); // Bytes on the ESP32
+#endif
+
+    if (!peakValid)
+    {
+        peak = last;
+        peakValid = true;
+    }
+    else
+    {
+        peak.freeHeap = min(peak.freeHeap, last.freeHeap);
+        peak.largestBlock = min(peak.largestBlock, last.largestBlock);
+        peak.minFreeHeap = min(peak.minFreeHeap, last.minFreeHeap);
+        peak.stackFree = min(peak.stackFree, last.stackFree);
+    }
+    return last;
+}
+
+void MemoryMonitor::resetPeak()
+{
+    peakValid = false;
+    sample();
+}
+
+uint8_t MemoryMonitor::largestBlockPercent(const MemoryStats &stats)
+{
+    if (stats.freeHeap == 0)
+    {
+        return 0;
+    }
+    return (uint8_t)min((uint64_t)stats.largestBlock * 100 / stats.freeHeap, (uint64_t)100);
+}
+
+String MemoryMonitor::format(const MemoryStats &stats)
+{
+    char text[96];
+    snprintf(text, sizeof(text), "free_heap:%lu,largest_block:%lu,min_free_heap:%lu,stack_free:%lu",
+             (unsigned long)stats.freeHeap, (unsigned long)stats.largestBlock,
+             (unsigned long)stats.minFreeHeap, (unsigned long)stats.stackFree);
+    return String(text);
+}
+
+void MemoryMonitor::print()
+{
+    if (!available())
+    {
+        Serial.println(F("Memory figures are not available on this board"));
+        return;
+    }
+
+    sample();
+    Serial.print(F("Free heap: "));
+    Serial.print(last.freeHeap);
+    Serial.println(F(" bytes"));
+    Serial.print(F("Largest free block: "));
+    Serial.print(last.largestBlock);
+    Serial.print(F(" bytes ("));
+    Serial.print(largestBlockPercent(last));
+    Serial.println(F("% of the free heap)"));
+    Serial.print(F("Lowest free heap since boot: "));
+    Serial.print(last.minFreeHeap);
+    Serial.println(F(" bytes"));
+    Serial.print(F("Loop stack never used: "));
+    Serial.print(last.stackFree);
+    Serial.println(F(" bytes"));
+}
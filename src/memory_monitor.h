@@ -0,0 +1,62 @@
+#ifndef MEMORY_MONITOR_H
+#define MEMORY_MONITOR_H
+
+#include <Arduino.h>
+
+//==============================================================================
+// Memory Monitor
+//==============================================================================
+//
+// Free heap, largest free heap block, lowest free heap since boot and the
+// loop task's stack high-water mark (the least free stack it has had). The
+// sequence buffer is allocated per config and String is used throughout, so
+// the heap matters more than the static RAM figures. The ESP32 heap spans
+// several regions, so the largest block is always well below the free heap;
+// a largest block that shrinks while the free heap does not is fragmentation.
+// sample() keeps the lowest of each figure since resetPeak(), which a session
+// calls at its start, so the session summary shows the session's peak usage.
+// On the ESP32 the figures come from heap_caps and FreeRTOS, in the host
+// builds from the emulated board; other boards report nothing.
+
+#define MEMORY_TELEMETRY_INTERVAL_MS 30000 // Default period of the `memory` events of a session
+
+struct MemoryStats
+{
+    uint32_t freeHeap;     // Free heap now (bytes)
+    uint32_t largestBlock; // Largest free heap block now (bytes)
+    uint32_t minFreeHeap;  // Lowest free heap since boot (bytes)
+    uint32_t stackFree;    // Least free loop task stack so far (bytes)
+};
+
+class MemoryMonitor
+{
+public:
+    MemoryMonitor();
+
+    // The board reports memory figures
+    static bool available();
+
+    // Read the figures and fold them into the peak
+    const MemoryStats &sample();
+    const MemoryStats &getLast() const { return last; }
+
+    // Lowest of each figure sampled since resetPeak()
+    void resetPeak();
+    const MemoryStats &getPeak() const { return peak; }
+
+    // Share of the free heap in the largest block (0-100)
+    static uint8_t largestBlockPercent(const MemoryStats &stats);
+
+    // "free_heap:N,largest_block:N,min_free_heap:N,stack_free:N"
+    static String format(const MemoryStats &stats);
+
+    // The 'mem' command
+    void print();
+
+private:
+    MemoryStats last;
+    MemoryStats peak;
+    bool peakValid;
+};
+
+#endif // MEMORY_MONITOR_H
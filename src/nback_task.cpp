@@ -1,4 +1,6 @@
 #include "nback_task.h"
+#include "trace.h"
+#include "trial_outcome.h"
 
 //==============================================================================
 // Constructor & Destructor
@@ -11,17 +13,34 @@ NBackTask::NBackTask()
       state(STATE_IDLE),
       currentTrial(0),
       trialStartTime(0),
+      trialStartUs(0),
+      onsetMarkerPending(false),
+      stimulusShownUs(0),
+      awaitingTrigger(false),
       stimulusEndTime(0),
       feedbackStartTime(0),
       debugColorIndex(0),
       lastColorChangeTime(0),
       inputMode(INPUT_MODE),
       colorSequence(nullptr),
-      study_id("DEFAULT")
+      streamedSequence(false),
+      sequenceSeed(0),
+      librarySequenceId(0),
+      validationBounds(DEFAULT_SEQUENCE_BOUNDS),
+      validationStrict(false),
+      validationFailures(0),
+      memoryTelemetryInterval(MEMORY_TELEMETRY_INTERVAL_MS),
+      lastMemoryTelemetry(0),
+      powerOnTestStart(0),
+      powerOnTestActive(false),
+      study_id("DEFAULT"),
+      verboseLogging(true),
+      commandError(nullptr)
 {
     // Initialize timing parameters (in milliseconds)
     timing.stimulusDuration = 2000;      // How long each stimulus is shown
     timing.interStimulusInterval = 2000; // Time between stimuli
+    timing.responseWindow = SELF_PACED_WINDOW; // The stimulus stays until the response
     timing.feedbackDuration = 100;       // Duration of button press feedback
     timing.debugColorDuration = 1000;    // How long each color shows in debug mode
 
@@ -93,40 +112,71 @@ void NBackTask::setup()
     pixels.begin();
     pixels.setBrightness(255);
 
-    // Initial power-on test
+    // Power-on test: white until POWER_ON_TEST_DURATION has passed (see loop())
     setNeoPixelColor(WHITE);
-    delay(1000);
-    pixels.clear();
-    pixels.show();
+    powerOnTestStart = millis();
+    powerOnTestActive = true;
 
     // Initialize input system based on current mode
     initializeInput();
 
-    // Initialize serial communication
-    Serial.begin(9600);
+    // Marker pins low until the first event
+    markers.begin();
 
-    // Print welcome message and command list
+    // Memory for a custom or library sequence; configure() chooses the
+    // sequence
+    colorSequence = new int[maxTrials]();
+}
+
+void NBackTask::printCommands()
+{
     Serial.println(F("N-Back Task"));
     Serial.println(F("Commands:"));
     Serial.println(F("- 'debug' to enter debug mode and test hardware"));
     Serial.println(F("- 'exit-debug' to exit debug mode"));
     Serial.println(F("- 'start' to begin task"));
     Serial.println(F("- 'pause' to pause/resume task"));
+    Serial.println(F("- 'stop' to end the current task early and keep its data"));
     Serial.println(F("- 'exit' to cancel the current task and discard data"));
-    Serial.println(F("- 'get_data' to retrieve collected data"));
-    Serial.println(F("- 'config stimDur,interStimInt,nBackLvl,trials,studyId,sessionNum' to configure all parameters"));
-    Serial.println(F("- 'input_mode 0|1' to set input mode (0=button, 1=touch)"));
-    Serial.println(F("ready"));
-
-    // Allocate memory for color sequence
-    colorSequence = new int[maxTrials];
-
-    // Generate initial random sequence
-    generateSequence();
+    Serial.println(F("- 'get_data' to retrieve the data of the last completed task"));
+    Serial.println(F("- 'config stimDur,interStimInt,nBackLvl,trials,studyId,sessionNum' to configure all parameters (trials 0 = until 'stop')"));
+    Serial.println(F("- 'input_mode' to forward button/touch presses to the host"));
+    Serial.println(F("- 'verbose on|off' to show/hide per-trial progress messages"));
+    Serial.println(F("- 'sequences' to list the sequences in flash (config ...,sessionNum,#id uses one)"));
+    Serial.println(F("- 'validate' to check the sequence, 'validate strict on|off', 'validate bounds minT,maxT,maxLure,maxColor,maxRun'"));
+    Serial.println(F("- 'settings' to show the stored settings, 'settings reset' to restore the defaults"));
+    Serial.println(F("- 'debug_touch' for capacitive touch debugging"));
+    Serial.println(F("- 'crashinfo' to show why the board last reset and where it was"));
+    Serial.println(F("- 'mem' to show heap and stack usage, 'mem every seconds' to set the session memory events (0 = off)"));
+    Serial.println(F("- 'sleep on|off' to sleep while idle, 'power' for the time asleep and wake latency"));
+    Serial.println(F("- 'marker' to show the TTL event markers, 'marker on|off', 'marker width ms', 'marker codes onset,target,confirm,wrong', 'marker test'"));
+    Serial.println(F("- 'trigger' to show the trigger input, 'trigger off|start|pace' to start or pace the trials on external pulses"));
+    Serial.println(F("- 'perf' to show the deferred work queue of the last session: jobs, queue depth and slack before each onset"));
+    Serial.println(F("- 'window' to show the response window, 'window ms' to time the trials and accept responses until ms after onset, 'window off' for self-paced trials"));
+    Serial.println(F("- 'stream' to show the data stream, 'stream on|off' to send each task's data in the background as the next one runs"));
+    Serial.println(F("- '@id command' to run any command with a request ID: ack id, then done id or nack id reason"));
 }
 
 void NBackTask::loop()
 {
+    // End the power-on test; any state that drives the LEDs ends it early
+    if (powerOnTestActive &&
+        (state != STATE_IDLE || millis() - powerOnTestStart >= POWER_ON_TEST_DURATION))
+    {
+        powerOnTestActive = false;
+        if (state == STATE_IDLE)
+        {
+            pixels.clear();
+            pixels.show();
+        }
+    }
+
+    // A session that stopped, paused or was cancelled finishes its trial's
+    // jobs at once
+    if (state != STATE_RUNNING)
+    {
+        deferredWork.drain();
+    }
 
     // Handle tasks based on current state
     switch (state)
@@ -137,17 +187,40 @@ void NBackTask::loop()
         break;
 
     case STATE_PAUSED:
-        // When paused, do nothing until resumed
+        // When paused, do nothing until resumed but send the previous block's data
         renderPixels();
+        dataCollector.streamNext();
         break;
 
     case STATE_RUNNING:
+        // Waiting for a trigger pulse the strip is dark and no response
+        // counts: the pass is the busy-wait, so that a pulse rarely falls
+        // outside it
+        if (awaitingTrigger)
+        {
+            manageTrials();
+            break;
+        }
+
         // Handle ongoing task
         renderPixels();
 
         // Check if visual feedback needs to be ended
         handleVisualFeedback(false);
 
+        // The completed trial's output, as the slack before the next onset
+        // allows; from the pass after its completion, once the strip shows
+        // the interval
+        deferredWork.runSlack();
+
+        // The previous block's data, a line at a time in what the interval
+        // leaves once the trial's own output is done
+        if (flags.inInterStimulusInterval && !flags.awaitingResponse && !flags.feedbackActive &&
+            deferredWork.depth() == 0)
+        {
+            dataCollector.streamNext(stimulusEndTime + timing.interStimulusInterval);
+        }
+
         // If not in feedback, manage trial progression
         if (!flags.feedbackActive)
         {
@@ -165,11 +238,126 @@ void NBackTask::loop()
 
     case STATE_IDLE:
     case STATE_DATA_READY:
-        // Nothing to do in idle or data ready states
+        // Nothing to do in idle or data ready states but send the last
+        // block's data, a line per pass
+        dataCollector.streamNext();
         break;
     }
 }
 
+unsigned long NBackTask::idleFor() const
+{
+    // Every other state polls inputs or runs timers on each pass
+    if (state != STATE_IDLE && state != STATE_DATA_READY)
+    {
+        return 0;
+    }
+    if (dataCollector.streamPending())
+    {
+        return 0; // A line per pass
+    }
+    if (powerOnTestActive)
+    {
+        unsigned long elapsed = millis() - powerOnTestStart;
+        return elapsed >= POWER_ON_TEST_DURATION ? 0 : POWER_ON_TEST_DURATION - elapsed;
+    }
+    return ~0UL; // Nothing due
+}
+
+//==============================================================================
+// Persistent Settings
+//==============================================================================
+
+static_assert(SETTINGS_PALETTE_SIZE == COLOR_COUNT, "stored palette must cover every color");
+static_assert(SETTINGS_MARKER_CODES == MARKER_EVENT_COUNT, "stored marker codes must cover every event");
+
+void NBackTask::exportSettings(DeviceSettings &settings) const
+{
+    memset(&settings, 0, sizeof(settings));
+    settings.stimulusDuration = timing.stimulusDuration;
+    settings.interStimulusInterval = timing.interStimulusInterval;
+    settings.nBackLevel = nBackLevel;
+    settings.trialsNumber = maxTrials;
+    settings.sessionNumber = dataCollector.getSessionNumber();
+    settings.sequenceId = librarySequenceId;
+    strncpy(settings.studyId, study_id.c_str(), SETTINGS_STUDY_ID_SIZE - 1);
+
+    for (int i = 0; i < COLOR_COUNT; i++)
+    {
+        settings.palette[i] = colors[i];
+    }
+    settings.touchThresholds[0] = touchCorrect.threshold;
+    settings.touchThresholds[1] = touchWrong.threshold;
+    settings.debounceMs[0] = buttonCorrect.debounceDelay;
+    settings.debounceMs[1] = buttonWrong.debounceDelay;
+    settings.validationBounds = validationBounds;
+    settings.validationStrict = validationStrict;
+    settings.markers = markers.isEnabled();
+    settings.markerWidthMs = markers.getWidth();
+    for (int i = 0; i < MARKER_EVENT_COUNT; i++)
+    {
+        settings.markerCodes[i] = markers.getCode((MarkerEvent)i);
+    }
+    settings.triggerMode = trigger.getMode();
+    settings.responseWindowMs = timing.responseWindow;
+    settings.dataStream = dataCollector.isStreaming();
+}
+
+bool NBackTask::applySettings(const DeviceSettings &settings)
+{
+    for (int i = 0; i < COLOR_COUNT; i++)
+    {
+        colors[i] = settings.palette[i];
+    }
+    setTouchThresholds(settings.touchThresholds[0], settings.touchThresholds[1]);
+    buttonCorrect.debounceDelay = settings.debounceMs[0];
+    buttonWrong.debounceDelay = settings.debounceMs[1];
+    validationBounds = settings.validationBounds;
+    validationStrict = settings.validationStrict != 0;
+    markers.setEnabled(settings.markers != 0);
+    if (!markers.setWidth(settings.markerWidthMs))
+    {
+        markers.setWidth(MARKER_DEFAULT_WIDTH_MS);
+    }
+    for (int i = 0; i < MARKER_EVENT_COUNT; i++)
+    {
+        markers.setCode((MarkerEvent)i, settings.markerCodes[i]);
+    }
+    if (TriggerInput::available() && settings.triggerMode <= TRIGGER_PACE)
+    {
+        trigger.setMode((TriggerMode)settings.triggerMode);
+    }
+    if (settings.responseWindowMs == SELF_PACED_WINDOW ||
+        (settings.responseWindowMs >= MIN_RESPONSE_WINDOW && settings.responseWindowMs <= MAX_RESPONSE_WINDOW))
+    {
+        timing.responseWindow = settings.responseWindowMs;
+    }
+    dataCollector.setStreaming(settings.dataStream != 0);
+
+    if (!configure(settings.stimulusDuration, settings.interStimulusInterval, settings.nBackLevel,
+                   settings.trialsNumber, String(settings.studyId), settings.sessionNumber, false))
+    {
+        return false;
+    }
+
+    // The library sequence, if it still matches (otherwise start generates one)
+    SequenceEntry entry;
+    if (settings.sequenceId != 0 && findSequence(settings.sequenceId, entry) &&
+        entry.nBackLevel == nBackLevel && entry.length == maxTrials && loadSequence(entry, colorSequence))
+    {
+        librarySequenceId = entry.id;
+        streamedSequence = false;
+        validateSequence();
+    }
+    return true;
+}
+
+void NBackTask::setTouchThresholds(int correct, int wrong)
+{
+    touchCorrect.threshold = correct;
+    touchWrong.threshold = wrong;
+}
+
 //==============================================================================
 // Command Processing
 //==============================================================================
@@ -224,11 +412,23 @@ bool NBackTask::processSerialCommands(const String &command)
         }
         return true;
     }
+    else if (command == "stop")
+    {
+        // End the session after the trials so far; unlike 'exit' the data is kept
+        if (state == STATE_RUNNING || state == STATE_PAUSED)
+        {
+            endTask();
+        }
+        return true;
+    }
     else if (command == "exit")
     {
         // Cancel the current study or exit input mode
         if (state == STATE_RUNNING || state == STATE_PAUSED)
         {
+            // A trial that completed in the interval still owes its output
+            deferredWork.drain();
+
             state = STATE_IDLE;
             pixels.clear();
             pixels.show();
@@ -238,6 +438,7 @@ bool NBackTask::processSerialCommands(const String &command)
         else if (state == STATE_DATA_READY)
         {
             state = STATE_IDLE;
+            dataCollector.discard();
             Serial.println(F("exiting"));
             Serial.println(F("ready"));
         }
@@ -249,14 +450,16 @@ bool NBackTask::processSerialCommands(const String &command)
     }
     else if (command == "get_data")
     {
-        // Send collected data over serial if available
-        if (state == STATE_DATA_READY)
+        // Send the last completed block if available, also once the next
+        // one is configured
+        if ((state == STATE_DATA_READY || state == STATE_IDLE) && dataCollector.hasData())
         {
             sendData();
         }
         else
         {
             Serial.println(F("No data available. Run task first."));
+            failCommand(F("no data"));
         }
         return true;
     }
@@ -276,10 +479,69 @@ bool NBackTask::processSerialCommands(const String &command)
         sendTimeSyncToMaster();
         return true;
     }
+    else if (command == "sequences")
+    {
+        printSequenceLibrary();
+        return true;
+    }
+    else if (command == "validate" || command.startsWith("validate "))
+    {
+        processValidateCommand(command);
+        return true;
+    }
+    else if (command == "mem" || command.startsWith("mem "))
+    {
+        processMemCommand(command);
+        return true;
+    }
+    else if (command == "marker" || command.startsWith("marker "))
+    {
+        processMarkerCommand(command);
+        return true;
+    }
+    else if (command == "trigger" || command.startsWith("trigger "))
+    {
+        processTriggerCommand(command);
+        return true;
+    }
+    else if (command == "window" || command.startsWith("window "))
+    {
+        processWindowCommand(command);
+        return true;
+    }
+    else if (command == "perf")
+    {
+        deferredWork.printStats();
+        return true;
+    }
+    else if (command == "stream" || command.startsWith("stream "))
+    {
+        processStreamCommand(command);
+        return true;
+    }
+    else if (command == "help")
+    {
+        printCommands();
+        return true;
+    }
+    else if (command == "verbose on" || command == "verbose off")
+    {
+        // Human-readable trial progress; protocol lines are always sent
+        verboseLogging = (command == "verbose on");
+        Serial.println(verboseLogging ? F("Verbose logging on") : F("Verbose logging off"));
+        return true;
+    }
 
     return false; // Command not recognized
 }
 
+const __FlashStringHelper *NBackTask::takeCommandError()
+{
+    const __FlashStringHelper *error = commandError;
+    commandError = nullptr;
+    return error;
+}
+
 void NBackTask::processConfigCommand(const String &command)
 {
     // `config ${config.stimDuration},${config.interStimulusInterval},${config.nBackLevel},${config.trialsNumber},${config.studyId},${config.sessionNumber},%${sequenceStr}%`;
@@ -336,30 +598,191 @@ void NBackTask::processConfigCommand(const String &command)
         }
     }
 
+    // Or a sequence from the flash library (format: #id)
+    uint16_t libraryId = 0;
+    if (!hasCustomSequence && startPos < (int)configStr.length() && configStr.charAt(startPos) == '#')
+    {
+        libraryId = configStr.substring(startPos + 1).toInt();
+    }
+
+    // Or a packed sequence (format: $base32, see sequence_codec.h)
+    bool hasPackedSequence = false;
+    PackedSequence packed;
+    PackedStatus packedStatus = PACKED_OK;
+    uint16_t packedPosition = 0;
+    size_t packedChars = 0;
+    if (!hasCustomSequence && startPos < (int)configStr.length() && configStr.charAt(startPos) == '$')
+    {
+        const char *packedText = configStr.c_str() + startPos + 1;
+        packedChars = configStr.length() - startPos - 1;
+        packedStatus = decodePackedSequence(packedText, packedChars, COLORS_USED, packed, packedPosition);
+        hasPackedSequence = true;
+    }
+
     // Apply configuration if all 6 parameters were found
     if (paramIndex == 6)
     {
-        if (configure(params[0], params[1], params[2], params[3], studyId, sessionNum, false))
+        // A library sequence must have been built for this level and length
+        SequenceEntry entry;
+        if (libraryId != 0 && !findSequence(libraryId, entry))
+        {
+            Serial.print(F("Unknown sequence #"));
+            Serial.println(libraryId);
+            failCommand(F("invalid sequence"));
+        }
+        else if (libraryId != 0 && (entry.nBackLevel != params[2] || entry.length != params[3]))
+        {
+            Serial.print(F("Sequence #"));
+            Serial.print(libraryId);
+            Serial.print(F(" is for "));
+            Serial.print(entry.nBackLevel);
+            Serial.print(F("-back with "));
+            Serial.print(entry.length);
+            Serial.println(F(" trials"));
+            failCommand(F("invalid sequence"));
+        }
+        else if (hasPackedSequence && packedStatus != PACKED_OK)
+        {
+            printPackedSequenceError(packedStatus, packedPosition, packedChars);
+            failCommand(F("invalid sequence"));
+        }
+        else if (hasPackedSequence && packed.length != params[3])
+        {
+            Serial.print(F("Packed sequence has "));
+            Serial.print(packed.length);
+            Serial.print(F(" trials, but "));
+            Serial.print(params[3]);
+            Serial.println(F(" are configured"));
+            failCommand(F("invalid sequence"));
+        }
+        else if (configure(params[0], params[1], params[2], params[3], studyId, sessionNum, true))
         {
             Serial.println(F("Configuration applied successfully"));
 
-            // Apply custom sequence if provided
+            // Apply custom sequence if provided; otherwise start generates one
             if (hasCustomSequence && colorSequence != nullptr)
             {
                 parseAndSetColorSequence(sequenceStr);
+                streamedSequence = false;
             }
+            else if (hasCustomSequence)
+            {
+                Serial.println(F("!!!Warning: Continuous sessions generate their sequence, the custom one is ignored.!!!"));
+            }
+            else if (libraryId != 0)
+            {
+                applyLibrarySequence(entry);
+            }
+            else if (hasPackedSequence)
+            {
+                // Checked in full above, so it fills the buffer as it is
+                for (int i = 0; i < maxTrials; i++)
+                {
+                    colorSequence[i] = packedColor(packed, i);
+                }
+                streamedSequence = false;
+                Serial.print(F("Packed color sequence applied ("));
+                Serial.print(maxTrials);
+                Serial.println(F(" trials)"));
+            }
+
+            // configure() checked the generated sequence it chose
+            if (!streamedSequence)
+            {
+                validateSequence();
+            }
+            printValidationWarning();
         }
         else
         {
             Serial.println(F("Failed to apply configuration - invalid parameters"));
+            failCommand(F("invalid parameters"));
         }
     }
     else
     {
-        Serial.println(F("Invalid config format. Use: config stimDuration,interStimulusInterval,nBackLevel,trialsNumber,study_id,session_number[,%color1,color2,...%]"));
+        Serial.println(F("Invalid config format. Use: config stimDuration,interStimulusInterval,nBackLevel,trialsNumber,study_id,session_number[,%color1,color2,...%|,#sequenceId|,$packed]"));
+        failCommand(F("invalid format"));
+    }
+}
+
+void NBackTask::printPackedSequenceError(PackedStatus status, uint16_t position, size_t chars)
+{
+    // The configuration is not changed
+    Serial.print(F("Packed sequence rejected: "));
+    switch (status)
+    {
+    case PACKED_BAD_CHARACTER:
+        Serial.print(F("invalid character at position "));
+        Serial.println(position);
+        break;
+    case PACKED_BAD_LENGTH:
+        Serial.print(chars);
+        if (position == 0)
+        {
+            Serial.println(F(" characters, no valid length"));
+            break;
+        }
+        Serial.print(F(" characters, expected "));
+        Serial.println(position);
+        break;
+    case PACKED_BAD_CRC:
+        Serial.println(F("checksum mismatch"));
+        break;
+    case PACKED_BAD_COLOR:
+        Serial.print(F("invalid color at trial "));
+        Serial.println(position);
+        break;
+    default:
+        Serial.println();
+        break;
     }
 }
 
+void NBackTask::printSequenceLibrary()
+{
+    uint16_t count = sequenceLibraryCount();
+    Serial.print(count);
+    Serial.println(F(" sequences in flash:"));
+    for (uint16_t id = 1; id <= count; id++)
+    {
+        SequenceEntry entry;
+        if (!findSequence(id, entry))
+        {
+            continue;
+        }
+        Serial.print('#');
+        Serial.print(entry.id);
+        Serial.print(F(": "));
+        Serial.print(entry.nBackLevel);
+        Serial.print(F("-back, "));
+        Serial.print(entry.length);
+        Serial.print(F(" trials, "));
+        Serial.print(entry.targets);
+        Serial.println(F(" targets"));
+    }
+}
+
+void NBackTask::applyLibrarySequence(const SequenceEntry &entry)
+{
+    if (!loadSequence(entry, colorSequence))
+    {
+        // Damaged flash: fall back to a generated sequence at start
+        Serial.print(F("!!!Warning: Sequence #"));
+        Serial.print(entry.id);
+        Serial.println(F(" failed its checksum, a random sequence will be generated.!!!"));
+        return;
+    }
+    librarySequenceId = entry.id;
+    streamedSequence = false;
+
+    Serial.print(F("Sequence #"));
+    Serial.print(entry.id);
+    Serial.print(F(" applied ("));
+    Serial.print(entry.targets);
+    Serial.println(F(" targets)"));
+}
+
 void NBackTask::sendData()
 {
     Serial.print(F("Sending data for "));
@@ -373,6 +796,19 @@ void NBackTask::sendData()
     Serial.println(F("data-completed"));
 }
 
+void NBackTask::reportStall(uint32_t durationMs, const __FlashStringHelper *phase)
+{
+    if (state == STATE_RUNNING || state == STATE_PAUSED)
+    {
+        dataCollector.sendTimestampedEvent("stall", "duration_ms:" + String(durationMs) + ",phase:" + String(phase));
+        return;
+    }
+    Serial.print(F("Stall: "));
+    Serial.print(durationMs);
+    Serial.print(F(" ms in "));
+    Serial.println(phase);
+}
+
 void NBackTask::sendTimeSyncToMaster()
 {
     // Send time sync message to master device
@@ -386,6 +822,13 @@ void NBackTask::sendTimeSyncToMaster()
 
 void NBackTask::startTask()
 {
+    if (validationStrict && validationFailures != 0)
+    {
+        Serial.println(F("Start refused: the sequence failed validation (see 'validate')"));
+        failCommand(F("validation failed"));
+        return;
+    }
+
     sendTimeSyncToMaster();
 
     // Reset performance metrics for the new task
@@ -398,16 +841,55 @@ void NBackTask::startTask()
     flags.feedbackActive = false;
     flags.inInterStimulusInterval = false;
 
+    // A generated sequence is repeated from its seed until the next config
+    if (streamedSequence)
+    {
+        beginGeneratedSequence();
+    }
+
     // Reset data collector for a new session
     dataCollector.reset();
 
     // Send real-time start event with configuration data
-    char configData[100];
+    char configData[160];
     snprintf(configData, sizeof(configData),
              "n-back_level:%d,stim_duration:%d,inter_stim_interval:%d,trials:%d",
              nBackLevel, timing.stimulusDuration, timing.interStimulusInterval, maxTrials);
+    if (librarySequenceId != 0)
+    {
+        // Which library sequence the session used
+        size_t used = strlen(configData);
+        snprintf(configData + used, sizeof(configData) - used, ",sequence:%u", librarySequenceId);
+    }
+    else if (streamedSequence)
+    {
+        // Enough to regenerate the sequence offline (nback-seqgen --stream)
+        size_t used = strlen(configData);
+        snprintf(configData + used, sizeof(configData) - used, ",seed:%lu,generator:%d",
+                 (unsigned long)sequenceSeed, SEQUENCE_GENERATOR_VERSION);
+    }
+    size_t used = strlen(configData);
+    if (timing.responseWindow != SELF_PACED_WINDOW)
+    {
+        // Timed trials; self-paced sessions leave it out
+        snprintf(configData + used, sizeof(configData) - used, ",response_window:%lu", responseWindowLength());
+        used = strlen(configData);
+    }
+    snprintf(configData + used, sizeof(configData) - used, ",validation:");
+    used = strlen(configData);
+    SequenceValidator::formatFailures(validationFailures, configData + used, sizeof(configData) - used);
     dataCollector.sendTimestampedEvent("start", configData);
 
+    // The session's memory peak starts here; the first `memory` event follows
+    // the first trial, in its inter-stimulus interval rather than before onset
+    memoryMonitor.resetPeak();
+    lastMemoryTelemetry = millis() - memoryTelemetryInterval;
+
+    // Trigger and deferred work figures of the session
+    memset(&trialTriggers, 0, sizeof(trialTriggers));
+    memset(&triggerStats, 0, sizeof(triggerStats));
+    deferredWork.resetStats();
+
     // Start the task
     state = STATE_RUNNING;
 
@@ -418,7 +900,15 @@ void NBackTask::startTask()
     Serial.print(F("Study ID: "));
     Serial.println(study_id);
 
-    // Start first trial
+    // The first trial starts now or on the next trigger pulse; pulses before
+    // 'start' are not this session's
+    awaitingTrigger = trigger.getMode() != TRIGGER_OFF;
+    if (awaitingTrigger)
+    {
+        trigger.discard();
+        Serial.println(F("Waiting for trigger"));
+        return;
+    }
     startNextTrial();
 }
 
@@ -428,6 +918,12 @@ void NBackTask::pauseTask(bool pause)
     state = pause ? STATE_PAUSED : STATE_RUNNING;
     Serial.println(pause ? F("Task paused") : F("Task resumed"));
 
+    // Pulses during the pause neither start a trial nor count as early or missed
+    if (!pause)
+    {
+        trigger.discard();
+    }
+
     // Send real-time event for pause/resume
     dataCollector.sendTimestampedEvent(pause ? "pause" : "resume");
 }
@@ -451,21 +947,28 @@ void NBackTask::enterDebugMode()
 
 void NBackTask::endTask()
 {
+    // The last trial's output comes before the summary
+    deferredWork.drain();
+
     state = STATE_DATA_READY;
     pixels.clear();
     pixels.show();
 
     reportResults();
 
+    // The next task records into the other block; the previous block's
+    // stream, if not done yet, is finished first
+    dataCollector.seal();
+
     Serial.println(F("task-completed"));
 }
 
 bool NBackTask::configure(uint16_t stimDuration, uint16_t interStimulusInt, uint8_t nBackLvl,
-                          uint8_t numTrials, const String &studyId, uint16_t sessionNum, bool genSequence)
+                          uint8_t numTrials, const String &studyId, uint16_t sessionNum, bool report)
 {
     // Validate parameters (basic sanity checks)
-    if (stimDuration < 100 || interStimulusInt < 100 || nBackLvl < 1 ||
-        numTrials < 5 || numTrials > 100 || studyId.length() == 0)
+    if (stimDuration < 100 || interStimulusInt < 100 || nBackLvl < 1 || nBackLvl > SEQUENCE_MAX_NBACK ||
+        (numTrials != CONTINUOUS_TRIALS && (numTrials < 5 || numTrials > 100)) || studyId.length() == 0)
     {
         return false;
     }
@@ -488,17 +991,21 @@ bool NBackTask::configure(uint16_t stimDuration, uint16_t interStimulusInt, uint
         if (colorSequence != nullptr)
         {
             delete[] colorSequence;
+            colorSequence = nullptr;
         }
 
         // Set new trial count
         maxTrials = numTrials;
 
-        // Allocate new sequence array
-        colorSequence = new int[maxTrials];
-        if (colorSequence == nullptr)
+        // Allocate new sequence array; continuous sessions only use the stream
+        if (maxTrials != CONTINUOUS_TRIALS)
         {
-            // Memory allocation failed
-            return false;
+            colorSequence = new int[maxTrials]();
+            if (colorSequence == nullptr)
+            {
+                // Memory allocation failed
+                return false;
+            }
         }
     }
 
@@ -508,11 +1015,17 @@ bool NBackTask::configure(uint16_t stimDuration, uint16_t interStimulusInt, uint
     // Initialize data collector with study information and session number
     dataCollector.begin(study_id, sessionNum);
 
-    // Generate new sequence with updated parameters
-    if (genSequence)
+    // A new generated sequence unless a custom or library one follows; only
+    // the seed is chosen here, the stimuli are generated while the task runs
+    randomSeed(analogRead(A0));
+    sequenceSeed = random(1, 0x7FFFFFFF);
+    streamedSequence = true;
+    librarySequenceId = 0;
+    validateSequence();
+
+    if (!report)
     {
-        // Generate a new random sequence of colors
-        generateSequence();
+        return true;
     }
 
     // Print confirmation of new settings
@@ -526,7 +1039,14 @@ bool NBackTask::configure(uint16_t stimDuration, uint16_t interStimulusInt, uint
     Serial.print(F("N-back Level: "));
     Serial.println(nBackLevel);
     Serial.print(F("Number of Trials: "));
-    Serial.println(maxTrials);
+    if (maxTrials == CONTINUOUS_TRIALS)
+    {
+        Serial.println(F("continuous"));
+    }
+    else
+    {
+        Serial.println(maxTrials);
+    }
     Serial.print(F("Study ID: "));
     Serial.println(study_id);
     Serial.print(F("Session Number: "));
@@ -541,6 +1061,19 @@ bool NBackTask::configure(uint16_t stimDuration, uint16_t interStimulusInt, uint
 
 void NBackTask::manageTrials()
 {
+    // The next onset waits for a trigger pulse: busy-wait for it a while on
+    // each pass, nothing else is due before the onset
+    if (awaitingTrigger)
+    {
+        unsigned long edgeUs;
+        if (trigger.waitFor(TRIGGER_SPIN_US, edgeUs))
+        {
+            startTriggeredTrial(edgeUs);
+        }
+        return;
+    }
+    collectTriggers();
+
     // Only manage trials when awaiting response or in inter-stimulus interval
     if (!flags.awaitingResponse && !flags.inInterStimulusInterval)
     {
@@ -549,41 +1082,61 @@ void NBackTask::manageTrials()
 
     unsigned long currentTime = millis();
 
-    // If in response window, check if a button was pressed or if time is up
-    if (flags.awaitingResponse)
+    if (timing.responseWindow == SELF_PACED_WINDOW)
     {
-        // End the trial if a button was pressed or time is up
-        if (flags.buttonPressed /* || (currentTime - trialStartTime > timing.stimulusDuration) */)
+        // Self-paced: the response ends the stimulus and the trial
+        if (flags.awaitingResponse && flags.buttonPressed)
         {
-            // End the trial
-            flags.awaitingResponse = false;
-
             // Record when the stimulus ended
             stimulusEndTime = currentTime;
-
-            // Send `trial-complete` message to serial
-            Serial.println(F("trial-complete"));
-
-            // Evaluate the trial outcome at the end
-            evaluateTrialOutcome();
-
-            // Enter inter-stimulus interval state
+            completeTrial();
+        }
+    }
+    else
+    {
+        // Timed: the stimulus goes off after its duration, answered or not
+        if (flags.awaitingResponse && !flags.inInterStimulusInterval &&
+            currentTime - trialStartTime >= timing.stimulusDuration)
+        {
+            stimulusEndTime = trialStartTime + timing.stimulusDuration;
             flags.inInterStimulusInterval = true;
         }
+
+        // The trial is scored once the stimulus is off and its window closed:
+        // by the response or when the window is over, at the latest as the
+        // interval ends, so before the next onset below
+        if (flags.awaitingResponse && flags.inInterStimulusInterval &&
+            (flags.buttonPressed || currentTime - trialStartTime >= responseWindowLength()))
+        {
+            completeTrial();
+        }
+    }
+
+    // Use the idle interval to generate the upcoming stimuli, one per pass
+    if (flags.inInterStimulusInterval && streamedSequence)
+    {
+        sequenceStream.generateNext(currentTrial + 1);
     }
 
     // If in inter-stimulus interval and enough time has passed
     if (flags.inInterStimulusInterval &&
         currentTime - stimulusEndTime > timing.interStimulusInterval)
     {
-        // Exit inter-stimulus interval state
+        // Exit inter-stimulus interval state; the last trial's jobs are
+        // normally done by now, or run here at the latest
         flags.inInterStimulusInterval = false;
+        deferredWork.drain();
 
-        // Move to next trial if not at the end
-        if (currentTrial < maxTrials - 1)
+        // Move to next trial if not at the end (continuous sessions end with 'stop');
+        // paced onsets wait for the next pulse
+        if (maxTrials == CONTINUOUS_TRIALS || currentTrial < maxTrials - 1)
         {
             currentTrial++;
-            startNextTrial();
+            awaitingTrigger = trigger.getMode() == TRIGGER_PACE;
+            if (!awaitingTrigger)
+            {
+                startNextTrial();
+            }
         }
         else
         {
@@ -591,127 +1144,285 @@ void NBackTask::manageTrials()
             endTask();
         }
     }
-}
+}
+
+void NBackTask::completeTrial()
+{
+    // End the trial
+    flags.awaitingResponse = false;
+
+    // Send `trial-complete` message to serial
+    Serial.println(F("trial-complete"));
+
+    // Score the trial now; its output and data row are queued for the interval
+    evaluateTrialOutcome();
+
+    // Enter inter-stimulus interval state
+    flags.inInterStimulusInterval = true;
+}
+
+void NBackTask::startTriggeredTrial(unsigned long edgeUs)
+{
+    awaitingTrigger = false;
+    startNextTrial();
+
+    // The stimulus goes out now rather than on the next pass; the latency
+    // runs to the end of its strip transfer, where the onset marker rises
+    renderPixels();
+    trialData.triggerLatencyUs = stimulusShownUs - edgeUs;
+
+    triggerStats.used++;
+    triggerStats.latencySumUs += trialData.triggerLatencyUs;
+    if (trialData.triggerLatencyUs > triggerStats.latencyMaxUs)
+    {
+        triggerStats.latencyMaxUs = trialData.triggerLatencyUs;
+    }
+}
+
+void NBackTask::collectTriggers()
+{
+    // Pulses that do not start a trial: after the first onset of a 'start'
+    // session they mean nothing; paced, they came while the trial was still
+    // waiting for its response (missed) or before the interval was over
+    // (early); timed trials do not wait for a response, so none is missed
+    if (trigger.getMode() == TRIGGER_OFF)
+    {
+        return;
+    }
+    uint32_t pulses = trigger.discard();
+    if (pulses == 0 || trigger.getMode() != TRIGGER_PACE)
+    {
+        return;
+    }
+    if (flags.awaitingResponse && timing.responseWindow == SELF_PACED_WINDOW)
+    {
+        trialTriggers.missed += pulses;
+    }
+    else
+    {
+        trialTriggers.early += pulses;
+    }
+}
+
+void NBackTask::sampleMemory()
+{
+    memoryMonitor.sample();
+    if (memoryTelemetryInterval == 0 || !MemoryMonitor::available() ||
+        millis() - lastMemoryTelemetry < memoryTelemetryInterval)
+    {
+        return;
+    }
+    lastMemoryTelemetry = millis();
+    dataCollector.sendTimestampedEvent("memory", MemoryMonitor::format(memoryMonitor.getLast()));
+}
+
+void NBackTask::evaluateTrialOutcome()
+{
+    NBACK_TRACE(TRACE_EVALUATE_BEGIN);
+
+    // Record the stimulus end time relative to session start
+    trialData.stimulusEndTime = stimulusEndTime - dataCollector.getSessionStartTime();
+
+    // Score the trial (trial_outcome.h):
+    // 0. No response = Missed target (false negative)
+    // 1. Target trial + response is confirm = Correct response
+    // 2. Target trial + response is not confirm = Missed target (false negative)
+    // 3. Non-target trial + response is confirm = False alarm (false positive)
+    // 4. Non-target trial + response is not confirm = Correct rejection
+    completedOutcome = classifyTrial(flags.buttonPressed, flags.targetTrial, flags.responseIsConfirm,
+                                     currentTrial, nBackLevel);
+
+    if (flags.buttonPressed)
+    {
+        // Add reaction time to totals (only for responses)
+        metrics.totalReactionTime += trialData.reactionTime;
+        metrics.reactionTimeCount++;
+    }
+
+    switch (completedOutcome)
+    {
+    case OUTCOME_NO_RESPONSE:
+    case OUTCOME_MISS:
+        // Missed target (false negative)
+        metrics.missedTargets++;
+        break;
+
+    case OUTCOME_HIT:
+        // Correct response (hit)
+        metrics.correctResponses++;
+        break;
+
+    case OUTCOME_FALSE_ALARM:
+        // False alarm (false positive)
+        metrics.falseAlarms++;
+        break;
+
+    default:
+        break;
+    }
 
-void NBackTask::evaluateTrialOutcome()
-{
-    // Record the stimulus end time relative to session start
-    trialData.stimulusEndTime = millis() - dataCollector.getSessionStartTime();
+    // Paced pulses this trial did not use; pulses from now on are the next
+    // trial's, while its events are still queued
+    completedTriggers = trialTriggers;
+    triggerStats.early += trialTriggers.early;
+    triggerStats.missed += trialTriggers.missed;
+    trialTriggers.early = 0;
+    trialTriggers.missed = 0;
 
-    // Determine trial outcome:
-    // 0. No response = Missed target (false negative)
-    // 1. Target trial + response is confirm = Correct response
-    // 2. Target trial + response is not confirm = Missed target (false negative)
-    // 3. Non-target trial + response is confirm = False alarm (false positive)
-    // 4. Non-target trial + response is not confirm = Correct rejection
+    // The rest is output and the data row: done in the interval, before the
+    // next onset
+    unsigned long deadline = stimulusEndTime + timing.interStimulusInterval;
+    if (verboseLogging)
+    {
+        deferredWork.post(&NBackTask::runTrialJob, this, JOB_PRINT_OUTCOME, deadline);
+    }
+    deferredWork.post(&NBackTask::runTrialJob, this, JOB_SEND_EVENTS, deadline);
+    deferredWork.post(&NBackTask::runTrialJob, this, JOB_RECORD_TRIAL, deadline);
+    deferredWork.post(&NBackTask::runTrialJob, this, JOB_SAMPLE_MEMORY, deadline);
 
-    bool isCorrect = false;
+    NBACK_TRACE(TRACE_EVALUATE_END);
+}
 
-    // Target trial
-    if (!flags.buttonPressed)
+void NBackTask::runTrialJob(void *task, uint8_t job)
+{
+    NBackTask *self = static_cast<NBackTask *>(task);
+    switch (job)
     {
-        // Missed target (miss = mistake)
-        metrics.missedTargets++;
-        isCorrect = false;
-        Serial.println(F("NO RESPONSE!"));
+    case JOB_PRINT_OUTCOME:
+        self->printOutcome();
+        break;
+    case JOB_RECORD_TRIAL:
+        self->recordTrial();
+        break;
+    case JOB_SEND_EVENTS:
+        self->sendTrialEvents();
+        break;
+    case JOB_SAMPLE_MEMORY:
+        // After the trial's events, when its Strings were at their largest
+        self->sampleMemory();
+        break;
     }
-    else
+}
+
+void NBackTask::printOutcome()
+{
+    switch (completedOutcome)
     {
-        // Add reaction time to totals (only for responses)
-        metrics.totalReactionTime += trialData.reactionTime;
-        metrics.reactionTimeCount++;
+    case OUTCOME_NO_RESPONSE:
+        Serial.println(F("NO RESPONSE!"));
+        break;
 
-        if (flags.targetTrial && currentTrial >= nBackLevel)
-        {
-            if (flags.responseIsConfirm)
-            {
-                // Correct response (hit)
-                metrics.correctResponses++;
-                isCorrect = true;
-
-                Serial.println(F("CORRECT RESPONSE!"));
-                Serial.print(F("Reaction time: "));
-                Serial.print(trialData.reactionTime);
-                Serial.println(F(" ms"));
-            }
-            else
-            {
-                // Missed target (false negative)
-                metrics.missedTargets++;
-                isCorrect = false;
-                Serial.println(F("MISSED TARGET!"));
-            }
-        }
-        else if (!flags.targetTrial)
-        {
-            if (flags.responseIsConfirm)
-            {
-                // False alarm (false positive)
-                metrics.falseAlarms++;
-                isCorrect = false;
-                Serial.println(F("FALSE ALARM!"));
-                Serial.print(F("Reaction time: "));
-                Serial.print(trialData.reactionTime);
-                Serial.println(F(" ms (not counted in average)"));
-            }
-            else
-            {
-                // Correct rejection
-                isCorrect = true;
-                Serial.println(F("CORRECT REJECTION"));
-            }
-        }
+    case OUTCOME_HIT:
+        Serial.println(F("CORRECT RESPONSE!"));
+        Serial.print(F("Reaction time: "));
+        Serial.print(trialData.reactionTime);
+        Serial.println(F(" ms"));
+        break;
+
+    case OUTCOME_MISS:
+        Serial.println(F("MISSED TARGET!"));
+        break;
+
+    case OUTCOME_FALSE_ALARM:
+        Serial.println(F("FALSE ALARM!"));
+        Serial.print(F("Reaction time: "));
+        Serial.print(trialData.reactionTime);
+        Serial.println(F(" ms (not counted in average)"));
+        break;
+
+    case OUTCOME_CORRECT_REJECTION:
+        Serial.println(F("CORRECT REJECTION"));
+        break;
+
+    default:
+        break;
     }
+}
 
+void NBackTask::recordTrial()
+{
     // Record the complete trial data in one row
     dataCollector.recordCompletedTrial(
         currentTrial + 1,                                 // 1-based stimulus number
-        colorSequence[currentTrial],                      // stimulus color
+        stimulusColor(currentTrial),                      // stimulus color
         flags.targetTrial,                                // is_target
         flags.responseIsConfirm,                          // response_made - true = confirm, false = wrong
-        isCorrect,                                        // is_correct
+        outcomeIsCorrect(completedOutcome),               // is_correct
         trialData.stimulusOnsetTime,                      // stimulus_onset_time
         flags.buttonPressed ? trialData.responseTime : 0, // response_time
         flags.buttonPressed ? trialData.reactionTime : 0, // reaction_time
-        trialData.stimulusEndTime                         // stimulus_end_time
+        trialData.stimulusEndTime,                        // stimulus_end_time
+        trialData.onsetMarkerUs,                          // onset_marker_us
+        trialData.responseMarkerUs,                       // response_marker_us
+        trialData.triggerLatencyUs                        // trigger_latency_us
     );
+}
 
+void NBackTask::sendTrialEvents()
+{
     // Send real-time data for trial completion
     dataCollector.sendRealTimeEvent(
         "trial_complete",
         currentTrial + 1,                                      // 1-based stimulus number
-        colorSequence[currentTrial],                           // stimulus color
+        stimulusColor(currentTrial),                           // stimulus color
         flags.targetTrial,                                     // is_target
         flags.buttonPressed ? flags.responseIsConfirm : false, // response_made
-        isCorrect,                                             // is_correct
+        outcomeIsCorrect(completedOutcome),                    // is_correct
         trialData.stimulusOnsetTime,                           // stimulus_onset_time
         flags.buttonPressed ? trialData.responseTime : 0,      // response_time
         flags.buttonPressed ? trialData.reactionTime : 0,      // reaction_time
         trialData.stimulusEndTime                              // stimulus_end_time
     );
 
-    Serial.println(F("-----------"));
+    // Paced pulses this trial did not use
+    if (completedTriggers.early != 0 || completedTriggers.missed != 0)
+    {
+        dataCollector.sendTimestampedEvent("trigger", "trial:" + String(currentTrial + 1) +
+                                                          ",early:" + String(completedTriggers.early) +
+                                                          ",missed:" + String(completedTriggers.missed));
+    }
+
+    if (verboseLogging)
+    {
+        Serial.println(F("-----------"));
+    }
 }
 
 void NBackTask::startNextTrial()
 {
     // Record start time
     trialStartTime = millis();
+    trialStartUs = micros();
     trialData.stimulusOnsetTime = trialStartTime - dataCollector.getSessionStartTime();
+    trialData.onsetMarkerUs = 0;
+    trialData.responseMarkerUs = 0;
+    trialData.triggerLatencyUs = 0;
+    onsetMarkerPending = true;
+    NBACK_TRACE(TRACE_TRIAL_ONSET);
 
     // Set trial state
     flags.awaitingResponse = true;
     flags.buttonPressed = false; // Reset button press tracking for new trial
 
+    // Normally generated during the last interval already
+    if (streamedSequence)
+    {
+        sequenceStream.generateThrough(currentTrial);
+    }
+
     // Check if this is a target trial (n-back match)
     flags.targetTrial = (currentTrial >= nBackLevel) &&
-                        (colorSequence[currentTrial] == colorSequence[currentTrial - nBackLevel]);
+                        (stimulusColor(currentTrial) == stimulusColor(currentTrial - nBackLevel));
 
     // Display trial information
+    if (!verboseLogging)
+    {
+        return;
+    }
     Serial.print(F("Trial "));
     Serial.print(currentTrial + 1);
     Serial.print(F(": Color "));
-    Serial.print(colorSequence[currentTrial]);
+    Serial.print(stimulusColor(currentTrial));
     if (flags.targetTrial)
     {
         Serial.println(F(" (TARGET)"));
@@ -722,6 +1433,33 @@ void NBackTask::startNextTrial()
     }
 }
 
+unsigned long NBackTask::responseWindowLength() const
+{
+    // Timed windows end with the interval at the latest: the next onset
+    // closes them, so a press never falls in two trials' windows
+    unsigned long trialLength = (unsigned long)timing.stimulusDuration + timing.interStimulusInterval;
+    return timing.responseWindow < trialLength ? timing.responseWindow : trialLength;
+}
+
+bool NBackTask::responseWindowOpen(unsigned long pressTime)
+{
+    // The press belongs to the current trial if its window was open when the
+    // press was read, even if manageTrials() has not closed it yet
+    if (flags.awaitingResponse &&
+        (timing.responseWindow == SELF_PACED_WINDOW || pressTime - trialStartTime < responseWindowLength()))
+    {
+        return true;
+    }
+
+    // After the window and before the next onset: no trial's response
+    metrics.strayResponses++;
+    if (verboseLogging)
+    {
+        Serial.println(F("Press outside the response window ignored"));
+    }
+    return false;
+}
+
 void NBackTask::handleButtonPress()
 {
     // Only process input in running state and not during feedback and if not pressed yet
@@ -730,8 +1468,9 @@ void NBackTask::handleButtonPress()
         return;
     }
 
-    // Check for correct button press using abstraction
-    if (isCorrectPressed() && flags.awaitingResponse)
+    // Check for correct button press using abstraction; the inputs are read
+    // on every pass anyway, a press is only attributed by when it was read
+    if (isCorrectPressed() && responseWindowOpen(millis()))
     {
         // Calculate and store timing data
         trialData.reactionTime = millis() - trialStartTime;
@@ -740,15 +1479,21 @@ void NBackTask::handleButtonPress()
         // Mark that the "correct" button was pressed for this trial
         flags.buttonPressed = true;
         flags.responseIsConfirm = true;
+        NBACK_TRACE(TRACE_RESPONSE_CAPTURED);
+        unsigned long edge = markers.emit(MARKER_CONFIRM);
+        trialData.responseMarkerUs = edge != 0 ? edge - trialStartUs : 0;
 
-        Serial.println(F("Confirm Button pressed"));
+        if (verboseLogging)
+        {
+            Serial.println(F("Confirm Button pressed"));
+        }
 
         // Provide visual feedback for button press
         handleVisualFeedback(true);
     }
 
     // Check for wrong button press using abstraction
-    if (isWrongPressed() && flags.awaitingResponse)
+    if (isWrongPressed() && responseWindowOpen(millis()))
     {
         // Calculate and store timing data
         trialData.reactionTime = millis() - trialStartTime;
@@ -757,8 +1502,14 @@ void NBackTask::handleButtonPress()
         // Mark that the "wrong" button was pressed for this trial
         flags.buttonPressed = true;
         flags.responseIsConfirm = false;
+        NBACK_TRACE(TRACE_RESPONSE_CAPTURED);
+        unsigned long edge = markers.emit(MARKER_WRONG);
+        trialData.responseMarkerUs = edge != 0 ? edge - trialStartUs : 0;
 
-        Serial.println(F("Wrong button pressed"));
+        if (verboseLogging)
+        {
+            Serial.println(F("Wrong button pressed"));
+        }
 
         // Provide visual feedback for button press
         handleVisualFeedback(true);
@@ -800,7 +1551,16 @@ void NBackTask::renderPixels()
     if (flags.awaitingResponse)
     {
         // Show the current color during response window
-        setNeoPixelColor(colorSequence[currentTrial]);
+        setNeoPixelColor(stimulusColor(currentTrial));
+
+        // show() returns once the transfer is done: the stimulus is visible
+        if (onsetMarkerPending)
+        {
+            onsetMarkerPending = false;
+            stimulusShownUs = micros();
+            unsigned long edge = markers.emit(flags.targetTrial ? MARKER_TARGET_ONSET : MARKER_ONSET);
+            trialData.onsetMarkerUs = edge != 0 ? edge - trialStartUs : 0;
+        }
     }
     else
     {
@@ -845,6 +1605,12 @@ void NBackTask::setNeoPixelColor(int colorIndex)
 // Input Handling System
 //==============================================================================
 
+void NBackTask::setInputMode(InputMode mode)
+{
+    inputMode = mode;
+    initializeInput();
+}
+
 void NBackTask::initializeInput()
 {
     if (inputMode == BUTTON_INPUT)
@@ -1003,49 +1769,436 @@ void NBackTask::resetMetrics()
     metrics.missedTargets = 0;     // False negatives
     metrics.totalReactionTime = 0; // Sum of reaction times
     metrics.reactionTimeCount = 0; // Count of measured reaction times
+    metrics.strayResponses = 0;    // Outside every response window
 }
 
-// TODO: make this a fixed sequence for each task to make study results comparable
-void NBackTask::generateSequence()
+void NBackTask::beginGeneratedSequence()
 {
-    // Seed the random number generator
-    randomSeed(analogRead(A0));
+    // Fill the lookahead now; the rest follows during the intervals
+    sequenceStream.begin(sequenceSeed, nBackLevel);
+    sequenceStream.generateThrough(SEQUENCE_LOOKAHEAD);
+
+    if (verboseLogging)
+    {
+        Serial.print(F("Sequence generated from seed "));
+        Serial.print(sequenceSeed);
+        Serial.print(F(" (generator "));
+        Serial.print(SEQUENCE_GENERATOR_VERSION);
+        Serial.println(F(")"));
+    }
+}
+
+int NBackTask::stimulusColor(int trial) const
+{
+    return streamedSequence ? sequenceStream.colorAt(trial) : colorSequence[trial];
+}
+
+void NBackTask::validateSequence()
+{
+    // One pass over the sequence; a generated one is replayed from its seed
+    // (the first MAX_TRIALS of a continuous session)
+    int trials = (maxTrials == CONTINUOUS_TRIALS) ? MAX_TRIALS : maxTrials;
+    SequenceValidator validator;
+    validator.begin(nBackLevel);
+    if (streamedSequence)
+    {
+        SequenceStream preview;
+        preview.begin(sequenceSeed, nBackLevel);
+        for (int i = 0; i < trials; i++)
+        {
+            preview.generateThrough(i);
+            validator.add(preview.colorAt(i));
+        }
+    }
+    else
+    {
+        for (int i = 0; i < trials; i++)
+        {
+            validator.add(colorSequence[i]);
+        }
+    }
+    validationStats = validator.getStats();
+    validationFailures = validator.check(validationBounds);
+}
+
+void NBackTask::printValidationWarning()
+{
+    if (validationFailures == 0)
+    {
+        return;
+    }
+    char failed[40];
+    SequenceValidator::formatFailures(validationFailures, failed, sizeof(failed));
+    Serial.print(F("!!!Warning: Sequence failed validation ("));
+    Serial.print(failed);
+    Serial.print(validationStrict ? F("), start is refused") : F(")"));
+    Serial.println(F(", see 'validate'.!!!"));
+}
+
+void NBackTask::printValidation()
+{
+    const SequenceStats &stats = validationStats;
+
+    Serial.print(F("Sequence: "));
+    if (streamedSequence)
+    {
+        Serial.print(F("generated, seed "));
+        Serial.print(sequenceSeed);
+    }
+    else if (librarySequenceId != 0)
+    {
+        Serial.print(F("library #"));
+        Serial.print(librarySequenceId);
+    }
+    else
+    {
+        Serial.print(F("custom"));
+    }
+    Serial.print(F(", "));
+    Serial.print(stats.trials);
+    Serial.print(maxTrials == CONTINUOUS_TRIALS ? F(" trials checked (continuous)") : F(" trials"));
+    Serial.print(F(", "));
+    Serial.print(nBackLevel);
+    Serial.println(F("-back"));
+
+    Serial.print(F("Targets: "));
+    Serial.print(stats.targets);
+    Serial.print(F(" of "));
+    Serial.print(stats.scored);
+    Serial.print(F(" ("));
+    Serial.print(SequenceValidator::percent(stats.targets, stats.scored));
+    Serial.print(F("%), bounds "));
+    Serial.print(validationBounds.minTargetPercent);
+    Serial.print('-');
+    Serial.print(validationBounds.maxTargetPercent);
+    Serial.println('%');
+
+    Serial.print(F("Lures: "));
+    Serial.print(stats.lures);
+    Serial.print(F(" ("));
+    Serial.print(SequenceValidator::percent(stats.lures, stats.scored));
+    Serial.print(F("%), max "));
+    Serial.print(validationBounds.maxLurePercent);
+    Serial.println('%');
+
+    uint16_t mostFrequent = 0;
+    Serial.print(F("Colors (red,green,blue,yellow,purple): "));
+    for (int i = 0; i < SEQUENCE_COLORS; i++)
+    {
+        if (i > 0)
+        {
+            Serial.print(',');
+        }
+        Serial.print(stats.colorCounts[i]);
+        if (stats.colorCounts[i] > mostFrequent)
+        {
+            mostFrequent = stats.colorCounts[i];
+        }
+    }
+    Serial.print(F(", most frequent "));
+    Serial.print(SequenceValidator::percent(mostFrequent, stats.trials));
+    Serial.print(F("%, max "));
+    Serial.print(validationBounds.maxColorPercent);
+    Serial.println('%');
+
+    Serial.print(F("Longest run: "));
+    Serial.print(stats.longestRun);
+    Serial.print(F(", max "));
+    Serial.println(validationBounds.maxRun);
 
-    // Aim for approximately 25% targets
-    int targetCount = maxTrials / 4;
+    char failed[40];
+    SequenceValidator::formatFailures(validationFailures, failed, sizeof(failed));
+    Serial.print(F("Validation: "));
+    if (validationFailures != 0)
+    {
+        Serial.print(F("failed: "));
+    }
+    Serial.print(failed);
+    Serial.println(validationStrict ? F(" (strict)") : F(" (not strict)"));
+}
 
-    // First, fill with random colors
-    for (int i = 0; i < maxTrials; i++)
+void NBackTask::processValidateCommand(const String &command)
+{
+    if (command == "validate")
+    {
+        validateSequence();
+        printValidation();
+    }
+    else if (command == "validate strict on" || command == "validate strict off")
+    {
+        // Strict: start refuses a sequence that fails
+        validationStrict = (command == "validate strict on");
+        Serial.println(validationStrict ? F("Strict validation on") : F("Strict validation off"));
+    }
+    else if (command.startsWith("validate bounds "))
+    {
+        // minTarget%,maxTarget%,maxLure%,maxColor%,maxRun
+        String values = command.substring(16);
+        long bounds[5];
+        int count = 0;
+        int startPos = 0;
+        while (count < 5)
+        {
+            int commaPos = values.indexOf(',', startPos);
+            String value = values.substring(startPos, commaPos == -1 ? values.length() : commaPos);
+            bounds[count++] = value.toInt();
+            if (commaPos == -1)
+            {
+                break;
+            }
+            startPos = commaPos + 1;
+        }
+        if (count != 5 || values.indexOf(',', startPos) != -1 || bounds[0] < 0 || bounds[0] > bounds[1] ||
+            bounds[1] > 100 || bounds[2] < 0 || bounds[2] > 100 || bounds[3] < 0 || bounds[3] > 100 ||
+            bounds[4] < 1 || bounds[4] > 255)
+        {
+            Serial.println(F("Invalid bounds. Use: validate bounds minTarget%,maxTarget%,maxLure%,maxColor%,maxRun"));
+            failCommand(F("invalid arguments"));
+            return;
+        }
+        validationBounds.minTargetPercent = bounds[0];
+        validationBounds.maxTargetPercent = bounds[1];
+        validationBounds.maxLurePercent = bounds[2];
+        validationBounds.maxColorPercent = bounds[3];
+        validationBounds.maxRun = bounds[4];
+        validateSequence();
+        Serial.println(F("Validation bounds set"));
+        printValidationWarning();
+    }
+    else
     {
-        colorSequence[i] = random(COLORS_USED);
+        Serial.println(F("Use: validate | validate strict on|off | validate bounds minTarget%,maxTarget%,maxLure%,maxColor%,maxRun"));
+        failCommand(F("invalid arguments"));
     }
+}
 
-    // Then ensure we have target trials (n-back matches) after position n
-    int targetsPlaced = 0;
-    while (targetsPlaced < targetCount)
+void NBackTask::processMemCommand(const String &command)
+{
+    if (command == "mem")
     {
-        // Choose a random position after the n-back position
-        int pos = random(nBackLevel, maxTrials);
+        memoryMonitor.print();
+        return;
+    }
 
-        // Make this position match the n-back position (creating a target)
-        colorSequence[pos] = colorSequence[pos - nBackLevel];
-        targetsPlaced++;
+    if (command.startsWith("mem every "))
+    {
+        // toInt() reads "abc" as 0; only a number turns the events off
+        String seconds = command.substring(10);
+        long interval = seconds.toInt();
+        if (String(interval) == seconds && interval >= 0 && interval <= 3600)
+        {
+            memoryTelemetryInterval = (unsigned long)interval * 1000;
+            if (interval == 0)
+            {
+                Serial.println(F("Memory events off"));
+            }
+            else
+            {
+                Serial.print(F("Memory events every "));
+                Serial.print(interval);
+                Serial.println(F(" s during a session"));
+            }
+            return;
+        }
     }
+    Serial.println(F("Use: mem | mem every seconds (0-3600, 0 = off)"));
+    failCommand(F("invalid arguments"));
+}
 
-    // Print the sequence with target indicators for debugging
-    Serial.println(F("Sequence generated:"));
-    for (int i = 0; i < maxTrials; i++)
+void NBackTask::processMarkerCommand(const String &command)
+{
+    if (!EventMarkers::available())
     {
-        Serial.print(colorSequence[i]);
+        markers.printStatus();
+        failCommand(F("not available"));
+        return;
+    }
 
-        // Mark target positions with an asterisk
-        if (i >= nBackLevel && colorSequence[i] == colorSequence[i - nBackLevel])
+    if (command == "marker")
+    {
+        markers.printStatus();
+        return;
+    }
+    if (command == "marker on" || command == "marker off")
+    {
+        markers.setEnabled(command == "marker on");
+        Serial.println(markers.isEnabled() ? F("Markers on") : F("Markers off"));
+        return;
+    }
+    if (command == "marker test")
+    {
+        // The onset code, as a stimulus would raise it
+        if (markers.emit(MARKER_ONSET) == 0)
+        {
+            Serial.println(F("No marker sent: markers are off or the onset code is 0"));
+            failCommand(F("not available"));
+            return;
+        }
+        Serial.println(F("Marker sent"));
+        return;
+    }
+    if (command.startsWith("marker width "))
+    {
+        String value = command.substring(13);
+        long width = value.toInt();
+        if (String(width) == value && width >= 1 && width <= MARKER_MAX_WIDTH_MS && markers.setWidth(width))
+        {
+            Serial.print(F("Marker width "));
+            Serial.print(width);
+            Serial.println(F(" ms"));
+            return;
+        }
+    }
+    else if (command.startsWith("marker codes "))
+    {
+        // onset,target onset,confirm,wrong
+        String values = command.substring(13);
+        long codes[MARKER_EVENT_COUNT];
+        int count = 0;
+        int startPos = 0;
+        bool valid = true;
+        while (count < MARKER_EVENT_COUNT)
+        {
+            int commaPos = values.indexOf(',', startPos);
+            String value = values.substring(startPos, commaPos == -1 ? values.length() : commaPos);
+            codes[count] = value.toInt();
+            valid = valid && String(codes[count]) == value && codes[count] >= 0 && codes[count] <= MARKER_MAX_CODE;
+            count++;
+            if (commaPos == -1)
+            {
+                break;
+            }
+            startPos = commaPos + 1;
+        }
+        if (valid && count == MARKER_EVENT_COUNT && values.indexOf(',', startPos) == -1)
         {
-            Serial.print(F("*"));
+            for (int i = 0; i < MARKER_EVENT_COUNT; i++)
+            {
+                markers.setCode((MarkerEvent)i, codes[i]);
+            }
+            Serial.println(F("Marker codes set"));
+            return;
         }
-        Serial.print(F(" "));
     }
-    Serial.println();
+    Serial.println(F("Use: marker | marker on|off | marker width ms (1-100) | marker codes onset,target,confirm,wrong (0-15, 0 = none) | marker test"));
+    failCommand(F("invalid arguments"));
+}
+
+void NBackTask::processTriggerCommand(const String &command)
+{
+    if (!TriggerInput::available())
+    {
+        trigger.printStatus();
+        failCommand(F("not available"));
+        return;
+    }
+
+    if (command == "trigger")
+    {
+        trigger.printStatus();
+        return;
+    }
+
+    TriggerMode mode;
+    if (command == "trigger off")
+    {
+        mode = TRIGGER_OFF;
+    }
+    else if (command == "trigger start")
+    {
+        mode = TRIGGER_START;
+    }
+    else if (command == "trigger pace")
+    {
+        mode = TRIGGER_PACE;
+    }
+    else
+    {
+        Serial.println(F("Use: trigger | trigger off|start|pace"));
+        failCommand(F("invalid arguments"));
+        return;
+    }
+
+    // A session keeps the mode it started with
+    if (state == STATE_RUNNING || state == STATE_PAUSED)
+    {
+        Serial.println(F("The trigger mode cannot change while a task runs"));
+        failCommand(F("task running"));
+        return;
+    }
+    trigger.setMode(mode);
+    Serial.print(F("Trigger "));
+    Serial.println(TriggerInput::modeName(mode));
+}
+
+void NBackTask::processWindowCommand(const String &command)
+{
+    if (command == "window")
+    {
+        printResponseWindow();
+        return;
+    }
+
+    String value = command.substring(7);
+    long window = value == "off" ? SELF_PACED_WINDOW : value.toInt();
+    if (value != "off" &&
+        (String(window) != value || window < MIN_RESPONSE_WINDOW || window > MAX_RESPONSE_WINDOW))
+    {
+        Serial.println(F("Use: window | window off | window ms (100-30000)"));
+        failCommand(F("invalid arguments"));
+        return;
+    }
+
+    // A session keeps the window it started with
+    if (state == STATE_RUNNING || state == STATE_PAUSED)
+    {
+        Serial.println(F("The response window cannot change while a task runs"));
+        failCommand(F("task running"));
+        return;
+    }
+    timing.responseWindow = window;
+    printResponseWindow();
+}
+
+void NBackTask::processStreamCommand(const String &command)
+{
+    if (command == "stream")
+    {
+        dataCollector.printStreamStatus();
+        return;
+    }
+    if (command != "stream on" && command != "stream off")
+    {
+        Serial.println(F("Use: stream | stream on|off"));
+        failCommand(F("invalid arguments"));
+        return;
+    }
+
+    // A block already streaming is finished either way
+    dataCollector.setStreaming(command == "stream on");
+    Serial.println(dataCollector.isStreaming() ? F("Data stream on") : F("Data stream off"));
+}
+
+void NBackTask::printResponseWindow()
+{
+    if (timing.responseWindow == SELF_PACED_WINDOW)
+    {
+        Serial.println(F("Response window: self-paced, the stimulus stays until the response"));
+        return;
+    }
+
+    Serial.print(F("Response window: "));
+    Serial.print(timing.responseWindow);
+    Serial.print(F(" ms after onset, stimulus "));
+    Serial.print(timing.stimulusDuration);
+    Serial.println(F(" ms"));
+    if (responseWindowLength() < timing.responseWindow)
+    {
+        // Set before a config with shorter trials, or longer than any trial
+        Serial.print(F("Ends with the interval, at "));
+        Serial.print(responseWindowLength());
+        Serial.println(F(" ms, with this config"));
+    }
 }
 
 void NBackTask::reportResults()
@@ -1064,7 +2217,8 @@ void NBackTask::reportResults()
     Serial.print(F("N-Back Level: "));
     Serial.println(nBackLevel);
     Serial.print(F("Total Trials: "));
-    Serial.println(maxTrials);
+    // A trial stopped before its response, or before its trigger, does not count
+    Serial.println(currentTrial + (flags.awaitingResponse || awaitingTrigger ? 0 : 1));
     Serial.print(F("Total Targets: "));
     Serial.println(totalTargets);
     Serial.print(F("Correct Responses: "));
@@ -1081,6 +2235,50 @@ void NBackTask::reportResults()
     Serial.println(F(" ms"));
     Serial.print(F("Session Duration: "));
     Serial.println(timestampBuffer);
+    if (MemoryMonitor::available())
+    {
+        // Peak usage of the session: the lowest figures sampled
+        const MemoryStats &peak = memoryMonitor.getPeak();
+        Serial.print(F("Lowest Free Heap: "));
+        Serial.print(peak.freeHeap);
+        Serial.print(F(" bytes (largest block "));
+        Serial.print(peak.largestBlock);
+        Serial.println(F(" bytes)"));
+        Serial.print(F("Lowest Free Stack: "));
+        Serial.print(peak.stackFree);
+        Serial.println(F(" bytes"));
+    }
+    if (triggerStats.used > 0)
+    {
+        Serial.print(F("Trigger Latency: avg "));
+        Serial.print(triggerStats.latencySumUs / triggerStats.used);
+        Serial.print(F(" us, max "));
+        Serial.print(triggerStats.latencyMaxUs);
+        Serial.print(F(" us ("));
+        Serial.print(triggerStats.used);
+        Serial.println(F(" pulses)"));
+    }
+    if (timing.responseWindow != SELF_PACED_WINDOW)
+    {
+        Serial.print(F("Responses Outside the Window: "));
+        Serial.println(metrics.strayResponses);
+    }
+    if (trigger.getMode() == TRIGGER_PACE)
+    {
+        Serial.print(F("Early Triggers: "));
+        Serial.println(triggerStats.early);
+        Serial.print(F("Missed Triggers: "));
+        Serial.println(triggerStats.missed);
+    }
+    if (dataCollector.getDroppedCount() > 0)
+    {
+        // Past the rows a block holds; the write> events have them all
+        Serial.print(F("Trials Not Stored: "));
+        Serial.print(dataCollector.getDroppedCount());
+        Serial.print(F(" (a block holds "));
+        Serial.print(MAX_DATA_ROWS);
+        Serial.println(F(")"));
+    }
     Serial.println(F("======================"));
 }
 
@@ -1289,18 +2487,7 @@ void NBackTask::handleInputModeLoop()
     }
     buttonWrong.lastState = wrongCurrent;
 
-    // Check for exit command
-    if (Serial.available() > 0)
-    {
-        String command = Serial.readStringUntil('\n');
-        command.trim();
-        command.toLowerCase();
-
-        if (command == "exit")
-        {
-            exitInputMode();
-        }
-    }
+    // 'exit' comes through the command queue (processSerialCommands)
 }
 
 void NBackTask::sendInputEvent(const String &inputType, bool isPressed)
@@ -4,6 +4,16 @@
 #include <Arduino.h>
 #include <Adafruit_NeoPixel.h>
 #include "data_collector.h"
+#include "deferred_work.h"
+#include "event_markers.h"
+#include "memory_monitor.h"
+#include "settings_store.h"
+#include "sequence_codec.h"
+#include "sequence_library.h"
+#include "sequence_stream.h"
+#include "sequence_validator.h"
+#include "trial_outcome.h"
+#include "trigger_input.h"
 
 //==============================================================================
 // Hardware Configuration
@@ -13,6 +23,9 @@
 #if defined(ESP32)
 #define NEOPIXEL_PIN 32 // Pin connected to the NeoPixel for ESP32
 #define INPUT_MODE CAPACITIVE_INPUT
+#elif defined(NBACK_HOST)
+#define NEOPIXEL_PIN 32 // Host build emulates the ESP32 board
+#define INPUT_MODE CAPACITIVE_INPUT
 #elif defined(ESP8266)
 #define touchRead(p) (analogRead(p))
 #define NEOPIXEL_PIN 4 // Pin connected to the NeoPixel for ESP8266 (D1 Mini)
@@ -40,6 +53,16 @@
 
 // Task constants - default values, can be changed via config command
 #define MAX_TRIALS 100 // Default, can be increased up to
+#define CONTINUOUS_TRIALS 0 // Trials setting for a session that runs until 'stop'
+#define POWER_ON_TEST_DURATION 1000 // White LED test after power-on (ms), runs alongside loop()
+
+// Response window (the window command): self-paced, the stimulus stays until
+// the response; or timed, the stimulus is shown for its duration and responses
+// count until the window after onset is over, into the interval. A window
+// never reaches past the interval: the next onset closes it.
+#define SELF_PACED_WINDOW 0      // Response window setting for self-paced trials
+#define MIN_RESPONSE_WINDOW 100  // Timed windows (ms)
+#define MAX_RESPONSE_WINDOW 30000
 
 //==============================================================================
 // Color Definitions
@@ -87,7 +110,7 @@ enum InputMode
 // Trial state flags (using bit fields to save memory)
 struct TrialFlags
 {
-    bool awaitingResponse : 1;        // Whether currently in response window
+    bool awaitingResponse : 1;        // Whether the trial is not scored yet (response window open)
     bool targetTrial : 1;             // Whether current trial is a target
     bool feedbackActive : 1;          // Whether visual feedback is active
     bool feedbackEnabled : 1;         // Whether feedback is enabled
@@ -103,6 +126,19 @@ struct TrialData
     unsigned long stimulusOnsetTime; // When stimulus appeared (relative to session start)
     unsigned long responseTime;      // When response occurred (relative to session start)
     unsigned long stimulusEndTime;   // When stimulus disappeared (relative to session start)
+    uint32_t onsetMarkerUs;          // Onset marker after trial start (us, 0 = none)
+    uint32_t responseMarkerUs;       // Response marker after trial start (us, 0 = none)
+    uint32_t triggerLatencyUs;       // Stimulus shown after its trigger pulse (us, 0 = not triggered)
+};
+
+// What a completed trial leaves to the deferred work queue, in this order;
+// all of it is done before the next onset
+enum TrialJob
+{
+    JOB_PRINT_OUTCOME, // Verbose outcome messages
+    JOB_SEND_EVENTS,   // trial_complete and trigger events
+    JOB_RECORD_TRIAL,  // The data row for get_data
+    JOB_SAMPLE_MEMORY  // Memory figures and event
 };
 
 //==============================================================================
@@ -120,13 +156,51 @@ public:
     void setup();
     void loop();
 
-    // Configuration function (public to allow direct configuration)
+    // Configuration function (public to allow direct configuration); a new
+    // sequence is generated while the task runs unless a custom one is set,
+    // and validated now. `numTrials` CONTINUOUS_TRIALS runs until 'stop'.
+    // `report` prints the new settings.
     bool configure(uint16_t stimDuration, uint16_t interStimulusInt, uint8_t nBackLvl,
-                   uint8_t numTrials, const String &studyId, uint16_t sessionNum, bool genSequence);
+                   uint8_t numTrials, const String &studyId, uint16_t sessionNum, bool report);
+
+    // Command list (the 'help' command)
+    void printCommands();
 
     void startTask();
     bool processSerialCommands(const String &command);
 
+    // Why the last command failed (the `nack` reason of command_queue.h), or
+    // nullptr; cleared by reading it
+    void failCommand(const __FlashStringHelper *reason) { commandError = reason; }
+    const __FlashStringHelper *takeCommandError();
+
+    // Switch between push buttons and capacitive touch pads
+    void setInputMode(InputMode mode);
+    InputMode getInputMode() const { return inputMode; }
+
+    // Read access to the recorded session data
+    const DataCollector &getDataCollector() const { return dataCollector; }
+
+    // Progress for the watchdog breadcrumbs (watchdog.h)
+    TaskState getState() const { return state; }
+    int getCurrentTrial() const { return currentTrial; }
+
+    // How long nothing is due (ms) for idle sleep (idle_sleep.h): 0 unless
+    // idle or data ready, where only the power-on test has a deadline
+    unsigned long idleFor() const;
+
+    // A loop() phase that took `durationMs` without a reset: a `stall` event
+    // during a session, a plain line otherwise
+    void reportStall(uint32_t durationMs, const __FlashStringHelper *phase);
+
+    // Persistent settings (settings_store.h): the current configuration,
+    // palette, touch thresholds and debounce times, and applying them at boot.
+    // applySettings() keeps the current configuration if the stored one is
+    // invalid and returns false.
+    void exportSettings(DeviceSettings &settings) const;
+    bool applySettings(const DeviceSettings &settings);
+    void setTouchThresholds(int correct, int wrong);
+
     // Input mode forwarding functions (separated for easy extraction to another class)
     void enterInputMode();
     void exitInputMode();
@@ -141,6 +215,7 @@ private:
     {
         uint16_t stimulusDuration;      // How long each stimulus is shown (ms)
         uint16_t interStimulusInterval; // Time between stimuli (ms)
+        uint16_t responseWindow;        // Responses count this long after onset (ms, SELF_PACED_WINDOW = until one)
         uint16_t feedbackDuration;      // Duration of visual feedback (ms)
         uint16_t debugColorDuration;    // Time for each color in debug mode (ms)
     } timing;
@@ -149,7 +224,7 @@ private:
     // Task Parameters
     //--------------------------------------------------------------------------
     int nBackLevel; // N-back level (e.g., 2 for 2-back)
-    int maxTrials;  // Total number of trials in a session
+    int maxTrials;  // Total number of trials in a session (CONTINUOUS_TRIALS = unbounded)
 
     //--------------------------------------------------------------------------
     // Task State
@@ -157,6 +232,10 @@ private:
     TaskState state;                 // Current state of the task
     int currentTrial;                // Current trial number (0-based)
     unsigned long trialStartTime;    // When current trial started (ms)
+    unsigned long trialStartUs;      // The same in us, for the marker times
+    bool onsetMarkerPending;         // Onset marker follows the stimulus' strip transfer
+    unsigned long stimulusShownUs;   // When that transfer returned (us)
+    bool awaitingTrigger;            // The next onset waits for a trigger pulse
     unsigned long stimulusEndTime;   // When stimulus ended (ms)
     unsigned long feedbackStartTime; // When visual feedback started (ms)
     TrialFlags flags;                // Trial state flags
@@ -216,6 +295,7 @@ private:
         int missedTargets;               // Number of missed targets (false negatives)
         unsigned long totalReactionTime; // Sum of all correct reaction times (ms)
         int reactionTimeCount;           // Count of measured reaction times
+        int strayResponses;              // Presses seen with no response window open
     } metrics;
 
     //--------------------------------------------------------------------------
@@ -223,23 +303,68 @@ private:
     //--------------------------------------------------------------------------
     Adafruit_NeoPixel pixels;     // NeoPixel control object
     uint32_t colors[COLOR_COUNT]; // Array of NeoPixel color values
-    int *colorSequence;           // Dynamically allocated array for color sequence
+    int *colorSequence;           // Custom or library sequence (not allocated for continuous sessions)
+    bool streamedSequence;        // Stimuli come from sequenceStream instead of colorSequence
+    uint32_t sequenceSeed;        // Seed of the generated sequence
+    SequenceStream sequenceStream; // Generated stimuli, a window ahead of the current trial
+    uint16_t librarySequenceId;   // Flash library sequence in colorSequence (0 = none)
+    SequenceBounds validationBounds; // Checked by validateSequence()
+    bool validationStrict;           // start refuses a sequence that failed
+    SequenceStats validationStats;   // Of the current sequence
+    uint8_t validationFailures;      // Failed checks (VALIDATION_*), 0 = passed
+    MemoryMonitor memoryMonitor;           // Heap and stack figures, peak per session
+    unsigned long memoryTelemetryInterval; // Between `memory` events of a session (ms, 0 = off)
+    unsigned long lastMemoryTelemetry;     // When the last one was sent (ms)
+    EventMarkers markers;           // TTL outputs at stimulus onset and response
+    TriggerInput trigger;           // External pulses that start or pace the onsets
+    struct
+    {
+        uint16_t early;  // Pulses in the interval before this trial's onset
+        uint16_t missed; // Pulses while this trial waited for its response
+    } trialTriggers, completedTriggers; // The current trial's, the completed one's
+    struct
+    {
+        uint32_t used;         // Pulses that started a trial
+        uint32_t early;        // Totals of trialTriggers
+        uint32_t missed;
+        uint32_t latencySumUs; // Trigger-to-onset latency of the used pulses
+        uint32_t latencyMaxUs;
+    } triggerStats;
+    unsigned long powerOnTestStart; // When the power-on white was shown (ms)
+    bool powerOnTestActive;         // Power-on white still showing
+    DeferredWork deferredWork;      // Jobs of the completed trial, run in its interval
+    TrialOutcome completedOutcome;  // Of the trial the queued jobs belong to
 
     // Data collection
     DataCollector dataCollector; // Data collector for research data
     String study_id;             // Current study identifier
+    bool verboseLogging;         // Print human-readable trial progress
+    const __FlashStringHelper *commandError; // See failCommand()
 
     //--------------------------------------------------------------------------
     // Command Processing Methods
     //--------------------------------------------------------------------------
     void processConfigCommand(const String &command);
+    void applyLibrarySequence(const SequenceEntry &entry);
+    void printPackedSequenceError(PackedStatus status, uint16_t position, size_t chars);
+    void printSequenceLibrary();
+    void processValidateCommand(const String &command);
+    void printValidation();
+    void printValidationWarning();
+    void processMemCommand(const String &command);
+    void processMarkerCommand(const String &command);
+    void processTriggerCommand(const String &command);
+    void processWindowCommand(const String &command);
+    void printResponseWindow();
+    void processStreamCommand(const String &command);
     void sendData();
     void sendTimeSyncToMaster();
 
     //--------------------------------------------------------------------------
     // State Management Methods
     //--------------------------------------------------------------------------
-    void generateSequence();
+    void beginGeneratedSequence();
+    void validateSequence();
     void pauseTask(bool pause);
     void enterDebugMode();
     void endTask();
@@ -250,8 +375,19 @@ private:
     void manageTrials();
     void renderPixels();
     void startNextTrial();
+    void startTriggeredTrial(unsigned long edgeUs);
+    void collectTriggers();
+    int stimulusColor(int trial) const;
+    unsigned long responseWindowLength() const;
+    bool responseWindowOpen(unsigned long pressTime);
     void handleButtonPress();
+    void completeTrial();
     void evaluateTrialOutcome();
+    static void runTrialJob(void *task, uint8_t job);
+    void printOutcome();
+    void recordTrial();
+    void sendTrialEvents();
+    void sampleMemory();
 
     //--------------------------------------------------------------------------
     // Visual Feedback Methods
@@ -0,0 +1,160 @@
+#include "sequence_codec.h"
+#include "checksum.h"
+
+static const char BASE32_DIGITS[] = "0123456789abcdefghjkmnpqrstvwxyz";
+
+// Crockford base32 digit value, either case; i/l read as 1 and o as 0
+static int base32Value(char c)
+{
+    if (c >= 'A' && c <= 'Z')
+    {
+        c = c - 'A' + 'a';
+    }
+    if (c == 'i' || c == 'l')
+    {
+        return 1;
+    }
+    if (c == 'o')
+    {
+        return 0;
+    }
+    for (int value = 0; value < 32; value++)
+    {
+        if (BASE32_DIGITS[value] == c)
+        {
+            return value;
+        }
+    }
+    return -1;
+}
+
+static size_t packedBytes(uint8_t length)
+{
+    return 1 + ((size_t)length * 3 + 7) / 8 + 4;
+}
+
+size_t packedSequenceChars(uint8_t length)
+{
+    return (packedBytes(length) * 8 + 4) / 5;
+}
+
+PackedStatus decodePackedSequence(const char *text, size_t count, uint8_t colorCount, PackedSequence &sequence,
+                                  uint16_t &position)
+{
+    position = 0;
+
+    // Every character first, so a typo is reported where it is
+    for (size_t i = 0; i < count; i++)
+    {
+        if (base32Value(text[i]) < 0)
+        {
+            position = (uint16_t)(i + 1);
+            return PACKED_BAD_CHARACTER;
+        }
+    }
+
+    // Decode what fits; anything longer fails the length check below
+    size_t decoded = 0;
+    uint32_t buffer = 0;
+    int bits = 0;
+    for (size_t i = 0; i < count && decoded < PACKED_SEQUENCE_MAX_BYTES; i++)
+    {
+        buffer = (buffer << 5) | (uint32_t)base32Value(text[i]);
+        bits += 5;
+        if (bits >= 8)
+        {
+            bits -= 8;
+            sequence.bytes[decoded++] = (uint8_t)(buffer >> bits);
+        }
+    }
+
+    if (decoded == 0 || sequence.bytes[0] == 0)
+    {
+        return PACKED_BAD_LENGTH; // No length to go by
+    }
+    sequence.length = sequence.bytes[0];
+    if (count != packedSequenceChars(sequence.length))
+    {
+        position = (uint16_t)packedSequenceChars(sequence.length);
+        return PACKED_BAD_LENGTH;
+    }
+    if ((buffer & ((1u << bits) - 1)) != 0)
+    {
+        // Only one character can encode each sequence: the padding bits are 0
+        position = (uint16_t)count;
+        return PACKED_BAD_CHARACTER;
+    }
+
+    size_t dataBytes = packedBytes(sequence.length) - 4;
+    const uint8_t *stored = sequence.bytes + dataBytes;
+    uint32_t crc = stored[0] | (uint32_t)stored[1] << 8 | (uint32_t)stored[2] << 16 | (uint32_t)stored[3] << 24;
+    if (crc32(sequence.bytes, dataBytes) != crc)
+    {
+        return PACKED_BAD_CRC;
+    }
+
+    for (int trial = 0; trial < sequence.length; trial++)
+    {
+        if (packedColor(sequence, (uint8_t)trial) >= colorCount)
+        {
+            position = (uint16_t)(trial + 1);
+            return PACKED_BAD_COLOR;
+        }
+    }
+    return PACKED_OK;
+}
+
+uint8_t packedColor(const PackedSequence &sequence, uint8_t trial)
+{
+    // Codes may span two bytes; the CRC follows, so the second always exists
+    size_t bit = (size_t)trial * 3;
+    const uint8_t *codes = sequence.bytes + 1;
+    uint16_t pair = codes[bit / 8] | (uint16_t)codes[bit / 8 + 1] << 8;
+    return (pair >> (bit % 8)) & 0x7;
+}
+
+size_t encodePackedSequence(const uint8_t *colors, uint8_t length, char *text, size_t size)
+{
+    size_t chars = packedSequenceChars(length);
+    if (size < chars + 1)
+    {
+        return 0;
+    }
+
+    uint8_t bytes[PACKED_SEQUENCE_MAX_BYTES] = {0};
+    size_t dataBytes = packedBytes(length) - 4;
+    bytes[0] = length;
+    for (size_t trial = 0; trial < length; trial++)
+    {
+        size_t bit = trial * 3;
+        uint16_t code = (uint16_t)(colors[trial] & 0x7) << (bit % 8);
+        bytes[1 + bit / 8] |= (uint8_t)code;
+        bytes[2 + bit / 8] |= (uint8_t)(code >> 8);
+    }
+    uint32_t crc = crc32(bytes, dataBytes);
+    for (int i = 0; i < 4; i++)
+    {
+        bytes[dataBytes + i] = (uint8_t)(crc >> (8 * i));
+    }
+
+    // Big-endian 5-bit groups, the last one padded with zero bits
+    uint32_t buffer = 0;
+    int bits = 0;
+    size_t written = 0;
+    for (size_t i = 0; i < dataBytes + 4; i++)
+    {
+        buffer = (buffer << 8) | bytes[i];
+        bits += 8;
+        while (bits >= 5)
+        {
+            bits -= 5;
+            text[written++] = BASE32_DIGITS[(buffer >> bits) & 0x1F];
+        }
+    }
+    if (bits > 0)
+    {
+        text[written++] = BASE32_DIGITS[(buffer << (5 - bits)) & 0x1F];
+    }
+    text[written] = '\0';
+    return written;
+}
@@ -0,0 +1,55 @@
+#ifndef SEQUENCE_CODEC_H
+#define SEQUENCE_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+//==============================================================================
+// Packed Sequence Codec
+//==============================================================================
+//
+// Compact form of a color sequence for `config ...,$<packed>`, instead of a
+// `%red,green,...%` list. The bytes are
+//
+//   length (1 byte, trials) | 3-bit color codes, LSB first | CRC-32 (LE)
+//
+// with the CRC over the length and the codes, written in Crockford base32:
+// commands are lowercased on the device, which base32 survives and base64
+// would not. 100 trials are 43 bytes, 69 characters. Decoding checks every
+// character, the length, the CRC and every color code, and reports where it
+// failed. No Arduino dependencies: the header also compiles on the host.
+
+#define PACKED_SEQUENCE_MAX_LENGTH 255
+#define PACKED_SEQUENCE_MAX_BYTES (1 + (PACKED_SEQUENCE_MAX_LENGTH * 3 + 7) / 8 + 4)
+#define PACKED_SEQUENCE_MAX_CHARS ((PACKED_SEQUENCE_MAX_BYTES * 8 + 4) / 5)
+
+enum PackedStatus
+{
+    PACKED_OK,
+    PACKED_BAD_CHARACTER, // Not a base32 digit, or padding bits set; position = character (1-based)
+    PACKED_BAD_LENGTH,    // Does not match the declared length; position = expected characters (0: no length)
+    PACKED_BAD_CRC,       // position = 0
+    PACKED_BAD_COLOR      // Code >= colorCount; position = trial (1-based)
+};
+
+struct PackedSequence
+{
+    uint8_t length; // Trials
+    uint8_t bytes[PACKED_SEQUENCE_MAX_BYTES];
+};
+
+// Characters of the packed form of `length` trials
+size_t packedSequenceChars(uint8_t length);
+
+// Decode `count` characters; on failure `position` says where (see PackedStatus)
+PackedStatus decodePackedSequence(const char *text, size_t count, uint8_t colorCount, PackedSequence &sequence,
+                                  uint16_t &position);
+
+// Color of `trial` (0-based) of a decoded sequence
+uint8_t packedColor(const PackedSequence &sequence, uint8_t trial);
+
+// Write the packed form of `colors` (codes below 8) and a terminating NUL;
+// returns the characters written, 0 if `size` is too small
+size_t encodePackedSequence(const uint8_t *colors, uint8_t length, char *text, size_t size);
+
+#endif // SEQUENCE_CODEC_H
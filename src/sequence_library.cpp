@@ -0,0 +1,31 @@
+#include "sequence_library.h"
+#include "checksum.h"
+#include "sequence_library_data.h"
+
+uint16_t sequenceLibraryCount()
+{
+    return SEQUENCE_LIBRARY_COUNT;
+}
+
+bool findSequence(uint16_t id, SequenceEntry &entry)
+{
+    if (id < 1 || id > SEQUENCE_LIBRARY_COUNT)
+    {
+        return false;
+    }
+    memcpy_P(&entry, &SEQUENCE_LIBRARY_ENTRIES[id - 1], sizeof(entry));
+    return entry.id == id;
+}
+
+bool loadSequence(const SequenceEntry &entry, int *colors)
+{
+    uint8_t header[2] = {entry.nBackLevel, entry.length};
+    uint32_t crc = crc32(header, sizeof(header));
+    for (int i = 0; i < entry.length; i++)
+    {
+        uint8_t color = pgm_read_byte(&SEQUENCE_LIBRARY_COLORS[entry.offset + i]);
+        crc = crc32(&color, 1, crc);
+        colors[i] = color;
+    }
+    return crc == entry.crc;
+}
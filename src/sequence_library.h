@@ -0,0 +1,36 @@
+#ifndef SEQUENCE_LIBRARY_H
+#define SEQUENCE_LIBRARY_H
+
+#include <Arduino.h>
+
+//==============================================================================
+// Sequence Library
+//==============================================================================
+//
+// Fixed color sequences compiled into flash, so every participant of a study
+// can see the same sequence without uploading it with each config. The data
+// (sequence_library_data.h) is generated by host/seqgen from a checked-in
+// specification; each sequence carries a CRC-32 that is verified when it is
+// loaded. IDs are dense (1..count), so a lookup is a single array index.
+
+struct SequenceEntry
+{
+    uint16_t id;
+    uint8_t nBackLevel;  // Level the targets were placed for
+    uint8_t length;      // Trials
+    uint8_t targets;     // n-back matches
+    uint16_t offset;     // First color in the color table
+    uint32_t crc;        // CRC-32 of nBackLevel, length and the colors
+};
+
+// Number of sequences in flash
+uint16_t sequenceLibraryCount();
+
+// Entry for `id`, copied out of flash; false if there is no such sequence
+bool findSequence(uint16_t id, SequenceEntry &entry);
+
+// Copy the entry's colors into `colors` (at least entry.length ints) and
+// verify them against the stored CRC; false if the flash data is damaged
+bool loadSequence(const SequenceEntry &entry, int *colors);
+
+#endif // SEQUENCE_LIBRARY_H
@@ -0,0 +1,169 @@
+#ifndef SEQUENCE_LIBRARY_DATA_H
+#define SEQUENCE_LIBRARY_DATA_H
+
+// Generated by nback-seqgen from host/seqgen/library.txt; do not edit.
+
+#include "sequence_library.h"
+
+#define SEQUENCE_LIBRARY_COUNT 36
+
+static const uint8_t SEQUENCE_LIBRARY_COLORS[] PROGMEM = {
+    // 1
+    4, 0, 3, 3, 3, 3, 1, 2, 4, 0, 2, 4, 3, 1, 3, 2, 2, 2, 4, 1,
+    // 2
+    3, 4, 1, 1, 4, 3, 3, 4, 2, 1, 0, 3, 3, 1, 1, 4, 2, 0, 0, 4,
+    // 3
+    4, 0, 1, 1, 2, 0, 1, 2, 4, 4, 2, 3, 4, 0, 4, 4, 1, 0, 0, 0,
+    // 4
+    0, 4, 4, 3, 4, 0, 1, 4, 3, 1, 2, 2, 2, 0, 0, 1, 3, 3, 0, 1,
+    // 5
+    4, 4, 0, 0, 3, 0, 4, 1, 4, 3, 4, 4, 1, 2, 0, 0, 2, 1, 1, 4, 4, 0, 1, 2, 1,
+    4, 0, 0, 1, 0,
+    // 6
+    2, 0, 2, 1, 1, 0, 3, 1, 1, 2, 1, 1, 1, 4, 0, 1, 3, 4, 4, 4, 4, 1, 2, 0, 1,
+    4, 1, 3, 0, 2,
+    // 7
+    2, 1, 2, 0, 0, 4, 1, 1, 1, 0, 2, 4, 0, 3, 3, 0, 3, 4, 0, 0, 2, 1, 4, 4, 0,
+    0, 4, 2, 1, 4,
+    // 8
+    0, 0, 0, 4, 2, 3, 4, 3, 2, 1, 0, 4, 0, 3, 1, 3, 0, 1, 1, 3, 1, 4, 4, 3, 1,
+    4, 0, 0, 0, 0,
+    // 9
+    2, 1, 2, 1, 3, 4, 4, 0, 1, 1, 0, 2, 0, 1, 0, 3, 0, 2, 2, 1,
+    // 10
+    4, 4, 0, 3, 1, 3, 1, 0, 1, 0, 3, 3, 0, 0, 3, 1, 0, 1, 4, 2,
+    // 11
+    0, 4, 4, 3, 1, 4, 3, 1, 3, 4, 4, 4, 0, 1, 0, 4, 0, 3, 4, 3,
+    // 12
+    4, 1, 4, 0, 3, 1, 0, 1, 0, 4, 4, 1, 3, 4, 4, 4, 4, 1, 2, 0,
+    // 13
+    3, 2, 2, 2, 0, 1, 2, 4, 4, 0, 4, 1, 2, 1, 0, 0, 2, 2, 3, 1, 3, 4, 3, 3, 1,
+    3, 4, 0, 4, 3,
+    // 14
+    3, 0, 4, 0, 0, 3, 3, 4, 0, 3, 0, 4, 4, 4, 1, 2, 1, 4, 3, 1, 4, 4, 0, 0, 0,
+    0, 1, 0, 4, 2,
+    // 15
+    2, 2, 3, 2, 0, 2, 2, 4, 4, 0, 1, 4, 2, 1, 1, 1, 1, 0, 1, 0, 4, 3, 0, 1, 2,
+    2, 2, 3, 3, 0,
+    // 16
+    4, 2, 1, 1, 0, 4, 4, 1, 0, 4, 0, 2, 0, 0, 0, 1, 0, 0, 2, 2, 2, 4, 3, 3, 4,
+    3, 0, 4, 3, 4,
+    // 17
+    3, 2, 4, 3, 0, 0, 4, 3, 3, 3, 0, 2, 4, 1, 2, 0, 1, 0, 1, 4, 4, 1, 1, 1, 0,
+    1, 4, 3, 4, 4, 4, 1, 2, 0, 3, 0, 0, 1, 0, 0, 3, 3, 2, 1, 1, 4, 3, 4, 3, 4,
+    // 18
+    4, 3, 2, 4, 0, 1, 4, 3, 0, 0, 3, 0, 4, 3, 2, 4, 0, 3, 4, 4, 1, 4, 1, 4, 1,
+    1, 4, 4, 4, 2, 3, 2, 1, 0, 0, 1, 2, 1, 2, 4, 4, 4, 4, 2, 3, 3, 0, 0, 3, 0,
+    // 19
+    1, 3, 0, 3, 0, 2, 3, 0, 2, 2, 3, 3, 4, 0, 4, 3, 4, 4, 0, 3, 3, 2, 1, 3, 3,
+    3, 3, 0, 0, 0, 0, 3, 1, 4, 3, 1, 2, 3, 2, 0, 1, 0, 3, 2, 3, 1, 3, 2, 0, 3,
+    // 20
+    4, 0, 2, 0, 1, 3, 2, 3, 0, 4, 1, 2, 2, 0, 1, 0, 4, 4, 4, 3, 4, 2, 1, 1, 4,
+    3, 4, 1, 1, 3, 2, 2, 0, 3, 1, 3, 3, 3, 0, 3, 4, 4, 2, 3, 4, 2, 4, 2, 2, 2,
+    // 21
+    1, 3, 4, 2, 3, 4, 0, 2, 2, 0, 4, 4, 1, 1, 1, 3, 2, 3, 0, 3, 3, 3, 4, 4, 4,
+    4, 3, 4, 2, 4, 4, 4, 4, 2, 2, 4, 1, 1, 4, 1, 3, 1, 4, 2, 3, 4, 3, 2, 4, 2,
+    1, 0, 0, 4, 2, 1, 4, 0, 4, 1, 0, 2, 3, 2, 2, 0, 3, 3, 3, 0, 3, 3, 2, 2, 2,
+    3, 4, 2, 0, 0, 4, 4, 0, 2, 1, 2, 1, 0, 4, 0, 4, 3, 1, 2, 2, 4, 2, 0, 2, 4,
+    // 22
+    4, 1, 0, 2, 1, 4, 4, 1, 0, 4, 1, 0, 4, 1, 1, 1, 3, 2, 3, 1, 0, 1, 0, 3, 4,
+    1, 1, 1, 1, 1, 0, 3, 2, 1, 0, 1, 4, 0, 4, 4, 2, 3, 1, 4, 1, 2, 0, 2, 2, 4,
+    4, 3, 4, 4, 4, 1, 4, 3, 4, 1, 1, 0, 2, 0, 0, 2, 3, 3, 3, 3, 0, 3, 3, 2, 2,
+    3, 4, 0, 4, 1, 3, 1, 2, 0, 4, 2, 4, 4, 2, 0, 2, 1, 1, 1, 0, 3, 2, 2, 2, 4,
+    // 23
+    4, 2, 0, 3, 3, 3, 4, 4, 4, 3, 4, 0, 0, 2, 3, 1, 1, 0, 1, 3, 4, 3, 3, 2, 2,
+    2, 2, 3, 0, 3, 0, 0, 2, 1, 4, 1, 1, 1, 2, 2, 0, 2, 1, 1, 0, 3, 1, 3, 3, 0,
+    1, 4, 1, 3, 3, 4, 0, 2, 2, 4, 2, 1, 2, 2, 3, 0, 2, 0, 3, 1, 1, 4, 4, 4, 3,
+    3, 4, 0, 2, 0, 2, 0, 3, 0, 2, 1, 0, 1, 4, 2, 0, 0, 2, 2, 4, 3, 4, 3, 1, 1,
+    // 24
+    4, 4, 0, 4, 0, 0, 2, 1, 2, 0, 3, 2, 0, 4, 2, 0, 1, 1, 4, 1, 1, 2, 1, 1, 1,
+    1, 2, 1, 4, 1, 3, 0, 3, 1, 0, 4, 4, 2, 1, 2, 3, 2, 4, 4, 2, 2, 2, 4, 3, 1,
+    0, 1, 4, 0, 3, 3, 2, 0, 1, 3, 3, 3, 2, 1, 2, 4, 3, 0, 3, 2, 3, 3, 1, 2, 3,
+    3, 3, 0, 0, 1, 0, 1, 0, 4, 4, 0, 1, 0, 0, 0, 3, 3, 2, 3, 0, 4, 2, 3, 1, 4,
+    // 25
+    2, 0, 1, 4, 1, 2, 4, 2, 2, 2, 4, 4, 3, 1, 2, 4, 1, 4, 1, 3, 3, 0, 3, 2, 1,
+    1, 2, 0, 1, 2,
+    // 26
+    4, 4, 4, 3, 1, 4, 1, 1, 1, 4, 2, 2, 3, 2, 3, 0, 1, 0, 2, 0, 0, 3, 0, 3, 3,
+    1, 0, 3, 2, 3,
+    // 27
+    0, 1, 4, 3, 4, 1, 0, 0, 3, 3, 1, 3, 3, 4, 4, 1, 1, 2, 1, 1, 2, 2, 2, 2, 0,
+    0, 4, 3, 0, 3,
+    // 28
+    1, 4, 0, 0, 1, 3, 3, 1, 4, 1, 2, 3, 4, 2, 3, 4, 3, 0, 2, 3, 3, 2, 1, 0, 3,
+    3, 0, 0, 2, 4,
+    // 29
+    2, 1, 0, 2, 4, 2, 3, 2, 0, 2, 4, 0, 4, 2, 3, 3, 2, 1, 0, 2, 3, 3, 1, 1, 0,
+    1, 4, 3, 4, 3, 0, 4, 1, 0, 3, 2, 3, 4, 0, 4, 4, 3, 4, 2, 3, 4, 0, 3, 0, 2,
+    // 30
+    0, 1, 1, 3, 4, 0, 0, 4, 1, 3, 3, 1, 1, 3, 4, 0, 1, 4, 3, 4, 4, 4, 0, 0, 3,
+    1, 0, 4, 0, 4, 3, 0, 4, 3, 0, 1, 2, 2, 2, 1, 3, 2, 1, 2, 1, 2, 4, 3, 0, 2,
+    // 31
+    4, 0, 2, 4, 1, 1, 1, 2, 3, 1, 2, 1, 3, 0, 2, 4, 2, 1, 0, 0, 1, 2, 2, 1, 2,
+    3, 4, 1, 4, 0, 4, 0, 1, 4, 4, 4, 0, 4, 0, 2, 2, 4, 4, 2, 3, 4, 2, 0, 3, 2,
+    // 32
+    0, 4, 3, 4, 0, 1, 1, 0, 4, 1, 3, 3, 3, 0, 1, 2, 4, 1, 2, 0, 2, 1, 0, 3, 4,
+    0, 3, 0, 1, 4, 1, 3, 1, 1, 2, 3, 1, 1, 4, 3, 2, 4, 0, 0, 1, 4, 4, 1, 4, 3,
+    // 33
+    0, 4, 3, 3, 2, 4, 0, 2, 4, 3, 3, 1, 4, 4, 2, 0, 2, 2, 0, 0, 0, 2, 3, 4, 4,
+    4, 3, 2, 2, 2, 3, 1, 0, 1, 2, 4, 0, 2, 1, 0, 0, 1, 0, 0, 3, 0, 1, 3, 4, 1,
+    0, 0, 4, 2, 0, 1, 2, 2, 3, 1, 0, 3, 1, 0, 3, 3, 0, 3, 1, 0, 1, 1, 1, 1, 0,
+    4, 2, 4, 0, 3, 2, 2, 2, 1, 0, 4, 0, 0, 2, 2, 4, 3, 3, 0, 1, 2, 2, 0, 0, 3,
+    // 34
+    3, 1, 1, 1, 2, 1, 2, 3, 0, 4, 2, 3, 1, 0, 1, 0, 0, 1, 0, 1, 4, 4, 1, 0, 1,
+    1, 2, 2, 3, 4, 2, 3, 1, 0, 4, 4, 0, 4, 4, 3, 0, 4, 2, 2, 2, 0, 1, 1, 3, 1,
+    3, 3, 2, 2, 0, 2, 0, 2, 4, 4, 0, 3, 2, 3, 2, 4, 3, 1, 1, 1, 2, 1, 2, 0, 3,
+    3, 4, 1, 4, 3, 0, 4, 2, 1, 0, 4, 2, 4, 0, 2, 4, 3, 2, 4, 0, 2, 1, 2, 1, 1,
+    // 35
+    2, 0, 2, 3, 3, 2, 3, 2, 2, 1, 1, 0, 1, 0, 4, 4, 3, 3, 4, 1, 2, 1, 1, 1, 4,
+    4, 4, 1, 1, 2, 3, 0, 3, 2, 1, 0, 1, 2, 4, 4, 1, 1, 1, 2, 1, 4, 2, 2, 1, 0,
+    4, 2, 1, 3, 2, 2, 0, 4, 1, 0, 1, 3, 4, 2, 1, 4, 0, 1, 3, 1, 4, 3, 2, 2, 3,
+    2, 4, 3, 3, 4, 2, 0, 0, 2, 4, 4, 0, 4, 0, 3, 2, 2, 0, 4, 2, 0, 3, 2, 0, 3,
+    // 36
+    4, 0, 2, 3, 0, 4, 3, 1, 2, 3, 1, 0, 3, 1, 4, 1, 0, 1, 0, 0, 3, 2, 0, 4, 3,
+    3, 0, 4, 1, 4, 1, 1, 3, 1, 2, 3, 2, 4, 1, 2, 2, 3, 1, 2, 3, 2, 0, 0, 4, 3,
+    2, 2, 3, 1, 1, 0, 1, 1, 1, 0, 0, 4, 0, 1, 3, 2, 4, 1, 0, 1, 0, 0, 3, 1, 2,
+    3, 3, 0, 4, 3, 1, 4, 3, 3, 4, 0, 4, 0, 2, 1, 1, 1, 2, 2, 4, 0, 3, 3, 2, 4,
+};
+
+static const SequenceEntry SEQUENCE_LIBRARY_ENTRIES[] PROGMEM = {
+    // id, n-back, length, targets, offset, crc
+    {1, 1, 20, 5, 0, 0xE05E5ADEu},
+    {2, 1, 20, 5, 20, 0x1EC59F74u},
+    {3, 1, 20, 5, 40, 0x66B60D9Eu},
+    {4, 1, 20, 5, 60, 0x5A637F17u},
+    {5, 1, 30, 7, 80, 0x28C798A9u},
+    {6, 1, 30, 7, 110, 0x3BC5C69Du},
+    {7, 1, 30, 7, 140, 0xAD982E1Cu},
+    {8, 1, 30, 7, 170, 0x5B289729u},
+    {9, 2, 20, 5, 200, 0x299D2A9Eu},
+    {10, 2, 20, 5, 220, 0x702A973Eu},
+    {11, 2, 20, 5, 240, 0xD449306Cu},
+    {12, 2, 20, 5, 260, 0x0668FBD0u},
+    {13, 2, 30, 7, 280, 0x39563E46u},
+    {14, 2, 30, 7, 310, 0xD0406561u},
+    {15, 2, 30, 7, 340, 0xD7494D8Fu},
+    {16, 2, 30, 7, 370, 0xB54462F1u},
+    {17, 2, 50, 12, 400, 0x022EBD33u},
+    {18, 2, 50, 12, 450, 0x05CB47B0u},
+    {19, 2, 50, 12, 500, 0x5592AF66u},
+    {20, 2, 50, 12, 550, 0xAA1DC09Du},
+    {21, 2, 100, 25, 600, 0x9C92E8E2u},
+    {22, 2, 100, 25, 700, 0x5E67FCBDu},
+    {23, 2, 100, 25, 800, 0x22F116C1u},
+    {24, 2, 100, 25, 900, 0x6A0B03A5u},
+    {25, 3, 30, 7, 1000, 0x8FC16F8Bu},
+    {26, 3, 30, 7, 1030, 0xBD59D62Au},
+    {27, 3, 30, 7, 1060, 0x0AA04C68u},
+    {28, 3, 30, 7, 1090, 0x37E8A0DDu},
+    {29, 3, 50, 12, 1120, 0x32ABEC7Eu},
+    {30, 3, 50, 12, 1170, 0x64607E97u},
+    {31, 3, 50, 12, 1220, 0x0CF077C9u},
+    {32, 3, 50, 12, 1270, 0x37A64B43u},
+    {33, 3, 100, 24, 1320, 0x4DBCC171u},
+    {34, 3, 100, 24, 1420, 0x04BDEB5Du},
+    {35, 3, 100, 24, 1520, 0x4DF8980Fu},
+    {36, 3, 100, 24, 1620, 0xE32EA270u},
+};
+
+#endif // SEQUENCE_LIBRARY_DATA_H
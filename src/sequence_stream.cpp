@@ -0,0 +1,81 @@
+#include "sequence_stream.h"
+
+SequenceStream::SequenceStream()
+    : seed(0), state(0), generated(0), nBackLevel(1), targetPercent(SEQUENCE_TARGET_PERCENT)
+{
+    for (int i = 0; i < SEQUENCE_WINDOW; i++)
+    {
+        window[i] = 0;
+    }
+}
+
+void SequenceStream::begin(uint32_t seed, uint8_t nBackLevel, uint8_t targetPercent)
+{
+    this->seed = seed;
+    this->nBackLevel = nBackLevel;
+    this->targetPercent = targetPercent;
+    state = seed != 0 ? seed : 0x9E3779B9u; // xorshift never leaves 0
+    generated = 0;
+}
+
+bool SequenceStream::generateNext(uint32_t trial)
+{
+    if (generated > trial + SEQUENCE_LOOKAHEAD)
+    {
+        return false;
+    }
+
+    uint32_t i = generated;
+    uint8_t color;
+    if (i >= nBackLevel && below(100) < targetPercent)
+    {
+        color = colorAt(i - nBackLevel);
+    }
+    else
+    {
+        // Any color but the n-back one (and the lure n - 1 back)
+        uint8_t allowed[SEQUENCE_COLORS];
+        uint8_t count = 0;
+        for (uint8_t c = 0; c < SEQUENCE_COLORS; c++)
+        {
+            bool excluded = (i >= nBackLevel && c == colorAt(i - nBackLevel)) ||
+                            (nBackLevel >= 2 && i >= (uint32_t)nBackLevel - 1 && c == colorAt(i - nBackLevel + 1));
+            if (!excluded)
+            {
+                allowed[count++] = c;
+            }
+        }
+        color = allowed[below(count)];
+    }
+
+    window[i % SEQUENCE_WINDOW] = color;
+    generated++;
+    return true;
+}
+
+void SequenceStream::generateThrough(uint32_t trial)
+{
+    while (generated <= trial)
+    {
+        generateNext(trial);
+    }
+}
+
+bool SequenceStream::isTarget(uint32_t trial) const
+{
+    return trial >= nBackLevel && colorAt(trial) == colorAt(trial - nBackLevel);
+}
+
+uint32_t SequenceStream::nextRandom()
+{
+    // xorshift32: small state, same results on every platform
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+uint32_t SequenceStream::below(uint32_t bound)
+{
+    return (uint32_t)(((uint64_t)nextRandom() * bound) >> 32);
+}
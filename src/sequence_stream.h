@@ -0,0 +1,66 @@
+#ifndef SEQUENCE_STREAM_H
+#define SEQUENCE_STREAM_H
+
+#include <stdint.h>
+
+//==============================================================================
+// Sequence Stream
+//==============================================================================
+//
+// Generated color sequences, produced a few stimuli ahead of the trial being
+// shown instead of all at once, so a session is not limited by RAM and the
+// first trial does not wait for the whole sequence. Only a fixed window is
+// kept: the n stimuli the current one is compared with and a short lookahead.
+//
+// Each stimulus past the first n is a target with SEQUENCE_TARGET_PERCENT
+// probability and repeats the color n back; otherwise it avoids that color,
+// and for n >= 2 also the color n - 1 back (the most common lure). The
+// generator has its own seeded state and draws its random values in stimulus
+// order, whatever the timing, so the sequence depends only on the seed and
+// the n-back level and can be regenerated offline (nback-seqgen --stream).
+// No Arduino dependencies: the header also compiles on the host.
+
+#define SEQUENCE_GENERATOR_VERSION 1 // Logged with the seed; bump when the output changes
+#define SEQUENCE_WINDOW 32           // Stimuli kept
+#define SEQUENCE_LOOKAHEAD 8         // Stimuli generated ahead of the current trial
+#define SEQUENCE_MAX_NBACK (SEQUENCE_WINDOW - SEQUENCE_LOOKAHEAD - 1)
+#define SEQUENCE_TARGET_PERCENT 25
+#define SEQUENCE_COLORS 5 // COLORS_USED of the task
+
+class SequenceStream
+{
+public:
+    SequenceStream();
+
+    // Start a new sequence; `nBackLevel` at most SEQUENCE_MAX_NBACK
+    void begin(uint32_t seed, uint8_t nBackLevel, uint8_t targetPercent = SEQUENCE_TARGET_PERCENT);
+
+    // Generate one stimulus unless SEQUENCE_LOOKAHEAD already exist past
+    // `trial`; false when there was nothing to do
+    bool generateNext(uint32_t trial);
+
+    // Generate until `trial` exists
+    void generateThrough(uint32_t trial);
+
+    // Color of `trial`, 0-based; only the last SEQUENCE_WINDOW stimuli
+    // generated are available
+    uint8_t colorAt(uint32_t trial) const { return window[trial % SEQUENCE_WINDOW]; }
+    bool isTarget(uint32_t trial) const;
+
+    uint32_t getSeed() const { return seed; }
+    uint32_t getGenerated() const { return generated; } // Stimuli so far
+    uint32_t getState() const { return state; }         // Generator state after the last stimulus
+
+private:
+    uint32_t nextRandom();
+    uint32_t below(uint32_t bound);
+
+    uint8_t window[SEQUENCE_WINDOW];
+    uint32_t seed;
+    uint32_t state;
+    uint32_t generated;
+    uint8_t nBackLevel;
+    uint8_t targetPercent;
+};
+
+#endif // SEQUENCE_STREAM_H
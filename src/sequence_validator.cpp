@@ -0,0 +1,105 @@
+#include "sequence_validator.h"
+#include <stdio.h>
+
+SequenceValidator::SequenceValidator()
+{
+    begin(1);
+}
+
+void SequenceValidator::begin(uint8_t nBackLevel)
+{
+    this->nBackLevel = nBackLevel;
+    run = 0;
+    stats.trials = 0;
+    stats.scored = 0;
+    stats.targets = 0;
+    stats.lures = 0;
+    stats.longestRun = 0;
+    for (int i = 0; i < SEQUENCE_COLORS; i++)
+    {
+        stats.colorCounts[i] = 0;
+    }
+}
+
+void SequenceValidator::add(uint8_t color)
+{
+    uint16_t i = stats.trials;
+    if (color < SEQUENCE_COLORS)
+    {
+        stats.colorCounts[color]++;
+    }
+
+    // Runs of one color
+    run = (i > 0 && history[(i - 1) % SEQUENCE_WINDOW] == color) ? run + 1 : 1;
+    if (run > stats.longestRun)
+    {
+        stats.longestRun = run;
+    }
+
+    if (i >= nBackLevel)
+    {
+        stats.scored++;
+        if (history[(i - nBackLevel) % SEQUENCE_WINDOW] == color)
+        {
+            stats.targets++;
+        }
+        else if ((nBackLevel >= 2 && history[(i - nBackLevel + 1) % SEQUENCE_WINDOW] == color) ||
+                 (i >= nBackLevel + 1 && history[(i - nBackLevel - 1) % SEQUENCE_WINDOW] == color))
+        {
+            stats.lures++;
+        }
+    }
+
+    history[i % SEQUENCE_WINDOW] = color;
+    stats.trials++;
+}
+
+uint8_t SequenceValidator::check(const SequenceBounds &bounds) const
+{
+    uint8_t failed = 0;
+    uint8_t targetPercent = percent(stats.targets, stats.scored);
+    if (targetPercent < bounds.minTargetPercent || targetPercent > bounds.maxTargetPercent)
+    {
+        failed |= VALIDATION_TARGETS;
+    }
+    if (percent(stats.lures, stats.scored) > bounds.maxLurePercent)
+    {
+        failed |= VALIDATION_LURES;
+    }
+
+    uint16_t mostFrequent = 0;
+    for (int i = 0; i < SEQUENCE_COLORS; i++)
+    {
+        if (stats.colorCounts[i] > mostFrequent)
+        {
+            mostFrequent = stats.colorCounts[i];
+        }
+    }
+    if (percent(mostFrequent, stats.trials) > bounds.maxColorPercent)
+    {
+        failed |= VALIDATION_COLORS;
+    }
+    if (stats.longestRun > bounds.maxRun)
+    {
+        failed |= VALIDATION_RUN;
+    }
+    return failed;
+}
+
+uint8_t SequenceValidator::percent(uint16_t part, uint16_t whole)
+{
+    return whole > 0 ? (uint8_t)((uint32_t)part * 100 / whole) : 0;
+}
+
+void SequenceValidator::formatFailures(uint8_t failed, char *text, int size)
+{
+    static const char *const names[] = {"targets", "lures", "colors", "run"};
+    int used = snprintf(text, size, "%s", failed == 0 ? "passed" : "");
+    for (int i = 0; i < 4 && used < size; i++)
+    {
+        if (failed & (1 << i))
+        {
+            used += snprintf(text + used, size - used, "%s%s", used > 0 ? "+" : "", names[i]);
+        }
+    }
+}
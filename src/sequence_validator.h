@@ -0,0 +1,78 @@
+#ifndef SEQUENCE_VALIDATOR_H
+#define SEQUENCE_VALIDATOR_H
+
+#include <stdint.h>
+#include "sequence_stream.h"
+
+//==============================================================================
+// Sequence Validator
+//==============================================================================
+//
+// Statistics of a prepared color sequence, gathered in one pass as the
+// colors are added, and checked against bounds:
+//
+//   - target rate: n-back matches among the trials after the first n
+//   - lures: other trials that repeat the color n - 1 (from 2-back on) or
+//     n + 1 back, as a share of the same trials
+//   - color balance: share of the most frequent color
+//   - longest run of one color
+//
+// Only the last SEQUENCE_WINDOW colors are kept, so a generated sequence can
+// be checked from its stream without storing it. No Arduino dependencies:
+// the header also compiles on the host.
+
+// Failed checks, combined with |
+#define VALIDATION_TARGETS 0x01
+#define VALIDATION_LURES 0x02
+#define VALIDATION_COLORS 0x04
+#define VALIDATION_RUN 0x08
+
+struct SequenceBounds
+{
+    uint8_t minTargetPercent;
+    uint8_t maxTargetPercent;
+    uint8_t maxLurePercent;
+    uint8_t maxColorPercent;
+    uint8_t maxRun;
+};
+
+// Loose enough for what SequenceStream generates at 100 trials
+#define DEFAULT_SEQUENCE_BOUNDS {15, 35, 30, 35, 5}
+
+struct SequenceStats
+{
+    uint16_t trials;
+    uint16_t scored; // Trials after the first n
+    uint16_t targets;
+    uint16_t lures;
+    uint16_t colorCounts[SEQUENCE_COLORS];
+    uint16_t longestRun;
+};
+
+class SequenceValidator
+{
+public:
+    SequenceValidator();
+
+    void begin(uint8_t nBackLevel);
+    void add(uint8_t color);
+
+    const SequenceStats &getStats() const { return stats; }
+
+    // Failed checks (VALIDATION_*), 0 if the sequence is within `bounds`
+    uint8_t check(const SequenceBounds &bounds) const;
+
+    // Percent of `part` in `whole`, rounded down; 0 for an empty whole
+    static uint8_t percent(uint16_t part, uint16_t whole);
+
+    // Failed checks by name, joined with '+' ("targets+run"), or "passed"
+    static void formatFailures(uint8_t failed, char *text, int size);
+
+private:
+    uint8_t history[SEQUENCE_WINDOW];
+    uint8_t nBackLevel;
+    uint16_t run;
+    SequenceStats stats;
+};
+
+#endif // SEQUENCE_VALIDATOR_H
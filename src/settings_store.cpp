@@ -0,0 +1,134 @@
+#include "settings_store.h"
+#include "checksum.h"
+
+#if defined(ESP32) || defined(NBACK_HOST)
+#include <Preferences.h>
+#define SETTINGS_NVS 1
+#endif
+
+// NVS namespace and key of the single settings entry
+static const char *const SETTINGS_NAMESPACE = "nback";
+static const char *const SETTINGS_KEY = "settings";
+static const uint32_t SETTINGS_MAGIC = 0x534B424E; // "NBKS"
+
+// The entry as stored: header, settings, CRC-32 over both
+struct StoredSettings
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t size; // sizeof(DeviceSettings)
+    DeviceSettings settings;
+    uint32_t crc;
+};
+
+SettingsStore::SettingsStore() : status(SETTINGS_MISSING)
+{
+    memset(&current, 0, sizeof(current));
+}
+
+SettingsStatus SettingsStore::load(DeviceSettings &settings)
+{
+    current = settings;
+#ifdef SETTINGS_NVS
+    Preferences preferences;
+    StoredSettings stored;
+    preferences.begin(SETTINGS_NAMESPACE, true);
+    size_t length = preferences.getBytes(SETTINGS_KEY, &stored, sizeof(stored));
+    preferences.end();
+
+    if (length == 0)
+    {
+        // Also returned for an entry too large for this version's layout
+        bool present = preferences.begin(SETTINGS_NAMESPACE, true) && preferences.getBytesLength(SETTINGS_KEY) > 0;
+        preferences.end();
+        status = present ? SETTINGS_CORRUPT : SETTINGS_MISSING;
+    }
+    else if (length < sizeof(stored.magic) + sizeof(stored.version) || stored.magic != SETTINGS_MAGIC)
+    {
+        status = SETTINGS_CORRUPT;
+    }
+    else if (stored.version != SETTINGS_VERSION)
+    {
+        status = SETTINGS_OUTDATED;
+    }
+    else if (length != sizeof(stored) || stored.size != sizeof(DeviceSettings) ||
+             stored.crc != crc32(&stored, offsetof(StoredSettings, crc)))
+    {
+        status = SETTINGS_CORRUPT;
+    }
+    else
+    {
+        // Terminate the study ID whatever was stored
+        stored.settings.studyId[SETTINGS_STUDY_ID_SIZE - 1] = '\0';
+        settings = stored.settings;
+        current = settings;
+        status = SETTINGS_LOADED;
+    }
+#else
+    status = SETTINGS_UNSUPPORTED;
+#endif
+    return status;
+}
+
+bool SettingsStore::save(const DeviceSettings &settings)
+{
+    if (memcmp(&settings, &current, sizeof(current)) == 0)
+    {
+        return false;
+    }
+#ifdef SETTINGS_NVS
+    StoredSettings stored;
+    memset(&stored, 0, sizeof(stored));
+    stored.magic = SETTINGS_MAGIC;
+    stored.version = SETTINGS_VERSION;
+    stored.size = sizeof(DeviceSettings);
+    stored.settings = settings;
+    stored.crc = crc32(&stored, offsetof(StoredSettings, crc));
+
+    Preferences preferences;
+    preferences.begin(SETTINGS_NAMESPACE, false);
+    bool written = preferences.putBytes(SETTINGS_KEY, &stored, sizeof(stored)) == sizeof(stored);
+    preferences.end();
+    if (written)
+    {
+        current = settings;
+        status = SETTINGS_LOADED;
+    }
+    return written;
+#else
+    return false;
+#endif
+}
+
+bool SettingsStore::erase(const DeviceSettings &defaults)
+{
+    current = defaults;
+#ifdef SETTINGS_NVS
+    Preferences preferences;
+    preferences.begin(SETTINGS_NAMESPACE, false);
+    preferences.remove(SETTINGS_KEY);
+    preferences.end();
+    status = SETTINGS_MISSING;
+    return true;
+#else
+    return false;
+#endif
+}
+
+const __FlashStringHelper *SettingsStore::statusName(SettingsStatus status)
+{
+    switch (status)
+    {
+    case SETTINGS_LOADED:
+        return F("stored");
+    case SETTINGS_MISSING:
+        return F("defaults");
+    case SETTINGS_OUTDATED:
+        return F("defaults, stored settings outdated");
+    case SETTINGS_CORRUPT:
+        return F("defaults, stored settings corrupt");
+    case SETTINGS_UNSUPPORTED:
+    default:
+        return F("defaults, no NVS");
+    }
+}
@@ -0,0 +1,97 @@
+#ifndef SETTINGS_STORE_H
+#define SETTINGS_STORE_H
+
+#include <Arduino.h>
+#include "sequence_validator.h"
+
+//==============================================================================
+// Settings Store
+//==============================================================================
+//
+// Device settings kept across power cycles: the task configuration, LED
+// palette, touch thresholds, debounce times, sequence validation bounds,
+// idle sleep, the event markers, the trigger input, the response window and
+// the data stream. On the ESP32 they are one NVS entry (Preferences), read
+// once at boot and rewritten only when a setting changes. The host builds use
+// the file-backed stand-in in host/arduino. Boards without NVS always boot
+// with the defaults.
+
+#define SETTINGS_VERSION 8       // Bump when DeviceSettings changes layout
+#define SETTINGS_STUDY_ID_SIZE 10 // Study ID (9 characters) plus terminator
+#define SETTINGS_PALETTE_SIZE 6   // One entry per color, as NBackTask::colors
+#define SETTINGS_MARKER_CODES 4   // One per MarkerEvent
+
+// Everything that is stored; keep it free of pointers and zero it before
+// filling it in, so two equal settings compare equal byte for byte
+struct DeviceSettings
+{
+    // Task configuration (the config command)
+    uint16_t stimulusDuration;
+    uint16_t interStimulusInterval;
+    uint8_t nBackLevel;
+    uint8_t trialsNumber;
+    uint16_t sessionNumber;
+    uint16_t sequenceId; // Flash library sequence (0 = generated at start)
+    char studyId[SETTINGS_STUDY_ID_SIZE];
+
+    // Hardware
+    uint32_t palette[SETTINGS_PALETTE_SIZE]; // NeoPixel colors
+    int16_t touchThresholds[2];              // Correct, wrong
+    uint16_t debounceMs[2];                  // Correct, wrong
+
+    // Sequence validation (the validate command)
+    SequenceBounds validationBounds;
+    uint8_t validationStrict; // 1 = start refuses a sequence that fails
+
+    // Power (the sleep command)
+    uint8_t idleSleep; // 1 = light sleep while idle (idle_sleep.h)
+
+    // TTL event markers (the marker command, event_markers.h)
+    uint8_t markers; // 1 = on
+    uint8_t markerWidthMs;
+    uint8_t markerCodes[SETTINGS_MARKER_CODES];
+
+    // External trigger (the trigger command, trigger_input.h)
+    uint8_t triggerMode; // TriggerMode
+
+    // Response window (the window command)
+    uint16_t responseWindowMs; // SELF_PACED_WINDOW or a timed window
+
+    // Data stream (the stream command, data_collector.h)
+    uint8_t dataStream; // 1 = send each block in the background
+};
+
+enum SettingsStatus
+{
+    SETTINGS_LOADED,     // Stored settings in effect
+    SETTINGS_MISSING,    // Nothing stored yet
+    SETTINGS_OUTDATED,   // Stored by another SETTINGS_VERSION
+    SETTINGS_CORRUPT,    // Wrong size or checksum
+    SETTINGS_UNSUPPORTED // No NVS on this board
+};
+
+class SettingsStore
+{
+public:
+    SettingsStore();
+
+    // Read the stored settings into `settings` in one NVS read. Anything
+    // but SETTINGS_LOADED leaves `settings` (the defaults) unchanged.
+    SettingsStatus load(DeviceSettings &settings);
+
+    // Store `settings` unless they equal what the device would boot with;
+    // true if NVS was written
+    bool save(const DeviceSettings &settings);
+
+    // Remove the stored settings; the device boots with `defaults` again
+    bool erase(const DeviceSettings &defaults);
+
+    SettingsStatus getStatus() const { return status; }
+    static const __FlashStringHelper *statusName(SettingsStatus status);
+
+private:
+    DeviceSettings current; // What the device boots with next
+    SettingsStatus status;
+};
+
+#endif // SETTINGS_STORE_H
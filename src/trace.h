@@ -0,0 +1,30 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+//==============================================================================
+// Trace Points
+//==============================================================================
+//
+// Marks the stages of a trial for the host benchmarks. On the device the
+// macro compiles to nothing; the host runtime timestamps each point on its
+// virtual clock.
+
+enum TracePoint
+{
+    TRACE_TRIAL_ONSET,           // Trial started (stimulus onset timestamp taken)
+    TRACE_RESPONSE_CAPTURED,     // Button/touch press accepted for the trial
+    TRACE_EVALUATE_BEGIN,        // evaluateTrialOutcome() entered
+    TRACE_EVALUATE_END,          // evaluateTrialOutcome() finished
+    TRACE_EVENT_SERIALIZE_BEGIN, // sendRealTimeEvent() entered
+    TRACE_EVENT_SERIALIZE_END,   // sendRealTimeEvent() handed the last byte to Serial
+    TRACE_DEFERRED_DONE          // The last deferred job of the trial finished
+};
+
+#if defined(NBACK_HOST)
+void hostTrace(TracePoint point);
+#define NBACK_TRACE(point) hostTrace(point)
+#else
+#define NBACK_TRACE(point) ((void)0)
+#endif
+
+#endif // TRACE_H
@@ -0,0 +1,47 @@
+#ifndef TRIAL_OUTCOME_H
+#define TRIAL_OUTCOME_H
+
+//==============================================================================
+// Trial Outcome
+//==============================================================================
+//
+// How a finished trial is scored. The firmware scores every trial with this
+// and the host analytics score recorded trials with it, so both always agree.
+// No Arduino dependencies: the header also compiles on the host.
+
+enum TrialOutcome
+{
+    OUTCOME_NO_RESPONSE,       // Nothing pressed (counted as a missed target)
+    OUTCOME_HIT,               // Target trial, confirm pressed
+    OUTCOME_MISS,              // Target trial, the other input pressed
+    OUTCOME_FALSE_ALARM,       // Non-target trial, confirm pressed
+    OUTCOME_CORRECT_REJECTION, // Non-target trial, the other input pressed
+    OUTCOME_UNSCORED,          // Target flagged before n trials were shown
+    TRIAL_OUTCOME_COUNT
+};
+
+// `trialIndex` is 0-based; `responseIsConfirm` is ignored without a response
+inline TrialOutcome classifyTrial(bool responded, bool isTarget, bool responseIsConfirm, int trialIndex,
+                                  int nBackLevel)
+{
+    if (!responded)
+    {
+        return OUTCOME_NO_RESPONSE;
+    }
+    if (isTarget)
+    {
+        if (trialIndex < nBackLevel)
+        {
+            return OUTCOME_UNSCORED;
+        }
+        return responseIsConfirm ? OUTCOME_HIT : OUTCOME_MISS;
+    }
+    return responseIsConfirm ? OUTCOME_FALSE_ALARM : OUTCOME_CORRECT_REJECTION;
+}
+
+inline bool outcomeIsCorrect(TrialOutcome outcome)
+{
+    return outcome == OUTCOME_HIT || outcome == OUTCOME_CORRECT_REJECTION;
+}
+
+#endif // TRIAL_OUTCOME_H
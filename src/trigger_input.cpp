@@ -0,0 +1,135 @@
+#include "trigger_input.h"
+
+TriggerInput::TriggerInput()
+    : mode(TRIGGER_OFF),
+      head(0),
+      lastEdgeUs(0),
+      ignored(0),
+      tail(0),
+      overflows(0)
+{
+}
+
+bool TriggerInput::available()
+{
+#if defined(TRIGGER_INPUT_AVAILABLE)
+    return true;
+#else
+    return false;
+#endif
+}
+
+void TriggerInput::setMode(TriggerMode mode)
+{
+#if defined(TRIGGER_INPUT_AVAILABLE)
+    if (mode != TRIGGER_OFF && this->mode == TRIGGER_OFF)
+    {
+        pinMode(TRIGGER_PIN, INPUT_PULLDOWN);
+        attachInterruptArg(digitalPinToInterrupt(TRIGGER_PIN), &TriggerInput::onEdge, this, RISING);
+    }
+    else if (mode == TRIGGER_OFF && this->mode != TRIGGER_OFF)
+    {
+        detachInterrupt(digitalPinToInterrupt(TRIGGER_PIN));
+    }
+    this->mode = mode;
+    discard();
+#else
+    (void)mode;
+#endif
+}
+
+#if defined(TRIGGER_INPUT_AVAILABLE)
+void IRAM_ATTR TriggerInput::onEdge(void *arg)
+{
+    // Runs in interrupt context: stamp the edge and nothing else
+    TriggerInput *input = static_cast<TriggerInput *>(arg);
+    unsigned long now = micros();
+    if (input->head != 0 && now - input->lastEdgeUs < TRIGGER_HOLDOFF_US)
+    {
+        input->ignored = input->ignored + 1;
+        return;
+    }
+    input->lastEdgeUs = now;
+    input->edges[input->head % TRIGGER_QUEUE_SIZE] = now;
+    input->head = input->head + 1; // After the edge: take() reads up to head
+}
+#endif
+
+bool TriggerInput::take(unsigned long &edgeUs)
+{
+    uint32_t seen = head;
+    if (seen - tail > TRIGGER_QUEUE_SIZE)
+    {
+        // The oldest edges were overwritten
+        overflows += seen - tail - TRIGGER_QUEUE_SIZE;
+        tail = seen - TRIGGER_QUEUE_SIZE;
+    }
+    if (tail == seen)
+    {
+        return false;
+    }
+    edgeUs = edges[tail % TRIGGER_QUEUE_SIZE];
+    tail++;
+    return true;
+}
+
+bool TriggerInput::waitFor(unsigned long timeoutUs, unsigned long &edgeUs)
+{
+    unsigned long start = micros();
+    while (!take(edgeUs))
+    {
+        if (micros() - start >= timeoutUs)
+        {
+            return false;
+        }
+        delayMicroseconds(1);
+    }
+    return true;
+}
+
+uint32_t TriggerInput::discard()
+{
+    uint32_t count = 0;
+    unsigned long edgeUs;
+    while (take(edgeUs))
+    {
+        count++;
+    }
+    return count;
+}
+
+void TriggerInput::printStatus() const
+{
+    if (!available())
+    {
+        Serial.println(F("The trigger input is not available on this board"));
+        return;
+    }
+
+    Serial.print(F("Trigger: "));
+    Serial.print(modeName(mode));
+    Serial.print(F(", rising edge on GPIO "));
+    Serial.println(TRIGGER_PIN);
+    Serial.print(F("Pulses: "));
+    Serial.print(head);
+    Serial.print(F(" ("));
+    Serial.print(ignored);
+    Serial.print(F(" ignored within "));
+    Serial.print(TRIGGER_HOLDOFF_US / 1000);
+    Serial.print(F(" ms, "));
+    Serial.print(overflows);
+    Serial.println(F(" lost to a full queue)"));
+}
+
+const __FlashStringHelper *TriggerInput::modeName(TriggerMode mode)
+{
+    switch (mode)
+    {
+    case TRIGGER_START:
+        return F("start");
+    case TRIGGER_PACE:
+        return F("pace");
+    default:
+        return F("off");
+    }
+}
@@ -0,0 +1,73 @@
+#ifndef TRIGGER_INPUT_H
+#define TRIGGER_INPUT_H
+
+#include <Arduino.h>
+
+#if defined(ESP32) || defined(NBACK_HOST)
+#define TRIGGER_INPUT_AVAILABLE
+#endif
+
+//==============================================================================
+// Trigger Input
+//==============================================================================
+//
+// External trigger pulses (scanner TR pulses, a headset's scene-ready signal)
+// on one GPIO. An interrupt on the rising edge stamps each pulse with micros()
+// into a small queue, so an edge is timed to the microsecond whatever loop()
+// is doing; the task takes the edges from the queue. While the task waits for
+// a pulse it busy-waits on the queue for up to TRIGGER_SPIN_US per loop pass,
+// which is what keeps the trigger-to-onset latency in the low microseconds.
+// Edges within TRIGGER_HOLDOFF_US of the previous one are ringing on the
+// cable and ignored. Boards without GPIO interrupts have no trigger input.
+
+#define TRIGGER_PIN 27            // Rising edge, internal pull-down; 3.3 V logic (5 V TTL needs a divider)
+#define TRIGGER_QUEUE_SIZE 8      // Edges not taken yet; must be a power of two
+#define TRIGGER_HOLDOFF_US 2000   // Ignore edges this soon after the last one
+#define TRIGGER_SPIN_US 20000     // Longest busy-wait for a pulse per loop pass
+
+enum TriggerMode
+{
+    TRIGGER_OFF,   // 'start' starts the session at once
+    TRIGGER_START, // The first onset waits for a pulse, then the session runs on its own clock
+    TRIGGER_PACE   // Every onset waits for the next pulse after the interval
+};
+
+class TriggerInput
+{
+public:
+    TriggerInput();
+
+    // The board has GPIO interrupts
+    static bool available();
+
+    // The interrupt is attached while the mode is not TRIGGER_OFF
+    void setMode(TriggerMode mode);
+    TriggerMode getMode() const { return mode; }
+
+    // Take the oldest edge not taken yet (micros() at the edge); false if none
+    bool take(unsigned long &edgeUs);
+
+    // Busy-wait up to `timeoutUs` for an edge and take it
+    bool waitFor(unsigned long timeoutUs, unsigned long &edgeUs);
+
+    // Drop the edges not taken yet; returns how many there were
+    uint32_t discard();
+
+    // The 'trigger' command
+    void printStatus() const;
+
+    static const __FlashStringHelper *modeName(TriggerMode mode);
+
+private:
+    static void onEdge(void *arg);
+
+    TriggerMode mode;
+    volatile unsigned long edges[TRIGGER_QUEUE_SIZE]; // Written by onEdge() only
+    volatile uint32_t head;                           // Edges seen, written by onEdge() only
+    volatile unsigned long lastEdgeUs;                // For the holdoff, onEdge() only
+    volatile uint32_t ignored;                        // Within the holdoff
+    uint32_t tail;                                    // Edges taken or dropped
+    uint32_t overflows;                               // Lost: the queue was full
+};
+
+#endif // TRIGGER_INPUT_H
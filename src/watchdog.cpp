@@ -0,0 +1,295 @@
+#include "watchdog.h"
+#include "nback_task.h"
+
+#if defined(ESP32)
+#include <esp_system.h>
+#include <esp_task_wdt.h>
+#include <esp_timer.h>
+#define BREADCRUMB_STORAGE RTC_NOINIT_ATTR // Not cleared by a reset
+#else
+#define BREADCRUMB_STORAGE
+#endif
+
+#define BREADCRUMB_MAGIC 0x4E42434Bu // "NBCK"
+
+static BREADCRUMB_STORAGE Breadcrumbs breadcrumbs;
+
+Watchdog::Watchdog()
+    : previousValid(false),
+      resetReason(RESET_POWER_ON),
+      passStartUs(0),
+      passStallMs(0),
+      passStallPhase(PHASE_IDLE),
+      suspended(false)
+{
+    memset(&previous, 0, sizeof(previous));
+}
+
+void Watchdog::begin()
+{
+    // After power-on the RTC memory holds noise; both magics must match
+    previousValid = breadcrumbs.magic == BREADCRUMB_MAGIC && breadcrumbs.endMagic == ~BREADCRUMB_MAGIC;
+    if (previousValid)
+    {
+        previous = breadcrumbs;
+        previous.lastCommand[BREADCRUMB_COMMAND_SIZE - 1] = '\0';
+    }
+
+#if defined(ESP32)
+    switch (esp_reset_reason())
+    {
+    case ESP_RST_POWERON:
+        resetReason = RESET_POWER_ON;
+        break;
+    case ESP_RST_SW:
+        resetReason = RESET_SOFTWARE;
+        break;
+    case ESP_RST_PANIC:
+        resetReason = RESET_PANIC;
+        break;
+    case ESP_RST_INT_WDT:
+    case ESP_RST_TASK_WDT:
+    case ESP_RST_WDT:
+        resetReason = RESET_WATCHDOG;
+        break;
+    case ESP_RST_BROWNOUT:
+        resetReason = RESET_BROWNOUT;
+        break;
+    default:
+        resetReason = RESET_OTHER;
+        break;
+    }
+    if (resetReason == RESET_POWER_ON)
+    {
+        previousValid = false;
+    }
+#endif
+
+    memset(&breadcrumbs, 0, sizeof(breadcrumbs));
+    breadcrumbs.magic = BREADCRUMB_MAGIC;
+    breadcrumbs.boots = previousValid ? previous.boots + 1 : 1;
+    breadcrumbs.phase = PHASE_IDLE;
+    breadcrumbs.endMagic = ~BREADCRUMB_MAGIC;
+
+#if defined(ESP32)
+    // Reconfigures the watchdog the core already runs, then watches loop()
+    esp_task_wdt_init(WATCHDOG_TIMEOUT_MS / 1000, true);
+    esp_task_wdt_add(NULL);
+
+    // Runs in the esp_timer task, which a hung loop() does not hold up
+    esp_timer_create_args_t args = {};
+    args.callback = &Watchdog::refreshUptime;
+    args.dispatch_method = ESP_TIMER_TASK;
+    args.name = "breadcrumbs";
+    esp_timer_handle_t timer = nullptr;
+    if (esp_timer_create(&args, &timer) == ESP_OK)
+    {
+        esp_timer_start_periodic(timer, (uint64_t)BREADCRUMB_UPTIME_MS * 1000);
+    }
+#endif
+    passStartUs = micros();
+    breadcrumbs.phaseStartMs = millis();
+}
+
+void Watchdog::closePhase(unsigned long now)
+{
+    // A phase that ran over its threshold is this pass's stall if the longest
+    uint32_t duration = now - breadcrumbs.phaseStartMs;
+    uint32_t threshold = 0;
+    switch (breadcrumbs.phase)
+    {
+    case PHASE_SERIAL_READ:
+        threshold = STALL_SERIAL_READ_MS;
+        break;
+    case PHASE_COMMAND:
+        threshold = STALL_COMMAND_MS;
+        break;
+    case PHASE_TASK:
+        threshold = STALL_TASK_MS;
+        break;
+    default:
+        return;
+    }
+    if (!suspended && duration > threshold && duration > passStallMs)
+    {
+        passStallMs = duration;
+        passStallPhase = breadcrumbs.phase;
+    }
+}
+
+void Watchdog::enterPhase(LoopPhase phase)
+{
+    unsigned long now = millis();
+    closePhase(now);
+    breadcrumbs.phase = phase;
+    breadcrumbs.phaseStartMs = now;
+    breadcrumbs.uptimeMs = now;
+}
+
+void Watchdog::refreshUptime(void *arg)
+{
+    (void)arg;
+    breadcrumbs.uptimeMs = millis();
+}
+
+void Watchdog::noteCommand(const String &command)
+{
+    strncpy(breadcrumbs.lastCommand, command.c_str(), BREADCRUMB_COMMAND_SIZE - 1);
+    breadcrumbs.lastCommand[BREADCRUMB_COMMAND_SIZE - 1] = '\0';
+}
+
+void Watchdog::setTaskState(uint8_t state, int trial)
+{
+    breadcrumbs.taskState = state;
+    breadcrumbs.trial = trial;
+}
+
+uint32_t Watchdog::endPass(LoopPhase &stalledPhase)
+{
+    enterPhase(PHASE_IDLE);
+
+    unsigned long nowUs = micros();
+    uint32_t passUs = nowUs - passStartUs;
+    if (passUs > breadcrumbs.maxPassUs)
+    {
+        breadcrumbs.maxPassUs = passUs;
+    }
+    breadcrumbs.lastPassMs = breadcrumbs.phaseStartMs; // The idle phase starts with the end of the pass
+    passStartUs = nowUs;
+
+#if defined(ESP32)
+    if (!suspended)
+    {
+        esp_task_wdt_reset();
+    }
+#endif
+
+    uint32_t stallMs = passStallMs;
+    stalledPhase = (LoopPhase)passStallPhase;
+    passStallMs = 0;
+    return stallMs;
+}
+
+void Watchdog::suspend()
+{
+    suspended = true;
+#if defined(ESP32)
+    esp_task_wdt_delete(NULL);
+#endif
+}
+
+void Watchdog::resume()
+{
+#if defined(ESP32)
+    esp_task_wdt_add(NULL);
+#endif
+    suspended = false;
+    breadcrumbs.phaseStartMs = millis(); // The suspended time is no stall
+}
+
+bool Watchdog::crashed() const
+{
+    return resetReason == RESET_PANIC || resetReason == RESET_WATCHDOG || resetReason == RESET_BROWNOUT;
+}
+
+void Watchdog::printCrashInfo() const
+{
+    Serial.print(F("Last reset: "));
+    Serial.println(resetReasonName(resetReason));
+    Serial.print(F("Boots since power-on: "));
+    Serial.println(breadcrumbs.boots);
+    if (!previousValid)
+    {
+        Serial.println(F("No breadcrumbs from the previous boot"));
+        return;
+    }
+
+    Serial.println(F("Breadcrumbs from the previous boot:"));
+    Serial.print(F("  Uptime: "));
+    Serial.print(previous.uptimeMs);
+    Serial.println(F(" ms"));
+    // A watchdog reset means the phase ran for the whole timeout, even if the
+    // uptime refresh could not run to record it
+    uint32_t phaseMs = previous.uptimeMs - previous.phaseStartMs;
+    Serial.print(F("  Phase: "));
+    Serial.print(phaseName(previous.phase));
+    Serial.print(F(" for "));
+    if (resetReason == RESET_WATCHDOG && phaseMs < WATCHDOG_TIMEOUT_MS)
+    {
+        Serial.print(F("at least "));
+        phaseMs = WATCHDOG_TIMEOUT_MS;
+    }
+    Serial.print(phaseMs);
+    Serial.println(F(" ms"));
+    Serial.print(F("  Task: "));
+    switch (previous.taskState)
+    {
+    case STATE_IDLE:
+        Serial.print(F("idle"));
+        break;
+    case STATE_RUNNING:
+        Serial.print(F("running"));
+        break;
+    case STATE_PAUSED:
+        Serial.print(F("paused"));
+        break;
+    case STATE_DEBUG:
+        Serial.print(F("debug"));
+        break;
+    case STATE_DATA_READY:
+        Serial.print(F("data ready"));
+        break;
+    case STATE_INPUT_MODE:
+        Serial.print(F("input mode"));
+        break;
+    default:
+        Serial.print(previous.taskState);
+        break;
+    }
+    Serial.print(F(", trial "));
+    Serial.println(previous.trial + 1);
+    Serial.print(F("  Last command: "));
+    Serial.println(previous.lastCommand);
+    Serial.print(F("  Last loop pass ended at: "));
+    Serial.print(previous.lastPassMs);
+    Serial.println(F(" ms"));
+    Serial.print(F("  Longest loop pass: "));
+    Serial.print(previous.maxPassUs);
+    Serial.println(F(" us"));
+}
+
+const __FlashStringHelper *Watchdog::phaseName(uint8_t phase)
+{
+    switch (phase)
+    {
+    case PHASE_IDLE:
+        return F("idle");
+    case PHASE_SERIAL_READ:
+        return F("serial read");
+    case PHASE_COMMAND:
+        return F("command");
+    case PHASE_TASK:
+        return F("task");
+    default:
+        return F("unknown");
+    }
+}
+
+const __FlashStringHelper *Watchdog::resetReasonName(ResetReason reason)
+{
+    switch (reason)
+    {
+    case RESET_POWER_ON:
+        return F("power-on");
+    case RESET_SOFTWARE:
+        return F("software");
+    case RESET_PANIC:
+        return F("panic");
+    case RESET_WATCHDOG:
+        return F("watchdog");
+    case RESET_BROWNOUT:
+        return F("brownout");
+    default:
+        return F("other");
+    }
+}
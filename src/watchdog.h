@@ -0,0 +1,113 @@
+#ifndef WATCHDOG_H
+#define WATCHDOG_H
+
+#include <Arduino.h>
+
+//==============================================================================
+// Watchdog
+//==============================================================================
+//
+// Resets the board when loop() stops making progress, and leaves breadcrumbs
+// of where it was. On the ESP32 the task watchdog watches the loop task and
+// is fed only at the end of a complete loop pass; the breadcrumbs (phase,
+// task state, trial, last command, loop timing) live in RTC memory that is
+// not cleared by a reset, so the next boot can report them ('crashinfo').
+// A periodic esp_timer keeps their uptime current while loop() hangs, so a
+// hung phase is reported with how long it ran.
+// Phases that take longer than their stall threshold without a reset are
+// reported by endPass(). Other boards have no watchdog and no breadcrumbs
+// survive a reset; stall detection works everywhere.
+
+#define WATCHDOG_TIMEOUT_MS 30000 // Reset after this long without a finished loop pass
+#define BREADCRUMB_UPTIME_MS 100  // Breadcrumb uptime refresh, independent of loop()
+
+// Stall thresholds per phase; command output alone can take seconds at
+// 9600 baud (get_data of 100 trials about 9 s)
+#define STALL_SERIAL_READ_MS 250
+#define STALL_TASK_MS 1000
+#define STALL_COMMAND_MS 15000
+
+#define BREADCRUMB_COMMAND_SIZE 16
+
+// Where loop() is
+enum LoopPhase
+{
+    PHASE_IDLE,        // Between passes
+    PHASE_SERIAL_READ, // Reading a command line
+    PHASE_COMMAND,     // Handling it
+    PHASE_TASK,        // NBackTask::loop()
+    PHASE_COUNT
+};
+
+enum ResetReason
+{
+    RESET_POWER_ON,
+    RESET_SOFTWARE,
+    RESET_PANIC,
+    RESET_WATCHDOG,
+    RESET_BROWNOUT,
+    RESET_OTHER
+};
+
+struct Breadcrumbs
+{
+    uint32_t magic;        // BREADCRUMB_MAGIC once written
+    uint32_t boots;        // Since power-on
+    uint32_t uptimeMs;     // At the last update or uptime refresh
+    uint32_t phaseStartMs; // When `phase` was entered
+    uint32_t lastPassMs;   // When the last loop pass finished
+    uint32_t maxPassUs;    // Longest loop pass
+    uint16_t trial;        // 0-based
+    uint8_t phase;         // LoopPhase
+    uint8_t taskState;     // TaskState of nback_task.h
+    char lastCommand[BREADCRUMB_COMMAND_SIZE];
+    uint32_t endMagic;     // ~BREADCRUMB_MAGIC: the whole record was written
+};
+
+class Watchdog
+{
+public:
+    Watchdog();
+
+    // Keep the previous boot's breadcrumbs and arm the watchdog
+    void begin();
+
+    // Progress markers for the breadcrumbs and stall detection
+    void enterPhase(LoopPhase phase);
+    void noteCommand(const String &command);
+    void setTaskState(uint8_t state, int trial);
+
+    // End of a loop pass: feeds the watchdog. Returns the longest stall of
+    // the pass in ms (0 if none) and its phase.
+    uint32_t endPass(LoopPhase &stalledPhase);
+
+    // Time spent after endPass() that is not part of the next pass (idle sleep)
+    void excludeFromPass(unsigned long us) { passStartUs += us; }
+
+    // For code that legitimately runs its own loop (the interactive touch
+    // debugger): no watchdog and no stall until resume()
+    void suspend();
+    void resume();
+
+    // The last reset was a crash (panic, watchdog or brownout)
+    bool crashed() const;
+    ResetReason getResetReason() const { return resetReason; }
+    void printCrashInfo() const;
+
+    static const __FlashStringHelper *phaseName(uint8_t phase);
+    static const __FlashStringHelper *resetReasonName(ResetReason reason);
+
+private:
+    void closePhase(unsigned long now);
+    static void refreshUptime(void *arg);
+
+    Breadcrumbs previous;  // Of the boot before this one
+    bool previousValid;
+    ResetReason resetReason;
+    unsigned long passStartUs;
+    uint32_t passStallMs;
+    uint8_t passStallPhase;
+    bool suspended;
+};
+
+#endif // WATCHDOG_H